@@ -0,0 +1,805 @@
+// File:    arith_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains the arithmetic expansion evaluator. A recursive
+//          descent parser compiles an expression into a postfix program of
+//          stack operations, with jumps for the short-circuit and conditional
+//          operators. Programs are kept in a direct-mapped cache keyed by the
+//          expression text, so evaluating one again only runs its program.
+
+#define _GNU_SOURCE
+
+#include "arith_utils.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache_utils.h"
+#include "var_utils.h"
+
+// Program operations.
+enum arith_code_t {
+    ARITH_PUSH,
+    ARITH_LOAD,
+    ARITH_STORE,
+    ARITH_JUMP,
+    ARITH_JUMP_ZERO,
+    ARITH_BOOL,
+    ARITH_NEGATE,
+    ARITH_NOT,
+    ARITH_COMPLEMENT,
+    ARITH_ADD,
+    ARITH_SUBTRACT,
+    ARITH_MULTIPLY,
+    ARITH_DIVIDE,
+    ARITH_MODULO,
+    ARITH_POWER,
+    ARITH_SHIFT_LEFT,
+    ARITH_SHIFT_RIGHT,
+    ARITH_LESS,
+    ARITH_LESS_EQUAL,
+    ARITH_GREATER,
+    ARITH_GREATER_EQUAL,
+    ARITH_EQUAL,
+    ARITH_NOT_EQUAL,
+    ARITH_BIT_AND,
+    ARITH_BIT_XOR,
+    ARITH_BIT_OR
+};
+
+// Struct holding an integer or floating-point number.
+struct arith_value_t {
+    int is_float;
+    long long integer;
+    double real;
+};
+
+// Struct holding one operation.
+//   code:    What it does.
+//   operand: The variable for loads and stores, or the target of jumps.
+//   value:   The number pushed.
+struct arith_op_t {
+    enum arith_code_t code;
+    size_t operand;
+    struct arith_value_t value;
+};
+
+// Struct holding a compiled expression.
+//   hash:       Hash of the expression, for the cache.
+//   expression: The expression text.
+//   ops:        The postfix program.
+//   names:      The variables it loads and stores.
+//   stack:      Scratch space for evaluation, one value per operation.
+struct arith_program_t {
+    uint64_t hash;
+    char* expression;
+    struct arith_op_t* ops;
+    size_t num_ops;
+    size_t ops_capacity;
+    char** names;
+    size_t num_names;
+    struct arith_value_t* stack;
+};
+
+// Struct holding the state of the compiler.
+//   text:     The expression.
+//   position: The next character to read.
+//   program:  The program being written.
+//   failed:   Whether a syntax error or allocation failure occurred.
+//   peeked:   The operator found at peeked_at, since every precedence level
+//             looks at the same position in turn.
+struct arith_parser_t {
+    const char* text;
+    size_t position;
+    struct arith_program_t* program;
+    int failed;
+    size_t peeked_at;
+    const char* peeked;
+};
+
+// Binary operators by precedence, lowest first, excluding "&&", "||" and
+// "**", which compile differently.
+struct arith_operator_t {
+    const char* text;
+    enum arith_code_t code;
+    int level;
+};
+
+static const struct arith_operator_t binary_operators[] = {
+    {"|", ARITH_BIT_OR, 0},       {"^", ARITH_BIT_XOR, 1},
+    {"&", ARITH_BIT_AND, 2},      {"==", ARITH_EQUAL, 3},
+    {"!=", ARITH_NOT_EQUAL, 3},   {"<", ARITH_LESS, 4},
+    {"<=", ARITH_LESS_EQUAL, 4},  {">", ARITH_GREATER, 4},
+    {">=", ARITH_GREATER_EQUAL, 4}, {"<<", ARITH_SHIFT_LEFT, 5},
+    {">>", ARITH_SHIFT_RIGHT, 5}, {"+", ARITH_ADD, 6},
+    {"-", ARITH_SUBTRACT, 6},     {"*", ARITH_MULTIPLY, 7},
+    {"/", ARITH_DIVIDE, 7},       {"%", ARITH_MODULO, 7},
+};
+#define BINARY_LEVELS 8
+
+// Every operator, longest first, so the longest one at a position is found.
+static const char* const operators[] = {
+    "**", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||", "+=", "-=", "*=",
+    "/=", "%=", "++", "--", "+",  "-",  "*",  "/",  "%",  "<",  ">",  "&",
+    "|",  "^",  "!",  "~",  "?",  ":",  "=",  "(",  ")"};
+
+static struct arith_program_t* cache[ARITH_CACHE_SIZE];
+
+static int parse_assignment(struct arith_parser_t* parser);
+
+// 64-bit FNV-1a hash of an expression.
+static uint64_t hash_expression(const char* text, size_t length) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (unsigned char)text[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static void free_program(struct arith_program_t* program) {
+  if (program == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < program->num_names; i++) {
+    free(program->names[i]);
+  }
+  free(program->names);
+  free(program->ops);
+  free(program->stack);
+  free(program->expression);
+  free(program);
+}
+
+#pragma region Compiler
+
+static void skip_spaces(struct arith_parser_t* parser) {
+  while (isspace((unsigned char)parser->text[parser->position])) {
+    parser->position++;
+  }
+}
+
+// Returns the operator at the current position, or NULL if there is none.
+static const char* peek_operator(struct arith_parser_t* parser) {
+  skip_spaces(parser);
+  if (parser->peeked_at == parser->position) {
+    return parser->peeked;
+  }
+  const char* text = parser->text + parser->position;
+  parser->peeked_at = parser->position;
+  parser->peeked = NULL;
+  for (size_t i = 0; text[0] != '\0' && i < sizeof(operators) /
+                                               sizeof(operators[0]);
+       i++) {
+    if (text[0] == operators[i][0] &&
+        (operators[i][1] == '\0' || text[1] == operators[i][1])) {
+      parser->peeked = operators[i];
+      break;
+    }
+  }
+  return parser->peeked;
+}
+
+// Consumes an operator if it is the one at the current position.
+static int accept_operator(struct arith_parser_t* parser, const char* op) {
+  const char* next = peek_operator(parser);
+  if (next == NULL || strcmp(next, op) != 0) {
+    return 0;
+  }
+  parser->position += strlen(op);
+  return 1;
+}
+
+// Appends an operation. Returns its index.
+static size_t emit(struct arith_parser_t* parser, enum arith_code_t code,
+                   size_t operand) {
+  struct arith_program_t* program = parser->program;
+
+  if (program->num_ops == program->ops_capacity) {
+    size_t capacity = program->ops_capacity ? program->ops_capacity * 2 : 16;
+    struct arith_op_t* ops =
+        realloc(program->ops, capacity * sizeof(struct arith_op_t));
+    if (ops == NULL) {
+      perror("ops realloc error in emit()");
+      parser->failed = 1;
+      return 0;
+    }
+    program->ops = ops;
+    program->ops_capacity = capacity;
+  }
+  struct arith_op_t* op = &program->ops[program->num_ops];
+  op->code = code;
+  op->operand = operand;
+  op->value.is_float = 0;
+  op->value.integer = 0;
+  op->value.real = 0;
+  return program->num_ops++;
+}
+
+// Points a jump at the next operation.
+static void patch_jump(struct arith_parser_t* parser, size_t jump) {
+  if (!parser->failed) {
+    parser->program->ops[jump].operand = parser->program->num_ops;
+  }
+}
+
+// Returns the index of a variable name, adding it if it is new.
+static size_t intern_name(struct arith_parser_t* parser, const char* name,
+                          size_t length) {
+  struct arith_program_t* program = parser->program;
+
+  for (size_t i = 0; i < program->num_names; i++) {
+    if (strncmp(program->names[i], name, length) == 0 &&
+        program->names[i][length] == '\0') {
+      return i;
+    }
+  }
+  char** names =
+      realloc(program->names, (program->num_names + 1) * sizeof(char*));
+  if (names == NULL || (names[program->num_names] = strndup(name, length)) ==
+                           NULL) {
+    perror("names realloc error in intern_name()");
+    if (names != NULL) {
+      program->names = names;
+    }
+    parser->failed = 1;
+    return 0;
+  }
+  program->names = names;
+  return program->num_names++;
+}
+
+// Parses a number as in C, without a sign. Returns the number of characters
+// it takes up, or 0 if there is no valid number.
+static size_t parse_number(const char* text, struct arith_value_t* value) {
+  char* integer_end;
+  char* real_end;
+
+  value->integer = (long long)strtoull(text, &integer_end, 0);
+  value->real = strtod(text, &real_end);
+  value->is_float = real_end > integer_end && !(text[0] == '0' &&
+                                                (text[1] == 'x' ||
+                                                 text[1] == 'X'));
+  const char* end = value->is_float ? real_end : integer_end;
+  if (end == text || isalnum((unsigned char)*end) || *end == '_' ||
+      *end == '.') {
+    return 0;
+  }
+  return end - text;
+}
+
+// Reads a variable name, optionally written as $name, ${name} or a special
+// parameter such as $1. Returns its length, or 0 if there is none, and stores
+// where it starts.
+static size_t read_name(struct arith_parser_t* parser, const char** name) {
+  const char* text = parser->text + parser->position;
+  size_t length = 0;
+  int braced = 0;
+
+  if (text[0] == '$') {
+    text++;
+    if (text[0] == '{') {
+      text++;
+      braced = 1;
+    }
+    if (text[0] != '\0' && (strchr("?#$", text[0]) != NULL ||
+                            isdigit((unsigned char)text[0]))) {
+      length = 1;
+    }
+  }
+  if (length == 0) {
+    while (isalnum((unsigned char)text[length]) || text[length] == '_') {
+      length++;
+    }
+    if (!is_valid_name(text, length)) {
+      return 0;
+    }
+  }
+  if (braced && text[length] != '}') {
+    return 0;
+  }
+  *name = text;
+  parser->position = (text + length + braced) - parser->text;
+  return length;
+}
+
+// primary: number | variable | "(" expression ")"
+static int parse_primary(struct arith_parser_t* parser) {
+  const char* name;
+  size_t length;
+
+  skip_spaces(parser);
+  const char* text = parser->text + parser->position;
+  if (accept_operator(parser, "(")) {
+    if (parse_assignment(parser) == ARITH_FAILURE ||
+        !accept_operator(parser, ")")) {
+      return ARITH_FAILURE;
+    }
+    return 0;
+  }
+  if (isdigit((unsigned char)text[0]) ||
+      (text[0] == '.' && isdigit((unsigned char)text[1]))) {
+    struct arith_value_t value;
+    if ((length = parse_number(text, &value)) == 0) {
+      return ARITH_FAILURE;
+    }
+    size_t op = emit(parser, ARITH_PUSH, 0);
+    if (!parser->failed) {
+      parser->program->ops[op].value = value;
+    }
+    parser->position += length;
+    return 0;
+  }
+  if ((length = read_name(parser, &name)) == 0) {
+    return ARITH_FAILURE;
+  }
+  emit(parser, ARITH_LOAD, intern_name(parser, name, length));
+  return 0;
+}
+
+// unary: ("+" | "-" | "!" | "~") unary | primary. As in other shells, unary
+// operators bind tighter than "**", so -2**2 is 4.
+static int parse_unary(struct arith_parser_t* parser) {
+  const char* op = peek_operator(parser);
+  enum arith_code_t code;
+
+  if (op == NULL || strlen(op) != 1 || strchr("+-!~", op[0]) == NULL) {
+    return parse_primary(parser);
+  }
+  parser->position++;
+  if (parse_unary(parser) == ARITH_FAILURE) {
+    return ARITH_FAILURE;
+  }
+  if (op[0] == '+') {
+    return 0;
+  }
+  code = (op[0] == '-') ? ARITH_NEGATE
+         : (op[0] == '!') ? ARITH_NOT
+                          : ARITH_COMPLEMENT;
+  emit(parser, code, 0);
+  return 0;
+}
+
+// power: unary ["**" power]. Right associative.
+static int parse_power(struct arith_parser_t* parser) {
+  if (parse_unary(parser) == ARITH_FAILURE) {
+    return ARITH_FAILURE;
+  }
+  if (accept_operator(parser, "**")) {
+    if (parse_power(parser) == ARITH_FAILURE) {
+      return ARITH_FAILURE;
+    }
+    emit(parser, ARITH_POWER, 0);
+  }
+  return 0;
+}
+
+// Binary operators at a precedence level and above, left associative.
+static int parse_binary(struct arith_parser_t* parser, int level) {
+  if (level == BINARY_LEVELS) {
+    return parse_power(parser);
+  }
+  if (parse_binary(parser, level + 1) == ARITH_FAILURE) {
+    return ARITH_FAILURE;
+  }
+  for (;;) {
+    const char* op = peek_operator(parser);
+    const struct arith_operator_t* found = NULL;
+    for (size_t i = 0; op != NULL && i < sizeof(binary_operators) /
+                                             sizeof(binary_operators[0]);
+         i++) {
+      if (binary_operators[i].level == level &&
+          strcmp(binary_operators[i].text, op) == 0) {
+        found = &binary_operators[i];
+      }
+    }
+    if (found == NULL) {
+      return 0;
+    }
+    parser->position += strlen(op);
+    if (parse_binary(parser, level + 1) == ARITH_FAILURE) {
+      return ARITH_FAILURE;
+    }
+    emit(parser, found->code, 0);
+  }
+}
+
+// and: binary {"&&" binary}. The right side is skipped if the left is 0.
+static int parse_and(struct arith_parser_t* parser) {
+  if (parse_binary(parser, 0) == ARITH_FAILURE) {
+    return ARITH_FAILURE;
+  }
+  while (accept_operator(parser, "&&")) {
+    size_t if_false = emit(parser, ARITH_JUMP_ZERO, 0);
+    if (parse_binary(parser, 0) == ARITH_FAILURE) {
+      return ARITH_FAILURE;
+    }
+    emit(parser, ARITH_BOOL, 0);
+    size_t done = emit(parser, ARITH_JUMP, 0);
+    patch_jump(parser, if_false);
+    emit(parser, ARITH_PUSH, 0);
+    patch_jump(parser, done);
+  }
+  return 0;
+}
+
+// or: and {"||" and}. The right side is skipped if the left is not 0.
+static int parse_or(struct arith_parser_t* parser) {
+  if (parse_and(parser) == ARITH_FAILURE) {
+    return ARITH_FAILURE;
+  }
+  while (accept_operator(parser, "||")) {
+    size_t if_false = emit(parser, ARITH_JUMP_ZERO, 0);
+    size_t op = emit(parser, ARITH_PUSH, 0);
+    if (!parser->failed) {
+      parser->program->ops[op].value.integer = 1;
+    }
+    size_t done = emit(parser, ARITH_JUMP, 0);
+    patch_jump(parser, if_false);
+    if (parse_and(parser) == ARITH_FAILURE) {
+      return ARITH_FAILURE;
+    }
+    emit(parser, ARITH_BOOL, 0);
+    patch_jump(parser, done);
+  }
+  return 0;
+}
+
+// conditional: or ["?" assignment ":" conditional]
+static int parse_conditional(struct arith_parser_t* parser) {
+  if (parse_or(parser) == ARITH_FAILURE) {
+    return ARITH_FAILURE;
+  }
+  if (!accept_operator(parser, "?")) {
+    return 0;
+  }
+  size_t if_false = emit(parser, ARITH_JUMP_ZERO, 0);
+  if (parse_assignment(parser) == ARITH_FAILURE ||
+      !accept_operator(parser, ":")) {
+    return ARITH_FAILURE;
+  }
+  size_t done = emit(parser, ARITH_JUMP, 0);
+  patch_jump(parser, if_false);
+  if (parse_conditional(parser) == ARITH_FAILURE) {
+    return ARITH_FAILURE;
+  }
+  patch_jump(parser, done);
+  return 0;
+}
+
+// assignment: name ("=" | "+=" | "-=" | "*=" | "/=" | "%=") assignment
+//           | conditional
+static int parse_assignment(struct arith_parser_t* parser) {
+  static const struct {
+    const char* text;
+    enum arith_code_t code;
+  } assignments[] = {{"=", ARITH_PUSH},       {"+=", ARITH_ADD},
+                     {"-=", ARITH_SUBTRACT},  {"*=", ARITH_MULTIPLY},
+                     {"/=", ARITH_DIVIDE},    {"%=", ARITH_MODULO}};
+  size_t start = (skip_spaces(parser), parser->position);
+  const char* name;
+  size_t length;
+
+  // Special parameters cannot be assigned.
+  if (parser->text[start] != '$' &&
+      (length = read_name(parser, &name)) > 0) {
+    const char* op = peek_operator(parser);
+    for (size_t i = 0;
+         op != NULL && i < sizeof(assignments) / sizeof(assignments[0]); i++) {
+      if (strcmp(op, assignments[i].text) != 0) {
+        continue;
+      }
+      parser->position += strlen(op);
+      size_t index = intern_name(parser, name, length);
+      if (assignments[i].code != ARITH_PUSH) {
+        emit(parser, ARITH_LOAD, index);
+      }
+      if (parse_assignment(parser) == ARITH_FAILURE) {
+        return ARITH_FAILURE;
+      }
+      if (assignments[i].code != ARITH_PUSH) {
+        emit(parser, assignments[i].code, 0);
+      }
+      emit(parser, ARITH_STORE, index);
+      return 0;
+    }
+  }
+  parser->position = start;
+  return parse_conditional(parser);
+}
+
+// Compiles an expression. Returns NULL on failure.
+static struct arith_program_t* compile_expression(const char* text,
+                                                  size_t length) {
+  struct arith_program_t* program = calloc(1, sizeof(*program));
+  struct arith_parser_t parser = {NULL, 0, program, 0, SIZE_MAX, NULL};
+
+  if (program == NULL || (program->expression = strndup(text, length)) ==
+                             NULL) {
+    perror("program allocation error in compile_expression()");
+    free(program);
+    return NULL;
+  }
+  parser.text = program->expression;
+
+  // An empty expression is 0.
+  skip_spaces(&parser);
+  if (parser.text[parser.position] == '\0') {
+    emit(&parser, ARITH_PUSH, 0);
+  } else if (parse_assignment(&parser) == ARITH_FAILURE ||
+             (skip_spaces(&parser), parser.text[parser.position] != '\0')) {
+    if (!parser.failed) {
+      fprintf(stderr, "shell error: arithmetic syntax error: %s\n",
+              program->expression);
+    }
+    parser.failed = 1;
+  }
+  if (!parser.failed &&
+      (program->stack = malloc(program->num_ops *
+                               sizeof(struct arith_value_t))) == NULL) {
+    perror("stack malloc error in compile_expression()");
+    parser.failed = 1;
+  }
+  if (parser.failed) {
+    free_program(program);
+    return NULL;
+  }
+  program->hash = hash_expression(text, length);
+  return program;
+}
+
+#pragma endregion Compiler
+
+#pragma region Evaluator
+
+static double to_real(const struct arith_value_t* value) {
+  return value->is_float ? value->real : (double)value->integer;
+}
+
+static int is_zero(const struct arith_value_t* value) {
+  return value->is_float ? value->real == 0 : value->integer == 0;
+}
+
+static void set_integer(struct arith_value_t* value, long long integer) {
+  value->is_float = 0;
+  value->integer = integer;
+}
+
+// Formats a number the way it is expanded and assigned.
+static void format_value(const struct arith_value_t* value, char* buffer) {
+  if (value->is_float) {
+    snprintf(buffer, ARITH_RESULT_MAX, "%.15g", value->real);
+  } else {
+    snprintf(buffer, ARITH_RESULT_MAX, "%lld", value->integer);
+  }
+}
+
+// Reads a variable's value as a number. Unset and empty variables are 0.
+static int load_variable(const char* name, struct arith_value_t* value) {
+  const char* text = get_variable(name, strlen(name));
+
+  set_integer(value, 0);
+  if (text == NULL) {
+    return 0;
+  }
+  while (isspace((unsigned char)*text)) {
+    text++;
+  }
+  int negative = (*text == '-');
+  if (*text == '-' || *text == '+') {
+    text++;
+  }
+  size_t length = (*text == '\0') ? 0 : parse_number(text, value);
+  while (length > 0 && isspace((unsigned char)text[length])) {
+    length++;
+  }
+  if (*text != '\0' && (length == 0 || text[length] != '\0')) {
+    fprintf(stderr, "shell error: %s: not a number\n", name);
+    return ARITH_FAILURE;
+  }
+  if (negative) {
+    value->integer = (long long)(0ULL - (unsigned long long)value->integer);
+    value->real = -value->real;
+  }
+  return 0;
+}
+
+// Raises an integer to a power, wrapping around on overflow.
+static long long integer_power(long long base, long long exponent) {
+  unsigned long long result = 1, factor = (unsigned long long)base;
+
+  while (exponent > 0) {
+    if (exponent & 1) {
+      result *= factor;
+    }
+    factor *= factor;
+    exponent >>= 1;
+  }
+  return (long long)result;
+}
+
+// Applies a binary operation to two integers. Returns -1 on failure.
+static int apply_integer(enum arith_code_t code, long long left,
+                         long long right, long long* result) {
+  unsigned long long a = (unsigned long long)left;
+  unsigned long long b = (unsigned long long)right;
+
+  switch (code) {
+    case ARITH_ADD: *result = (long long)(a + b); break;
+    case ARITH_SUBTRACT: *result = (long long)(a - b); break;
+    case ARITH_MULTIPLY: *result = (long long)(a * b); break;
+    case ARITH_DIVIDE:
+    case ARITH_MODULO:
+      if (right == 0) {
+        fprintf(stderr, "shell error: division by zero\n");
+        return ARITH_FAILURE;
+      }
+      if (right == -1) {
+        // Avoids the overflow of LLONG_MIN / -1.
+        *result = (code == ARITH_DIVIDE) ? (long long)(0ULL - a) : 0;
+      } else {
+        *result = (code == ARITH_DIVIDE) ? left / right : left % right;
+      }
+      break;
+    case ARITH_POWER:
+      if (right < 0) {
+        fprintf(stderr, "shell error: exponent less than 0\n");
+        return ARITH_FAILURE;
+      }
+      *result = integer_power(left, right);
+      break;
+    case ARITH_SHIFT_LEFT: *result = (long long)(a << (b & 63)); break;
+    case ARITH_SHIFT_RIGHT: *result = left >> (b & 63); break;
+    case ARITH_LESS: *result = left < right; break;
+    case ARITH_LESS_EQUAL: *result = left <= right; break;
+    case ARITH_GREATER: *result = left > right; break;
+    case ARITH_GREATER_EQUAL: *result = left >= right; break;
+    case ARITH_EQUAL: *result = left == right; break;
+    case ARITH_NOT_EQUAL: *result = left != right; break;
+    case ARITH_BIT_AND: *result = left & right; break;
+    case ARITH_BIT_XOR: *result = left ^ right; break;
+    case ARITH_BIT_OR: *result = left | right; break;
+    default: return ARITH_FAILURE;
+  }
+  return 0;
+}
+
+// Applies a binary operation to two numbers, at least one of them
+// floating-point. Returns -1 on failure.
+static int apply_real(enum arith_code_t code, double left, double right,
+                      struct arith_value_t* result) {
+  result->is_float = 1;
+  switch (code) {
+    case ARITH_ADD: result->real = left + right; return 0;
+    case ARITH_SUBTRACT: result->real = left - right; return 0;
+    case ARITH_MULTIPLY: result->real = left * right; return 0;
+    case ARITH_DIVIDE: result->real = left / right; return 0;
+    case ARITH_MODULO: result->real = fmod(left, right); return 0;
+    case ARITH_POWER: result->real = pow(left, right); return 0;
+    case ARITH_LESS: set_integer(result, left < right); return 0;
+    case ARITH_LESS_EQUAL: set_integer(result, left <= right); return 0;
+    case ARITH_GREATER: set_integer(result, left > right); return 0;
+    case ARITH_GREATER_EQUAL: set_integer(result, left >= right); return 0;
+    case ARITH_EQUAL: set_integer(result, left == right); return 0;
+    case ARITH_NOT_EQUAL: set_integer(result, left != right); return 0;
+    default:
+      fprintf(stderr,
+              "shell error: bitwise operation on a floating-point number\n");
+      return ARITH_FAILURE;
+  }
+}
+
+// Runs a program. Returns -1 on failure.
+static int run_program(struct arith_program_t* program,
+                       struct arith_value_t* result) {
+  struct arith_value_t* stack = program->stack;
+  size_t depth = 0;
+  char text[ARITH_RESULT_MAX];
+
+  for (size_t pc = 0; pc < program->num_ops; pc++) {
+    const struct arith_op_t* op = &program->ops[pc];
+    struct arith_value_t* top = (depth > 0) ? &stack[depth - 1] : stack;
+
+    switch (op->code) {
+      case ARITH_PUSH:
+        stack[depth++] = op->value;
+        break;
+      case ARITH_LOAD:
+        if (load_variable(program->names[op->operand], &stack[depth]) ==
+            ARITH_FAILURE) {
+          return ARITH_FAILURE;
+        }
+        depth++;
+        break;
+      case ARITH_STORE:
+        format_value(top, text);
+        if (set_variable(program->names[op->operand], text) == VAR_FAILURE) {
+          return ARITH_FAILURE;
+        }
+        break;
+      case ARITH_JUMP:
+        pc = op->operand - 1;
+        break;
+      case ARITH_JUMP_ZERO:
+        depth--;
+        if (is_zero(top)) {
+          pc = op->operand - 1;
+        }
+        break;
+      case ARITH_BOOL:
+        set_integer(top, !is_zero(top));
+        break;
+      case ARITH_NEGATE:
+        top->integer = (long long)(0ULL - (unsigned long long)top->integer);
+        top->real = -top->real;
+        break;
+      case ARITH_NOT:
+        set_integer(top, is_zero(top));
+        break;
+      case ARITH_COMPLEMENT:
+        if (top->is_float) {
+          return apply_real(op->code, 0, 0, top);
+        }
+        top->integer = ~top->integer;
+        break;
+      default: {
+        struct arith_value_t* left = &stack[depth - 2];
+        depth--;
+        if (left->is_float || top->is_float) {
+          if (apply_real(op->code, to_real(left), to_real(top), left) ==
+              ARITH_FAILURE) {
+            return ARITH_FAILURE;
+          }
+        } else if (apply_integer(op->code, left->integer, top->integer,
+                                 &left->integer) == ARITH_FAILURE) {
+          return ARITH_FAILURE;
+        }
+        break;
+      }
+    }
+  }
+  *result = stack[0];
+  return 0;
+}
+
+#pragma endregion Evaluator
+
+void clear_arithmetic_cache(void) {
+  for (size_t i = 0; i < ARITH_CACHE_SIZE; i++) {
+    free_program(cache[i]);
+    cache[i] = NULL;
+  }
+}
+
+int evaluate_arithmetic(const char* expression, size_t length, char* result) {
+  struct arith_value_t value;
+  struct arith_program_t* program = NULL;
+  uint64_t hash = hash_expression(expression, length);
+  struct arith_program_t** slot = &cache[hash % ARITH_CACHE_SIZE];
+
+  // The parse_cache option covers compiled expressions too.
+  if (parse_cache_enabled && *slot != NULL && (*slot)->hash == hash &&
+      strncmp((*slot)->expression, expression, length) == 0 &&
+      (*slot)->expression[length] == '\0') {
+    program = *slot;
+  } else if ((program = compile_expression(expression, length)) == NULL) {
+    return ARITH_FAILURE;
+  } else if (parse_cache_enabled) {
+    free_program(*slot);
+    *slot = program;
+  }
+
+  int status = run_program(program, &value);
+  if (program != *slot) {
+    free_program(program);
+  }
+  if (status == ARITH_FAILURE) {
+    return ARITH_FAILURE;
+  }
+  format_value(&value, result);
+  return 0;
+}
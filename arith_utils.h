@@ -0,0 +1,41 @@
+#ifndef ARITH_UTILS_H
+#define ARITH_UTILS_H
+
+#define ARITH_CACHE_SIZE 256
+#define ARITH_FAILURE -1
+#define ARITH_RESULT_MAX 32
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// void clear_arithmetic_cache()
+// Description: Frees every cached arithmetic program.
+// Preconditions: None.
+// Postconditions: The cache is empty.
+// Return: None.
+extern void clear_arithmetic_cache(void);
+
+// int evaluate_arithmetic(const char*, size_t, char*)
+// Description: Evaluates the body of a $((...)) expansion. Expressions are
+// compiled once into a postfix program, cached by their text, so a loop
+// evaluates the same expression without parsing it again. Supports integer
+// and floating-point numbers, variables (with or without "$"), the C unary,
+// binary, logical and conditional operators, "**" and the assignments "=",
+// "+=", "-=", "*=", "/=" and "%=". An operation on a floating-point number
+// gives one. Integers are 64 bits and wrap around on overflow.
+// Preconditions: A non-null expression, its length and a buffer of at least
+// ARITH_RESULT_MAX bytes are provided.
+// Postconditions: Assigned variables are set. The result is written to the
+// buffer.
+// Return: 0 on success, -1 on a syntax error, an invalid operand or a division
+// by zero.
+extern int evaluate_arithmetic(const char*, size_t, char*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ARITH_UTILS_H
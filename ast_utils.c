@@ -0,0 +1,1355 @@
+// File:    ast_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains the compiler that turns a line of user input into
+//          a syntax tree and the interpreter that executes it. Simple commands
+//          that need no expansion are tokenized once at compile time, so loop
+//          bodies run without being parsed again.
+
+#define _GNU_SOURCE
+
+#include "ast_utils.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "builtins.h"
+#include "exec_utils.h"
+#include "expand_utils.h"
+#include "parse_utils.h"
+#include "redirect_utils.h"
+#include "usage_utils.h"
+#include "utils.h"
+#include "var_utils.h"
+
+// Types of tokens produced by the lexer.
+enum token_type_t {
+  TOKEN_WORD,
+  TOKEN_SEMI,
+  TOKEN_NEWLINE,
+  TOKEN_AND,
+  TOKEN_OR,
+  TOKEN_LPAREN,
+  TOKEN_RPAREN,
+  TOKEN_REDIRECT,
+  TOKEN_END
+};
+
+// Struct holding a token as a range of the source text.
+struct token_t {
+    enum token_type_t type;
+    size_t start;
+    size_t end;
+};
+
+// Struct holding a here-document found by the lexer.
+//   delimiter:  The delimiter word with its quotes removed.
+//   quoted:     Whether the delimiter was quoted, which turns off expansion
+//               of the body.
+//   strip_tabs: Whether leading tabs are removed from each line (<<-).
+//   start:      The index of the body in the source.
+//   end:        The index of the delimiter line.
+struct heredoc_t {
+    char* delimiter;
+    int quoted;
+    int strip_tabs;
+    size_t start;
+    size_t end;
+};
+
+// Struct holding the state of the recursive descent parser. Here-documents
+// are listed in the order of their operators, which is the order of their
+// bodies.
+struct parser_t {
+    const char* source;
+    struct token_t* tokens;
+    size_t num_tokens;
+    size_t pos;
+    int status;
+    struct heredoc_t* heredocs;
+    size_t num_heredocs;
+    size_t next_heredoc;
+};
+
+// Struct holding a shell function. The program that defined the function is
+// kept alive for as long as the function exists.
+struct shell_function_t {
+    char* name;
+    struct ast_program_t* program;
+    struct ast_node_t* body;
+};
+
+static struct shell_function_t* functions = NULL;
+static size_t num_functions = 0;
+static struct ast_program_t* current_program = NULL;
+static int exit_requested = 0;
+
+// The here-document the last compile ran out of input in, if any.
+static char* open_delimiter = NULL;
+static int open_strip_tabs = 0;
+
+static struct ast_node_t* parse_and_or(struct parser_t*);
+static struct ast_node_t* parse_one_command(struct parser_t*);
+static struct ast_node_t* parse_list(struct parser_t*, const char* const*);
+static int exec_node(struct ast_node_t*);
+
+#pragma region Lexer
+
+// Appends a token. Returns 0 on success, -1 on failure.
+static int add_token(struct token_t** tokens, size_t* num_tokens,
+                     size_t* capacity, enum token_type_t type, size_t start,
+                     size_t end) {
+  if (*num_tokens >= *capacity) {
+    size_t new_capacity = *capacity ? *capacity * 2 : 16;
+    struct token_t* temp_tokens =
+        realloc(*tokens, new_capacity * sizeof(struct token_t));
+    if (temp_tokens == NULL) {
+      perror("realloc error in add_token()");
+      return -1;
+    }
+    *tokens = temp_tokens;
+    *capacity = new_capacity;
+  }
+  (*tokens)[*num_tokens].type = type;
+  (*tokens)[*num_tokens].start = start;
+  (*tokens)[*num_tokens].end = end;
+  (*num_tokens)++;
+  return 0;
+}
+
+// Returns the index just past the word starting at the given index, or -1 if
+// the word ends inside a quote or command substitution. Quotes and
+// substitutions may contain operator characters and whitespace.
+static long scan_word(const char* source, size_t pos) {
+  char quoted = 0;
+
+  while (source[pos] != '\0') {
+    char c = source[pos];
+
+    if (c == '\\' && source[pos + 1] != '\0') {
+      // Escape sequences are left for unescape().
+      pos += 2;
+      continue;
+    }
+    if (quoted == '\'') {
+      if (c == quoted) {
+        quoted = 0;
+      }
+      pos++;
+      continue;
+    }
+    if ((c == '$' && source[pos + 1] == '(') || c == '`') {
+      long end = find_substitution_end(source, pos);
+      if (end == -1) {
+        return -1;
+      }
+      pos = end + 1;
+      continue;
+    }
+    if (quoted) {
+      if (c == quoted) {
+        quoted = 0;
+      }
+      pos++;
+      continue;
+    }
+    if (c == '\'' || c == '"') {
+      quoted = c;
+    } else if (isspace((unsigned char)c) || strchr(";()<>", c) != NULL ||
+               (c == '&' && source[pos + 1] == '&') ||
+               (c == '|' && source[pos + 1] == '|')) {
+      break;
+    }
+    pos++;
+  }
+  return quoted ? -1 : (long)pos;
+}
+
+// Returns the length of the redirection operator ([n]<, [n]>, [n]>>, [n]<&,
+// [n]>&, [n]<<, [n]<<- or [n]<<<) at the start of a string, or 0 if there is
+// none.
+static size_t redirect_length(const char* str) {
+  size_t length = isdigit((unsigned char)str[0]) ? 1 : 0;
+
+  if (str[length] != '<' && str[length] != '>') {
+    return 0;
+  }
+  if (str[length] == '<' && str[length + 1] == '<') {
+    return length + ((str[length + 2] == '<' || str[length + 2] == '-') ? 3 : 2);
+  }
+  if (str[length + 1] == '&' || (str[length] == '>' && str[length + 1] == '>')) {
+    return length + 2;
+  }
+  return length + 1;
+}
+
+// Adds a here-document for the delimiter word after a << or <<- operator.
+// Quotes and backslashes are removed from the word, and turn off expansion of
+// the body. Returns 0 on success, -1 on failure.
+static int add_heredoc(struct parser_t* parser, size_t* capacity,
+                       size_t start, size_t end, int strip_tabs) {
+  const char* word = parser->source + start;
+  size_t length = end - start;
+  char* delimiter = malloc(length + 1);
+  size_t n = 0;
+  int quoted = 0;
+
+  if (delimiter == NULL) {
+    perror("malloc error in add_heredoc()");
+    return -1;
+  }
+  for (size_t i = 0; i < length; i++) {
+    if (word[i] == '\\' && i + 1 < length) {
+      quoted = 1;
+      delimiter[n++] = word[++i];
+    } else if (word[i] == '\'' || word[i] == '"') {
+      quoted = 1;
+    } else {
+      delimiter[n++] = word[i];
+    }
+  }
+  delimiter[n] = '\0';
+
+  if (parser->num_heredocs >= *capacity) {
+    size_t new_capacity = *capacity ? *capacity * 2 : 4;
+    struct heredoc_t* temp_heredocs =
+        realloc(parser->heredocs, new_capacity * sizeof(struct heredoc_t));
+    if (temp_heredocs == NULL) {
+      perror("realloc error in add_heredoc()");
+      free(delimiter);
+      return -1;
+    }
+    parser->heredocs = temp_heredocs;
+    *capacity = new_capacity;
+  }
+  struct heredoc_t* heredoc = &parser->heredocs[parser->num_heredocs++];
+  heredoc->delimiter = delimiter;
+  heredoc->quoted = quoted;
+  heredoc->strip_tabs = strip_tabs;
+  heredoc->start = heredoc->end = 0;
+  return 0;
+}
+
+// Finds the bodies of the here-documents from the given one on, in the lines
+// starting at the given index. Each body ends before a line holding just its
+// delimiter. Returns the index just past the last delimiter line, or -1 if
+// the input ends first.
+static long scan_heredoc_bodies(struct parser_t* parser, size_t first,
+                                size_t pos) {
+  const char* source = parser->source;
+
+  for (size_t i = first; i < parser->num_heredocs; i++) {
+    struct heredoc_t* heredoc = &parser->heredocs[i];
+    size_t delimiter_length = strlen(heredoc->delimiter);
+
+    if (i > first && source[pos] == '\n') {
+      pos++;
+    }
+    heredoc->start = pos;
+    while (1) {
+      // Input has its trailing blank lines removed, so an empty delimiter
+      // may have been the end of the source.
+      if (source[pos] == '\0' && delimiter_length == 0 &&
+          pos > heredoc->start) {
+        heredoc->end = pos;
+        break;
+      }
+      if (source[pos] == '\0') {
+        free(open_delimiter);
+        open_delimiter = strdup(heredoc->delimiter);
+        open_strip_tabs = heredoc->strip_tabs;
+        return -1;
+      }
+      const char* line = source + pos;
+      size_t line_length = strchrnul(line, '\n') - line;
+      size_t tabs = 0;
+      while (heredoc->strip_tabs && line[tabs] == '\t') {
+        tabs++;
+      }
+      if (line_length - tabs == delimiter_length &&
+          memcmp(line + tabs, heredoc->delimiter, delimiter_length) == 0) {
+        heredoc->end = pos;
+        pos += line_length;
+        break;
+      }
+      pos += line_length + (line[line_length] == '\n');
+    }
+  }
+  return (long)pos;
+}
+
+// Splits the source into tokens and finds the bodies of here-documents.
+// Returns COMPILE_OK, COMPILE_INCOMPLETE or COMPILE_FAILURE.
+static int tokenize(struct parser_t* parser) {
+  const char* source = parser->source;
+  size_t capacity = 0, heredoc_capacity = 0;
+  size_t pos = 0;
+  size_t scanned_heredocs = 0;
+  int heredoc_operator = 0;
+
+  while (1) {
+    // Skip blanks and comments. Newlines are separators.
+    while (source[pos] != '\0' && source[pos] != '\n' &&
+           isspace((unsigned char)source[pos])) {
+      pos++;
+    }
+    if (source[pos] == '#') {
+      while (source[pos] != '\0' && source[pos] != '\n') {
+        pos++;
+      }
+    }
+
+    enum token_type_t type = TOKEN_WORD;
+    size_t start = pos;
+    size_t size;
+    switch (source[pos]) {
+      case '\0':
+        type = TOKEN_END;
+        break;
+      case '\n':
+        type = TOKEN_NEWLINE;
+        pos++;
+        break;
+      case ';':
+        type = TOKEN_SEMI;
+        pos++;
+        break;
+      case '(':
+        type = TOKEN_LPAREN;
+        pos++;
+        break;
+      case ')':
+        type = TOKEN_RPAREN;
+        pos++;
+        break;
+      default:
+        if ((size = redirect_length(source + pos)) > 0) {
+          type = TOKEN_REDIRECT;
+          pos += size;
+        } else if (strncmp(source + pos, "&&", 2) == 0) {
+          type = TOKEN_AND;
+          pos += 2;
+        } else if (strncmp(source + pos, "||", 2) == 0) {
+          type = TOKEN_OR;
+          pos += 2;
+        } else {
+          long end = scan_word(source, pos);
+          if (end == -1) {
+            return COMPILE_INCOMPLETE;
+          }
+          pos = end;
+        }
+        break;
+    }
+
+    if (add_token(&parser->tokens, &parser->num_tokens, &capacity, type, start,
+                  pos) == -1) {
+      return COMPILE_FAILURE;
+    }
+
+    // The word after << or <<- is a here-document delimiter.
+    if (heredoc_operator && type == TOKEN_WORD &&
+        add_heredoc(parser, &heredoc_capacity, start, pos,
+                    heredoc_operator == '-') == -1) {
+      return COMPILE_FAILURE;
+    }
+    heredoc_operator = 0;
+    if (type == TOKEN_REDIRECT) {
+      const char* op = source + start;
+      op += isdigit((unsigned char)*op) ? 1 : 0;
+      if (op[0] == '<' && op[1] == '<' && op[2] != '<') {
+        heredoc_operator = (op[2] == '-') ? '-' : '<';
+      }
+    }
+
+    // Bodies follow the line their operators are on.
+    if ((type == TOKEN_NEWLINE || type == TOKEN_END) &&
+        scanned_heredocs < parser->num_heredocs) {
+      long end = scan_heredoc_bodies(parser, scanned_heredocs, pos);
+      if (end == -1) {
+        return COMPILE_INCOMPLETE;
+      }
+      scanned_heredocs = parser->num_heredocs;
+      pos = end;
+    }
+    if (type == TOKEN_END) {
+      return COMPILE_OK;
+    }
+  }
+}
+
+#pragma endregion Lexer
+
+#pragma region Parser
+
+// Returns the current token. The last token is always TOKEN_END.
+static struct token_t* peek(struct parser_t* parser) {
+  return &parser->tokens[parser->pos];
+}
+
+// Moves past the current token.
+static void advance(struct parser_t* parser) {
+  if (parser->pos + 1 < parser->num_tokens) {
+    parser->pos++;
+  }
+}
+
+// Returns 1 if a token is the given reserved word.
+static int is_keyword(struct parser_t* parser, struct token_t* token,
+                      const char* keyword) {
+  size_t length = strlen(keyword);
+  return token->type == TOKEN_WORD && token->end - token->start == length &&
+         strncmp(parser->source + token->start, keyword, length) == 0;
+}
+
+// Returns 1 if a token is one of the given reserved words.
+static int is_any_keyword(struct parser_t* parser, struct token_t* token,
+                          const char* const* keywords) {
+  for (size_t i = 0; keywords != NULL && keywords[i] != NULL; i++) {
+    if (is_keyword(parser, token, keywords[i])) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Records a syntax error at a token that more input cannot fix, such as a
+// redirection without a target. The end of input counts as a newline.
+static void syntax_error_at(struct parser_t* parser, struct token_t* token) {
+  if (parser->status != COMPILE_OK) {
+    return;
+  }
+  parser->status = COMPILE_FAILURE;
+  if (token->type == TOKEN_NEWLINE || token->type == TOKEN_END) {
+    fprintf(stderr, "shell error: syntax error near unexpected newline\n");
+  } else {
+    fprintf(stderr, "shell error: syntax error near unexpected token `%.*s'\n",
+            (int)(token->end - token->start), parser->source + token->start);
+  }
+}
+
+// Records a syntax error at a token. Running out of input where more may
+// follow, as in an open compound command or after "&&", is not an error: the
+// caller reads another line and compiles again.
+static void syntax_error(struct parser_t* parser, struct token_t* token) {
+  if (parser->status == COMPILE_OK && token->type == TOKEN_END) {
+    parser->status = COMPILE_INCOMPLETE;
+    return;
+  }
+  syntax_error_at(parser, token);
+}
+
+// Consumes the given reserved word. Returns 1 on success, 0 on failure.
+static int expect_keyword(struct parser_t* parser, const char* keyword) {
+  if (!is_keyword(parser, peek(parser), keyword)) {
+    syntax_error(parser, peek(parser));
+    return 0;
+  }
+  advance(parser);
+  return 1;
+}
+
+// Skips newline tokens.
+static void skip_newlines(struct parser_t* parser) {
+  while (peek(parser)->type == TOKEN_NEWLINE) {
+    advance(parser);
+  }
+}
+
+// Allocates an empty node.
+static struct ast_node_t* new_node(struct parser_t* parser,
+                                   enum ast_type_t type) {
+  struct ast_node_t* node = calloc(1, sizeof(struct ast_node_t));
+  if (node == NULL) {
+    perror("calloc error in new_node()");
+    parser->status = COMPILE_FAILURE;
+    return NULL;
+  }
+  node->type = type;
+  return node;
+}
+
+// Frees a node and all of its children.
+static void free_node(struct ast_node_t* node) {
+  if (node == NULL) {
+    return;
+  }
+  free(node->text);
+  free(node->name);
+  free_parsed_command(node->argv);
+  for (size_t i = 0; node->words != NULL && node->words[i] != NULL; i++) {
+    free(node->words[i]);
+  }
+  free(node->words);
+  free_redirects(node->redirects, node->num_redirects);
+  for (size_t i = 0; i < node->num_children; i++) {
+    free_node(node->children[i]);
+  }
+  free(node->children);
+  free_node(node->first);
+  free_node(node->second);
+  free_node(node->third);
+  free(node);
+}
+
+// Copies the source text from the start of one token to the end of another.
+static char* token_text(struct parser_t* parser, struct token_t* first,
+                        struct token_t* last) {
+  char* text = strndup(parser->source + first->start, last->end - first->start);
+  if (text == NULL) {
+    perror("strndup error in token_text()");
+    parser->status = COMPILE_FAILURE;
+  }
+  return text;
+}
+
+// Tokenizes words that need no expansion once, at compile time. Returns 0 on
+// success, -1 on failure.
+static int precompile_words(struct parser_t* parser, struct ast_node_t* node) {
+  if ((node->needs_expansion = needs_expansion(node->text))) {
+    return 0;
+  }
+  char* copy = strdup(node->text);
+  if (copy == NULL) {
+    perror("strdup error in precompile_words()");
+    parser->status = COMPILE_FAILURE;
+    return -1;
+  }
+  node->argv = parse_command(copy);
+  free(copy);
+  if (node->argv == NULL && node->type == AST_SIMPLE &&
+      node->text[0] != '\0') {
+    // parse_command() has reported the bad escape sequence.
+    parser->status = COMPILE_FAILURE;
+    return -1;
+  }
+  return 0;
+}
+
+// Returns 1 if a word has the form NAME=value.
+static int is_assignment(const char* word, size_t length) {
+  const char* equals = memchr(word, '=', length);
+  return equals != NULL && is_valid_name(word, equals - word);
+}
+
+// Sets the body of the next here-document as the target of a redirection.
+// Bodies that need no expansion are stored as they will be read; others are
+// expanded each time the command runs. Returns 0 on success, -1 on failure.
+static int parse_heredoc(struct parser_t* parser, struct redirect_t* redirect) {
+  struct heredoc_t* heredoc = &parser->heredocs[parser->next_heredoc++];
+  const char* body = parser->source + heredoc->start;
+  size_t length = heredoc->end - heredoc->start;
+  char* text = malloc(length + 2);
+  size_t n = 0;
+
+  if (text == NULL) {
+    perror("malloc error in parse_heredoc()");
+    parser->status = COMPILE_FAILURE;
+    return -1;
+  }
+  if (heredoc->strip_tabs) {
+    // Remove the leading tabs of every line.
+    int line_start = 1;
+    for (size_t i = 0; i < length; i++) {
+      if (!(line_start && body[i] == '\t')) {
+        text[n++] = body[i];
+        line_start = (body[i] == '\n');
+      }
+    }
+  } else {
+    memcpy(text, body, length);
+    n = length;
+  }
+  if (n > 0 && text[n - 1] != '\n') {
+    // An empty delimiter matched at the end of the source.
+    text[n++] = '\n';
+  }
+  text[n] = '\0';
+
+  if (heredoc->quoted) {
+    redirect->path = text;
+  } else if (needs_expansion(text)) {
+    redirect->word = text;
+  } else {
+    // Only backslash escapes to resolve, which has no side effects.
+    redirect->path = expand_here_document(text, &n);
+    free(text);
+    if (redirect->path == NULL) {
+      parser->status = COMPILE_FAILURE;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// Adds the redirection whose operator is the current token. Returns 0 on
+// success, -1 on failure.
+static int parse_redirect(struct parser_t* parser, struct ast_node_t* node) {
+  struct token_t* op = peek(parser);
+  const char* text = parser->source + op->start;
+  struct redirect_t redirect = {1, 0, NULL, NULL};
+
+  // [n]< [n]> [n]>> [n]<& [n]>& [n]<< [n]<<- [n]<<<
+  if (isdigit((unsigned char)*text)) {
+    redirect.fd = *text++ - '0';
+  } else if (*text == '<') {
+    redirect.fd = 0;
+  }
+  if (text[0] == '<' && text[1] == '<') {
+    redirect.flags =
+        (text[2] == '<') ? REDIRECT_HERESTRING : REDIRECT_HEREDOC;
+  } else if (text[1] == '&') {
+    redirect.flags = REDIRECT_DUP;
+  } else if (text[0] == '<') {
+    redirect.flags = O_RDONLY;
+  } else if (text[1] == '>') {
+    redirect.flags = O_WRONLY | O_CREAT | O_APPEND;
+  } else {
+    redirect.flags = O_WRONLY | O_CREAT | O_TRUNC;
+  }
+
+  advance(parser);
+  struct token_t* target = peek(parser);
+  if (target->type != TOKEN_WORD) {
+    syntax_error_at(parser, target);
+    return -1;
+  }
+  advance(parser);
+  if (redirect.flags == REDIRECT_HEREDOC) {
+    if (parse_heredoc(parser, &redirect) == -1) {
+      return -1;
+    }
+  } else if ((redirect.word = token_text(parser, target, target)) == NULL) {
+    return -1;
+  } else if (!needs_expansion(redirect.word) &&
+      (redirect.path = unescape(redirect.word, stderr)) == NULL) {
+    parser->status = COMPILE_FAILURE;
+    free(redirect.word);
+    return -1;
+  }
+
+  struct redirect_t* temp_redirects = realloc(
+      node->redirects, (node->num_redirects + 1) * sizeof(struct redirect_t));
+  if (temp_redirects == NULL) {
+    perror("realloc error in parse_redirect()");
+    parser->status = COMPILE_FAILURE;
+    free(redirect.word);
+    free(redirect.path);
+    return -1;
+  }
+  node->redirects = temp_redirects;
+  node->redirects[node->num_redirects++] = redirect;
+  return 0;
+}
+
+// simple_command: (WORD | redirect)+
+static struct ast_node_t* parse_simple(struct parser_t* parser) {
+  struct ast_node_t* node = new_node(parser, AST_SIMPLE);
+  size_t first = parser->pos;
+  size_t num_words = 0;
+  size_t text_length = 0;
+  int assignments_only = 1;
+
+  if (node == NULL) {
+    return NULL;
+  }
+
+  // Words and redirections may be interleaved, as in "echo >out hello".
+  while (peek(parser)->type == TOKEN_WORD ||
+         peek(parser)->type == TOKEN_REDIRECT) {
+    struct token_t* token = peek(parser);
+    if (token->type == TOKEN_REDIRECT) {
+      if (parse_redirect(parser, node) == -1) {
+        free_node(node);
+        return NULL;
+      }
+      continue;
+    }
+    assignments_only &= is_assignment(parser->source + token->start,
+                                      token->end - token->start);
+    text_length += token->end - token->start + 1;
+    num_words++;
+    advance(parser);
+  }
+
+  // Collect the words, separated by single spaces.
+  char** words = calloc(num_words + 1, sizeof(char*));
+  if (words == NULL || (node->text = malloc(text_length + 1)) == NULL) {
+    perror("malloc error in parse_simple()");
+    parser->status = COMPILE_FAILURE;
+    free(words);
+    free_node(node);
+    return NULL;
+  }
+  node->text[0] = '\0';
+  for (size_t i = first, n = 0; n < num_words; i++) {
+    struct token_t* token = &parser->tokens[i];
+    if (token->type != TOKEN_WORD) {
+      // Skip a redirection operator and its target.
+      i++;
+      continue;
+    }
+    if ((words[n] = token_text(parser, token, token)) == NULL) {
+      node->words = words;
+      free_node(node);
+      return NULL;
+    }
+    if (n++ > 0) {
+      strcat(node->text, " ");
+    }
+    strcat(node->text, words[n - 1]);
+  }
+
+  if (assignments_only && num_words > 0 && node->num_redirects == 0) {
+    // Values are expanded when the assignment runs.
+    node->type = AST_ASSIGNMENT;
+    node->words = words;
+    return node;
+  }
+  for (size_t n = 0; n < num_words; n++) {
+    free(words[n]);
+  }
+  free(words);
+
+  if (precompile_words(parser, node) == -1) {
+    free_node(node);
+    return NULL;
+  }
+  node->builtin = find_builtin(node->argv);
+  return node;
+}
+
+// if_clause: if list then list (elif list then list)* [else list] fi
+// Called after the "if" or "elif" has been consumed.
+static struct ast_node_t* parse_if(struct parser_t* parser) {
+  static const char* const condition_end[] = {"then", NULL};
+  static const char* const branch_end[] = {"elif", "else", "fi", NULL};
+  static const char* const else_end[] = {"fi", NULL};
+  struct ast_node_t* node = new_node(parser, AST_IF);
+
+  if (node == NULL ||
+      (node->first = parse_list(parser, condition_end)) == NULL ||
+      !expect_keyword(parser, "then") ||
+      (node->second = parse_list(parser, branch_end)) == NULL) {
+    free_node(node);
+    return NULL;
+  }
+
+  if (is_keyword(parser, peek(parser), "elif")) {
+    // The nested clause consumes the closing "fi".
+    advance(parser);
+    if ((node->third = parse_if(parser)) == NULL) {
+      free_node(node);
+      return NULL;
+    }
+    return node;
+  }
+  if (is_keyword(parser, peek(parser), "else")) {
+    advance(parser);
+    if ((node->third = parse_list(parser, else_end)) == NULL) {
+      free_node(node);
+      return NULL;
+    }
+  }
+  if (!expect_keyword(parser, "fi")) {
+    free_node(node);
+    return NULL;
+  }
+  return node;
+}
+
+// while_clause: (while|until) list do list done
+static struct ast_node_t* parse_while(struct parser_t* parser,
+                                      enum ast_type_t type) {
+  static const char* const condition_end[] = {"do", NULL};
+  static const char* const body_end[] = {"done", NULL};
+  struct ast_node_t* node = new_node(parser, type);
+
+  advance(parser);
+  if (node == NULL ||
+      (node->first = parse_list(parser, condition_end)) == NULL ||
+      !expect_keyword(parser, "do") ||
+      (node->second = parse_list(parser, body_end)) == NULL ||
+      !expect_keyword(parser, "done")) {
+    free_node(node);
+    return NULL;
+  }
+  return node;
+}
+
+// for_clause: for NAME [in WORD*] (;|newline) do list done
+static struct ast_node_t* parse_for(struct parser_t* parser) {
+  static const char* const body_end[] = {"done", NULL};
+  struct ast_node_t* node = new_node(parser, AST_FOR);
+  struct token_t* token;
+
+  advance(parser);
+  if (node == NULL) {
+    return NULL;
+  }
+  token = peek(parser);
+  if (token->type != TOKEN_WORD ||
+      !is_valid_name(parser->source + token->start, token->end - token->start)) {
+    syntax_error(parser, token);
+    free_node(node);
+    return NULL;
+  }
+  if ((node->name = token_text(parser, token, token)) == NULL) {
+    free_node(node);
+    return NULL;
+  }
+  advance(parser);
+
+  if (is_keyword(parser, peek(parser), "in")) {
+    advance(parser);
+    struct token_t* first = peek(parser);
+    struct token_t* last = NULL;
+    while (peek(parser)->type == TOKEN_WORD) {
+      last = peek(parser);
+      advance(parser);
+    }
+    // An empty word list still differs from no list at all.
+    if ((node->text = (last != NULL) ? token_text(parser, first, last)
+                                     : strdup("")) == NULL ||
+        precompile_words(parser, node) == -1) {
+      free_node(node);
+      return NULL;
+    }
+    if (peek(parser)->type != TOKEN_SEMI &&
+        peek(parser)->type != TOKEN_NEWLINE) {
+      syntax_error(parser, peek(parser));
+      free_node(node);
+      return NULL;
+    }
+    advance(parser);
+  } else if (peek(parser)->type == TOKEN_SEMI) {
+    advance(parser);
+  }
+
+  skip_newlines(parser);
+  if (!expect_keyword(parser, "do") ||
+      (node->second = parse_list(parser, body_end)) == NULL ||
+      !expect_keyword(parser, "done")) {
+    free_node(node);
+    return NULL;
+  }
+  return node;
+}
+
+// brace_group: { list }
+static struct ast_node_t* parse_group(struct parser_t* parser) {
+  static const char* const group_end[] = {"}", NULL};
+  struct ast_node_t* node;
+
+  advance(parser);
+  if ((node = parse_list(parser, group_end)) == NULL) {
+    return NULL;
+  }
+  if (!expect_keyword(parser, "}")) {
+    free_node(node);
+    return NULL;
+  }
+  return node;
+}
+
+// function_definition: NAME ( ) newline* command
+static struct ast_node_t* parse_function(struct parser_t* parser) {
+  struct token_t* token = peek(parser);
+  struct ast_node_t* node = new_node(parser, AST_FUNCTION);
+
+  if (node == NULL) {
+    return NULL;
+  }
+  if (!is_valid_name(parser->source + token->start,
+                     token->end - token->start)) {
+    syntax_error(parser, token);
+    free_node(node);
+    return NULL;
+  }
+  if ((node->name = token_text(parser, token, token)) == NULL) {
+    free_node(node);
+    return NULL;
+  }
+  advance(parser);
+  advance(parser);
+  if (peek(parser)->type != TOKEN_RPAREN) {
+    syntax_error_at(parser, peek(parser));
+    free_node(node);
+    return NULL;
+  }
+  advance(parser);
+  skip_newlines(parser);
+  if ((node->second = parse_one_command(parser)) == NULL) {
+    free_node(node);
+    return NULL;
+  }
+  return node;
+}
+
+// command: simple_command | compound_command | function_definition
+static struct ast_node_t* parse_one_command(struct parser_t* parser) {
+  static const char* const reserved[] = {"then", "elif", "else", "fi", "do",
+                                         "done", "}",    "in",   NULL};
+  struct token_t* token = peek(parser);
+
+  if (token->type == TOKEN_REDIRECT) {
+    return parse_simple(parser);
+  }
+  if (token->type != TOKEN_WORD || is_any_keyword(parser, token, reserved)) {
+    syntax_error(parser, token);
+    return NULL;
+  }
+  if (is_keyword(parser, token, "if")) {
+    advance(parser);
+    return parse_if(parser);
+  }
+  if (is_keyword(parser, token, "while")) {
+    return parse_while(parser, AST_WHILE);
+  }
+  if (is_keyword(parser, token, "until")) {
+    return parse_while(parser, AST_UNTIL);
+  }
+  if (is_keyword(parser, token, "for")) {
+    return parse_for(parser);
+  }
+  if (is_keyword(parser, token, "{")) {
+    return parse_group(parser);
+  }
+  if ((token + 1)->type == TOKEN_LPAREN) {
+    return parse_function(parser);
+  }
+  return parse_simple(parser);
+}
+
+// and_or: command ((&& | ||) newline* command)*
+static struct ast_node_t* parse_and_or(struct parser_t* parser) {
+  struct ast_node_t* left = parse_one_command(parser);
+
+  while (left != NULL && (peek(parser)->type == TOKEN_AND ||
+                          peek(parser)->type == TOKEN_OR)) {
+    struct ast_node_t* node = new_node(
+        parser, (peek(parser)->type == TOKEN_AND) ? AST_AND : AST_OR);
+    if (node == NULL) {
+      free_node(left);
+      return NULL;
+    }
+    advance(parser);
+    skip_newlines(parser);
+    node->first = left;
+    if ((node->second = parse_one_command(parser)) == NULL) {
+      free_node(node);
+      return NULL;
+    }
+    left = node;
+  }
+  return left;
+}
+
+// list: newline* and_or ((; | newline) newline* and_or)* [;]
+// Stops before any of the given reserved words. A list inside a compound
+// command that reaches the end of input is incomplete.
+static struct ast_node_t* parse_list(struct parser_t* parser,
+                                     const char* const* stops) {
+  struct ast_node_t* sequence = new_node(parser, AST_SEQUENCE);
+  size_t capacity = 0;
+
+  while (sequence != NULL) {
+    skip_newlines(parser);
+    struct token_t* token = peek(parser);
+    if (token->type == TOKEN_END) {
+      if (stops != NULL) {
+        syntax_error(parser, token);
+        free_node(sequence);
+        return NULL;
+      }
+      break;
+    }
+    if (is_any_keyword(parser, token, stops) || token->type == TOKEN_RPAREN) {
+      break;
+    }
+
+    struct ast_node_t* node = parse_and_or(parser);
+    if (node == NULL) {
+      free_node(sequence);
+      return NULL;
+    }
+    if (sequence->num_children >= capacity) {
+      capacity = capacity ? capacity * 2 : 4;
+      struct ast_node_t** temp_children =
+          realloc(sequence->children, capacity * sizeof(struct ast_node_t*));
+      if (temp_children == NULL) {
+        perror("realloc error in parse_list()");
+        parser->status = COMPILE_FAILURE;
+        free_node(node);
+        free_node(sequence);
+        return NULL;
+      }
+      sequence->children = temp_children;
+    }
+    sequence->children[sequence->num_children++] = node;
+
+    if (peek(parser)->type != TOKEN_SEMI &&
+        peek(parser)->type != TOKEN_NEWLINE) {
+      break;
+    }
+    advance(parser);
+  }
+
+  // A sequence of one command is just the command.
+  if (sequence != NULL && sequence->num_children == 1) {
+    struct ast_node_t* node = sequence->children[0];
+    sequence->num_children = 0;
+    free_node(sequence);
+    return node;
+  }
+  return sequence;
+}
+
+#pragma endregion Parser
+
+#pragma region Interpreter
+
+// Returns the function with the given name, or NULL if there is none.
+static struct shell_function_t* find_function(const char* name) {
+  for (size_t i = 0; i < num_functions; i++) {
+    if (strcmp(functions[i].name, name) == 0) {
+      return &functions[i];
+    }
+  }
+  return NULL;
+}
+
+// Defines or replaces a function. Returns 0 on success, -1 on failure.
+static int define_function(struct ast_node_t* node) {
+  struct shell_function_t* function = find_function(node->name);
+
+  if (function == NULL) {
+    struct shell_function_t* temp_functions =
+        realloc(functions, (num_functions + 1) * sizeof(*functions));
+    if (temp_functions == NULL) {
+      perror("realloc error in define_function()");
+      return -1;
+    }
+    functions = temp_functions;
+    function = &functions[num_functions];
+    if ((function->name = strdup(node->name)) == NULL) {
+      perror("strdup error in define_function()");
+      return -1;
+    }
+    function->program = NULL;
+    num_functions++;
+  }
+
+  retain_program(current_program);
+  release_program(function->program);
+  function->program = current_program;
+  function->body = node->second;
+  return 0;
+}
+
+// Calls a function with the given arguments.
+static int call_function(struct shell_function_t* function, char** argv) {
+  // The function may be redefined while it runs.
+  struct ast_program_t* program = function->program;
+  struct ast_program_t* saved_program = current_program;
+  int status = 1;
+
+  if (push_positional(argv + 1) == VAR_FAILURE) {
+    return status;
+  }
+  retain_program(program);
+  current_program = program;
+  status = exec_node(function->body);
+  current_program = saved_program;
+  release_program(program);
+  pop_positional();
+  return status;
+}
+
+// Returns 1 if the text runs a command substitution when expanded.
+static int has_substitution(const char* text) {
+  return strstr(text, "$(") != NULL || strchr(text, '`') != NULL;
+}
+
+// Expands and parses the words of a command. Returns 0 with the arguments,
+// or NULL if nothing is left, or -1 if the expansion failed.
+static int expand_words(const char* text, char*** argv) {
+  char* expanded = expand_command(text);
+  if (expanded == NULL) {
+    return -1;
+  }
+  *argv = parse_command(expanded);
+
+  // Only a line that was left blank parses to nothing.
+  size_t i = 0;
+  while (isspace((unsigned char)expanded[i])) {
+    i++;
+  }
+  int failed = (*argv == NULL && expanded[i] != '\0');
+  free(expanded);
+  return failed ? -1 : 0;
+}
+
+// Executes a simple command. Redirections are applied to the shell around
+// the command, so builtins and functions honor them too.
+static int exec_simple(struct ast_node_t* node) {
+  const struct builtin_t* builtin = node->builtin;
+  struct saved_fd_t* saved = NULL;
+  char** argv = NULL;
+  int status;
+
+  if (node->needs_expansion) {
+    // A command whose words cannot be expanded fails without running.
+    if (expand_words(node->text, &argv) == -1) {
+      return 1;
+    }
+    builtin = find_builtin(argv);
+  } else if (node->argv != NULL &&
+             (argv = copy_parsed_command(node->argv)) == NULL) {
+    return 1;
+  }
+
+  if (node->num_redirects > 0 &&
+      (saved = apply_redirects(node->redirects, node->num_redirects)) ==
+          NULL) {
+    free_parsed_command(argv);
+    return 1;
+  }
+
+  if (argv == NULL) {
+    // Only redirections, or nothing left after expansion. A command
+    // substitution that expanded to nothing decides the status, as in
+    // "$(false)".
+    status = (node->needs_expansion && has_substitution(node->text))
+                 ? last_exit_status
+                 : 0;
+  } else {
+    struct shell_function_t* function = find_function(argv[0]);
+    if (function != NULL) {
+      status = call_function(function, argv);
+    } else {
+      if (dispatch_command(argv, builtin) == BUILTIN_EXIT) {
+        exit_requested = 1;
+      }
+      status = last_exit_status;
+    }
+  }
+
+  if (saved != NULL) {
+    restore_redirects(saved, node->num_redirects);
+  }
+  free_parsed_command(argv);
+  return status;
+}
+
+// Executes a list of NAME=value assignments.
+static int exec_assignment(struct ast_node_t* node) {
+  int substituted = 0;
+
+  for (size_t i = 0; node->words[i] != NULL; i++) {
+    char* equals = strchr(node->words[i], '=');
+    substituted |= has_substitution(equals + 1);
+    char* value = expand_word(equals + 1);
+    if (value == NULL) {
+      return 1;
+    }
+    *equals = '\0';
+    int result = set_variable(node->words[i], value);
+    *equals = '=';
+    free(value);
+    if (result == VAR_FAILURE) {
+      return 1;
+    }
+  }
+  // Substituted commands decide the status, as in "x=$(false)".
+  return substituted ? last_exit_status : 0;
+}
+
+// Executes a for loop.
+static int exec_for(struct ast_node_t* node) {
+  char** words = node->argv;
+  char** expanded = NULL;
+  int status = 0;
+
+  if (node->text == NULL) {
+    // No word list: loop over the positional parameters.
+    words = get_positional();
+  } else if (node->needs_expansion) {
+    // A word list that cannot be expanded, as in "$((1/0))", fails the loop.
+    if (expand_words(node->text, &expanded) == -1) {
+      return 1;
+    }
+    words = expanded;
+  }
+
+  for (size_t i = 0; words != NULL && words[i] != NULL; i++) {
+    if (set_variable(node->name, words[i]) == VAR_FAILURE) {
+      status = 1;
+      break;
+    }
+    status = exec_node(node->second);
+    if (exit_requested) {
+      break;
+    }
+  }
+  free_parsed_command(expanded);
+  return status;
+}
+
+// Executes a node and returns its exit status.
+static int exec_node(struct ast_node_t* node) {
+  int status = 0;
+
+  switch (node->type) {
+    case AST_SIMPLE:
+      status = exec_simple(node);
+      break;
+    case AST_ASSIGNMENT:
+      status = exec_assignment(node);
+      break;
+    case AST_SEQUENCE:
+      for (size_t i = 0; i < node->num_children && !exit_requested; i++) {
+        status = exec_node(node->children[i]);
+      }
+      break;
+    case AST_AND:
+    case AST_OR:
+      status = exec_node(node->first);
+      if (!exit_requested && ((status == 0) == (node->type == AST_AND))) {
+        status = exec_node(node->second);
+      }
+      break;
+    case AST_IF:
+      status = exec_node(node->first);
+      if (exit_requested) {
+        break;
+      }
+      if (status == 0) {
+        status = exec_node(node->second);
+      } else {
+        status = (node->third != NULL) ? exec_node(node->third) : 0;
+      }
+      break;
+    case AST_WHILE:
+    case AST_UNTIL:
+      while (!exit_requested) {
+        int condition = exec_node(node->first);
+        if (exit_requested ||
+            ((condition == 0) != (node->type == AST_WHILE))) {
+          break;
+        }
+        status = exec_node(node->second);
+      }
+      break;
+    case AST_FOR:
+      status = exec_for(node);
+      break;
+    case AST_FUNCTION:
+      status = (define_function(node) == -1) ? 1 : 0;
+      break;
+  }
+
+  last_exit_status = status;
+  return status;
+}
+
+// Runs a program in a capture child process.
+static int run_captured_program(void* arg) {
+  run_program(arg);
+  return last_exit_status;
+}
+
+#pragma endregion Interpreter
+
+char* capture_program(struct ast_program_t* program, size_t* length) {
+  struct ast_node_t* root = program->root;
+
+  // Simple commands may run in-process if they are capturable builtins.
+  if (root->type == AST_SIMPLE && root->argv != NULL &&
+      !root->needs_expansion && root->num_redirects == 0 &&
+      find_function(root->argv[0]) == NULL) {
+    return capture_command(root->argv, length);
+  }
+  return capture_subshell(run_captured_program, program, length);
+}
+
+void clear_functions(void) {
+  for (size_t i = 0; i < num_functions; i++) {
+    free(functions[i].name);
+    release_program(functions[i].program);
+  }
+  free(functions);
+  functions = NULL;
+  num_functions = 0;
+}
+
+int compile_program(const char* source, struct ast_program_t** program) {
+  struct parser_t parser = {source, NULL, 0, 0, COMPILE_OK, NULL, 0, 0};
+  struct ast_node_t* root = NULL;
+  int status;
+
+  *program = NULL;
+  free(open_delimiter);
+  open_delimiter = NULL;
+  if ((status = tokenize(&parser)) != COMPILE_OK) {
+    parser.status = status;
+  } else if ((root = parse_list(&parser, NULL)) != NULL &&
+             peek(&parser)->type != TOKEN_END) {
+    // A stray ")" or reserved word.
+    syntax_error(&parser, peek(&parser));
+  }
+  free(parser.tokens);
+  for (size_t i = 0; i < parser.num_heredocs; i++) {
+    free(parser.heredocs[i].delimiter);
+  }
+  free(parser.heredocs);
+  if (parser.status != COMPILE_OK) {
+    free_node(root);
+    return parser.status;
+  }
+
+  // Blank lines and comments compile to nothing.
+  if (root->type == AST_SEQUENCE && root->num_children == 0) {
+    free_node(root);
+    return COMPILE_OK;
+  }
+
+  if ((*program = malloc(sizeof(struct ast_program_t))) == NULL) {
+    perror("malloc error in compile_program()");
+    free_node(root);
+    return COMPILE_FAILURE;
+  }
+  (*program)->refcount = 1;
+  (*program)->root = root;
+  return COMPILE_OK;
+}
+
+const char* open_heredoc_delimiter(int* strip_tabs) {
+  *strip_tabs = open_strip_tabs;
+  return open_delimiter;
+}
+
+void release_program(struct ast_program_t* program) {
+  if (program != NULL && --program->refcount == 0) {
+    free_node(program->root);
+    free(program);
+  }
+}
+
+void retain_program(struct ast_program_t* program) {
+  program->refcount++;
+}
+
+int run_program(struct ast_program_t* program) {
+  struct ast_program_t* saved_program = current_program;
+
+  retain_program(program);
+  current_program = program;
+  exec_node(program->root);
+  current_program = saved_program;
+  release_program(program);
+  return exit_requested ? BUILTIN_EXIT : 0;
+}
@@ -0,0 +1,134 @@
+#ifndef AST_UTILS_H
+#define AST_UTILS_H
+
+#define COMPILE_FAILURE -1
+#define COMPILE_INCOMPLETE 1
+#define COMPILE_OK 0
+
+#include <stddef.h>
+
+struct builtin_t;
+struct redirect_t;
+
+// Types of syntax tree nodes.
+enum ast_type_t {
+    AST_SIMPLE,
+    AST_ASSIGNMENT,
+    AST_SEQUENCE,
+    AST_AND,
+    AST_OR,
+    AST_IF,
+    AST_WHILE,
+    AST_UNTIL,
+    AST_FOR,
+    AST_FUNCTION
+};
+
+// Struct holding a node of a compiled command.
+//   AST_SIMPLE:     text is the raw command without its redirections. argv
+//                   and builtin are resolved at compile time unless the text
+//                   needs expansion.
+//   AST_ASSIGNMENT: words holds the raw NAME=value words.
+//   AST_SEQUENCE:   children run in order.
+//   AST_AND/AST_OR: first runs, then second depending on its status.
+//   AST_IF:         first is the condition, second the then-branch and third
+//                   the else-branch (an AST_IF for elif), if any.
+//   AST_WHILE/AST_UNTIL: first is the condition, second the body.
+//   AST_FOR:        name is the loop variable, text the raw word list (NULL
+//                   for the positional parameters), argv the words when no
+//                   expansion is needed, second the body.
+//   AST_FUNCTION:   name is the function name, second the body.
+struct ast_node_t {
+    enum ast_type_t type;
+    char* text;
+    char* name;
+    char** argv;
+    char** words;
+    int needs_expansion;
+    const struct builtin_t* builtin;
+    struct redirect_t* redirects;
+    size_t num_redirects;
+    struct ast_node_t** children;
+    size_t num_children;
+    struct ast_node_t* first;
+    struct ast_node_t* second;
+    struct ast_node_t* third;
+};
+
+// Struct holding a compiled line of input. Programs are shared by the parse
+// cache and by the functions they define, so they are reference counted.
+struct ast_program_t {
+    int refcount;
+    struct ast_node_t* root;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// char* capture_program(struct ast_program_t*, size_t*)
+// Description: Runs a compiled program with its standard output captured.
+// Simple commands go through capture_command(); anything else runs in a
+// child process.
+// Preconditions: A non-null program and length pointer are provided.
+// Postconditions: The output length is stored in the second argument.
+// Return: A newly allocated, NUL-terminated buffer holding the output, or NULL
+// on failure.
+extern char* capture_program(struct ast_program_t*, size_t*);
+
+// void clear_functions()
+// Description: Frees every function defined in the shell.
+// Preconditions: None.
+// Postconditions: The function table is empty.
+// Return: None.
+extern void clear_functions(void);
+
+// int compile_program(const char*, struct ast_program_t**)
+// Description: Compiles a line of input into a syntax tree. Supports the
+// separators ";", newline, "&&" and "||", if/elif/else/fi, while and until
+// loops, for loops, "{ ...; }" groups, "name() { ...; }" functions, and
+// here-documents whose bodies follow on the next lines.
+// Preconditions: A non-null command and program pointer are provided.
+// Postconditions: The compiled program, or NULL for an empty line, is stored in
+// the second argument with a reference count of 1.
+// Return: 0 on success, 1 if the input ends inside a compound command or
+// quote, -1 on a syntax error.
+extern int compile_program(const char*, struct ast_program_t**);
+
+// const char* open_heredoc_delimiter(int*)
+// Description: Reports the here-document the last incomplete compile ran out
+// of input in, so its body can be read in one go.
+// Preconditions: A non-null flag pointer is provided.
+// Postconditions: Whether leading tabs are stripped from the body's lines
+// (<<-) is stored in the argument.
+// Return: The delimiter, valid until the next compile, or NULL if the last
+// compile did not end inside a here-document.
+extern const char* open_heredoc_delimiter(int*);
+
+// void release_program(struct ast_program_t*)
+// Description: Drops a reference to a compiled program.
+// Preconditions: The argument is NULL or a program with references left.
+// Postconditions: The program is freed when its last reference is dropped.
+// Return: None.
+extern void release_program(struct ast_program_t*);
+
+// void retain_program(struct ast_program_t*)
+// Description: Adds a reference to a compiled program.
+// Preconditions: A non-null program is provided.
+// Postconditions: The reference count is incremented.
+// Return: None.
+extern void retain_program(struct ast_program_t*);
+
+// int run_program(struct ast_program_t*)
+// Description: Executes a compiled program.
+// Preconditions: A non-null program is provided.
+// Postconditions: The commands are executed. last_exit_status holds the status
+// of the program.
+// Return: 0 on success, BUILTIN_EXIT if the shell should exit.
+extern int run_program(struct ast_program_t*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AST_UTILS_H
@@ -0,0 +1,298 @@
+// File:    batch_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains functions for running a command whose arguments
+//          are too many for one execve(), split into batches that each fit,
+//          like xargs. Batches can run in parallel. The shell waits for them
+//          by polling their pidfds, so other children, such as background
+//          jobs, are never reaped by mistake.
+
+#define _GNU_SOURCE
+
+#include "batch_utils.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/pidfd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "limit_utils.h"
+#include "output_utils.h"
+#include "profile_utils.h"
+#include "sched_utils.h"
+#include "trace_utils.h"
+#include "usage_utils.h"
+
+extern char** environ;
+
+// Struct holding a running batch.
+//   pid:   Its process id.
+//   pidfd: Its pidfd, readable once it has exited.
+struct batch_job_t {
+    pid_t pid;
+    int pidfd;
+};
+
+// Global variables.
+int auto_batch_enabled = 0;
+
+// Returns the bytes execve() takes for an argument or environment string.
+static size_t string_cost(const char* string) {
+  return strlen(string) + 1 + sizeof(char*);
+}
+
+// Returns the bytes available for arguments: ARG_MAX less the environment,
+// the NULL terminators and the headroom.
+static size_t argument_space(void) {
+  long arg_max = sysconf(_SC_ARG_MAX);
+  size_t used = 2 * sizeof(char*) + BATCH_HEADROOM;
+
+  for (char** variable = environ; variable != NULL && *variable != NULL;
+       variable++) {
+    used += string_cost(*variable);
+  }
+  return (arg_max > 0 && (size_t)arg_max > used) ? (size_t)arg_max - used : 0;
+}
+
+// Starts one batch. Returns 0 on success, -1 on failure.
+static int start_batch(char** argv, struct batch_job_t* job) {
+  PROFILE_COUNT(PROFILE_SPAWNS);
+  pid_t process_id = fork();
+
+  if (process_id < 0) {
+    perror("fork error in start_batch()");
+    return BATCH_FAILURE;
+  }
+  if (process_id == 0) {
+    if (job_limits != NULL) {
+      apply_limits(job_limits);
+    }
+    if (job_sched != NULL) {
+      apply_sched(job_sched);
+    }
+    execvp(argv[0], argv);
+    _exit(EXIT_FAILURE);
+  }
+  trace_launch(process_id, TRACE_FOREGROUND, argv);
+  job->pid = process_id;
+  if ((job->pidfd = pidfd_open(process_id, 0)) == -1) {
+    perror("pidfd_open error in start_batch()");
+  }
+  return 0;
+}
+
+// Waits for a batch and records its exit status. Returns the status.
+static int finish_batch(struct batch_job_t* job) {
+  int status;
+  int exit_status = EXIT_FAILURE;
+  pid_t reaped;
+
+  while ((reaped = waitpid(job->pid, &status, 0)) == -1 && errno == EINTR) {
+  }
+  if (reaped == -1) {
+    perror("waitpid error in finish_batch()");
+  } else {
+    exit_status = exit_status_from_wait(status);
+  }
+  trace_exit(job->pid, exit_status);
+  if (job->pidfd != -1) {
+    close(job->pidfd);
+  }
+  return exit_status;
+}
+
+// Waits until at least one of the running batches has exited and reaps the
+// ones that have. Returns the highest of their exit statuses.
+static int reap_batches(struct batch_job_t* jobs, int* num_jobs) {
+  struct pollfd fds[BATCH_MAX_JOBS];
+  int highest = 0;
+
+  // Without a pidfd, the oldest batch is waited for.
+  for (int i = 0; i < *num_jobs; i++) {
+    if (jobs[i].pidfd == -1) {
+      highest = finish_batch(&jobs[i]);
+      jobs[i] = jobs[--*num_jobs];
+      return highest;
+    }
+    fds[i].fd = jobs[i].pidfd;
+    fds[i].events = POLLIN;
+    fds[i].revents = 0;
+  }
+  while (poll(fds, *num_jobs, -1) == -1) {
+    if (errno != EINTR) {
+      perror("poll error in reap_batches()");
+      break;
+    }
+  }
+
+  // Compact the table, keeping the batches that are still running in order.
+  int kept = 0;
+  for (int i = 0; i < *num_jobs; i++) {
+    if (fds[i].revents != 0) {
+      int status = finish_batch(&jobs[i]);
+      if (status > highest) {
+        highest = status;
+      }
+    } else {
+      jobs[kept++] = jobs[i];
+    }
+  }
+  *num_jobs = kept;
+  return highest;
+}
+
+int batch_command(char** parsed_command, const struct batch_options_t* options) {
+  struct batch_job_t jobs[BATCH_MAX_JOBS];
+  struct rusage before, after, delta;
+  size_t space = argument_space();
+  size_t fixed_cost = 0, num_args = 0;
+  int num_jobs = 0, highest = 0, started = 0, result = 0;
+
+  for (size_t i = 0; i < options->fixed; i++) {
+    fixed_cost += string_cost(parsed_command[i]);
+  }
+  while (parsed_command[options->fixed + num_args] != NULL) {
+    num_args++;
+  }
+  char** argv = malloc((options->fixed + num_args + 1) * sizeof(char*));
+  if (argv == NULL) {
+    perror("argv malloc error in batch_command()");
+    return BATCH_FAILURE;
+  }
+  memcpy(argv, parsed_command, options->fixed * sizeof(char*));
+  char** rest = parsed_command + options->fixed;
+
+  // Batches write straight to standard output.
+  flush_output();
+  getrusage(RUSAGE_CHILDREN, &before);
+  for (size_t next = 0; next < num_args || (num_args == 0 && !started);) {
+    // Take as many arguments as fit.
+    size_t cost = fixed_cost, count = 0;
+    while (next + count < num_args &&
+           (options->max_args == 0 || count < options->max_args)) {
+      size_t length = strlen(rest[next + count]);
+      if (length >= BATCH_MAX_ARG_LENGTH) {
+        fprintf(stderr, "batch: argument %zu is too long\n",
+                options->fixed + next + count);
+        result = BATCH_FAILURE;
+        break;
+      }
+      if (cost + length + 1 + sizeof(char*) > space) {
+        break;
+      }
+      cost += length + 1 + sizeof(char*);
+      count++;
+    }
+    if (result == BATCH_FAILURE) {
+      break;
+    }
+    if (count == 0 && num_args > 0) {
+      fprintf(stderr, "batch: the command does not fit in ARG_MAX\n");
+      result = BATCH_FAILURE;
+      break;
+    }
+
+    if (num_jobs == options->jobs) {
+      int status = reap_batches(jobs, &num_jobs);
+      highest = (status > highest) ? status : highest;
+    }
+    memcpy(argv + options->fixed, rest + next, count * sizeof(char*));
+    argv[options->fixed + count] = NULL;
+    if (start_batch(argv, &jobs[num_jobs]) == BATCH_FAILURE) {
+      result = BATCH_FAILURE;
+      break;
+    }
+    num_jobs++;
+    started = 1;
+    next += count;
+  }
+  while (num_jobs > 0) {
+    int status = reap_batches(jobs, &num_jobs);
+    highest = (status > highest) ? status : highest;
+  }
+  free(argv);
+
+  getrusage(RUSAGE_CHILDREN, &after);
+  subtract_rusage(&delta, &after, &before);
+  if (result == BATCH_FAILURE && highest == 0) {
+    highest = EXIT_FAILURE;
+  }
+  finish_usage(&last_usage, &delta, highest);
+  return (result == BATCH_FAILURE && !started) ? BATCH_FAILURE : 0;
+}
+
+int exceeds_argument_space(char** parsed_command) {
+  size_t cost = 0;
+
+  for (size_t i = 0; parsed_command[i] != NULL; i++) {
+    cost += string_cost(parsed_command[i]);
+  }
+  return cost > argument_space();
+}
+
+int set_up_batch(char** parsed_cmd, struct batch_options_t* options,
+                 char*** command) {
+  int fixed = -1;
+  int i = 1;
+
+  options->fixed = 0;
+  options->max_args = 0;
+  options->jobs = 1;
+  for (; parsed_cmd[i] != NULL && parsed_cmd[i][0] == '-'; i += 2) {
+    const char* value = parsed_cmd[i + 1];
+    char* end;
+    if (strcmp(parsed_cmd[i], "--") == 0) {
+      i++;
+      break;
+    }
+    if (value == NULL || strlen(parsed_cmd[i]) != 2) {
+      return BATCH_FAILURE;
+    }
+    long number = strtol(value, &end, 10);
+    if (*end != '\0' || number < 1) {
+      return BATCH_FAILURE;
+    }
+    switch (parsed_cmd[i][1]) {
+      case 'P':
+        if (number > BATCH_MAX_JOBS) {
+          return BATCH_FAILURE;
+        }
+        options->jobs = (int)number;
+        break;
+      case 'n':
+        options->max_args = (size_t)number;
+        break;
+      case 'c':
+        fixed = (int)number;
+        break;
+      default:
+        return BATCH_FAILURE;
+    }
+  }
+  if (parsed_cmd[i] == NULL) {
+    return BATCH_FAILURE;
+  }
+  *command = parsed_cmd + i;
+
+  // The command and its options are repeated in every batch.
+  if (fixed == -1) {
+    fixed = 1;
+    while ((*command)[fixed] != NULL && (*command)[fixed][0] == '-') {
+      if (strcmp((*command)[fixed++], "--") == 0) {
+        break;
+      }
+    }
+  }
+  for (int j = 0; j < fixed; j++) {
+    if ((*command)[j] == NULL) {
+      return BATCH_FAILURE;
+    }
+  }
+  options->fixed = fixed;
+  return 0;
+}
@@ -0,0 +1,69 @@
+#ifndef BATCH_UTILS_H
+#define BATCH_UTILS_H
+
+#define BATCH_FAILURE -1
+#define BATCH_HEADROOM 4096
+#define BATCH_MAX_ARG_LENGTH 131072
+#define BATCH_MAX_JOBS 256
+
+#include <stddef.h>
+
+// Struct holding how a command's arguments are split into batches.
+//   fixed:    The number of leading words, the command included, repeated in
+//             every batch.
+//   max_args: The most arguments per batch besides those words, or 0 for as
+//             many as fit.
+//   jobs:     The most batches run at once.
+struct batch_options_t {
+    size_t fixed;
+    size_t max_args;
+    int jobs;
+};
+
+// Whether external commands whose arguments do not fit in ARG_MAX are run in
+// batches instead of failing.
+extern int auto_batch_enabled;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// int batch_command(char**, const struct batch_options_t*)
+// Description: Runs an external command as many times as needed to pass all
+// of its arguments, each time with the fixed leading words and as many of the
+// rest as fit in the argument space. The space is sysconf(_SC_ARG_MAX) less
+// the environment and BATCH_HEADROOM bytes. Up to the given number of batches
+// run at once, in the order of their arguments.
+// Preconditions: A non-null command with at least the fixed words and valid
+// options are provided. start_usage() was called on last_usage.
+// Postconditions: The resource usage of every batch and the highest exit
+// status among them are stored in last_usage and last_exit_status.
+// Return: 0 on success, -1 if an argument cannot fit or no batch could start.
+extern int batch_command(char**, const struct batch_options_t*);
+
+// int exceeds_argument_space(char**)
+// Description: Checks whether a command's arguments and the environment are
+// too large for execve(), which would fail with E2BIG.
+// Preconditions: A non-null, NULL-terminated command is provided.
+// Postconditions: None.
+// Return: 1 if they do not fit, 0 otherwise.
+extern int exceeds_argument_space(char**);
+
+// int set_up_batch(char**, struct batch_options_t*, char***)
+// Description: Parses the options of the batch builtin. -P sets the number of
+// batches run at once, -n the most arguments per batch and -c the number of
+// leading words repeated in every batch. By default they are the command and
+// its options up to the first argument not starting with "-", or up to and
+// including "--".
+// Preconditions: A non-null batch command, options and command pointer are
+// provided.
+// Postconditions: The options are filled in and the third argument points at
+// the command after them.
+// Return: 0 on success, -1 on invalid options.
+extern int set_up_batch(char**, struct batch_options_t*, char***);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BATCH_UTILS_H
@@ -0,0 +1,500 @@
+#!/bin/sh
+# File:    bench.sh
+# Author:  Eric Ekey
+# Date:    10/19/2026
+# Desc:    Drives one or more shell binaries with scripted workloads and prints
+#          the results as CSV for regression tracking.
+#
+# Usage:   bench/bench.sh [-t] [-w workload[,workload...]] binary...
+#          -t  Training mode for PGO: small scale, no CSV output.
+#          -w  Only run the named workloads.
+#
+#          history_index is not run by default; it writes about 5GB of
+#          history. Select it with -w history_index.
+#
+#          startup reports the median time from starting a binary on a
+#          pseudo-terminal to its first prompt (startup_prompt) and to its
+#          exit after "exit" is typed (startup_exit), measured by
+#          bench/startup_bench.
+#
+# Environment:
+#          BENCH_SCALE  Multiplier for workload sizes (default 1).
+#          BENCH_RUNS   Runs per workload; the fastest is reported (default 3).
+#          HISTORY_GEN  History file generator (default bench/history_gen).
+#          STARTUP_BENCH      Startup harness (default bench/startup_bench).
+#          STARTUP_RUNS       Starts per binary (default 500).
+#          STARTUP_BUDGET_US  Fail if a binary takes longer than this to
+#                             start and exit (default: no budget).
+#          BENCH_HEAP_MB      Heap the *heap_spawn_storm workloads grow the
+#                             shell by before spawning (default 64).
+#          BENCH_HEREDOC_MB   Size of the large_heredoc body (default 100).
+
+set -eu
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+SCALE=${BENCH_SCALE:-1}
+RUNS=${BENCH_RUNS:-3}
+TRAINING=0
+WORKLOADS="startup builtin_storm spawn_storm long_line large_history
+  substitution substitution_inprocess repeated_line repeated_line_nocache
+  for_loop utilities utilities_external history_pipe jobs_table
+  coproc_requests exec_requests limit_spawn_storm timeout_spawn_storm
+  heap_spawn_storm zygote_heap_spawn_storm large_heredoc arith_loop
+  arith_loop_nocache arith_loop_expr batch_files"
+OVER_BUDGET=0
+
+while getopts "tw:" opt; do
+  case $opt in
+    t) TRAINING=1; SCALE=1; RUNS=1 ;;
+    w) WORKLOADS=$(echo "$OPTARG" | tr ',' ' ') ;;
+    *) echo "Usage: $0 [-t] [-w workloads] binary..." >&2; exit 2 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -eq 0 ]; then
+  echo "Usage: $0 [-t] [-w workloads] binary..." >&2
+  exit 2
+fi
+
+WORK_DIR=$(mktemp -d "${TMPDIR:-/tmp}/simple_shell_bench.XXXXXX")
+trap 'rm -rf "$WORK_DIR"' EXIT INT TERM
+
+# Scales a base iteration count. Training runs use a tenth of the base size.
+scaled() {
+  if [ "$TRAINING" -eq 1 ]; then
+    echo $(($1 / 10))
+  else
+    echo $(($1 * SCALE))
+  fi
+}
+
+now_ns() {
+  date +%s%N
+}
+
+# ---- Workloads ----
+# Each gen_<name> function writes a script to the file given as $1 and prints
+# the number of commands it contains.
+
+# Builtins only: measures prompt, parse, dispatch and history overhead.
+gen_builtin_storm() {
+  n=$(scaled 100000)
+  awk -v n="$n" 'BEGIN { for (i = 0; i < n; i++) print "cd ." }' > "$1"
+  echo "$n"
+}
+
+# External programs only: measures fork/exec/wait overhead. The full path
+# keeps the in-process true builtin out of it.
+gen_spawn_storm() {
+  n=$(scaled 5000)
+  awk -v n="$n" 'BEGIN { for (i = 0; i < n; i++) print "/bin/true" }' > "$1"
+  echo "$n"
+}
+
+# The same programs started under rlimits by the limit builtin: measures
+# the cost of applying them between fork() and exec(). Specific to
+# simple_shell.
+gen_limit_spawn_storm() {
+  n=$(scaled 5000)
+  awk -v n="$n" 'BEGIN {
+    for (i = 0; i < n; i++) print "limit -t 60 -v 1G -n 256 /bin/true"
+  }' > "$1"
+  echo "$n"
+}
+
+# The same programs started with a deadline by the timeout builtin: measures
+# waiting on a pidfd instead of in wait4(). Specific to simple_shell.
+gen_timeout_spawn_storm() {
+  n=$(scaled 5000)
+  awk -v n="$n" 'BEGIN { for (i = 0; i < n; i++) print "timeout 60 /bin/true" }' \
+    > "$1"
+  echo "$n"
+}
+
+# The spawn storm from a shell whose heap has first grown by BENCH_HEAP_MB
+# megabytes, held in a variable: measures how fork() slows down as the
+# address space it copies grows.
+gen_heap_spawn_storm() {
+  n=$(scaled 2000)
+  heap_file="$WORK_DIR/heap.txt"
+  if [ ! -e "$heap_file" ]; then
+    if [ "$TRAINING" -eq 1 ]; then
+      heap_mb=1
+    else
+      heap_mb=${BENCH_HEAP_MB:-64}
+    fi
+    yes 0123456789abcdef | head -c $((heap_mb * 1048576)) > "$heap_file"
+  fi
+  {
+    echo "heap=\"\$(cat $heap_file)\""
+    awk -v n="$n" 'BEGIN { for (i = 0; i < n; i++) print "/bin/true" }'
+  } > "$1"
+  echo "$n"
+}
+
+# The same with SHELL_ZYGOTE set, so the programs are forked from the zygote
+# the shell started before its heap grew. Specific to simple_shell.
+gen_zygote_heap_spawn_storm() {
+  echo "SHELL_ZYGOTE=1" > "$WORK_DIR/$workload.env"
+  gen_heap_spawn_storm "$1"
+}
+
+# A counting loop with arithmetic expansion, compiled once per expression.
+# Also runs under bash and dash for comparison.
+gen_arith_loop() {
+  n=$(scaled 200000)
+  echo "n=0; while [ \$n -lt $n ]; do n=\$((n + 1)); done" > "$1"
+  echo "$n"
+}
+
+# The same loop with the parse cache, and so the expression cache, switched
+# off.
+gen_arith_loop_nocache() {
+  n=$(scaled 200000)
+  {
+    echo "option parse_cache off"
+    echo "n=0; while [ \$n -lt $n ]; do n=\$((n + 1)); done"
+  } > "$1"
+  echo "$n"
+}
+
+# The same loop counting with expr, as scripts did before arithmetic
+# expansion. Also runs under bash and dash for comparison.
+gen_arith_loop_expr() {
+  n=$(scaled 2000)
+  echo "n=0; while [ \$n -lt $n ]; do n=\$(expr \$n + 1); done" > "$1"
+  echo "$n"
+}
+
+# One here-document of BENCH_HEREDOC_MB megabytes fed to wc: measures reading
+# the body and passing it to the child, which simple_shell does through a memfd
+# and bash through a temporary file. Also runs under bash and dash for
+# comparison.
+gen_large_heredoc() {
+  if [ "$TRAINING" -eq 1 ]; then
+    heredoc_mb=1
+  else
+    heredoc_mb=${BENCH_HEREDOC_MB:-100}
+  fi
+  {
+    echo "wc -c <<EOF"
+    yes 0123456789abcdef | head -n $((heredoc_mb * 1048576 / 17))
+    echo "EOF"
+  } > "$1"
+  echo 1
+}
+
+# Creates and removes a million files, more than one execve() can take, in
+# batches sized to ARG_MAX. The removal runs four batches at once.
+gen_batch_files() {
+  n=$(scaled 1000000)
+  dir="$WORK_DIR/batch_files"
+  {
+    echo "mkdir -p $dir"
+    echo "cd $dir"
+    echo "batch touch \$(seq $n)"
+    echo "batch -P 4 rm -f \$(seq $n)"
+  } > "$1"
+  echo 4
+}
+
+# Long lines with many quoted and escaped words: measures parse_command().
+gen_long_line() {
+  n=$(scaled 2000)
+  awk -v n="$n" 'BEGIN {
+    line = "prompt \"";
+    for (j = 0; j < 2000; j++) line = line "word\\t" j " ";
+    line = line "\"";
+    for (i = 0; i < n; i++) print line
+  }' > "$1"
+  echo "$n"
+}
+
+# A large session history that is printed repeatedly.
+gen_large_history() {
+  n=$(scaled 50000)
+  awk -v n="$n" 'BEGIN {
+    for (i = 0; i < n; i++) print "cd .";
+    for (i = 0; i < 100; i++) print "history"
+  }' > "$1"
+  echo $((n + 100))
+}
+# Command substitution of an external program. Also runs under bash and dash
+# for comparison.
+gen_substitution() {
+  n=$(scaled 5000)
+  awk -v n="$n" 'BEGIN { for (i = 0; i < n; i++) print "cd \"$(echo .)\"" }' \
+    > "$1"
+  echo "$n"
+}
+
+# Command substitution of a builtin that runs in-process without forking.
+# Specific to simple_shell.
+gen_substitution_inprocess() {
+  n=$(scaled 20000)
+  awk -v n="$n" 'BEGIN {
+    for (i = 0; i < n; i++) print "prompt \"$(/proc/loadavg)\""
+  }' > "$1"
+  echo "$n"
+}
+
+# One identical line repeated, served from the parse cache after the first.
+gen_repeated_line() {
+  n=$(scaled 1000000)
+  awk -v n="$n" 'BEGIN {
+    for (i = 0; i < n; i++) print "prompt \"\\x3e repeated\\tline\""
+  }' > "$1"
+  echo "$n"
+}
+
+# The same workload with the parse cache switched off.
+gen_repeated_line_nocache() {
+  n=$(scaled 1000000)
+  awk -v n="$n" 'BEGIN {
+    print "option parse_cache off";
+    for (i = 0; i < n; i++) print "prompt \"\\x3e repeated\\tline\""
+  }' > "$1"
+  echo $((n + 1))
+}
+
+# A single for loop of builtins, compiled once. Also runs under bash and dash
+# for comparison.
+gen_for_loop() {
+  n=$(scaled 1000000)
+  echo "for i in \$(seq $n); do cd .; done" > "$1"
+  echo "$n"
+}
+
+# Trivial utilities that run in-process: echo, printf, test, [, true, false
+# and cat. Also runs under bash and dash for comparison.
+gen_utilities() {
+  n=$(scaled 20000)
+  printf 'line one\nline two\n' > "$WORK_DIR/cat_input.txt"
+  awk -v n="$n" -v f="$WORK_DIR/cat_input.txt" 'BEGIN {
+    for (i = 0; i < n; i++) {
+      print "echo hello " i;
+      print "printf \"%s=%d\\n\" count " i;
+      print "test " i " -ge 0";
+      print "[ -f " f " ]";
+      print "true";
+      print "false";
+      print "cat " f
+    }
+  }' > "$1"
+  echo $((n * 7))
+}
+
+# The same workload with the external programs forced.
+gen_utilities_external() {
+  n=$(scaled 2000)
+  printf 'line one\nline two\n' > "$WORK_DIR/cat_input.txt"
+  awk -v n="$n" -v f="$WORK_DIR/cat_input.txt" 'BEGIN {
+    print "option external_utils on";
+    for (i = 0; i < n; i++) {
+      print "echo hello " i;
+      print "printf \"%s=%d\\n\" count " i;
+      print "test " i " -ge 0";
+      print "[ -f " f " ]";
+      print "true";
+      print "false";
+      print "cat " f
+    }
+  }' > "$1"
+  echo $((n * 7 + 1))
+}
+
+# Random access into a 50M entry history: single entries, ranges and time
+# ranges. The history is generated once into seed_history_index and linked
+# into each run, so the entries the runs append accumulate across runs.
+gen_history_index() {
+  entries=$(scaled 50000000)
+  n=$(scaled 2000)
+  generator=${HISTORY_GEN:-$BENCH_DIR/history_gen}
+  if [ ! -x "$generator" ]; then
+    echo "$generator not found; run make $generator" >&2
+    exit 1
+  fi
+  mkdir -p "$WORK_DIR/seed_history_index"
+  "$generator" "$entries" "$WORK_DIR/seed_history_index/.421sh"
+  awk -v n="$n" -v entries="$entries" 'BEGIN {
+    srand(421);
+    for (i = 0; i < n; i++) {
+      e = int(rand() * entries) + 1;
+      print "history -e " e;
+      print "history -r " e " " e + 9;
+      print "history -T " 1700000000 + int(e / 1000) " " \
+        1700000000 + int(e / 1000);
+      print "history"
+    }
+  }' > "$1"
+  echo $((n * 4))
+}
+
+# Startup is measured per binary by run_startup instead of a script.
+gen_startup() {
+  echo 1
+}
+
+# Prints the startup rows for a binary and checks them against the budget.
+run_startup() {
+  harness=${STARTUP_BENCH:-$BENCH_DIR/startup_bench}
+  if [ ! -x "$harness" ]; then
+    echo "$harness not found; run make $harness" >&2
+    exit 1
+  fi
+  times=$(HISTFILE="$WORK_DIR/startup.421sh" \
+    "$harness" -n "${STARTUP_RUNS:-500}" "$1")
+  awk -v bin="$(basename "$1")" -v t="$times" 'BEGIN {
+    split(t, s, " ");
+    printf "%s,startup_prompt,1,%s,%.1f\n", bin, s[1], (s[1] > 0) ? 1 / s[1] : 0;
+    printf "%s,startup_exit,1,%s,%.1f\n", bin, s[2], (s[2] > 0) ? 1 / s[2] : 0
+  }'
+  if [ -n "${STARTUP_BUDGET_US:-}" ] &&
+    ! awk -v t="${times#* }" -v b="$STARTUP_BUDGET_US" \
+      'BEGIN { exit !(t * 1e6 <= b) }'; then
+    echo "$(basename "$1"): startup took ${times#* }s, over the" \
+      "${STARTUP_BUDGET_US}us budget" >&2
+    OVER_BUDGET=1
+  fi
+}
+
+# Prints a 1M entry history into a pipe ten times. The history is generated
+# once into seed_history_pipe.
+gen_history_pipe() {
+  entries=$(scaled 1000000)
+  generator=${HISTORY_GEN:-$BENCH_DIR/history_gen}
+  if [ ! -x "$generator" ]; then
+    echo "$generator not found; run make $generator" >&2
+    exit 1
+  fi
+  mkdir -p "$WORK_DIR/seed_history_pipe"
+  "$generator" "$entries" "$WORK_DIR/seed_history_pipe/.421sh"
+  touch "$WORK_DIR/history_pipe.pipe"
+  awk -v n="$entries" 'BEGIN { for (i = 0; i < 10; i++) print "history " n }' \
+    > "$1"
+  echo 10
+}
+
+# Lists a table of background jobs repeatedly. The sleeps outlive the run, so
+# each listing has the whole table to print. Their output is redirected, so
+# they do not hold the pipe open.
+gen_jobs_table() {
+  jobs=$(scaled 1000)
+  n=$(scaled 200)
+  touch "$WORK_DIR/jobs_table.pipe"
+  awk -v jobs="$jobs" -v n="$n" 'BEGIN {
+    for (i = 0; i < jobs; i++) print "sleep 5 > /dev/null 2>&1 &";
+    for (i = 0; i < n; i++) print "jobs"
+  }' > "$1"
+  echo $((jobs + n))
+}
+
+# The helper program for the request workloads. mawk reads pipes in blocks
+# unless it is interactive, which would stall a coprocess.
+if awk -W version 2>/dev/null | grep -q mawk; then
+  LINE_AWK="awk -W interactive"
+else
+  LINE_AWK="awk"
+fi
+
+# Requests sent line by line to one long-lived awk started with coproc. The
+# rate is requests per second. Specific to simple_shell.
+gen_coproc_requests() {
+  n=$(scaled 5000)
+  awk -v n="$n" -v helper="$LINE_AWK" 'BEGIN {
+    printf "coproc %s \047{ print toupper($0); fflush() }\047\n", helper;
+    for (i = 0; i < n; i++) {
+      print "echo request " i " >&$COPROC_WRITE";
+      print "read -u $COPROC_READ reply"
+    }
+    print "coproc -c"
+  }' > "$1"
+  echo "$n"
+}
+
+# The same requests, each answered by a new awk process.
+gen_exec_requests() {
+  n=$(scaled 1000)
+  awk -v n="$n" 'BEGIN {
+    for (i = 0; i < n; i++) {
+      printf "awk \047BEGIN { print toupper(ARGV[1]) }\047 \"request %d\"\n", i
+    }
+  }' > "$1"
+  echo "$n"
+}
+
+# Runs a script through a binary and prints the elapsed time in seconds.
+time_script() {
+  binary=$1
+  script=$2
+  run_dir="$WORK_DIR/run"
+  rm -rf "$run_dir"
+  mkdir -p "$run_dir"
+  if [ -d "$WORK_DIR/seed_$workload" ]; then
+    ln "$WORK_DIR/seed_$workload"/.421sh* "$run_dir"
+  fi
+  # Some workloads set environment variables, one assignment per line.
+  env_vars=""
+  if [ -e "$WORK_DIR/$workload.env" ]; then
+    env_vars=$(cat "$WORK_DIR/$workload.env")
+  fi
+  start=$(now_ns)
+  if [ -e "$WORK_DIR/$workload.pipe" ]; then
+    # Output-heavy workloads write into a pipe, as they would in a script.
+    (cd "$run_dir" && env HISTFILE="$run_dir/.421sh" $env_vars "$binary" \
+      < "$script" 2>&1 | cat > /dev/null) || true
+  else
+    (cd "$run_dir" && env HISTFILE="$run_dir/.421sh" $env_vars "$binary" \
+      < "$script" > /dev/null 2>&1) || true
+  fi
+  end=$(now_ns)
+  awk -v s="$start" -v e="$end" 'BEGIN { printf "%.6f\n", (e - s) / 1e9 }'
+}
+
+if [ "$TRAINING" -eq 0 ]; then
+  echo "binary,workload,commands,seconds,commands_per_sec"
+fi
+
+for workload in $WORKLOADS; do
+  if [ "$workload" = startup ]; then
+    # Not part of the PGO training run, which times nothing.
+    if [ "$TRAINING" -eq 0 ]; then
+      for binary in "$@"; do
+        case $binary in
+          /*) ;;
+          *) binary="$(pwd)/$binary" ;;
+        esac
+        run_startup "$binary"
+      done
+    fi
+    continue
+  fi
+  script="$WORK_DIR/$workload.sh"
+  commands=$("gen_$workload" "$script")
+
+  for binary in "$@"; do
+    case $binary in
+      /*) ;;
+      *) binary="$(pwd)/$binary" ;;
+    esac
+
+    best=""
+    run=0
+    while [ "$run" -lt "$RUNS" ]; do
+      seconds=$(time_script "$binary" "$script")
+      best=$(awk -v a="$best" -v b="$seconds" \
+        'BEGIN { if (a == "" || b < a) print b; else print a }')
+      run=$((run + 1))
+    done
+
+    if [ "$TRAINING" -eq 0 ]; then
+      awk -v bin="$(basename "$binary")" -v w="$workload" -v c="$commands" \
+        -v s="$best" 'BEGIN {
+          printf "%s,%s,%d,%s,%.1f\n", bin, w, c, s, (s > 0) ? c / s : 0
+        }'
+    fi
+  done
+done
+
+exit "$OVER_BUDGET"
@@ -0,0 +1,196 @@
+// File:    capture_bench.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains a harness that measures what capturing the
+//          output of chatty background jobs costs the shell. It runs the
+//          shell on a pseudo-terminal, so it waits for input in its event
+//          loop, starts many background seq commands and waits for them to
+//          finish, once writing to the terminal and once with
+//          capture_output on. The shell's CPU time and peak memory are read
+//          from /proc before it exits.
+//
+// Usage:   capture_bench [-j jobs] [-n lines] binary
+//          Prints CSV with the shell's CPU time and peak memory in each mode.
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <poll.h>
+#include <pty.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_JOBS 50
+#define DEFAULT_LINES 200000
+#define SETTLE_MS 300
+
+// Returns the monotonic time in seconds.
+static double now_seconds(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Writes a line to the shell's terminal.
+static void send_line(int fd, const char* line) {
+  size_t length = strlen(line);
+  if (write(fd, line, length) != (ssize_t)length || write(fd, "\n", 1) != 1) {
+    perror("write error in send_line()");
+  }
+}
+
+// Counts the shell's children that have not exited.
+static int running_children(pid_t shell) {
+  char path[64], state;
+  int running = 0;
+
+  snprintf(path, sizeof(path), "/proc/%d/task/%d/children", shell, shell);
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    return 0;
+  }
+  int child;
+  while (fscanf(file, "%d", &child) == 1) {
+    snprintf(path, sizeof(path), "/proc/%d/stat", child);
+    FILE* stat = fopen(path, "r");
+    if (stat != NULL && fscanf(stat, "%*d (%*[^)]) %c", &state) == 1 &&
+        state != 'Z') {
+      running++;
+    }
+    if (stat != NULL) {
+      fclose(stat);
+    }
+  }
+  fclose(file);
+  return running;
+}
+
+// Reads a process's CPU time in milliseconds and peak resident memory in
+// kilobytes.
+static void read_usage(pid_t pid, double* cpu_ms, long* peak_kb) {
+  char path[64], line[256];
+  unsigned long user = 0, system = 0;
+
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  FILE* file = fopen(path, "r");
+  if (file != NULL) {
+    if (fscanf(file, "%*d (%*[^)]) %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+                     "%lu %lu",
+               &user, &system) != 2) {
+      user = system = 0;
+    }
+    fclose(file);
+  }
+  *cpu_ms = (user + system) * 1000.0 / sysconf(_SC_CLK_TCK);
+
+  *peak_kb = 0;
+  snprintf(path, sizeof(path), "/proc/%d/status", pid);
+  if ((file = fopen(path, "r")) != NULL) {
+    while (fgets(line, sizeof(line), file) != NULL) {
+      if (sscanf(line, "VmHWM: %ld", peak_kb) == 1) {
+        break;
+      }
+    }
+    fclose(file);
+  }
+}
+
+// Runs the shell on a pseudo-terminal with the jobs started in the
+// background, and prints its usage once they have finished. Returns 0 on
+// success, -1 on failure.
+static int run_shell(const char* binary, int capture, int jobs, long lines) {
+  char command[64];
+  char buffer[65536];
+  int master;
+  long long terminal_bytes = 0;
+
+  fflush(stdout);
+  double start = now_seconds();
+  pid_t shell = forkpty(&master, NULL, NULL, NULL);
+  if (shell == -1) {
+    perror("forkpty error in run_shell()");
+    return -1;
+  }
+  if (shell == 0) {
+    execl(binary, binary, (char*)NULL);
+    _exit(127);
+  }
+
+  if (capture) {
+    send_line(master, "option capture_output on");
+  }
+  snprintf(command, sizeof(command), "seq %ld &", lines);
+  for (int i = 0; i < jobs; i++) {
+    send_line(master, command);
+  }
+
+  // Keep reading the terminal until the jobs have finished and the shell
+  // has been idle for a while.
+  double idle_since = 0;
+  while (1) {
+    struct pollfd fds = {master, POLLIN, 0};
+    if (poll(&fds, 1, 10) > 0) {
+      ssize_t bytes_read = read(master, buffer, sizeof(buffer));
+      if (bytes_read <= 0) {
+        break;
+      }
+      terminal_bytes += bytes_read;
+      idle_since = 0;
+      continue;
+    }
+    if (running_children(shell) > 0) {
+      idle_since = 0;
+    } else if (idle_since == 0) {
+      idle_since = now_seconds();
+    } else if (now_seconds() - idle_since > SETTLE_MS / 1000.0) {
+      break;
+    }
+  }
+  double seconds = now_seconds() - start - SETTLE_MS / 1000.0;
+
+  double cpu_ms;
+  long peak_kb;
+  read_usage(shell, &cpu_ms, &peak_kb);
+  send_line(master, "exit");
+  while (read(master, buffer, sizeof(buffer)) > 0) {
+  }
+  close(master);
+  waitpid(shell, NULL, 0);
+
+  printf("%s,%d,%ld,%.1f,%ld,%lld,%.2f\n", capture ? "capture" : "terminal",
+         jobs, lines, cpu_ms, peak_kb, terminal_bytes, seconds);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  int jobs = DEFAULT_JOBS;
+  long lines = DEFAULT_LINES;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "j:n:")) != -1) {
+    if (opt == 'j' && atoi(optarg) > 0) {
+      jobs = atoi(optarg);
+    } else if (opt == 'n' && atol(optarg) > 0) {
+      lines = atol(optarg);
+    } else {
+      optind = argc;
+      break;
+    }
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, "Usage: %s [-j jobs] [-n lines] binary\n", argv[0]);
+    return 2;
+  }
+
+  printf("mode,jobs,lines_per_job,shell_cpu_ms,shell_peak_kb,terminal_bytes,"
+         "seconds\n");
+  if (run_shell(argv[optind], 0, jobs, lines) == -1 ||
+      run_shell(argv[optind], 1, jobs, lines) == -1) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,113 @@
+// File:    history_gen.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains a generator for large history files in the
+//          shell's on-disk format, used by the history_index benchmark.
+//          Going through the shell would take hours for 50M entries.
+//
+// Usage:   history_gen count path
+//          Writes path and path.idx with count entries, one millisecond apart
+//          starting at HISTORY_GEN_START (seconds since the epoch).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../history_utils.h"
+
+#define HISTORY_GEN_START 1700000000LL
+#define WRITE_BUFFER_SIZE (1 << 20)
+
+// FNV-1a hash, continued from a previous value, as in history_utils.c.
+static uint32_t checksum_bytes(uint32_t hash, const void* bytes, size_t size) {
+  const unsigned char* p = bytes;
+
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ p[i]) * 16777619u;
+  }
+  return hash;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s count path\n", argv[0]);
+    return 1;
+  }
+  long long count = atoll(argv[1]);
+  char* index_path = malloc(strlen(argv[2]) + strlen(HISTORY_INDEX_SUFFIX) + 1);
+  if (index_path == NULL) {
+    perror("malloc error in main()");
+    return 1;
+  }
+  strcpy(index_path, argv[2]);
+  strcat(index_path, HISTORY_INDEX_SUFFIX);
+
+  FILE* data_file = fopen(argv[2], "w");
+  FILE* index_file = fopen(index_path, "w");
+  if (data_file == NULL || index_file == NULL) {
+    perror("fopen error in main()");
+    return 1;
+  }
+  setvbuf(data_file, NULL, _IOFBF, WRITE_BUFFER_SIZE);
+  setvbuf(index_file, NULL, _IOFBF, WRITE_BUFFER_SIZE);
+
+  // Headers: the magic strings. The index header is completed at the end.
+  struct history_index_header_t index_header;
+  memset(&index_header, 0, sizeof(index_header));
+  memcpy(index_header.magic, HISTORY_INDEX_MAGIC, HISTORY_MAGIC_SIZE);
+  fwrite(HISTORY_DATA_MAGIC, 1, HISTORY_MAGIC_SIZE, data_file);
+  fwrite(&index_header, sizeof(index_header), 1, index_file);
+
+  static const char padding[8] = {0};
+  static const char cwd[] = "/home/user/project";
+  char command[64];
+  uint64_t offset = HISTORY_MAGIC_SIZE;
+
+  for (long long i = 0; i < count; i++) {
+    struct history_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.magic = HISTORY_ENTRY_MAGIC;
+    int command_length = snprintf(command, sizeof(command), "make test_%lld", i);
+
+    entry.status = (i % 7 == 0);
+    entry.timestamp = (HISTORY_GEN_START * 1000 + i) * 1000000LL;
+    entry.cwd_length = sizeof(cwd) - 1;
+    entry.command_length = command_length;
+    entry.wall_seconds = 0.001;
+    entry.user_usec = 500;
+    entry.sys_usec = 250;
+    entry.maxrss = 4096;
+    size_t unpadded = sizeof(entry) + sizeof(cwd) + command_length + 1;
+    entry.length = (unpadded + 7) & ~(size_t)7;
+    const char* checked = (const char*)&entry.length;
+    entry.checksum = checksum_bytes(2166136261u, checked,
+                                    sizeof(entry) - (checked - (char*)&entry));
+    entry.checksum = checksum_bytes(entry.checksum, cwd, sizeof(cwd));
+    entry.checksum = checksum_bytes(entry.checksum, command, command_length + 1);
+    entry.checksum =
+        checksum_bytes(entry.checksum, padding, entry.length - unpadded);
+
+    struct history_index_t index_entry = {offset, entry.timestamp};
+    fwrite(&entry, sizeof(entry), 1, data_file);
+    fwrite(cwd, 1, sizeof(cwd), data_file);
+    fwrite(command, 1, command_length + 1, data_file);
+    fwrite(padding, 1, entry.length - unpadded, data_file);
+    fwrite(&index_entry, sizeof(index_entry), 1, index_file);
+    offset += entry.length;
+  }
+
+  // Every entry is indexed, up to the end of the data file.
+  index_header.indexed_end = offset;
+  if (fseek(index_file, 0, SEEK_SET) == -1 ||
+      fwrite(&index_header, sizeof(index_header), 1, index_file) != 1) {
+    perror("index header error in main()");
+    return 1;
+  }
+
+  if (fclose(data_file) != 0 || fclose(index_file) != 0) {
+    perror("fclose error in main()");
+    return 1;
+  }
+  free(index_path);
+  return 0;
+}
@@ -0,0 +1,61 @@
+#!/bin/sh
+# File:    history_stress.sh
+# Author:  Eric Ekey
+# Date:    10/19/2026
+# Desc:    Runs many shells at once against one shared history and checks
+#          that every command was recorded exactly once and in full.
+#
+# Usage:   bench/history_stress.sh binary [shells [commands]]
+#          Defaults to 64 shells of 500 commands each. Every 50th command is
+#          longer than a page, so writes cross page boundaries, and every
+#          10th is a history lookup, so readers merge while others write.
+
+set -eu
+
+BINARY=$1
+SHELLS=${2:-64}
+COMMANDS=${3:-500}
+
+WORK_DIR=$(mktemp -d "${TMPDIR:-/tmp}/simple_shell_history.XXXXXX")
+trap 'rm -rf "$WORK_DIR"' EXIT INT TERM
+HISTFILE="$WORK_DIR/.421sh"
+export HISTFILE
+
+LONG=$(awk 'BEGIN { for (i = 0; i < 5000; i++) printf "x" }')
+s=0
+while [ "$s" -lt "$SHELLS" ]; do
+  awk -v s="$s" -v n="$COMMANDS" -v long="$LONG" 'BEGIN {
+    for (i = 0; i < n; i++) {
+      if (i % 50 == 49) print "true s" s " c" i " " long;
+      else print "true s" s " c" i;
+      if (i % 10 == 9) print "history -e 1"
+    }
+  }' > "$WORK_DIR/script_$s"
+  s=$((s + 1))
+done
+
+s=0
+while [ "$s" -lt "$SHELLS" ]; do
+  "$BINARY" < "$WORK_DIR/script_$s" > /dev/null 2>&1 &
+  s=$((s + 1))
+done
+wait
+
+# Every command must appear once, whole, and after the previous command of the
+# same shell.
+echo "history -r 1 $((SHELLS * COMMANDS * 2))" | "$BINARY" 2>&1 |
+  awk -F '\t' -v shells="$SHELLS" -v n="$COMMANDS" -v long="$LONG" '
+    split($2, word, " ") >= 3 && word[1] == "true" {
+      s = substr(word[2], 2); i = substr(word[3], 2) + 0;
+      if ((i % 50 == 49) != (word[4] == long)) { print "torn: " $0; bad++ }
+      if (seen[s, i]++) { print "duplicate: s" s " c" i; bad++ }
+      if (s in last && last[s] >= i) { print "out of order: s" s " c" i; bad++ }
+      last[s] = i; total++
+    }
+    END {
+      expected = shells * n;
+      if (total != expected) { print "recorded " total " of " expected; bad++ }
+      if (bad) exit 1;
+      printf "history_stress: %d shells, %d commands, none lost or torn.\n",
+        shells, total
+    }'
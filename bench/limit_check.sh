@@ -0,0 +1,89 @@
+#!/bin/sh
+# File:    limit_check.sh
+# Author:  Eric Ekey
+# Date:    10/19/2026
+# Desc:    Checks that the limit builtin applies its limits. CPU time, address
+#          space and open files are checked as rlimits. When a cgroup v2
+#          hierarchy is mounted and writable, jobs are placed in a leaf
+#          cgroup and its cpu.weight and memory.max are checked if the
+#          controllers are enabled there, or their nice and rlimit fallbacks
+#          if they are not.
+#
+# Usage:   bench/limit_check.sh binary
+
+set -eu
+
+BINARY=$1
+FAILED=0
+
+WORK_DIR=$(mktemp -d "${TMPDIR:-/tmp}/simple_shell_limit.XXXXXX")
+CGROUP_MOUNT=$(awk '{
+  for (i = 1; i <= NF; i++) if ($i == "-") { if ($(i + 1) == "cgroup2") print $5; break }
+}' /proc/self/mountinfo | head -n 1)
+LEAF="simple_shell_limit_check.$$"
+cleanup() {
+  rm -rf "$WORK_DIR"
+  if [ -n "$CGROUP_MOUNT" ] && [ -d "$CGROUP_MOUNT/$LEAF" ]; then
+    rmdir "$CGROUP_MOUNT/$LEAF" 2>/dev/null || true
+  fi
+}
+trap cleanup EXIT INT TERM
+HISTFILE="$WORK_DIR/.421sh"
+export HISTFILE
+
+# Runs a script through the shell and prints its output without prompts or
+# background job notices.
+run() {
+  printf '%s\n' "$@" > "$WORK_DIR/script"
+  "$BINARY" < "$WORK_DIR/script" 2>&1 |
+    sed 's/\x1b\[[0-9;]*m//g; s/^\([^$]*\$ \)*//; /^Started background process/d'
+}
+
+# Compares the output of a script with the expected output.
+check() {
+  name=$1
+  expected=$2
+  shift 2
+  actual=$(run "$@")
+  if [ "$actual" = "$expected" ]; then
+    echo "limit_check: $name ok"
+  else
+    echo "limit_check: $name FAILED: expected '$expected', got '$actual'" >&2
+    FAILED=1
+  fi
+}
+
+check "open files" "16" "limit -n 16 sh -c 'ulimit -n'"
+check "address space" "65536" "limit -v 64M sh -c 'ulimit -v'"
+check "cpu time" "152" \
+  "limit -t 1 sh -c 'while :; do :; done'" 'echo $?'
+
+# A runaway background job is gone once its CPU time is used up.
+check "background cpu time" "No active background processes." \
+  "limit -t 1 sh -c 'while :; do :; done' > /dev/null &" \
+  "/bin/sleep 3" "jobs"
+
+if [ -n "$CGROUP_MOUNT" ] && mkdir "$CGROUP_MOUNT/$LEAF" 2>/dev/null; then
+  check "cgroup placement" "0::/$LEAF" \
+    "limit -g $LEAF sh -c 'grep ^0:: /proc/self/cgroup'"
+  if [ -e "$CGROUP_MOUNT/$LEAF/memory.max" ]; then
+    check "cgroup memory.max" "33554432" \
+      "limit -g $LEAF -m 32M true" "cat $CGROUP_MOUNT/$LEAF/memory.max"
+  else
+    check "memory.max fallback" "32768" \
+      "limit -g $LEAF -m 32M sh -c 'ulimit -v' 2> /dev/null"
+  fi
+  if [ -e "$CGROUP_MOUNT/$LEAF/cpu.weight" ]; then
+    check "cgroup cpu.weight" "50" \
+      "limit -g $LEAF -w 50 true" "cat $CGROUP_MOUNT/$LEAF/cpu.weight"
+  else
+    check "cpu.weight fallback" "3" \
+      "limit -g $LEAF -w 50 nice 2> /dev/null"
+  fi
+else
+  echo "limit_check: no writable cgroup v2 hierarchy; checking fallbacks only"
+  check "memory fallback" "32768" "limit -m 32M sh -c 'ulimit -v'"
+  check "weight fallback" "3" "limit -w 50 nice"
+fi
+
+exit "$FAILED"
@@ -0,0 +1,79 @@
+#!/bin/sh
+# File:    prompt_bench.sh
+# Author:  Eric Ekey
+# Date:    10/19/2026
+# Desc:    Measures the time to the first prompt inside a large git
+#          repository, with the git segment computed on the prompt worker
+#          thread and computed before the prompt is drawn. The repository is
+#          generated once, with one tracked file changed so the work tree is
+#          dirty. Prints CSV with the median of STARTUP_RUNS starts.
+#
+# Usage:   bench/prompt_bench.sh binary
+#
+# Environment:
+#          PROMPT_BENCH_FILES  Tracked files in the repository (default
+#                              100000).
+#          STARTUP_BENCH       Startup harness (default bench/startup_bench).
+#          STARTUP_RUNS        Starts per mode (default 50).
+
+set -eu
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+BINARY=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+FILES=${PROMPT_BENCH_FILES:-100000}
+HARNESS=${STARTUP_BENCH:-$BENCH_DIR/startup_bench}
+RUNS=${STARTUP_RUNS:-50}
+
+if [ ! -x "$HARNESS" ]; then
+  echo "$HARNESS not found; run make $HARNESS" >&2
+  exit 1
+fi
+
+WORK_DIR=$(mktemp -d "${TMPDIR:-/tmp}/simple_shell_prompt.XXXXXX")
+trap 'rm -rf "$WORK_DIR"' EXIT INT TERM
+REPO="$WORK_DIR/repo"
+
+# 1000 files per directory.
+mkdir -p "$REPO"
+(
+  cd "$REPO"
+  git init -q .
+  awk -v n="$FILES" 'BEGIN {
+    for (i = 0; i < n; i++) {
+      dir = sprintf("d%04d", int(i / 1000));
+      if (i % 1000 == 0) system("mkdir -p " dir);
+      print i > (dir "/f" i);
+      close(dir "/f" i)
+    }
+  }'
+  git add -A
+  git -c user.name=bench -c user.email=bench@localhost commit -q -m initial
+  echo changed >> d0000/f0
+)
+
+# How long the git segment itself takes to compute.
+start=$(date +%s%N)
+git --no-optional-locks -C "$REPO" status --porcelain --untracked-files=no \
+  > /dev/null
+end=$(date +%s%N)
+
+echo "binary,mode,files,seconds"
+awk -v f="$FILES" -v s="$start" -v e="$end" \
+  'BEGIN { printf "git,status,%d,%.6f\n", f, (e - s) / 1e9 }'
+
+# Starts the shell in the repository and prints the median time to its first
+# prompt, with the given environment assignments.
+time_prompt() {
+  (cd "$REPO" && env HISTFILE="$WORK_DIR/.421sh" "$@" "$HARNESS" -n "$RUNS" \
+    "$BINARY") | cut -d ' ' -f 1
+}
+
+for mode in cwd async sync; do
+  case $mode in
+    cwd) seconds=$(time_prompt PROMPT_SEGMENTS=cwd) ;;
+    async) seconds=$(time_prompt PROMPT_SEGMENTS="cwd git status jobs load") ;;
+    sync) seconds=$(time_prompt PROMPT_SEGMENTS="cwd git status jobs load" \
+      SHELL_SYNC_PROMPT=1) ;;
+  esac
+  echo "$(basename "$BINARY"),$mode,$FILES,$seconds"
+done
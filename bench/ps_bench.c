@@ -0,0 +1,133 @@
+// File:    ps_bench.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains a harness that measures how long the ps builtin
+//          takes to scan a large process table. It starts idle children to
+//          fill the table, then runs the shell with a script of ps commands
+//          using one scanning thread and the default number, and runs the
+//          procps ps for comparison. The shell's startup is measured with a
+//          script of true commands and subtracted.
+//
+// Usage:   ps_bench [-p processes] [-r runs] binary
+//          Prints CSV with the milliseconds per scan of each command.
+
+#define _GNU_SOURCE
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_PROCESSES 10000
+#define DEFAULT_RUNS 10
+#define PROCPS_COMMAND "/bin/ps -e -o pid,ppid,uid,stat,pcpu,rss,time,args"
+
+// Returns the monotonic time in seconds.
+static double now_seconds(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Starts idle children until the count is reached or fork() fails. Returns
+// the number started.
+static long start_children(long count) {
+  long started = 0;
+
+  for (; started < count; started++) {
+    pid_t pid = fork();
+    if (pid == -1) {
+      perror("fork error in start_children()");
+      break;
+    }
+    if (pid == 0) {
+      prctl(PR_SET_PDEATHSIG, SIGKILL);
+      pause();
+      _exit(0);
+    }
+  }
+  return started;
+}
+
+// Runs a shell with a line repeated the given number of times as its script,
+// and its output discarded. Returns the seconds it took, or -1 on failure.
+static double run_shell(const char* binary, const char* line, int runs) {
+  int fds[2];
+
+  if (pipe(fds) == -1) {
+    perror("pipe error in run_shell()");
+    return -1;
+  }
+  fflush(stdout);
+  double start = now_seconds();
+  pid_t pid = fork();
+  if (pid == 0) {
+    dup2(fds[0], STDIN_FILENO);
+    if (freopen("/dev/null", "w", stdout) == NULL) {
+      _exit(127);
+    }
+    close(fds[0]);
+    close(fds[1]);
+    execl(binary, binary, (char*)NULL);
+    _exit(127);
+  }
+  close(fds[0]);
+  FILE* script = fdopen(fds[1], "w");
+  for (int i = 0; i < runs; i++) {
+    fprintf(script, "%s\n", line);
+  }
+  fprintf(script, "exit\n");
+  fclose(script);
+
+  int status;
+  if (pid == -1 || waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "%s failed running %s\n", binary, line);
+    return -1;
+  }
+  return now_seconds() - start;
+}
+
+int main(int argc, char** argv) {
+  long processes = DEFAULT_PROCESSES;
+  int runs = DEFAULT_RUNS;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "p:r:")) != -1) {
+    if (opt == 'p' && atol(optarg) >= 0) {
+      processes = atol(optarg);
+    } else if (opt == 'r' && atoi(optarg) > 0) {
+      runs = atoi(optarg);
+    } else {
+      optind = argc;
+      break;
+    }
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, "Usage: %s [-p processes] [-r runs] binary\n", argv[0]);
+    return 2;
+  }
+  const char* binary = argv[optind];
+
+  long started = start_children(processes);
+  double baseline = run_shell(binary, "true", runs);
+  const char* commands[] = {"ps -t 1", "ps", PROCPS_COMMAND};
+  const char* names[] = {"simple_shell,1", "simple_shell,default", "procps,1"};
+
+  printf("command,threads,processes,ms_per_scan\n");
+  for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+    double seconds = run_shell(binary, commands[i], runs);
+    if (seconds < 0 || baseline < 0) {
+      break;
+    }
+    printf("%s,%ld,%.2f\n", names[i], started,
+           (seconds - baseline) * 1000 / runs);
+  }
+
+  // The children are killed when the harness exits.
+  return 0;
+}
@@ -0,0 +1,91 @@
+#!/bin/sh
+# File:    sched_check.sh
+# Author:  Eric Ekey
+# Date:    10/19/2026
+# Desc:    Checks that the sched builtin applies its settings, reading each
+#          job's CPU affinity from /proc/PID/status and its nice value and
+#          policy from /proc/PID/stat, and that spread_jobs pins background
+#          jobs to every CPU the shell may run on in turn.
+#
+# Usage:   bench/sched_check.sh binary
+
+set -eu
+
+BINARY=$1
+FAILED=0
+
+WORK_DIR=$(mktemp -d "${TMPDIR:-/tmp}/simple_shell_sched.XXXXXX")
+trap 'rm -rf "$WORK_DIR"' EXIT INT TERM
+HISTFILE="$WORK_DIR/.421sh"
+export HISTFILE
+
+# The CPUs this script may run on, one per line.
+CPUS=$(awk '/^Cpus_allowed_list:/ {
+  n = split($2, ranges, ",")
+  for (i = 1; i <= n; i++) {
+    if (split(ranges[i], bounds, "-") == 1) bounds[2] = bounds[1]
+    for (cpu = bounds[1]; cpu <= bounds[2]; cpu++) print cpu
+  }
+}' /proc/self/status)
+FIRST_CPU=$(echo "$CPUS" | head -n 1)
+NUM_CPUS=$(echo "$CPUS" | wc -l)
+
+# Runs a script through the shell and prints its output without prompts or
+# background job notices.
+run() {
+  printf '%s\n' "$@" > "$WORK_DIR/script"
+  "$BINARY" < "$WORK_DIR/script" 2>&1 |
+    sed 's/\x1b\[[0-9;]*m//g; s/^\([^$]*\$ \)*//; /^Started background process/d'
+}
+
+# Compares the output of a script with the expected output.
+check() {
+  name=$1
+  expected=$2
+  shift 2
+  actual=$(run "$@")
+  if [ "$actual" = "$expected" ]; then
+    echo "sched_check: $name ok"
+  else
+    echo "sched_check: $name FAILED: expected '$expected', got '$actual'" >&2
+    FAILED=1
+  fi
+}
+
+# Prints a field of the job's own /proc/PID/stat, after its command name.
+STAT_FIELD='sh -c '\''cut -d")" -f2 /proc/$$/stat | cut -d" " -f$0'\'''
+ALLOWED='sh -c '\''grep ^Cpus_allowed_list: /proc/$$/status | cut -f2'\'''
+
+check "affinity" "$FIRST_CPU" "sched -c $FIRST_CPU $ALLOWED"
+check "cpu list" "$FIRST_CPU" "sched -c $FIRST_CPU-$FIRST_CPU,$FIRST_CPU $ALLOWED"
+check "nice" "7" "sched -n 7 $STAT_FIELD 18"
+check "batch policy" "3" "sched -p batch $STAT_FIELD 40"
+check "idle policy" "5" "sched -p idle $STAT_FIELD 40"
+if command -v ionice > /dev/null; then
+  check "io priority" "best-effort: prio 6" "sched -i be:6 ionice"
+  check "idle io class" "idle" "sched -i idle ionice"
+fi
+check "through limit" "$FIRST_CPU" "sched -c $FIRST_CPU limit -t 5 $ALLOWED"
+check "unavailable cpu" "sched: none of CPUs 1023 are available" \
+  "sched -c 1023 true"
+
+# A background job keeps its affinity.
+check "background affinity" "$FIRST_CPU" \
+  "sched -c $FIRST_CPU $ALLOWED &" "/bin/sleep 1"
+
+# Background jobs started together land on every CPU once, in turn.
+jobs=""
+for cpu in $CPUS; do
+  jobs="$jobs
+sh -c 'sleep 1; grep ^Cpus_allowed_list: /proc/\$\$/status | cut -f2' &"
+done
+actual=$(run "option spread_jobs on" "$jobs" "/bin/sleep 2" | sort -n)
+expected=$(echo "$CPUS" | sort -n)
+if [ "$actual" = "$expected" ]; then
+  echo "sched_check: spread_jobs over $NUM_CPUS CPUs ok"
+else
+  echo "sched_check: spread_jobs FAILED: expected '$expected', got '$actual'" >&2
+  FAILED=1
+fi
+
+exit "$FAILED"
@@ -0,0 +1,125 @@
+#!/bin/sh
+# File:    script_check.sh
+# Author:  Eric Ekey
+# Date:    10/19/2026
+# Desc:    Checks scripts piped into the shell: each line runs exactly once
+#          up to the end of input, even when a command cannot be run,
+#          redirections of descriptors above 2 reach the command, with or
+#          without the zygote, commands whose words cannot be expanded fail,
+#          and the captured output of finished jobs can be shown by job
+#          number.
+#
+# Usage:   bench/script_check.sh binary
+
+set -eu
+
+BINARY=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+FAILED=0
+
+WORK_DIR=$(mktemp -d "${TMPDIR:-/tmp}/simple_shell_script.XXXXXX")
+trap 'rm -rf "$WORK_DIR"' EXIT INT TERM
+HISTFILE="$WORK_DIR/.421sh"
+export HISTFILE
+
+# Runs a script through the shell and prints its output without prompts or
+# continuation prompts or background job notices. A shell that reads its
+# script again is stopped.
+run() {
+  printf '%s\n' "$@" > "$WORK_DIR/script"
+  (cd "$WORK_DIR" && timeout 10 "$BINARY" < "$WORK_DIR/script" 2>&1) |
+    sed 's/\x1b\[[0-9;]*m//g; s/^\([^$]*\$ \)*//; s/^\(> \)*//; /^Started background process/d'
+}
+
+# Compares the output of a script with the expected output.
+check() {
+  name=$1
+  expected=$2
+  shift 2
+  actual=$(run "$@")
+  if [ "$actual" = "$expected" ]; then
+    echo "script_check: $name ok"
+  else
+    echo "script_check: $name FAILED: expected '$expected', got '$actual'" >&2
+    FAILED=1
+  fi
+}
+
+check "command not found" \
+  "one
+shell error: nonexistent_cmd_xyz: command not found
+127
+two
+ZZEND" \
+  "echo one" "nonexistent_cmd_xyz" 'echo $?' "echo two" "echo ZZEND"
+
+# A redirection whose file opens on the very descriptor redirected, as the
+# lowest free one does, must stay open for the command.
+check "high descriptors" "fd3 fd4 fd5 fd6 fd7 fd8 fd9" \
+  "sh -c 'echo fd3 >&3' 3>3.txt" \
+  "sh -c 'echo fd4 >&4' 4>4.txt" \
+  "sh -c 'echo fd5 >&5' 5>5.txt" \
+  "sh -c 'echo fd6 >&6' 6>6.txt" \
+  "sh -c 'echo fd7 >&7' 7>7.txt" \
+  "sh -c 'echo fd8 >&8' 8>8.txt" \
+  "sh -c 'echo fd9 >&9' 9>9.txt" \
+  'echo $(cat 3.txt 4.txt 5.txt 6.txt 7.txt 8.txt 9.txt)'
+
+check "failed expansion" "shell error: bad substitution
+1
+shell error: bad substitution
+skipped" \
+  'echo "${unterminated"' 'echo $?' 'echo "${unterminated" || echo skipped'
+check "empty expansion" "0 1 0 1" \
+  'false' '$empty' 'x=$?' '$(false)' 'y=$?' 'false' '> /dev/null' 'z=$?' \
+  'w=$(false)' 'echo $x $y $z $?'
+check "arithmetic error" "shell error: division by zero
+1
+shell error: division by zero
+else
+shell error: division by zero
+1
+shell error: division by zero
+1" \
+  'echo $((1/0)) && echo ran' 'echo $?' \
+  'if echo $((1/0)); then echo then; else echo else; fi' \
+  'x=$((1/0))' 'echo $?' 'for i in $((1/0)); do echo in; done' 'echo $?'
+
+# Substituted commands that cannot be run are reported too.
+check "substitution not found" \
+  "shell error: nonexistent_cmd_xyz: command not found
+[] 127" \
+  'x=$(nonexistent_cmd_xyz)' 'echo "[$x]" $?'
+
+# Lines no further input can complete fail at once, without swallowing the
+# next line, while open compound commands and "&&" read on.
+check "syntax errors" "shell error: syntax error near unexpected newline
+after1
+shell error: syntax error near unexpected newline
+after2
+a
+b
+t" \
+  'prompt >' 'echo after1' 'echo (' 'echo after2' 'echo a &&' 'echo b' \
+  'if true' 'then echo t' 'fi'
+
+# The zygote only receives the standard descriptors, so the command must get
+# the others another way.
+check "zygote high descriptors" "fd3 fd5" \
+  'option zygote on' "sh -c 'echo fd3 >&3' 3>z3.txt" \
+  "sh -c 'echo fd5 >&5' 5>z5.txt" 'echo $(cat z3.txt z5.txt)'
+
+# Commands the zygote cannot run are reported as forked ones are.
+check "zygote command not found" \
+  "shell error: nonexistent_cmd_xyz: command not found
+127" \
+  'option zygote on' "nonexistent_cmd_xyz" 'echo $?'
+
+# Finished jobs are numbered as output lists them, not as jobs does.
+check "output of finished jobs" "No active background processes.
+second
+first
+No captured output for %1." \
+  'option capture_output on' '/bin/echo first &' '/bin/echo second &' \
+  '/bin/sleep 0.3' 'jobs' 'output %2' 'output %1' 'output %1'
+
+exit "$FAILED"
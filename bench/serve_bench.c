@@ -0,0 +1,353 @@
+// File:    serve_bench.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains a harness that load-tests a shell server. It
+//          starts the shell with --serve, connects many clients at once and
+//          has each send commands one after another, timing every command
+//          from the write to its status record. For comparison, it then runs
+//          the same commands with the same concurrency by starting a shell
+//          for each one.
+//
+// Usage:   serve_bench [-c clients] [-n commands] [-e command] binary
+//          Prints the requests per second and the p50 and p99 latencies in
+//          seconds of both ways.
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../serve_utils.h"
+
+#define DEFAULT_CLIENTS 200
+#define DEFAULT_COMMAND "echo hello"
+#define DEFAULT_COMMANDS 20
+#define START_ATTEMPTS 5000
+#define START_DELAY_NS 1000000
+
+// Struct holding one client of the server.
+//   fd:        The connection, or -1 once all commands have finished.
+//   remaining: Commands still to send.
+//   sent:      When the current command was sent.
+struct client_t {
+    int fd;
+    int remaining;
+    double sent;
+};
+
+// Returns the monotonic time in seconds.
+static double now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+// Prints the rate and latency percentiles of a run.
+static void report(const char* name, double* latencies, int count,
+                   double seconds) {
+  qsort(latencies, count, sizeof(double), compare_doubles);
+  printf("%s %.0f %.6f %.6f\n", name, count / seconds, latencies[count / 2],
+         latencies[(int)(count * 0.99)]);
+}
+
+// Connects to the server and passes it /dev/null as the session's standard
+// descriptors. Returns the connection, or -1 on failure.
+static int connect_client(const struct sockaddr_un* address, int null_fd) {
+  int fds[3] = {null_fd, null_fd, null_fd};
+  union {
+    struct cmsghdr header;
+    char space[CMSG_SPACE(sizeof(fds))];
+  } control;
+  char handshake = '\0';
+  struct iovec data = {&handshake, 1};
+  struct msghdr message;
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  if (fd == -1 ||
+      connect(fd, (const struct sockaddr*)address, sizeof(*address)) == -1) {
+    if (fd != -1) {
+      close(fd);
+    }
+    return -1;
+  }
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  message.msg_control = control.space;
+  message.msg_controllen = sizeof(control.space);
+  struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+  header->cmsg_level = SOL_SOCKET;
+  header->cmsg_type = SCM_RIGHTS;
+  header->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(header), fds, sizeof(fds));
+  if (sendmsg(fd, &message, 0) != 1) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Sends the command of a client and notes the time. Returns 0 on success, -1
+// on failure.
+static int send_command(struct client_t* client, const char* line) {
+  size_t length = strlen(line);
+
+  client->sent = now();
+  client->remaining--;
+  return (write(client->fd, line, length) == (ssize_t)length) ? 0 : -1;
+}
+
+// Runs every client's commands against the server with all clients
+// connected at once. Returns 0 on success, -1 on failure.
+static int run_server(const struct sockaddr_un* address, int num_clients,
+                      int num_commands, const char* line, double* latencies) {
+  struct client_t* clients = calloc(num_clients, sizeof(struct client_t));
+  struct pollfd* polled = calloc(num_clients, sizeof(struct pollfd));
+  int null_fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+  int count = 0, active = num_clients, result = 0;
+
+  if (clients == NULL || polled == NULL || null_fd == -1) {
+    perror("set up error in run_server()");
+    return -1;
+  }
+  for (int i = 0; i < num_clients; i++) {
+    clients[i].remaining = num_commands;
+    if ((clients[i].fd = connect_client(address, null_fd)) == -1 ||
+        send_command(&clients[i], line) == -1) {
+      perror("connect error in run_server()");
+      return -1;
+    }
+  }
+
+  // Each status record is one line, and nothing else comes over the socket.
+  while (active > 0 && result == 0) {
+    for (int i = 0; i < num_clients; i++) {
+      polled[i].fd = clients[i].fd;
+      polled[i].events = POLLIN;
+    }
+    if (poll(polled, num_clients, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("poll error in run_server()");
+      result = -1;
+      break;
+    }
+    for (int i = 0; i < num_clients; i++) {
+      struct client_t* client = &clients[i];
+      char buffer[64];
+      if (client->fd == -1 || polled[i].revents == 0) {
+        continue;
+      }
+      ssize_t length = read(client->fd, buffer, sizeof(buffer));
+      if (length <= 0 || memchr(buffer, '\n', length) == NULL) {
+        fprintf(stderr, "serve_bench: session ended early\n");
+        result = -1;
+        break;
+      }
+      latencies[count++] = now() - client->sent;
+      if (client->remaining > 0) {
+        if (send_command(client, line) == -1) {
+          result = -1;
+        }
+      } else {
+        close(client->fd);
+        client->fd = -1;
+        active--;
+      }
+    }
+  }
+
+  for (int i = 0; i < num_clients; i++) {
+    if (clients[i].fd != -1) {
+      close(clients[i].fd);
+    }
+  }
+  close(null_fd);
+  free(clients);
+  free(polled);
+  return result;
+}
+
+// Starts a shell that runs one command from a pipe and exits. Returns its
+// process id, or -1 on failure.
+static pid_t start_shell(const char* binary, const char* line, int null_fd) {
+  int input[2];
+
+  if (pipe2(input, O_CLOEXEC) == -1) {
+    return -1;
+  }
+  pid_t process_id = fork();
+  if (process_id == 0) {
+    dup2(input[0], STDIN_FILENO);
+    dup2(null_fd, STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+    execl(binary, binary, (char*)NULL);
+    _exit(127);
+  }
+  close(input[0]);
+  if (process_id != -1 && write(input[1], line, strlen(line)) == -1) {
+    perror("write error in start_shell()");
+  }
+  close(input[1]);
+  return process_id;
+}
+
+// Runs the same number of commands by starting a shell for each, with as
+// many shells running at once as there were clients. Returns 0 on success,
+// -1 on failure.
+static int run_shells(const char* binary, int num_clients, int total,
+                      const char* line, double* latencies) {
+  pid_t* shells = calloc(num_clients, sizeof(pid_t));
+  double* started = calloc(num_clients, sizeof(double));
+  int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+  int launched = 0, count = 0;
+
+  if (shells == NULL || started == NULL || null_fd == -1) {
+    perror("set up error in run_shells()");
+    return -1;
+  }
+  for (int i = 0; i < num_clients && launched < total; i++, launched++) {
+    started[i] = now();
+    if ((shells[i] = start_shell(binary, line, null_fd)) == -1) {
+      perror("fork error in run_shells()");
+      return -1;
+    }
+  }
+  while (count < total) {
+    int status;
+    pid_t process_id = waitpid(-1, &status, 0);
+    if (process_id == -1) {
+      perror("waitpid error in run_shells()");
+      return -1;
+    }
+    for (int i = 0; i < num_clients; i++) {
+      if (shells[i] != process_id) {
+        continue;
+      }
+      latencies[count++] = now() - started[i];
+      shells[i] = 0;
+      if (launched < total) {
+        started[i] = now();
+        shells[i] = start_shell(binary, line, null_fd);
+        launched++;
+      }
+      break;
+    }
+  }
+  close(null_fd);
+  free(shells);
+  free(started);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  int num_clients = DEFAULT_CLIENTS, num_commands = DEFAULT_COMMANDS;
+  const char* command = DEFAULT_COMMAND;
+  char directory[] = "/tmp/serve_bench.XXXXXX";
+  struct sockaddr_un address;
+  char line[4096];
+  int opt;
+
+  while ((opt = getopt(argc, argv, "c:n:e:")) != -1) {
+    if (opt == 'c' && atoi(optarg) > 0) {
+      num_clients = atoi(optarg);
+    } else if (opt == 'n' && atoi(optarg) > 0) {
+      num_commands = atoi(optarg);
+    } else if (opt == 'e') {
+      command = optarg;
+    } else {
+      optind = argc;
+      break;
+    }
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, "Usage: %s [-c clients] [-n commands] [-e command] binary\n",
+            argv[0]);
+    return 2;
+  }
+  const char* binary = argv[optind];
+  int total = num_clients * num_commands;
+  snprintf(line, sizeof(line), "%s\n", command);
+
+  // The sessions share a history of their own, removed afterwards.
+  if (mkdtemp(directory) == NULL) {
+    perror("mkdtemp error in main()");
+    return 1;
+  }
+  char history[sizeof(directory) + 16];
+  snprintf(history, sizeof(history), "%s/.421sh", directory);
+  setenv("HISTFILE", history, 1);
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  snprintf(address.sun_path, sizeof(address.sun_path), "%s/socket", directory);
+
+  pid_t server = fork();
+  if (server == 0) {
+    execl(binary, binary, SERVE_OPTION, address.sun_path, (char*)NULL);
+    _exit(127);
+  }
+
+  // Wait for the server to listen.
+  int probe = -1;
+  for (int i = 0; i < START_ATTEMPTS && probe == -1; i++) {
+    struct timespec delay = {0, START_DELAY_NS};
+    probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connect(probe, (struct sockaddr*)&address, sizeof(address)) == -1) {
+      close(probe);
+      probe = -1;
+      nanosleep(&delay, NULL);
+    }
+  }
+  if (probe == -1) {
+    fprintf(stderr, "%s: %s did not start serving\n", argv[0], binary);
+    kill(server, SIGTERM);
+    return 1;
+  }
+  close(probe);
+
+  double* latencies = malloc(total * sizeof(double));
+  if (latencies == NULL) {
+    perror("malloc error in main()");
+    return 1;
+  }
+  int result = 0;
+  double start = now();
+  if (run_server(&address, num_clients, num_commands, line, latencies) == 0) {
+    report("serve", latencies, total, now() - start);
+  } else {
+    result = 1;
+  }
+  kill(server, SIGTERM);
+  waitpid(server, NULL, 0);
+
+  start = now();
+  if (run_shells(binary, num_clients, total, line, latencies) == 0) {
+    report("spawn", latencies, total, now() - start);
+  } else {
+    result = 1;
+  }
+
+  unlink(history);
+  strcat(history, ".idx");
+  unlink(history);
+  rmdir(directory);
+  free(latencies);
+  return result;
+}
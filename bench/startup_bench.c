@@ -0,0 +1,133 @@
+// File:    startup_bench.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains a harness that measures how fast a shell starts.
+//          Each run starts the shell on a pseudo-terminal, as a user would,
+//          and times the first byte of the prompt and the exit after "exit"
+//          is typed.
+//
+// Usage:   startup_bench [-n runs] binary
+//          Prints the median time to the first prompt and to exit in seconds,
+//          separated by a space.
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_RUNS 200
+#define EXIT_COMMAND "exit\n"
+
+// Returns the monotonic time in seconds.
+static double now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+// Starts the binary once. Stores the seconds until the first output and until
+// exit. Returns 0 on success, -1 on failure.
+static int time_start(const char* binary, double* prompt, double* exited) {
+  char buffer[4096];
+  int master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+
+  if (master == -1 || grantpt(master) == -1 || unlockpt(master) == -1) {
+    perror("posix_openpt error in time_start()");
+    return -1;
+  }
+  const char* slave_name = ptsname(master);
+
+  double start = now();
+  pid_t pid = fork();
+  if (pid == -1) {
+    perror("fork error in time_start()");
+    close(master);
+    return -1;
+  }
+  if (pid == 0) {
+    // The terminal becomes the controlling terminal of a new session.
+    setsid();
+    int slave = open(slave_name, O_RDWR);
+    if (slave == -1) {
+      _exit(127);
+    }
+    dup2(slave, STDIN_FILENO);
+    dup2(slave, STDOUT_FILENO);
+    dup2(slave, STDERR_FILENO);
+    if (slave > STDERR_FILENO) {
+      close(slave);
+    }
+    execl(binary, binary, (char*)NULL);
+    _exit(127);
+  }
+
+  // The first output is the prompt, printed when the shell waits for input.
+  ssize_t length;
+  while ((length = read(master, buffer, sizeof(buffer))) == -1 &&
+         errno == EINTR) {
+  }
+  *prompt = now() - start;
+  if (length > 0 && write(master, EXIT_COMMAND, strlen(EXIT_COMMAND)) == -1) {
+    perror("write error in time_start()");
+  }
+
+  // The terminal reports EIO once the shell has closed it.
+  while ((length = read(master, buffer, sizeof(buffer))) > 0 ||
+         (length == -1 && errno == EINTR)) {
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  *exited = now() - start;
+  close(master);
+  return (WIFEXITED(status) && WEXITSTATUS(status) == 127) ? -1 : 0;
+}
+
+int main(int argc, char** argv) {
+  int runs = DEFAULT_RUNS;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:")) != -1) {
+    if (opt == 'n' && atoi(optarg) > 0) {
+      runs = atoi(optarg);
+    } else {
+      fprintf(stderr, "Usage: %s [-n runs] binary\n", argv[0]);
+      return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, "Usage: %s [-n runs] binary\n", argv[0]);
+    return 2;
+  }
+
+  double* prompts = malloc(runs * sizeof(double));
+  double* exits = malloc(runs * sizeof(double));
+  if (prompts == NULL || exits == NULL) {
+    perror("malloc error in main()");
+    return 1;
+  }
+  for (int i = 0; i < runs; i++) {
+    if (time_start(argv[optind], &prompts[i], &exits[i]) == -1) {
+      fprintf(stderr, "%s: could not start %s\n", argv[0], argv[optind]);
+      return 1;
+    }
+  }
+
+  qsort(prompts, runs, sizeof(double), compare_doubles);
+  qsort(exits, runs, sizeof(double), compare_doubles);
+  printf("%.6f %.6f\n", prompts[runs / 2], exits[runs / 2]);
+  free(prompts);
+  free(exits);
+  return 0;
+}
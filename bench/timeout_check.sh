@@ -0,0 +1,59 @@
+#!/bin/sh
+# File:    timeout_check.sh
+# Author:  Eric Ekey
+# Date:    10/19/2026
+# Desc:    Checks the timeout builtin with sleeping children: commands that
+#          finish in time keep their status, commands that overrun are
+#          stopped at the deadline with status 124, SIGTERM is escalated to
+#          SIGKILL, and deadlines hold for background jobs and fg.
+#
+# Usage:   bench/timeout_check.sh binary
+
+set -eu
+
+BINARY=$1
+FAILED=0
+
+WORK_DIR=$(mktemp -d "${TMPDIR:-/tmp}/simple_shell_timeout.XXXXXX")
+trap 'rm -rf "$WORK_DIR"' EXIT INT TERM
+HISTFILE="$WORK_DIR/.421sh"
+export HISTFILE
+
+now_ns() {
+  date +%s%N
+}
+
+# Checks the output of a script and that it ran for at most a number of
+# seconds.
+check() {
+  name=$1
+  expected=$2
+  max_seconds=$3
+  shift 3
+  printf '%s\n' "$@" > "$WORK_DIR/script"
+  start=$(now_ns)
+  actual=$("$BINARY" < "$WORK_DIR/script" 2>&1 |
+    sed 's/\x1b\[[0-9;]*m//g; s/^\([^$]*\$ \)*//; /^Started background process/d')
+  seconds=$(awk -v s="$start" -v e="$(now_ns)" 'BEGIN { print (e - s) / 1e9 }')
+  if [ "$actual" != "$expected" ]; then
+    echo "timeout_check: $name FAILED: expected '$expected', got '$actual'" >&2
+    FAILED=1
+  elif awk -v t="$seconds" -v m="$max_seconds" 'BEGIN { exit !(t > m) }'; then
+    echo "timeout_check: $name FAILED: took ${seconds}s, over ${max_seconds}s" >&2
+    FAILED=1
+  else
+    echo "timeout_check: $name ok (${seconds}s)"
+  fi
+}
+
+check "finishes in time" "0" 1.5 "timeout 5 sleep 0.2" 'echo $?'
+check "keeps exit status" "1" 1 "timeout 5 sh -c 'exit 1'" 'echo $?'
+check "stopped at deadline" "124" 1.5 "timeout 0.3 sleep 10" 'echo $?'
+check "escalates to SIGKILL" "124" 2 \
+  "timeout -k 0.3 0.3 sh -c 'trap \"\" TERM; exec sleep 10'" 'echo $?'
+check "background deadline" "No active background processes." 3 \
+  "timeout 0.3 sleep 10 > /dev/null &" "/bin/sleep 1" "jobs"
+check "fg deadline" "124" 2 \
+  "coproc sleep 10" 'timeout 0.3 fg $COPROC_PID' 'echo $?' "coproc -c"
+
+exit "$FAILED"
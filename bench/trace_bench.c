@@ -0,0 +1,68 @@
+// File:    trace_bench.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains a harness that measures the cost of recording
+//          trace events. It records launch and exit events for a typical
+//          command line, more of them than the ring buffer holds, and
+//          reports the time per event with tracing on and off.
+//
+// Usage:   trace_bench [-n events]
+//          Prints the nanoseconds per event with tracing on and off,
+//          separated by a space.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../trace_utils.h"
+
+#define DEFAULT_EVENTS 4000000
+
+// Returns the monotonic time in nanoseconds.
+static double now_ns(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+// Records launch and exit pairs. Returns the nanoseconds per event.
+static double time_events(long events) {
+  char* argv[] = {"make", "-j8", "CFLAGS=-O2 -g", "all", NULL};
+
+  double start = now_ns();
+  for (long i = 0; i < events / 2; i++) {
+    trace_launch(1000 + (i & 0xffff), TRACE_BACKGROUND, argv);
+    trace_exit(1000 + (i & 0xffff), 0);
+  }
+  return (now_ns() - start) / events;
+}
+
+int main(int argc, char** argv) {
+  long events = DEFAULT_EVENTS;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:")) != -1) {
+    if (opt == 'n' && atol(optarg) > 1) {
+      events = atol(optarg);
+    } else {
+      fprintf(stderr, "Usage: %s [-n events]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (trace_start() == TRACE_FAILURE) {
+    return 1;
+  }
+  // The first pass faults in the buffer's pages.
+  time_events(TRACE_BUFFER_EVENTS);
+  double traced = time_events(events);
+  trace_stop();
+  double untraced = time_events(events);
+  clear_trace();
+
+  printf("%.1f %.1f\n", traced, untraced);
+  return 0;
+}
@@ -1,9 +1,14 @@
+#define _GNU_SOURCE
+
 #include "bg_utils.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/wait.h>
 
+#include "trace_utils.h"
+#include "usage_utils.h"
+
 int append_bg_process(pid_t process_id) {
   if (process_id <= 0) {
     // Process not active.
@@ -15,6 +20,12 @@ int append_bg_process(pid_t process_id) {
     return CLEAR_BG_FAILURE;
   }
 
+  if (bg_processes->process_ids == NULL &&
+      set_up_bg_processes() == SETUP_FAILURE) {
+    // Array allocated on first use.
+    return CLEAR_BG_FAILURE;
+  }
+
   if (bg_processes->num_processes >= bg_processes->capacity) {
     // Array is full, allocate more memory.
     size_t old_capacity = bg_processes->capacity;
@@ -25,12 +36,23 @@ int append_bg_process(pid_t process_id) {
 
     if (temp_pids == NULL) {
       perror("realloc error in append_bg_process()");
+      bg_processes->capacity = old_capacity;
       return CLEAR_BG_FAILURE;
     }
     bg_processes->process_ids = temp_pids;
 
+    int* temp_cpus = realloc(bg_processes->cpus,
+                             (sizeof(int) * bg_processes->capacity));
+    if (temp_cpus == NULL) {
+      perror("realloc error in append_bg_process()");
+      bg_processes->capacity = old_capacity;
+      return CLEAR_BG_FAILURE;
+    }
+    bg_processes->cpus = temp_cpus;
+
     for (int i = old_capacity; i < bg_processes->capacity; i++) {
       bg_processes->process_ids[i] = DEAD_PROCESS_ID;
+      bg_processes->cpus[i] = -1;
     }
   }
 
@@ -40,6 +62,7 @@ int append_bg_process(pid_t process_id) {
     i++;
   }
   bg_processes->process_ids[i] = process_id;
+  bg_processes->cpus[i] = -1;
   bg_processes->num_processes++;
 
   return 0;
@@ -57,10 +80,35 @@ int clear_bg_processes(void) {
   }
 
   free(bg_processes->process_ids);
+  free(bg_processes->cpus);
+  bg_processes->process_ids = NULL;
+  bg_processes->cpus = NULL;
   bg_processes->num_processes = 0;
+  bg_processes->capacity = 0;
   return 0;
 }
 
+pid_t find_bg_job(const char* job) {
+  char* end;
+  long number = strtol(job + (job[0] == '%'), &end, 10);
+
+  if (end == job + (job[0] == '%') || *end != '\0' || number <= 0) {
+    // Not a number greater than 0.
+    return DEAD_PROCESS_ID;
+  }
+  if (job[0] != '%') {
+    return (pid_t)number;
+  }
+
+  // Jobs are numbered in the order jobs lists them.
+  for (size_t i = 0; bg_processes != NULL && i < bg_processes->capacity; i++) {
+    if (bg_processes->process_ids[i] > DEAD_PROCESS_ID && --number == 0) {
+      return bg_processes->process_ids[i];
+    }
+  }
+  return DEAD_PROCESS_ID;
+}
+
 int remove_bg_process(pid_t process_id) {
   if (bg_processes == NULL || bg_processes->process_ids == NULL) {
     // Global struct or process array not initialized.
@@ -71,6 +119,7 @@ int remove_bg_process(pid_t process_id) {
   for (int i = 0; i < bg_processes->capacity; i++) {
     if (bg_processes->process_ids[i] == process_id) {
       bg_processes->process_ids[i] = DEAD_PROCESS_ID;
+      bg_processes->cpus[i] = -1;
       bg_processes->num_processes--;
       return 0;
     }
@@ -80,19 +129,33 @@ int remove_bg_process(pid_t process_id) {
   return REMOVE_BG_FAILURE;
 }
 
+int set_bg_process_cpu(pid_t process_id, int cpu) {
+  for (size_t i = 0; bg_processes != NULL && i < bg_processes->capacity; i++) {
+    if (bg_processes->process_ids[i] == process_id) {
+      bg_processes->cpus[i] = cpu;
+      return 0;
+    }
+  }
+  return REMOVE_BG_FAILURE;
+}
+
 int remove_dead_processes(void) {
-  if (bg_processes == NULL || bg_processes->process_ids == NULL) {
-    // Global struct or process array not initialized.
+  pid_t process_id;
+  int status;
+
+  if (bg_processes == NULL) {
+    // Global struct not initialized.
     return CLEAR_BG_FAILURE;
   }
 
-  for (int i = 0; i < bg_processes->capacity; i++) {
-    // Check if process is still active.
-    if ((waitpid(bg_processes->process_ids[i], NULL, WNOHANG) != 0)) {
-      // Process is no longer active. Set id to default value.
-      bg_processes->process_ids[i] = DEAD_PROCESS_ID;
-      bg_processes->num_processes--;
-    }
+  // Reap only the children that have exited, instead of asking about every
+  // process in the table. Foreground children are always waited for, so any
+  // child left is a background process. Children of the prompt worker thread
+  // are left to it.
+  while (bg_processes->num_processes > 0 &&
+         (process_id = waitpid(-1, &status, WNOHANG | __WNOTHREAD)) > 0) {
+    remove_bg_process(process_id);
+    trace_exit(process_id, exit_status_from_wait(status));
   }
 
   return 0;
@@ -111,6 +174,16 @@ int set_up_bg_processes(void) {
     perror("calloc error in set_up_bg_processes()");
     return SETUP_FAILURE;
   }
+  if ((bg_processes->cpus = malloc(bg_processes->capacity * sizeof(int))) ==
+      NULL) {
+    perror("malloc error in set_up_bg_processes()");
+    free(bg_processes->process_ids);
+    bg_processes->process_ids = NULL;
+    return SETUP_FAILURE;
+  }
+  for (size_t i = 0; i < bg_processes->capacity; i++) {
+    bg_processes->cpus[i] = -1;
+  }
   bg_processes->num_processes = 0;
 
   return 0;
@@ -9,8 +9,13 @@
 #include <unistd.h>
 
 // Struct holding info for background process management.
+//   process_ids:   The jobs' process ids, DEAD_PROCESS_ID in free slots.
+//   cpus:          The CPU each job was pinned to by spread_jobs, or -1.
+//   num_processes: The number of jobs.
+//   capacity:      The number of slots.
 struct bg_processes_t {
     pid_t* process_ids;
+    int* cpus;
     size_t num_processes;
     size_t capacity;
 };
@@ -22,12 +27,22 @@ extern "C" {
 #endif
 
 // int append_bg_process(pid_t)
-// Description: Adds a process id to the bg_processes struct.
+// Description: Adds a process id to the bg_processes struct. The array of
+// process ids is allocated on first use.
 // Preconditions: bg_processes struct is initialized.
 // Postconditions: The process id is added to the array of background processes.
 // Return: 0 on success, -1 on failure.
 extern int append_bg_process(pid_t);
 
+// pid_t find_bg_job(const char*)
+// Description: Finds the background process named by a job argument: "%n" for
+// the nth job listed by jobs, or a process id.
+// Preconditions: A non-null argument is provided.
+// Postconditions: None.
+// Return: The process id, which may not be a background process, or 0 if the
+// argument is invalid or there is no such job.
+extern pid_t find_bg_job(const char*);
+
 // int clear_bg_processes()
 // Description: Resets the bg_processes struct.
 // Preconditions: bg_processes struct is initialized.
@@ -42,6 +57,13 @@ extern int clear_bg_processes(void);
 // Return: 0 on success, -1 on failure.
 extern int remove_bg_process(pid_t);
 
+// int set_bg_process_cpu(pid_t, int)
+// Description: Records the CPU a background process was pinned to.
+// Preconditions: bg_processes struct is initialized.
+// Postconditions: The CPU is stored alongside the process id.
+// Return: 0 on success, -1 if the process is not a background process.
+extern int set_bg_process_cpu(pid_t, int);
+
 // int remove_dead_processes()
 // Description: Removes dead processes from the bg_processes struct.
 // Preconditions: bg_processes struct is initialized.
@@ -0,0 +1,768 @@
+// File:    builtins.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains the table of built-in shell commands and the
+//          argument checking for each of them.
+
+#include "builtins.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "batch_utils.h"
+#include "bg_utils.h"
+#include "capture_utils.h"
+#include "cache_utils.h"
+#include "coproc_utils.h"
+#include "exec_utils.h"
+#include "history_utils.h"
+#include "limit_utils.h"
+#include "output_utils.h"
+#include "profile_utils.h"
+#include "prompt_utils.h"
+#include "sched_utils.h"
+#include "ps_utils.h"
+#include "shell_commands.h"
+#include "timeout_utils.h"
+#include "trace_utils.h"
+#include "usage_utils.h"
+#include "utility_commands.h"
+#include "var_utils.h"
+#include "zygote_utils.h"
+
+#define FWD_SLASH "/"
+#define MAX_HISTORY_SECONDS (INT64_MAX / 1000000000LL)
+#define PROC_CMD "/proc/"
+#define PROC_CMD1 "/proc"
+
+// Global variables.
+int external_utils_enabled = 0;
+
+#pragma region Handlers
+
+// Runs an external command with its arguments split into batches that each
+// fit in ARG_MAX, optionally several at once.
+static int builtin_batch(char** parsed_cmd) {
+  struct batch_options_t options;
+  char** command;
+
+  if (set_up_batch(parsed_cmd, &options, &command) == BATCH_FAILURE) {
+    fprintf(stderr,
+            "Usage: batch [-P jobs] [-n args] [-c words] command [args]\n");
+    return BUILTIN_FAILURE;
+  }
+  const struct builtin_t* builtin = find_builtin(command);
+  if (builtin != NULL && !(builtin->flags & BUILTIN_UTILITY)) {
+    fprintf(stderr, "batch: %s is a builtin and cannot be batched\n",
+            command[0]);
+    return BUILTIN_FAILURE;
+  }
+  return (batch_command(command, &options) == BATCH_FAILURE) ? BUILTIN_FAILURE
+                                                             : 0;
+}
+
+// Copies files or standard input to standard output.
+static int builtin_cat(char** parsed_cmd) {
+  return (cat_command(parsed_cmd) == CAT_FAILURE) ? BUILTIN_FAILURE : 0;
+}
+
+// Changes the current working directory.
+static int builtin_cd(char** parsed_cmd) {
+  // NOTE: Extra credit - changes working directory.
+  if (change_directory(parsed_cmd) == CD_FAILURE) {
+    fprintf(stderr, "Error changing directory.\n");
+    return BUILTIN_FAILURE;
+  }
+  return 0;
+}
+
+// Starts a coprocess, or closes one with -c.
+static int builtin_coproc(char** parsed_cmd) {
+  const char* name = COPROC_DEFAULT_NAME;
+  int i = 1;
+
+  if (parsed_cmd[i] != NULL && strcmp(parsed_cmd[i], "-c") == 0) {
+    if (parsed_cmd[i + 1] != NULL && parsed_cmd[i + 2] != NULL) {
+      fprintf(stderr, "Usage: coproc -c [name]\tToo many arguments.\n");
+      return BUILTIN_FAILURE;
+    }
+    if (parsed_cmd[i + 1] != NULL) {
+      name = parsed_cmd[i + 1];
+    }
+    return (close_coproc(name) == 0) ? 0 : BUILTIN_FAILURE;
+  }
+
+  if (parsed_cmd[i] != NULL && strcmp(parsed_cmd[i], "-n") == 0) {
+    name = parsed_cmd[i + 1];
+    i += 2;
+  }
+  if (name == NULL || !is_valid_name(name, strlen(name)) ||
+      parsed_cmd[i] == NULL) {
+    fprintf(stderr,
+            "Usage: coproc [-n name] command [args]\tcoproc -c [name]\n");
+    return BUILTIN_FAILURE;
+  }
+  return (start_coproc(name, parsed_cmd + i) == COPROC_FAILURE)
+             ? BUILTIN_FAILURE
+             : 0;
+}
+
+// Prints its arguments.
+static int builtin_echo(char** parsed_cmd) {
+  echo_command(parsed_cmd);
+  return 0;
+}
+
+// Requests that the shell exits.
+static int builtin_exit(char** parsed_cmd) {
+  if (parsed_cmd[1] != NULL) {
+    // Invalid exit command.
+    fprintf(stderr, "Usage: exit\tAdditional arguments are not supported.\n");
+    return BUILTIN_FAILURE;
+  }
+  return BUILTIN_EXIT;
+}
+
+// Does nothing, unsuccessfully.
+static int builtin_false(char** parsed_cmd) {
+  return BUILTIN_FAILURE;
+}
+
+// Brings a background process to the foreground.
+static int builtin_fg(char** parsed_cmd) {
+  // NOTE: Extra credit - foregrounds a background process.
+  if (parsed_cmd[1] == NULL) {
+    // Invalid foreground command.
+    fprintf(stderr, "Usage: fg [pid | %%job]\tToo few arguments.\n");
+    return BUILTIN_FAILURE;
+  }
+  if (parsed_cmd[2] != NULL) {
+    // Invalid foreground command.
+    fprintf(stderr, "Usage: fg [pid | %%job]\tToo many arguments.\n");
+    return BUILTIN_FAILURE;
+  }
+
+  // Valid foreground command.
+  if (foreground_process(find_bg_job(parsed_cmd[1])) == FG_FAILURE) {
+    fprintf(stderr, "Error foregrounding process.\n");
+    return BUILTIN_FAILURE;
+  }
+  return 0;
+}
+
+// Parses a non-negative number argument of the history builtin. Returns 0 on
+// success, -1 on failure.
+static int parse_history_number(const char* arg, long long* value) {
+  char* end;
+
+  if (arg == NULL) {
+    return BUILTIN_FAILURE;
+  }
+  *value = strtoll(arg, &end, 10);
+  return (arg[0] == '\0' || *end != '\0' || *value < 0) ? BUILTIN_FAILURE : 0;
+}
+
+// Prints or clears the command history. Entries are numbered from 1. Single
+// entries and ranges are read through the index without reading the entries
+// before them, and time ranges are found by binary search.
+static int builtin_history(char** parsed_cmd) {
+  int show_usage = 0;
+  int i = 1;
+  long long a = 0, b = 0;
+
+  if (parsed_cmd[i] != NULL && strcmp(parsed_cmd[i], "-c") == 0 &&
+      parsed_cmd[i + 1] == NULL) {
+    if (clear_history() == CLEAR_FAILURE) {
+      fprintf(stderr, "Error clearing command history.\n");
+      return BUILTIN_FAILURE;
+    }
+    return 0;
+  }
+  if (parsed_cmd[i] != NULL && strcmp(parsed_cmd[i], "-t") == 0) {
+    // Print the recorded metadata alongside each command.
+    show_usage = 1;
+    i++;
+  }
+
+  // Entries are read under the shared lock, so no other shell can clear
+  // them meanwhile.
+  long length = HISTORY_FAILURE;
+  if (history_length() == HISTORY_FAILURE ||
+      (length = begin_history_read()) == HISTORY_FAILURE) {
+    fprintf(stderr, "Error reading command history.\n");
+    return BUILTIN_FAILURE;
+  }
+
+  // Select the range of entries to print.
+  size_t first, last = length;
+  const char* option = parsed_cmd[i];
+  if (option == NULL ||
+      (parse_history_number(option, &a) == 0 && parsed_cmd[i + 1] == NULL)) {
+    // The most recent entries.
+    size_t count = (option == NULL) ? MAX_HISTORY_LINES : (size_t)a;
+    first = (last > count) ? last - count : 0;
+  } else if (strcmp(option, "-e") == 0 &&
+             parse_history_number(parsed_cmd[i + 1], &a) == 0 && a > 0 &&
+             parsed_cmd[i + 2] == NULL) {
+    // A single entry.
+    first = a - 1;
+    last = a;
+  } else if (strcmp(option, "-r") == 0 &&
+             parse_history_number(parsed_cmd[i + 1], &a) == 0 && a > 0 &&
+             parse_history_number(parsed_cmd[i + 2], &b) == 0 &&
+             parsed_cmd[i + 3] == NULL) {
+    // Entries a to b.
+    first = a - 1;
+    last = b;
+  } else if (strcmp(option, "-T") == 0 &&
+             parse_history_number(parsed_cmd[i + 1], &a) == 0 &&
+             parse_history_number(parsed_cmd[i + 2], &b) == 0 &&
+             parsed_cmd[i + 3] == NULL) {
+    // Entries recorded from second a to second b since the epoch. Times past
+    // the range of nanosecond timestamps match nothing newer.
+    a = (a > MAX_HISTORY_SECONDS) ? MAX_HISTORY_SECONDS : a;
+    b = (b >= MAX_HISTORY_SECONDS) ? MAX_HISTORY_SECONDS - 1 : b;
+    first = find_history_time(a * 1000000000LL);
+    last = find_history_time((b + 1) * 1000000000LL);
+  } else {
+    end_history_read();
+    fprintf(stderr, "Usage: history [-t] [count | -e entry | -r first last | "
+                    "-T start end]\n       history -c\n");
+    return BUILTIN_FAILURE;
+  }
+
+  if (last > (size_t)length) {
+    last = length;
+  }
+  if (first > last) {
+    first = last;
+  }
+  int result = print_history(show_usage, first, last);
+  end_history_read();
+  if (result == PRINT_FAILURE) {
+    fprintf(stderr, "Error printing command history.\n");
+    return BUILTIN_FAILURE;
+  }
+  return 0;
+}
+
+// Lists the active background processes, and with -l a summary of their
+// captured output.
+static int builtin_jobs(char** parsed_cmd) {
+  // NOTE: Extra credit - lists background processes.
+  int show_output = (parsed_cmd[1] != NULL && strcmp(parsed_cmd[1], "-l") == 0);
+  if (parsed_cmd[1 + show_output] != NULL) {
+    // Invalid background command.
+    fprintf(stderr, "Usage: jobs [-l]\n");
+    return BUILTIN_FAILURE;
+  }
+
+  // Valid background command.
+  if (remove_dead_processes() == CLEAR_BG_FAILURE) {
+    fprintf(stderr, "Error removing dead background processes.\n");
+  }
+  drain_captures();
+  if (list_bg_processes(show_output) == BG_FAILURE) {
+    fprintf(stderr, "Error listing background processes.\n");
+    return BUILTIN_FAILURE;
+  }
+  return 0;
+}
+
+// Runs an external command with resource limits and, optionally, in a cgroup.
+static int builtin_limit(char** parsed_cmd) {
+  struct job_limits_t limits;
+  char** command;
+
+  if (set_up_limits(parsed_cmd, &limits, &command) == LIMIT_FAILURE) {
+    return BUILTIN_FAILURE;
+  }
+  // Builtins run inside the shell, which must not be limited itself.
+  // Utilities run as the external programs of the same name instead.
+  const struct builtin_t* builtin = find_builtin(command);
+  if (builtin != NULL && !(builtin->flags & BUILTIN_UTILITY)) {
+    fprintf(stderr, "limit: %s is a builtin and cannot be limited\n",
+            command[0]);
+    release_limits(&limits);
+    return BUILTIN_FAILURE;
+  }
+
+  // The child applies the limits between fork() and exec().
+  job_limits = &limits;
+  int result = dispatch_command(command, NULL);
+  job_limits = NULL;
+  release_limits(&limits);
+  return result;
+}
+
+// Displays a file from the proc filesystem.
+static int builtin_proc(char** parsed_cmd) {
+  // Case when command is passed as a single argument.
+  if (strncmp(parsed_cmd[0], PROC_CMD, strlen(PROC_CMD)) == 0) {
+    if (parsed_cmd[1] != NULL) {
+      // Invalid /proc command.
+      fprintf(stderr,
+              "Usage: /proc/[filepath]\tAdditional arguments are "
+              "not supported.\n");
+      return BUILTIN_FAILURE;
+    }
+    // Valid /proc command.
+    if (execute_proc_command(parsed_cmd[0]) == EXEC_PROC_FAILURE) {
+      fprintf(stderr, "Error executing /proc command.\n");
+      return BUILTIN_FAILURE;
+    }
+    return 0;
+  }
+
+  // Case when command is passed as 2 arguments (e.g., "/proc /filepath").
+  if (strncmp(parsed_cmd[1], FWD_SLASH, strlen(FWD_SLASH)) != 0) {
+    return BUILTIN_FAILURE;
+  }
+  if (parsed_cmd[2] != NULL) {
+    fprintf(stderr,
+            "Usage: /proc/[filepath]\tAdditional arguments are "
+            "not supported.\n");
+    return BUILTIN_FAILURE;
+  }
+
+  // Valid /proc command that needs to be concatenated.
+  char* proc_cmd_concat;
+  if ((proc_cmd_concat = malloc(
+           (strlen(parsed_cmd[0]) + strlen(parsed_cmd[1]) + 1) *
+           sizeof(char))) == NULL) {
+    perror("proc_cmd_concat malloc error in builtin_proc()");
+    exit(EXIT_FAILURE);
+  }
+  strcpy(proc_cmd_concat, parsed_cmd[0]);
+  strcat(proc_cmd_concat, parsed_cmd[1]);
+  int result = 0;
+  if (execute_proc_command(proc_cmd_concat) == EXEC_PROC_FAILURE) {
+    fprintf(stderr, "Error executing /proc command.\n");
+    result = BUILTIN_FAILURE;
+  }
+  free(proc_cmd_concat);
+  return result;
+}
+
+// Struct describing a shell option that can be switched on and off.
+//   name:    The option's name.
+//   value:   The flag it sets.
+//   changed: Applies a new value, or NULL if the flag is only read.
+struct shell_option_t {
+    const char* name;
+    int* value;
+    void (*changed)(void);
+};
+
+// Table of shell options.
+static const struct shell_option_t shell_options[] = {
+    {"async_prompt", &async_prompt_enabled, NULL},
+    {"auto_batch", &auto_batch_enabled, NULL},
+    {"capture_output", &capture_enabled, NULL},
+    {"external_utils", &external_utils_enabled, NULL},
+    {"parse_cache", &parse_cache_enabled, NULL},
+    {"spread_jobs", &spread_jobs_enabled, NULL},
+    {"zygote", &zygote_enabled, update_zygote},
+};
+
+// Lists or sets shell options.
+static int builtin_option(char** parsed_cmd) {
+  size_t num_options = sizeof(shell_options) / sizeof(shell_options[0]);
+
+  // List every option when no arguments are given.
+  if (parsed_cmd[1] == NULL) {
+    for (size_t i = 0; i < num_options; i++) {
+      format_output("%s\t%s\n", shell_options[i].name,
+                    *shell_options[i].value ? "on" : "off");
+    }
+    return 0;
+  }
+
+  if (parsed_cmd[2] == NULL || parsed_cmd[3] != NULL ||
+      (strcmp(parsed_cmd[2], "on") != 0 && strcmp(parsed_cmd[2], "off") != 0)) {
+    fprintf(stderr, "Usage: option [name on|off]\n");
+    return BUILTIN_FAILURE;
+  }
+
+  for (size_t i = 0; i < num_options; i++) {
+    if (strcmp(parsed_cmd[1], shell_options[i].name) == 0) {
+      *shell_options[i].value = (strcmp(parsed_cmd[2], "on") == 0);
+      if (shell_options[i].changed != NULL) {
+        shell_options[i].changed();
+      }
+      return 0;
+    }
+  }
+  fprintf(stderr, "Unknown option %s.\n", parsed_cmd[1]);
+  return BUILTIN_FAILURE;
+}
+
+// Prints the output captured from a background job since it was last shown,
+// or lists the jobs with output to show.
+static int builtin_output(char** parsed_cmd) {
+  if (parsed_cmd[1] == NULL) {
+    list_captures();
+    return 0;
+  }
+  if (parsed_cmd[2] != NULL) {
+    fprintf(stderr, "Usage: output [pid | %%job]\n");
+    return BUILTIN_FAILURE;
+  }
+  if (print_capture(find_capture_job(parsed_cmd[1])) == CAPTURE_FAILURE) {
+    fprintf(stderr, "No captured output for %s.\n", parsed_cmd[1]);
+    return BUILTIN_FAILURE;
+  }
+  return 0;
+}
+
+// Prints formatted output.
+static int builtin_printf(char** parsed_cmd) {
+  return (printf_command(parsed_cmd) == PRINTF_FAILURE) ? BUILTIN_FAILURE : 0;
+}
+
+// Parses a positive whole number no larger than a maximum. Returns -1 if it is
+// invalid.
+static long parse_count(const char* text, long maximum) {
+  char* end;
+  long count = strtol(text, &end, 10);
+  return (*end != '\0' || count < 1 || count > maximum) ? -1 : count;
+}
+
+// Applies an option of the ps builtin, which top accepts too. Returns 1 if it
+// was applied, 0 if it is not one of them, or -1 if its value is invalid.
+static int parse_ps_option(const char* option, const char* value,
+                           struct ps_options_t* options) {
+  if (strcmp(option, "-s") == 0) {
+    if (strcmp(value, "pid") == 0) {
+      options->sort = PS_SORT_PID;
+    } else if (strcmp(value, "cpu") == 0) {
+      options->sort = PS_SORT_CPU;
+    } else if (strcmp(value, "mem") == 0) {
+      options->sort = PS_SORT_MEM;
+    } else {
+      return -1;
+    }
+    return 1;
+  }
+  if (strcmp(option, "-t") == 0) {
+    long threads = parse_count(value, PS_MAX_THREADS);
+    options->threads = (int)threads;
+    return (threads == -1) ? -1 : 1;
+  }
+  return 0;
+}
+
+// Lists processes from /proc, marking the shell's jobs.
+static int builtin_ps(char** parsed_cmd) {
+  struct ps_options_t options = {PS_SORT_PID, 0, 0};
+  int valid = 1;
+
+  for (int i = 1; valid && parsed_cmd[i] != NULL; i += 2) {
+    const char* value = parsed_cmd[i + 1];
+    int result = (value == NULL) ? -1
+                                 : parse_ps_option(parsed_cmd[i], value,
+                                                   &options);
+    if (result == 0 && strcmp(parsed_cmd[i], "-n") == 0) {
+      long limit = parse_count(value, LONG_MAX);
+      options.limit = (size_t)limit;
+      result = (limit == -1) ? -1 : 1;
+    }
+    valid = (result == 1);
+  }
+  if (!valid) {
+    fprintf(stderr, "Usage: ps [-s pid|cpu|mem] [-t threads] [-n count]\n");
+    return BUILTIN_FAILURE;
+  }
+  return (ps_command(&options) == PS_FAILURE) ? BUILTIN_FAILURE : 0;
+}
+
+// Reads a line from standard input, or the descriptor given with -u, into a
+// variable. Fails at end of input.
+static int builtin_read(char** parsed_cmd) {
+  const char* name = "REPLY";
+  int fd = STDIN_FILENO;
+  int i = 1;
+
+  if (parsed_cmd[i] != NULL && strcmp(parsed_cmd[i], "-u") == 0) {
+    char* end;
+    long value = (parsed_cmd[i + 1] != NULL)
+                     ? strtol(parsed_cmd[i + 1], &end, 10)
+                     : -1;
+    if (value < 0 || value > INT32_MAX || parsed_cmd[i + 1][0] == '\0' ||
+        *end != '\0') {
+      fprintf(stderr, "Usage: read [-u fd] [name]\tBad file descriptor.\n");
+      return BUILTIN_FAILURE;
+    }
+    fd = (int)value;
+    i += 2;
+  }
+  if (parsed_cmd[i] != NULL) {
+    name = parsed_cmd[i++];
+  }
+  if (parsed_cmd[i] != NULL || !is_valid_name(name, strlen(name))) {
+    fprintf(stderr, "Usage: read [-u fd] [name]\n");
+    return BUILTIN_FAILURE;
+  }
+
+  size_t length;
+  char* line = read_line(fd, &length);
+  if (line == NULL) {
+    return BUILTIN_FAILURE;
+  }
+  int result = (set_variable(name, line) == VAR_FAILURE) ? BUILTIN_FAILURE : 0;
+  free(line);
+  return result;
+}
+
+// Changes the shell prompt.
+static int builtin_prompt(char** parsed_cmd) {
+  // NOTE: Extra credit - changes shell prompt.
+  if (change_shell_prompt(parsed_cmd) == CHANGE_PROMPT_FAILURE) {
+    fprintf(stderr, "Error changing shell prompt.\n");
+    return BUILTIN_FAILURE;
+  }
+  return 0;
+}
+
+// Prints or saves the shell's own statistics. Timings are only available in
+// builds made with `make profile`.
+static int builtin_shellstats(char** parsed_cmd) {
+  if (parsed_cmd[1] != NULL && parsed_cmd[2] != NULL) {
+    fprintf(stderr, "Usage: shellstats [file]\tToo many arguments.\n");
+    return BUILTIN_FAILURE;
+  }
+  // Print to stdout when no file is given, after any buffered output.
+  if (parsed_cmd[1] == NULL) {
+    flush_output();
+    int result = profile_dump(stdout);
+    fflush(stdout);
+    return (result == PROFILE_FAILURE) ? BUILTIN_FAILURE : 0;
+  }
+
+  FILE* stats_file;
+  if ((stats_file = fopen(parsed_cmd[1], "w")) == NULL) {
+    perror("fopen error in builtin_shellstats()");
+    return BUILTIN_FAILURE;
+  }
+  int result = profile_dump(stats_file);
+  fclose(stats_file);
+  return (result == PROFILE_FAILURE) ? BUILTIN_FAILURE : 0;
+}
+
+// Evaluates a conditional expression. False and invalid expressions both
+// report failure.
+static int builtin_test(char** parsed_cmd) {
+  return (test_command(parsed_cmd) == TEST_TRUE) ? 0 : BUILTIN_FAILURE;
+}
+
+// Runs a command and reports its resource usage.
+static int builtin_time(char** parsed_cmd) {
+  if (parsed_cmd[1] == NULL) {
+    fprintf(stderr, "Usage: time [command]\tToo few arguments.\n");
+    return BUILTIN_FAILURE;
+  }
+
+  // The inner command records its own usage and exit status in last_usage.
+  if (run_command(parsed_cmd + 1) == BUILTIN_EXIT) {
+    return BUILTIN_EXIT;
+  }
+  print_usage(&last_usage);
+  return 0;
+}
+
+// Runs an external command, or waits for a background job with fg, with a
+// deadline. A zero duration runs it without one.
+static int builtin_timeout(char** parsed_cmd) {
+  struct job_deadline_t deadline = {0, TIMEOUT_KILL_AFTER};
+  int i = 1;
+
+  if (parsed_cmd[i] != NULL && strcmp(parsed_cmd[i], "-k") == 0) {
+    if (parsed_cmd[i + 1] == NULL ||
+        parse_duration(parsed_cmd[i + 1], &deadline.kill_after) ==
+            TIMEOUT_FAILURE) {
+      fprintf(stderr, "timeout: invalid kill duration\n");
+      return BUILTIN_FAILURE;
+    }
+    i += 2;
+  }
+  if (parsed_cmd[i] == NULL || parsed_cmd[i + 1] == NULL ||
+      parse_duration(parsed_cmd[i], &deadline.seconds) == TIMEOUT_FAILURE) {
+    fprintf(stderr, "Usage: timeout [-k duration] duration command [args]\n");
+    return BUILTIN_FAILURE;
+  }
+  char** command = parsed_cmd + i + 1;
+
+  // Only builtins that run or wait for programs can be stopped. Utilities run
+  // as the external programs of the same name.
+  const struct builtin_t* builtin = find_builtin(command);
+  if (builtin != NULL && !(builtin->flags & BUILTIN_RECORDS_USAGE)) {
+    if (!(builtin->flags & BUILTIN_UTILITY)) {
+      fprintf(stderr, "timeout: %s is a builtin and cannot be stopped\n",
+              command[0]);
+      return BUILTIN_FAILURE;
+    }
+    builtin = NULL;
+  }
+
+  const struct job_deadline_t* previous = job_deadline;
+  job_deadline = (deadline.seconds > 0) ? &deadline : NULL;
+  int result = dispatch_command(command, builtin);
+  job_deadline = previous;
+  return result;
+}
+
+// Runs an external command with a CPU affinity, nice value, scheduling
+// policy or I/O priority.
+static int builtin_sched(char** parsed_cmd) {
+  struct job_sched_t sched;
+  char** command;
+
+  if (set_up_sched(parsed_cmd, &sched, &command) == SCHED_FAILURE) {
+    return BUILTIN_FAILURE;
+  }
+  // Only builtins that run programs, such as limit or batch, pass it on.
+  // Utilities run as the external programs of the same name.
+  const struct builtin_t* builtin = find_builtin(command);
+  if (builtin != NULL && !(builtin->flags & BUILTIN_RECORDS_USAGE)) {
+    if (!(builtin->flags & BUILTIN_UTILITY)) {
+      fprintf(stderr, "sched: %s is a builtin and cannot be scheduled\n",
+              command[0]);
+      return BUILTIN_FAILURE;
+    }
+    builtin = NULL;
+  }
+
+  // The child applies the scheduling between fork() and exec().
+  const struct job_sched_t* previous = job_sched;
+  job_sched = &sched;
+  int result = dispatch_command(command, builtin);
+  job_sched = previous;
+  return result;
+}
+
+// Redraws the processes using the most CPU until a line is entered, or for a
+// number of iterations.
+static int builtin_top(char** parsed_cmd) {
+  struct ps_options_t options = {PS_SORT_CPU, 0, 0};
+  double delay = TOP_DEFAULT_DELAY;
+  long iterations = isatty(STDIN_FILENO) ? 0 : 1;
+  int valid = 1;
+
+  for (int i = 1; valid && parsed_cmd[i] != NULL; i += 2) {
+    const char* value = parsed_cmd[i + 1];
+    int result = (value == NULL) ? -1
+                                 : parse_ps_option(parsed_cmd[i], value,
+                                                   &options);
+    if (result == 0 && strcmp(parsed_cmd[i], "-d") == 0) {
+      result = (parse_duration(value, &delay) == TIMEOUT_FAILURE || delay <= 0)
+                   ? -1
+                   : 1;
+    } else if (result == 0 && strcmp(parsed_cmd[i], "-n") == 0) {
+      iterations = parse_count(value, LONG_MAX);
+      result = (iterations == -1) ? -1 : 1;
+    }
+    valid = (result == 1);
+  }
+  if (!valid) {
+    fprintf(stderr,
+            "Usage: top [-d seconds] [-n iterations] [-s pid|cpu|mem] "
+            "[-t threads]\n");
+    return BUILTIN_FAILURE;
+  }
+  return (top_command(&options, delay, iterations) == PS_FAILURE)
+             ? BUILTIN_FAILURE
+             : 0;
+}
+
+// Starts or stops recording the processes the shell starts, or writes them to
+// a file as a Chrome trace.
+static int builtin_trace(char** parsed_cmd) {
+  const char* action = parsed_cmd[1];
+
+  if (action != NULL && parsed_cmd[2] == NULL && strcmp(action, "start") == 0) {
+    return (trace_start() == TRACE_FAILURE) ? BUILTIN_FAILURE : 0;
+  }
+  if (action != NULL && parsed_cmd[2] == NULL && strcmp(action, "stop") == 0) {
+    trace_stop();
+    return 0;
+  }
+  if (action != NULL && strcmp(action, "dump") == 0 && parsed_cmd[2] != NULL &&
+      parsed_cmd[3] == NULL) {
+    return (trace_dump(parsed_cmd[2]) == TRACE_FAILURE) ? BUILTIN_FAILURE : 0;
+  }
+  fprintf(stderr, "Usage: trace start|stop\ttrace dump file\n");
+  return BUILTIN_FAILURE;
+}
+
+// Does nothing, successfully.
+static int builtin_true(char** parsed_cmd) {
+  return 0;
+}
+
+#pragma endregion Handlers
+
+// Table of built-in commands. Looked up by exact name match.
+static const struct builtin_t builtins[] = {
+    {"[", builtin_test, BUILTIN_CAPTURABLE | BUILTIN_UTILITY},
+    {"batch", builtin_batch, BUILTIN_RECORDS_USAGE},
+    {"cat", builtin_cat, BUILTIN_CAPTURABLE | BUILTIN_UTILITY},
+    {"cd", builtin_cd, 0},
+    {"coproc", builtin_coproc, 0},
+    {"echo", builtin_echo, BUILTIN_CAPTURABLE | BUILTIN_UTILITY},
+    {"exit", builtin_exit, 0},
+    {"false", builtin_false, BUILTIN_CAPTURABLE | BUILTIN_UTILITY},
+    {"fg", builtin_fg, BUILTIN_RECORDS_USAGE},
+    {"history", builtin_history, BUILTIN_CAPTURABLE},
+    {"jobs", builtin_jobs, BUILTIN_CAPTURABLE},
+    {"limit", builtin_limit, BUILTIN_RECORDS_USAGE},
+    {"option", builtin_option, 0},
+    {"output", builtin_output, BUILTIN_CAPTURABLE},
+    {"printf", builtin_printf, BUILTIN_CAPTURABLE | BUILTIN_UTILITY},
+    {"ps", builtin_ps, BUILTIN_CAPTURABLE | BUILTIN_UTILITY},
+    {"prompt", builtin_prompt, 0},
+    {"read", builtin_read, 0},
+    {"sched", builtin_sched, BUILTIN_RECORDS_USAGE},
+    {"shellstats", builtin_shellstats, BUILTIN_CAPTURABLE},
+    {"test", builtin_test, BUILTIN_CAPTURABLE | BUILTIN_UTILITY},
+    {"time", builtin_time, BUILTIN_RECORDS_USAGE},
+    {"timeout", builtin_timeout, BUILTIN_RECORDS_USAGE},
+    {"top", builtin_top, BUILTIN_UTILITY},
+    {"trace", builtin_trace, 0},
+    {"true", builtin_true, BUILTIN_CAPTURABLE | BUILTIN_UTILITY},
+};
+
+// The /proc builtin matches on a prefix rather than an exact name.
+static const struct builtin_t proc_builtin = {PROC_CMD1, builtin_proc,
+                                              BUILTIN_CAPTURABLE};
+
+const struct builtin_t* find_builtin(char** parsed_cmd) {
+  if (parsed_cmd == NULL || parsed_cmd[0] == NULL) {
+    return NULL;
+  }
+
+  for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+    if (strcmp(parsed_cmd[0], builtins[i].name) == 0) {
+      return resolve_builtin(&builtins[i]);
+    }
+  }
+
+  // First argument starts with "/proc/", or is "/proc" followed by a path.
+  if ((strncmp(parsed_cmd[0], PROC_CMD, strlen(PROC_CMD)) == 0) ||
+      ((strcmp(parsed_cmd[0], PROC_CMD1) == 0) && (parsed_cmd[1] != NULL))) {
+    return &proc_builtin;
+  }
+
+  return NULL;
+}
+
+const struct builtin_t* resolve_builtin(const struct builtin_t* builtin) {
+  if (builtin != NULL && (builtin->flags & BUILTIN_UTILITY) &&
+      external_utils_enabled) {
+    return NULL;
+  }
+  return builtin;
+}
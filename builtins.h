@@ -0,0 +1,47 @@
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#define BUILTIN_EXIT 1
+#define BUILTIN_FAILURE -1
+
+// Builtin flags. Capturable builtins have no side effects, so they may run
+// in-process when their output is captured. Utilities replace external
+// programs of the same name unless the external_utils option is on.
+#define BUILTIN_RECORDS_USAGE 0x1
+#define BUILTIN_CAPTURABLE 0x2
+#define BUILTIN_UTILITY 0x4
+
+// Struct describing a built-in shell command.
+struct builtin_t {
+    const char* name;
+    int (*handler)(char**);
+    int flags;
+};
+
+extern int external_utils_enabled;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// const struct builtin_t* find_builtin(char**)
+// Description: Looks up the built-in command matching a parsed command.
+// Preconditions: A non-null parsed command is provided as an argument.
+// Postconditions: None.
+// Return: The matching builtin, or NULL if the command is not built in or is
+// a utility while external_utils is on.
+extern const struct builtin_t* find_builtin(char**);
+
+// const struct builtin_t* resolve_builtin(const struct builtin_t*)
+// Description: Applies the external_utils option to a builtin looked up
+// earlier, e.g. when a command was compiled.
+// Preconditions: None.
+// Postconditions: None.
+// Return: The builtin, or NULL if it is a utility while external_utils is on.
+extern const struct builtin_t* resolve_builtin(const struct builtin_t*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUILTINS_H
@@ -0,0 +1,155 @@
+// File:    cache_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains an LRU cache of compiled programs keyed by the
+//          raw input line, so repeated lines skip parsing entirely.
+
+#define _GNU_SOURCE
+
+#include "cache_utils.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast_utils.h"
+#include "profile_utils.h"
+
+// Global variables.
+int parse_cache_enabled = 1;
+
+static struct parse_cache_entry_t* buckets[PARSE_CACHE_BUCKETS];
+static struct parse_cache_entry_t* newest = NULL;
+static struct parse_cache_entry_t* oldest = NULL;
+static size_t num_entries = 0;
+
+// 64-bit FNV-1a hash of a string.
+static uint64_t hash_line(const char* line) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  while (*line) {
+    hash ^= (unsigned char)*line++;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Unlinks an entry from the LRU list.
+static void unlink_entry(struct parse_cache_entry_t* entry) {
+  if (entry->newer != NULL) {
+    entry->newer->older = entry->older;
+  } else {
+    newest = entry->older;
+  }
+  if (entry->older != NULL) {
+    entry->older->newer = entry->newer;
+  } else {
+    oldest = entry->newer;
+  }
+  entry->newer = entry->older = NULL;
+}
+
+// Links an entry at the most recently used end of the LRU list.
+static void link_newest(struct parse_cache_entry_t* entry) {
+  entry->older = newest;
+  entry->newer = NULL;
+  if (newest != NULL) {
+    newest->newer = entry;
+  }
+  newest = entry;
+  if (oldest == NULL) {
+    oldest = entry;
+  }
+}
+
+// Removes an entry from the cache and frees it.
+static void evict_entry(struct parse_cache_entry_t* entry) {
+  struct parse_cache_entry_t** link = &buckets[entry->hash % PARSE_CACHE_BUCKETS];
+  while (*link != entry) {
+    link = &(*link)->next_in_bucket;
+  }
+  *link = entry->next_in_bucket;
+
+  unlink_entry(entry);
+  free(entry->line);
+  release_program(entry->program);
+  free(entry);
+  num_entries--;
+}
+
+// Adds a compiled line to the cache, evicting the least recently used entry
+// if the cache is full. Failures only mean the line is not cached.
+static void insert_entry(const char* line, uint64_t hash,
+                         struct ast_program_t* program) {
+  struct parse_cache_entry_t* entry = calloc(1, sizeof(*entry));
+  if (entry == NULL || (entry->line = strdup(line)) == NULL) {
+    free(entry);
+    return;
+  }
+  entry->hash = hash;
+  retain_program(program);
+  entry->program = program;
+
+  if (num_entries >= PARSE_CACHE_CAPACITY) {
+    evict_entry(oldest);
+    profile_count(PROFILE_PARSE_CACHE_EVICTIONS);
+  }
+
+  entry->next_in_bucket = buckets[hash % PARSE_CACHE_BUCKETS];
+  buckets[hash % PARSE_CACHE_BUCKETS] = entry;
+  link_newest(entry);
+  num_entries++;
+}
+
+struct ast_program_t* cached_compile_command_line(char* command,
+                                                  int* status) {
+  struct ast_program_t* program;
+
+  // Eliminate trailing whitespaces, as parse_command() would.
+  size_t length = strlen(command);
+  while (length > 0 && isspace((unsigned char)command[length - 1])) {
+    command[--length] = '\0';
+  }
+
+  if (!parse_cache_enabled || length > PARSE_CACHE_MAX_LINE) {
+    *status = compile_program(command, &program);
+    return program;
+  }
+
+  uint64_t hash = hash_line(command);
+  struct parse_cache_entry_t* entry = buckets[hash % PARSE_CACHE_BUCKETS];
+  while (entry != NULL &&
+         (entry->hash != hash || strcmp(entry->line, command) != 0)) {
+    entry = entry->next_in_bucket;
+  }
+
+  if (entry != NULL) {
+    // Hit: hand out another reference to the cached program.
+    profile_count(PROFILE_PARSE_CACHE_HITS);
+    unlink_entry(entry);
+    link_newest(entry);
+    *status = COMPILE_OK;
+    retain_program(entry->program);
+    return entry->program;
+  }
+
+  // Miss: compile the line and remember the result. Expansions are performed
+  // when the program runs, so every complete line can be cached.
+  *status = compile_program(command, &program);
+  if (program == NULL) {
+    // Incomplete and invalid lines are compiled again once they are fixed.
+    if (*status != COMPILE_OK) {
+      profile_count(PROFILE_PARSE_CACHE_BYPASSES);
+    }
+    return NULL;
+  }
+  profile_count(PROFILE_PARSE_CACHE_MISSES);
+  insert_entry(command, hash, program);
+  return program;
+}
+
+void clear_parse_cache(void) {
+  while (oldest != NULL) {
+    evict_entry(oldest);
+  }
+}
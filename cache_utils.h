@@ -0,0 +1,54 @@
+#ifndef CACHE_UTILS_H
+#define CACHE_UTILS_H
+
+#define PARSE_CACHE_BUCKETS 512
+#define PARSE_CACHE_CAPACITY 256
+#define PARSE_CACHE_MAX_LINE 65536
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct ast_program_t;
+
+// Struct holding one compiled command line. Entries are kept in a hash
+// table for lookup and in a doubly linked list in least recently used order.
+struct parse_cache_entry_t {
+    uint64_t hash;
+    char* line;
+    struct ast_program_t* program;
+    struct parse_cache_entry_t* next_in_bucket;
+    struct parse_cache_entry_t* newer;
+    struct parse_cache_entry_t* older;
+};
+
+extern int parse_cache_enabled;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// struct ast_program_t* cached_compile_command_line(char*, int*)
+// Description: Compiles a line of user input, reusing the program compiled
+// from an earlier identical line when possible.
+// Preconditions: A non-null command and status pointer are provided.
+// Postconditions: Trailing whitespace is removed from the command in place.
+// The compile_program() status is stored in the second argument. Hit, miss,
+// eviction and bypass counters are updated. Lines longer than
+// PARSE_CACHE_MAX_LINE, such as ones carrying large here-documents, are
+// compiled without being cached.
+// Return: A program holding a reference owned by the caller, or NULL if the
+// command is empty, incomplete or cannot be compiled.
+extern struct ast_program_t* cached_compile_command_line(char*, int*);
+
+// void clear_parse_cache()
+// Description: Empties the parse cache.
+// Preconditions: None.
+// Postconditions: Every cache entry is freed.
+// Return: None.
+extern void clear_parse_cache(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CACHE_UTILS_H
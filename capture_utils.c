@@ -0,0 +1,507 @@
+// File:    capture_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains functions for capturing the output of
+//          background jobs. Each job writes to a pipe the shell drains into
+//          a ring buffer while it waits for input, so the output never
+//          interleaves with the prompt. It is shown on request, or streamed
+//          when the job is brought to the foreground.
+
+#define _GNU_SOURCE
+
+#include "capture_utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/pidfd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "output_utils.h"
+#include "redirect_utils.h"
+
+// Struct holding the captured output of a background job.
+//   pid:      The job's process id.
+//   fd:       The read end of its pipe, or -1 once the pipe is closed.
+//   buffer:   The ring buffer of output not yet shown.
+//   capacity: The size of the buffer, 0 until output arrives.
+//   start:    The offset of the oldest byte in the buffer.
+//   length:   The number of bytes in the buffer.
+//   dropped:  The bytes lost to a full buffer since output was last shown.
+struct capture_t {
+    pid_t pid;
+    int fd;
+    char* buffer;
+    size_t capacity;
+    size_t start;
+    size_t length;
+    size_t dropped;
+};
+
+// Global variables.
+int capture_enabled = 0;
+
+// Captures in the order their jobs started, and the memory of their buffers.
+static struct capture_t* captures = NULL;
+static size_t num_captures = 0;
+static size_t capture_capacity = 0;
+static size_t capture_memory = 0;
+
+// Returns the capture of a job, or NULL if its output is not captured.
+static struct capture_t* find_capture(pid_t process_id) {
+  for (size_t i = 0; i < num_captures; i++) {
+    if (captures[i].pid == process_id) {
+      return &captures[i];
+    }
+  }
+  return NULL;
+}
+
+// Closes a capture's pipe and frees its buffer, and removes it from the
+// table.
+static void release_capture(struct capture_t* capture) {
+  size_t index = capture - captures;
+
+  if (capture->fd != -1) {
+    close(capture->fd);
+  }
+  capture_memory -= capture->capacity;
+  free(capture->buffer);
+  memmove(capture, capture + 1,
+          (num_captures - index - 1) * sizeof(struct capture_t));
+  num_captures--;
+}
+
+// Frees the buffer of the oldest finished job other than the one given.
+// Returns 1 if one was freed, 0 if there was none.
+static int evict_capture(const struct capture_t* keep) {
+  for (size_t i = 0; i < num_captures; i++) {
+    if (&captures[i] != keep && captures[i].fd == -1 &&
+        captures[i].capacity > 0) {
+      release_capture(&captures[i]);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Grows a capture's buffer towards the given size, within the per-job and
+// global limits, keeping its contents in order. Leaves it as it is if the
+// memory cannot be found.
+static void grow_capture(struct capture_t** capture, size_t needed) {
+  size_t capacity = ((*capture)->capacity > 0) ? (*capture)->capacity
+                                               : CAPTURE_MIN_SIZE;
+  pid_t process_id = (*capture)->pid;
+
+  needed = (needed > CAPTURE_JOB_MAX) ? CAPTURE_JOB_MAX : needed;
+  while (capacity < needed) {
+    capacity *= 2;
+  }
+  if (capacity <= (*capture)->capacity) {
+    return;
+  }
+
+  // Evicting moves the table, so the capture is found again afterwards.
+  while (capture_memory - (*capture)->capacity + capacity >
+             CAPTURE_MEMORY_MAX &&
+         evict_capture(*capture)) {
+    *capture = find_capture(process_id);
+  }
+  struct capture_t* grown = *capture;
+  if (capture_memory - grown->capacity + capacity > CAPTURE_MEMORY_MAX) {
+    return;
+  }
+  char* buffer = malloc(capacity);
+  if (buffer == NULL) {
+    return;
+  }
+
+  // Copy the contents out of the ring, oldest first.
+  size_t first = grown->capacity - grown->start;
+  first = (grown->length < first) ? grown->length : first;
+  if (grown->length > 0) {
+    memcpy(buffer, grown->buffer + grown->start, first);
+    memcpy(buffer + first, grown->buffer, grown->length - first);
+  }
+  free(grown->buffer);
+  capture_memory += capacity - grown->capacity;
+  grown->buffer = buffer;
+  grown->capacity = capacity;
+  grown->start = 0;
+}
+
+// Closes a capture's pipe at end of file. Returns the capture, or NULL if it
+// was released since there is nothing to show.
+static struct capture_t* end_capture(struct capture_t* capture) {
+  close(capture->fd);
+  capture->fd = -1;
+  if (capture->length == 0 && capture->dropped == 0) {
+    release_capture(capture);
+    return NULL;
+  }
+  return capture;
+}
+
+// Reads what is waiting in a capture's pipe, closing it at end of file.
+// Returns the capture, which may have moved, or NULL if it was released.
+static struct capture_t* drain_capture(struct capture_t* capture) {
+  while (capture->fd != -1) {
+    // Size the read, and the buffer, by the bytes waiting. With none, the
+    // pipe is either empty or closed by every writer.
+    int waiting = 0;
+    if (ioctl(capture->fd, FIONREAD, &waiting) == -1) {
+      perror("ioctl error in drain_capture()");
+      return end_capture(capture);
+    }
+    if (waiting < 1) {
+      struct pollfd ready = {capture->fd, POLLIN, 0};
+      if (poll(&ready, 1, 0) < 1) {
+        break;
+      }
+      if (ready.revents & POLLIN) {
+        continue;
+      }
+      return end_capture(capture);
+    }
+    if (capture->capacity < CAPTURE_JOB_MAX &&
+        capture->length + waiting > capture->capacity) {
+      grow_capture(&capture, capture->length + waiting);
+    }
+
+    ssize_t bytes_read;
+    size_t wanted = waiting;
+    if (capture->capacity == 0) {
+      // No memory is left for this job, so its output is discarded.
+      char discard[CAPTURE_MIN_SIZE];
+      wanted = (wanted < sizeof(discard)) ? wanted : sizeof(discard);
+      if ((bytes_read = read(capture->fd, discard, wanted)) > 0) {
+        capture->dropped += bytes_read;
+      }
+    } else {
+      // Write after the newest byte, wrapping around and overwriting the
+      // oldest ones once the buffer is full.
+      size_t end = (capture->start + capture->length) % capture->capacity;
+      wanted = (wanted < capture->capacity) ? wanted : capture->capacity;
+      size_t first = capture->capacity - end;
+      first = (wanted < first) ? wanted : first;
+      struct iovec parts[2] = {{capture->buffer + end, first},
+                               {capture->buffer, wanted - first}};
+      if ((bytes_read = readv(capture->fd, parts, 2)) > 0) {
+        capture->length += bytes_read;
+        if (capture->length > capture->capacity) {
+          size_t lost = capture->length - capture->capacity;
+          capture->start = (capture->start + lost) % capture->capacity;
+          capture->length = capture->capacity;
+          capture->dropped += lost;
+        }
+      }
+    }
+
+    if (bytes_read == -1 && errno == EINTR) {
+      continue;
+    }
+    if (bytes_read == -1 && errno != EAGAIN) {
+      perror("read error in drain_capture()");
+      return end_capture(capture);
+    }
+    if (bytes_read == 0) {
+      return end_capture(capture);
+    }
+    // Read again only if the buffer held less than was waiting.
+    if (bytes_read == -1 || (size_t)bytes_read >= (size_t)waiting) {
+      break;
+    }
+  }
+  return capture;
+}
+
+// Appends a capture's buffer to the shell's output and empties it.
+static void append_capture(struct capture_t* capture) {
+  if (capture->dropped > 0) {
+    fprintf(stderr, "[%zu bytes of output dropped]\n", capture->dropped);
+  }
+  if (capture->length > 0) {
+    size_t first = capture->capacity - capture->start;
+    first = (capture->length < first) ? capture->length : first;
+    append_output(capture->buffer + capture->start, first);
+    append_output(capture->buffer, capture->length - first);
+  }
+  capture->start = 0;
+  capture->length = 0;
+  capture->dropped = 0;
+}
+
+void append_capture_status(pid_t process_id) {
+  struct capture_t* capture = find_capture(process_id);
+  char preview[CAPTURE_PREVIEW_MAX + 1];
+  size_t preview_length = 0;
+
+  if (capture == NULL) {
+    return;
+  }
+  format_output("\t%zu bytes", capture->length);
+  if (capture->dropped > 0) {
+    format_output(" (%zu dropped)", capture->dropped);
+  }
+
+  // Find the last line, ignoring the newline that ends it.
+  size_t end = capture->length;
+  if (end > 0 &&
+      capture->buffer[(capture->start + end - 1) % capture->capacity] == '\n') {
+    end--;
+  }
+  size_t line = end;
+  while (line > 0 &&
+         capture->buffer[(capture->start + line - 1) % capture->capacity] !=
+             '\n') {
+    line--;
+  }
+  for (size_t i = line; i < end && preview_length < CAPTURE_PREVIEW_MAX; i++) {
+    char c = capture->buffer[(capture->start + i) % capture->capacity];
+    preview[preview_length++] = ((unsigned char)c < ' ') ? ' ' : c;
+  }
+  preview[preview_length] = '\0';
+  if (preview_length > 0) {
+    format_output("\t%s", preview);
+  }
+}
+
+// Checks whether two descriptors refer to the same file.
+static int same_file(int fd, int other_fd) {
+  struct stat status, other;
+  return fstat(fd, &status) == 0 && fstat(other_fd, &other) == 0 &&
+         status.st_dev == other.st_dev && status.st_ino == other.st_ino;
+}
+
+void attach_capture(int fd) {
+  // An output redirected to the other one, as in "cmd >&2 &", is captured
+  // with it.
+  int capture_out = !output_redirected(STDOUT_FILENO) ||
+                    (!output_redirected(STDERR_FILENO) &&
+                     same_file(STDOUT_FILENO, STDERR_FILENO));
+  int capture_err = !output_redirected(STDERR_FILENO) ||
+                    (!output_redirected(STDOUT_FILENO) &&
+                     same_file(STDERR_FILENO, STDOUT_FILENO));
+  if (capture_out) {
+    dup2(fd, STDOUT_FILENO);
+  }
+  if (capture_err) {
+    dup2(fd, STDERR_FILENO);
+  }
+}
+
+void clear_captures(void) {
+  while (num_captures > 0) {
+    release_capture(&captures[num_captures - 1]);
+  }
+  free(captures);
+  captures = NULL;
+  capture_capacity = 0;
+}
+
+void drain_captures(void) {
+  // Walk backwards, since draining may release captures and evict older
+  // ones, which moves those after them.
+  for (size_t i = num_captures; i > 0; i--) {
+    if (i <= num_captures && captures[i - 1].fd != -1) {
+      drain_capture(&captures[i - 1]);
+    }
+  }
+}
+
+pid_t find_capture_job(const char* job) {
+  char* end;
+  long number = strtol(job + (job[0] == '%'), &end, 10);
+
+  if (end == job + (job[0] == '%') || *end != '\0' || number <= 0) {
+    // Not a number greater than 0.
+    return CAPTURE_FAILURE;
+  }
+  if (job[0] != '%') {
+    return (pid_t)number;
+  }
+
+  // Jobs are numbered in the order list_captures() lists them, which drains
+  // the pipes first in the same way.
+  drain_captures();
+  return ((size_t)number <= num_captures) ? captures[number - 1].pid
+                                          : CAPTURE_FAILURE;
+}
+
+void list_captures(void) {
+  drain_captures();
+  for (size_t i = 0; i < num_captures; i++) {
+    append_output_char('[');
+    append_output_unsigned(i + 1);
+    append_output("]\t", 2);
+    append_output_unsigned(captures[i].pid);
+    append_output_string(captures[i].fd == -1 ? "\tdone" : "\trunning");
+    append_capture_status(captures[i].pid);
+    append_output_char('\n');
+  }
+}
+
+int open_capture(int fds[2]) {
+  fds[0] = -1;
+  fds[1] = -1;
+  if (!capture_enabled ||
+      (output_redirected(STDOUT_FILENO) && output_redirected(STDERR_FILENO))) {
+    return 0;
+  }
+  if (pipe2(fds, O_CLOEXEC) == -1) {
+    perror("pipe2 error in open_capture()");
+    fds[0] = -1;
+    fds[1] = -1;
+    return CAPTURE_FAILURE;
+  }
+  return 0;
+}
+
+int print_capture(pid_t process_id) {
+  struct capture_t* capture = find_capture(process_id);
+
+  if (capture == NULL || (capture = drain_capture(capture)) == NULL) {
+    return CAPTURE_FAILURE;
+  }
+  append_capture(capture);
+  if (capture->fd == -1) {
+    release_capture(capture);
+  }
+  return 0;
+}
+
+int start_capture(pid_t process_id, int fd) {
+  int flags = fcntl(fd, F_GETFL);
+
+  if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+    perror("fcntl error in start_capture()");
+    close(fd);
+    return CAPTURE_FAILURE;
+  }
+  if (num_captures == capture_capacity) {
+    size_t capacity = (capture_capacity == 0) ? 8 : capture_capacity * 2;
+    struct capture_t* grown =
+        realloc(captures, capacity * sizeof(struct capture_t));
+    if (grown == NULL) {
+      perror("realloc error in start_capture()");
+      close(fd);
+      return CAPTURE_FAILURE;
+    }
+    captures = grown;
+    capture_capacity = capacity;
+  }
+  captures[num_captures++] =
+      (struct capture_t){process_id, fd, NULL, 0, 0, 0, 0};
+  return 0;
+}
+
+int stream_capture(pid_t process_id) {
+  struct capture_t* capture = find_capture(process_id);
+  char buffer[CAPTURE_STREAM_SIZE];
+
+  if (capture == NULL) {
+    return CAPTURE_FAILURE;
+  }
+  append_capture(capture);
+  flush_output();
+
+  // Copy the pipe until it closes, or until the job exits and what it wrote
+  // has been read. A process the job started may hold the pipe open.
+  int pidfd = pidfd_open(process_id, 0);
+  int exited = (pidfd == -1);
+  while (1) {
+    struct pollfd fds[2] = {{capture->fd, POLLIN, 0}, {pidfd, POLLIN, 0}};
+    if (!exited) {
+      if (poll(fds, 2, -1) == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        perror("poll error in stream_capture()");
+        break;
+      }
+      exited = (fds[1].revents != 0);
+    }
+
+    ssize_t bytes_read = read(capture->fd, buffer, sizeof(buffer));
+    if (bytes_read > 0) {
+      append_output(buffer, bytes_read);
+      flush_output();
+      continue;
+    }
+    if (bytes_read == -1 && (errno == EINTR || (errno == EAGAIN && !exited))) {
+      continue;
+    }
+    if (bytes_read == -1 && errno != EAGAIN) {
+      perror("read error in stream_capture()");
+    }
+    break;
+  }
+  if (pidfd != -1) {
+    close(pidfd);
+  }
+  release_capture(capture);
+  return 0;
+}
+
+void wait_for_capture_input(void) {
+  struct pollfd* fds = NULL;
+  size_t fds_capacity = 0;
+
+  drain_captures();
+
+  // On a terminal, a line is read only once it is complete, so stdin's
+  // buffer is empty and polling the descriptor shows whether input is
+  // waiting. Elsewhere, the pipes are drained between commands.
+  if (!isatty(STDIN_FILENO) || input_redirected()) {
+    return;
+  }
+  while (1) {
+    size_t num_fds = 1;
+    if (fds_capacity < num_captures + 1) {
+      struct pollfd* grown =
+          realloc(fds, (num_captures + 1) * sizeof(struct pollfd));
+      if (grown == NULL) {
+        perror("realloc error in wait_for_capture_input()");
+        break;
+      }
+      fds = grown;
+      fds_capacity = num_captures + 1;
+    }
+    fds[0] = (struct pollfd){STDIN_FILENO, POLLIN, 0};
+    for (size_t i = 0; i < num_captures; i++) {
+      if (captures[i].fd != -1) {
+        fds[num_fds++] = (struct pollfd){captures[i].fd, POLLIN, 0};
+      }
+    }
+    if (num_fds == 1) {
+      break;
+    }
+    if (poll(fds, num_fds, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("poll error in wait_for_capture_input()");
+      break;
+    }
+    if (fds[0].revents != 0) {
+      break;
+    }
+
+    // Drain the pipes that are ready. Draining may release captures, so
+    // each is found by its descriptor.
+    for (size_t i = 1; i < num_fds; i++) {
+      for (size_t j = 0; fds[i].revents != 0 && j < num_captures; j++) {
+        if (captures[j].fd == fds[i].fd) {
+          drain_capture(&captures[j]);
+          break;
+        }
+      }
+    }
+  }
+  free(fds);
+}
@@ -0,0 +1,125 @@
+#ifndef CAPTURE_UTILS_H
+#define CAPTURE_UTILS_H
+
+#define CAPTURE_FAILURE -1
+#define CAPTURE_JOB_MAX 1048576
+#define CAPTURE_MEMORY_MAX 16777216
+#define CAPTURE_MIN_SIZE 4096
+#define CAPTURE_PREVIEW_MAX 60
+#define CAPTURE_STREAM_SIZE 65536
+
+#include <unistd.h>
+
+// Whether background jobs write to a pipe the shell reads instead of the
+// terminal.
+extern int capture_enabled;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// void append_capture_status(pid_t)
+// Description: Appends a summary of a job's captured output for jobs -l: the
+// bytes not yet shown, the bytes dropped when its buffer was full and the
+// start of its last line.
+// Preconditions: None.
+// Postconditions: Nothing is appended if the job's output is not captured.
+// Return: None.
+extern void append_capture_status(pid_t);
+
+// void attach_capture(int)
+// Description: Points standard output and standard error, unless the command
+// redirects them elsewhere than each other, at the write end of a capture
+// pipe.
+// Preconditions: Called in the child between fork() and exec(). The write end
+// of a pipe from open_capture() is provided.
+// Postconditions: The descriptor is duplicated onto 1 and 2.
+// Return: None.
+extern void attach_capture(int);
+
+// void clear_captures()
+// Description: Closes every capture pipe and frees the buffers.
+// Preconditions: None.
+// Postconditions: Jobs still running get SIGPIPE if they write again.
+// Return: None.
+extern void clear_captures(void);
+
+// void drain_captures()
+// Description: Reads whatever the capturing jobs have written so far without
+// blocking. Each pipe is read into its job's ring buffer with one read of all
+// the bytes waiting. Buffers grow up to CAPTURE_JOB_MAX bytes each and
+// CAPTURE_MEMORY_MAX bytes in all, evicting the output of finished jobs
+// oldest first. A full buffer keeps the newest output.
+// Preconditions: None.
+// Postconditions: Pipes at end of file are closed.
+// Return: None.
+extern void drain_captures(void);
+
+// pid_t find_capture_job(const char*)
+// Description: Resolves a job argument of the output builtin. "%n" is the
+// nth job list_captures() lists, running or finished, and a plain number is a
+// process id.
+// Preconditions: A non-null job argument is provided.
+// Postconditions: Pending output is read first for "%n".
+// Return: The job's process id, or -1 if there is no such job.
+extern pid_t find_capture_job(const char*);
+
+// void list_captures()
+// Description: Lists every job with captured output not yet shown, running
+// or finished, numbered as "%n" arguments count them, with the summary of
+// append_capture_status().
+// Preconditions: None.
+// Postconditions: Pending output is read first.
+// Return: None.
+extern void list_captures(void);
+
+// int open_capture(int[2])
+// Description: Creates the pipe a background job's output is captured
+// through, if capturing is on and the command does not redirect both of its
+// outputs.
+// Preconditions: A non-null array of two descriptors is provided.
+// Postconditions: The array holds a close-on-exec pipe, or -1 twice if
+// nothing is captured.
+// Return: 0 on success, -1 on failure.
+extern int open_capture(int[2]);
+
+// int print_capture(pid_t)
+// Description: Appends a job's captured output to the shell's output and
+// empties its buffer. The buffer is freed once the job's pipe is closed.
+// Preconditions: None.
+// Postconditions: Pending output is read first.
+// Return: 0 on success, -1 if the job's output is not captured.
+extern int print_capture(pid_t);
+
+// int start_capture(pid_t, int)
+// Description: Starts capturing a job's output from the read end of its
+// pipe, which is made non-blocking.
+// Preconditions: The job's process id and the read end of a pipe from
+// open_capture() are provided. The write end is closed in the shell.
+// Postconditions: The shell owns the descriptor, which is closed on failure.
+// Return: 0 on success, -1 on failure.
+extern int start_capture(pid_t, int);
+
+// int stream_capture(pid_t)
+// Description: Prints a job's captured output, then copies its pipe to the
+// shell's output as it arrives until the job exits or closes the pipe. Used
+// when the job is brought to the foreground.
+// Preconditions: None.
+// Postconditions: The capture is released.
+// Return: 0 on success, -1 if the job's output is not captured.
+extern int stream_capture(pid_t);
+
+// void wait_for_capture_input()
+// Description: Waits at the prompt for input to be ready on a terminal,
+// draining capture pipes as the jobs write to them, so they do not block on
+// a full pipe. Otherwise, drains what is waiting and returns at once.
+// Preconditions: Output is flushed.
+// Postconditions: None.
+// Return: None.
+extern void wait_for_capture_input(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAPTURE_UTILS_H
@@ -0,0 +1,296 @@
+// File:    coproc_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains functions for running coprocesses: long-lived
+//          children that a script sends requests to and reads responses from
+//          line by line, so a heavy program starts once instead of once per
+//          request.
+
+#define _GNU_SOURCE
+
+#include "coproc_utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include "bg_utils.h"
+#include "output_utils.h"
+#include "redirect_utils.h"
+#include "trace_utils.h"
+#include "usage_utils.h"
+#include "var_utils.h"
+
+#define COPROC_SUFFIXES 3
+
+// Suffixes of the variables describing a coprocess.
+static const char* const suffixes[COPROC_SUFFIXES] = {"_PID", "_READ",
+                                                      "_WRITE"};
+
+// Running coprocesses, most recently started first.
+static struct coproc_t* coprocs = NULL;
+
+// Returns the coprocess with a name, or NULL if there is none.
+static struct coproc_t* find_coproc(const char* name) {
+  for (struct coproc_t* coproc = coprocs; coproc != NULL;
+       coproc = coproc->next) {
+    if (strcmp(coproc->name, name) == 0) {
+      return coproc;
+    }
+  }
+  return NULL;
+}
+
+// Returns the coprocess whose output is read from a descriptor, or NULL if
+// there is none.
+static struct coproc_t* find_coproc_fd(int fd) {
+  for (struct coproc_t* coproc = coprocs; coproc != NULL;
+       coproc = coproc->next) {
+    if (coproc->read_fd == fd) {
+      return coproc;
+    }
+  }
+  return NULL;
+}
+
+// Sets or unsets (when values is NULL) the variables of a coprocess. Returns
+// 0 on success, -1 on failure.
+static int set_coproc_variables(const char* name, const long* values) {
+  char var_name[256];
+  char value[32];
+
+  for (int i = 0; i < COPROC_SUFFIXES; i++) {
+    snprintf(var_name, sizeof(var_name), "%s%s", name, suffixes[i]);
+    if (values == NULL) {
+      unset_variable(var_name);
+      continue;
+    }
+    snprintf(value, sizeof(value), "%ld", values[i]);
+    if (set_variable(var_name, value) == VAR_FAILURE) {
+      return COPROC_FAILURE;
+    }
+  }
+  return 0;
+}
+
+// Closes the shell's ends of a coprocess, unlinks it and frees it.
+static void free_coproc(struct coproc_t* coproc) {
+  struct coproc_t** link = &coprocs;
+
+  while (*link != coproc) {
+    link = &(*link)->next;
+  }
+  *link = coproc->next;
+  close(coproc->write_fd);
+  close(coproc->read_fd);
+  free(coproc->input.data);
+  free(coproc->name);
+  free(coproc);
+}
+
+// Moves a descriptor of the shell above the ones scripts redirect, keeping it
+// out of children. Returns the new descriptor, or -1 on failure.
+static int move_fd(int fd) {
+  int moved = fcntl(fd, F_DUPFD_CLOEXEC, SAVED_FD_MIN);
+  close(fd);
+  return moved;
+}
+
+void clear_coprocs(void) {
+  while (coprocs != NULL) {
+    free_coproc(coprocs);
+  }
+}
+
+int close_coproc(const char* name) {
+  struct coproc_t* coproc = find_coproc(name);
+  int status;
+
+  if (coproc == NULL) {
+    fprintf(stderr, "shell error: no coprocess named %s\n", name);
+    return COPROC_FAILURE;
+  }
+
+  // End of input tells the coprocess to finish. It may already have been
+  // reaped by jobs or fg, in which case its status is gone.
+  pid_t process_id = coproc->process_id;
+  close(coproc->write_fd);
+  coproc->write_fd = -1;
+  int reaped = 1;
+  while (waitpid(process_id, &status, 0) == -1) {
+    if (errno != EINTR) {
+      status = 0;
+      reaped = 0;
+      break;
+    }
+  }
+  if (reaped) {
+    trace_exit(process_id, exit_status_from_wait(status));
+  }
+  remove_bg_process(process_id);
+  set_coproc_variables(coproc->name, NULL);
+  free_coproc(coproc);
+  return exit_status_from_wait(status);
+}
+
+char* read_line(int fd, size_t* length) {
+  struct coproc_t* coproc = find_coproc_fd(fd);
+  char byte;
+  struct line_buffer_t single = {&byte, 1, 0, 0};
+  struct line_buffer_t* input = (coproc != NULL) ? &coproc->input : &single;
+  char* line = NULL;
+  size_t capacity = 0;
+  int found_newline = 0;
+
+  // The shell's own input, usually standard input, is read through stdio,
+  // unless a redirection such as "read line <<< text" has replaced it.
+  if (fd == fileno(stdin) && !input_redirected()) {
+    ssize_t line_length = getline(&line, &capacity, stdin);
+    if (line_length == -1) {
+      free(line);
+      return NULL;
+    }
+    if (line_length > 0 && line[line_length - 1] == '\n') {
+      line[--line_length] = '\0';
+    }
+    *length = line_length;
+    return line;
+  }
+
+  *length = 0;
+  while (!found_newline) {
+    if (input->start == input->end) {
+      ssize_t bytes_read = read(fd, input->data, input->size);
+      if (bytes_read == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        perror("read error in read_line()");
+        free(line);
+        return NULL;
+      }
+      if (bytes_read == 0) {
+        break;
+      }
+      input->start = 0;
+      input->end = bytes_read;
+    }
+
+    // Take everything up to the newline, or the whole buffer without one.
+    char* start = input->data + input->start;
+    char* newline = memchr(start, '\n', input->end - input->start);
+    size_t chunk = newline ? (size_t)(newline - start)
+                           : input->end - input->start;
+    if (*length + chunk + 1 > capacity) {
+      size_t new_capacity = capacity ? capacity : 128;
+      while (*length + chunk + 1 > new_capacity) {
+        new_capacity *= 2;
+      }
+      char* temp_line = realloc(line, new_capacity);
+      if (temp_line == NULL) {
+        perror("realloc error in read_line()");
+        free(line);
+        return NULL;
+      }
+      line = temp_line;
+      capacity = new_capacity;
+    }
+    memcpy(line + *length, start, chunk);
+    *length += chunk;
+    input->start += chunk + (newline ? 1 : 0);
+    found_newline = (newline != NULL);
+  }
+
+  // End of input before anything was read.
+  if (line == NULL) {
+    return NULL;
+  }
+  line[*length] = '\0';
+  return line;
+}
+
+int start_coproc(const char* name, char** parsed_command) {
+  int to_child[2], from_child[2];
+
+  if (find_coproc(name) != NULL) {
+    fprintf(stderr, "shell error: coprocess %s is already running\n", name);
+    return COPROC_FAILURE;
+  }
+
+  struct coproc_t* coproc = calloc(1, sizeof(struct coproc_t));
+  if (coproc == NULL || (coproc->name = strdup(name)) == NULL ||
+      (coproc->input.data = malloc(COPROC_READ_SIZE)) == NULL) {
+    perror("malloc error in start_coproc()");
+    if (coproc != NULL) {
+      free(coproc->name);
+    }
+    free(coproc);
+    return COPROC_FAILURE;
+  }
+  coproc->input.size = COPROC_READ_SIZE;
+
+  if (pipe2(to_child, O_CLOEXEC) == -1) {
+    perror("pipe2 error in start_coproc()");
+    free(coproc->input.data);
+    free(coproc->name);
+    free(coproc);
+    return COPROC_FAILURE;
+  }
+  if (pipe2(from_child, O_CLOEXEC) == -1) {
+    perror("pipe2 error in start_coproc()");
+    close(to_child[0]);
+    close(to_child[1]);
+    free(coproc->input.data);
+    free(coproc->name);
+    free(coproc);
+    return COPROC_FAILURE;
+  }
+
+  // The child must not inherit pending output.
+  flush_output();
+  pid_t process_id = fork();
+  if (process_id == 0) {
+    // Child process. Requests arrive on standard input and responses leave on
+    // standard output; the shell's ends close on exec.
+    dup2(to_child[0], STDIN_FILENO);
+    dup2(from_child[1], STDOUT_FILENO);
+    execvp(parsed_command[0], parsed_command);
+    fprintf(stderr, "shell error: %s: %s\n", parsed_command[0],
+            strerror(errno));
+    _exit(127);
+  }
+
+  close(to_child[0]);
+  close(from_child[1]);
+  if (process_id < 0) {
+    perror("fork error in start_coproc()");
+    close(to_child[1]);
+    close(from_child[0]);
+    free(coproc->input.data);
+    free(coproc->name);
+    free(coproc);
+    return COPROC_FAILURE;
+  }
+
+  // Link the coprocess first, so a failure below still closes its input and
+  // lets it exit.
+  trace_launch(process_id, TRACE_COPROC, parsed_command);
+  coproc->process_id = process_id;
+  coproc->write_fd = move_fd(to_child[1]);
+  coproc->read_fd = move_fd(from_child[0]);
+  coproc->next = coprocs;
+  coprocs = coproc;
+  long values[COPROC_SUFFIXES] = {process_id, coproc->read_fd,
+                                  coproc->write_fd};
+  if (coproc->write_fd == -1 || coproc->read_fd == -1 ||
+      append_bg_process(process_id) == CLEAR_BG_FAILURE ||
+      set_coproc_variables(name, values) == COPROC_FAILURE) {
+    fprintf(stderr, "shell error: could not set up coprocess %s\n", name);
+    close_coproc(name);
+    return COPROC_FAILURE;
+  }
+  return 0;
+}
@@ -0,0 +1,82 @@
+#ifndef COPROC_UTILS_H
+#define COPROC_UTILS_H
+
+#define COPROC_DEFAULT_NAME "COPROC"
+#define COPROC_FAILURE -1
+#define COPROC_READ_SIZE 4096
+
+#include <stddef.h>
+#include <unistd.h>
+
+// Struct holding input read ahead from a descriptor.
+//   data:  The buffer.
+//   size:  The capacity of the buffer.
+//   start: The first byte not yet returned.
+//   end:   One past the last byte read.
+struct line_buffer_t {
+    char* data;
+    size_t size;
+    size_t start;
+    size_t end;
+};
+
+// Struct holding a running coprocess. The shell writes requests to write_fd,
+// which is the coprocess's standard input, and reads responses from read_fd,
+// which is its standard output.
+struct coproc_t {
+    char* name;
+    pid_t process_id;
+    int read_fd;
+    int write_fd;
+    struct line_buffer_t input;
+    struct coproc_t* next;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// void clear_coprocs()
+// Description: Closes the shell's ends of every coprocess and frees them. The
+// coprocesses see end of input and are left to exit on their own.
+// Preconditions: None.
+// Postconditions: No coprocesses are tracked.
+// Return: None.
+extern void clear_coprocs(void);
+
+// int close_coproc(const char*)
+// Description: Closes a coprocess's standard input and waits for it to exit.
+// Preconditions: A non-null name is provided.
+// Postconditions: The coprocess is removed from the background process table,
+// its descriptors are closed and its NAME_PID, NAME_READ and NAME_WRITE
+// variables are unset.
+// Return: The coprocess's exit status, or -1 on failure.
+extern int close_coproc(const char*);
+
+// char* read_line(int, size_t*)
+// Description: Reads one line from a descriptor. Coprocess output is read in
+// blocks of COPROC_READ_SIZE and kept between calls. Standard input is read
+// through stdio, like the shell's own input. Other descriptors are read a
+// byte at a time, so nothing past the line is consumed.
+// Preconditions: A length pointer is provided.
+// Postconditions: The line's length without its newline is stored in the
+// second argument.
+// Return: A newly allocated line without its newline, or NULL at end of input
+// or on failure.
+extern char* read_line(int, size_t*);
+
+// int start_coproc(const char*, char**)
+// Description: Starts a command as a coprocess connected to the shell by two
+// pipes, and adds it to the background process table. The shell's ends are
+// stored in the variables NAME_READ and NAME_WRITE and the process id in
+// NAME_PID.
+// Preconditions: A valid variable name and a non-null command are provided.
+// Postconditions: The coprocess is running.
+// Return: 0 on success, -1 on failure.
+extern int start_coproc(const char*, char**);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COPROC_UTILS_H
@@ -0,0 +1,381 @@
+// File:    exec_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains functions for dispatching parsed commands to
+//          builtins and launching external programs.
+
+#define _GNU_SOURCE
+
+#include "exec_utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "batch_utils.h"
+#include "bg_utils.h"
+#include "capture_utils.h"
+#include "builtins.h"
+#include "limit_utils.h"
+#include "output_utils.h"
+#include "profile_utils.h"
+#include "sched_utils.h"
+#include "timeout_utils.h"
+#include "trace_utils.h"
+#include "usage_utils.h"
+#include "zygote_utils.h"
+
+// Reads a file descriptor until EOF into a growable buffer with large reads.
+// Returns the NUL-terminated buffer, or NULL on failure.
+static char* read_all(int fd, size_t* length) {
+  size_t capacity = CAPTURE_READ_SIZE;
+  char* buffer = malloc(capacity + 1);
+  ssize_t bytes_read;
+
+  if (buffer == NULL) {
+    perror("malloc error in read_all()");
+    return NULL;
+  }
+  *length = 0;
+
+  while (1) {
+    // Double the buffer whenever it is full.
+    if (*length == capacity) {
+      char* temp_buffer = realloc(buffer, (capacity *= 2) + 1);
+      if (temp_buffer == NULL) {
+        perror("realloc error in read_all()");
+        free(buffer);
+        return NULL;
+      }
+      buffer = temp_buffer;
+    }
+
+    bytes_read = read(fd, buffer + *length, capacity - *length);
+    if (bytes_read == 0) {
+      break;
+    }
+    if (bytes_read == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("read error in read_all()");
+      free(buffer);
+      return NULL;
+    }
+    *length += bytes_read;
+  }
+
+  buffer[*length] = '\0';
+  return buffer;
+}
+
+// Runs a builtin in-process with standard output redirected to a memfd.
+// Returns NULL without running it if no memfd could be created.
+static char* capture_builtin(char** parsed_command, size_t* length) {
+  int capture_fd, saved_stdout;
+
+  if ((capture_fd = memfd_create("capture", MFD_CLOEXEC)) == -1) {
+    return NULL;
+  }
+
+  // Point standard output at the memfd while the builtin runs.
+  flush_output();
+  if ((saved_stdout = dup(STDOUT_FILENO)) == -1 ||
+      dup2(capture_fd, STDOUT_FILENO) == -1) {
+    perror("dup error in capture_builtin()");
+    if (saved_stdout != -1) {
+      close(saved_stdout);
+    }
+    close(capture_fd);
+    return NULL;
+  }
+  run_command(parsed_command);
+  flush_output();
+  dup2(saved_stdout, STDOUT_FILENO);
+  close(saved_stdout);
+
+  // Read the output back from the start of the memfd.
+  char* output = NULL;
+  if (lseek(capture_fd, 0, SEEK_SET) == -1) {
+    perror("lseek error in capture_builtin()");
+  } else {
+    output = read_all(capture_fd, length);
+  }
+  close(capture_fd);
+  return output;
+}
+
+// Replaces a child process with an external command. On failure it reports
+// the command as the shell does and exits with 127 if it was not found and 126
+// otherwise. It must not run exit(), which would seek the standard input it
+// shares with the shell back to what stdio had buffered, so a script would be
+// read again from there.
+static void exec_external(char** parsed_command) {
+  execvp(parsed_command[0], parsed_command);
+  int error = errno;
+  fprintf(stderr, "shell error: %s: %s\n", parsed_command[0],
+          (error == ENOENT) ? "command not found" : strerror(error));
+  _exit((error == ENOENT) ? 127 : 126);
+}
+
+// Runs a captured command in the child process. Builtins with side effects
+// run here so they cannot change the shell itself.
+static int run_captured_command(void* arg) {
+  char** parsed_command = arg;
+
+  if (find_builtin(parsed_command) != NULL) {
+    return (run_command(parsed_command) == BUILTIN_FAILURE) ? EXIT_FAILURE
+                                                            : last_exit_status;
+  }
+  exec_external(parsed_command);
+  return EXIT_FAILURE;
+}
+
+char* capture_command(char** parsed_command, size_t* length) {
+  const struct builtin_t* builtin = find_builtin(parsed_command);
+  char* output;
+
+  // Builtins without side effects run without forking.
+  if (builtin != NULL && (builtin->flags & BUILTIN_CAPTURABLE)) {
+    if ((output = capture_builtin(parsed_command, length)) != NULL) {
+      return output;
+    }
+  }
+  return capture_subshell(run_captured_command, parsed_command, length);
+}
+
+char* capture_subshell(int (*run)(void*), void* arg, size_t* length) {
+  int pipe_fds[2];
+  char* output;
+
+  if (pipe2(pipe_fds, O_CLOEXEC) == -1) {
+    perror("pipe2 error in capture_subshell()");
+    return NULL;
+  }
+
+  // Flush so the child does not inherit pending output.
+  flush_output();
+  start_usage(&last_usage);
+  PROFILE_COUNT(PROFILE_SPAWNS);
+  pid_t process_id = fork();
+
+  if (process_id < 0) {
+    perror("fork error in capture_subshell()");
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    return NULL;
+  }
+
+  if (process_id == 0) {
+    // Child process. Standard output goes into the pipe.
+    dup2(pipe_fds[1], STDOUT_FILENO);
+    int status = run(arg);
+    flush_output();
+    _exit(status);
+  }
+
+  // Parent process. Read until the child closes its end, then reap it.
+  trace_launch(process_id, TRACE_SUBSHELL, NULL);
+  close(pipe_fds[1]);
+  output = read_all(pipe_fds[0], length);
+  close(pipe_fds[0]);
+
+  int status;
+  struct rusage rusage;
+  if (wait4(process_id, &status, 0, &rusage) == -1) {
+    perror("wait4 error in capture_subshell()");
+  } else {
+    finish_usage(&last_usage, &rusage, exit_status_from_wait(status));
+    trace_exit(process_id, last_exit_status);
+  }
+  return output;
+}
+
+int execute_command(char** parsed_command) {
+  // NOTE: Extra credit - implementing background process execution.
+  // Check if the command should start a background process.
+  int is_background = 0;
+  int i = 0;
+  while (parsed_command[i] != NULL) {
+    i++;
+  }
+  if (strcmp(parsed_command[i - 1], AMPERSAND) == 0) {
+    parsed_command[i - 1] = NULL;
+    is_background = 1;
+  }
+
+  // Arguments that do not fit in ARG_MAX would make execvp() fail with
+  // E2BIG. With the auto_batch option, the command runs in batches instead.
+  if (!is_background && exceeds_argument_space(parsed_command)) {
+    if (auto_batch_enabled) {
+      struct batch_options_t options = {1, 0, 1};
+      return (batch_command(parsed_command, &options) == BATCH_FAILURE)
+                 ? EXECUTE_FAILURE
+                 : 0;
+    }
+    fprintf(stderr,
+            "shell error: argument list too long; see batch and option "
+            "auto_batch\n");
+    return EXECUTE_FAILURE;
+  }
+
+  // Earlier output comes before the child's, and is not inherited by it.
+  flush_output();
+
+  // Background jobs write to a pipe the shell drains, if output is captured.
+  int capture_fds[2] = {-1, -1};
+  if (is_background && open_capture(capture_fds) == CAPTURE_FAILURE) {
+    return EXECUTE_FAILURE;
+  }
+
+  // Background jobs may be pinned to a CPU of their own.
+  struct job_sched_t spread;
+  int spread_cpu = -1;
+  const struct job_sched_t* sched =
+      is_background ? background_sched(&spread, &spread_cpu) : job_sched;
+
+  // Create child process.
+  PROFILE_COUNT(PROFILE_SPAWNS);
+  PROFILE_BEGIN(fork);
+  // Commands with limits, scheduling or captured output are forked, since
+  // those are set up in the child.
+  pid_t process_id =
+      (job_limits == NULL && sched == NULL && capture_fds[1] == -1)
+          ? zygote_spawn(parsed_command)
+          : ZYGOTE_FAILURE;
+  if (process_id == ZYGOTE_FAILURE) {
+    process_id = fork();
+  }
+
+  // Check for error in child process creation.
+  if (process_id < 0) {
+    perror("fork error in execute_command()");
+    if (capture_fds[0] != -1) {
+      close(capture_fds[0]);
+      close(capture_fds[1]);
+    }
+    return EXECUTE_FAILURE;
+  }
+
+  if (process_id == 0) {
+    // Child process.
+    // Limits from the limit builtin apply to the command only.
+    if (job_limits != NULL) {
+      apply_limits(job_limits);
+    }
+    if (sched != NULL) {
+      apply_sched(sched);
+    }
+    if (capture_fds[1] != -1) {
+      attach_capture(capture_fds[1]);
+    }
+    // Child executes the parsed command.
+    exec_external(parsed_command);
+  } else {
+    // Parent process.
+    PROFILE_END(fork, PROFILE_FORK);
+    trace_launch(process_id,
+                 is_background ? TRACE_BACKGROUND : TRACE_FOREGROUND,
+                 parsed_command);
+    if (!is_background) {
+      // Wait for child process to terminate if it is not a background process
+      // and collect its resource usage.
+      int status;
+      struct rusage rusage;
+      int timed_out = 0;
+      PROFILE_BEGIN(wait);
+      if (job_deadline != NULL) {
+        // Commands run by the timeout builtin are stopped at their deadline.
+        timed_out =
+            wait_with_deadline(process_id, job_deadline, &status, &rusage);
+      } else if (wait4(process_id, &status, 0, &rusage) == -1) {
+        timed_out = TIMEOUT_FAILURE;
+      }
+      if (timed_out == TIMEOUT_FAILURE) {
+        perror("wait4 error in execute_command()");
+        return EXECUTE_FAILURE;
+      }
+      PROFILE_END(wait, PROFILE_WAIT);
+      finish_usage(&last_usage, &rusage,
+                   timed_out ? TIMEOUT_EXIT_STATUS
+                             : exit_status_from_wait(status));
+      trace_exit(process_id, last_exit_status);
+    } else {
+      // Add child process to background process array.
+      if (capture_fds[0] != -1) {
+        close(capture_fds[1]);
+        if (start_capture(process_id, capture_fds[0]) == CAPTURE_FAILURE) {
+          fprintf(stderr, "Error capturing the output of process %d.\n",
+                  process_id);
+        }
+      }
+      if (append_bg_process(process_id) == CLEAR_BG_FAILURE) {
+        return EXECUTE_FAILURE;
+      }
+      if (spread_cpu != -1) {
+        set_bg_process_cpu(process_id, spread_cpu);
+      }
+      format_output("Started background process %d\n", process_id);
+      if (job_deadline != NULL &&
+          add_bg_deadline(process_id, job_deadline) == TIMEOUT_FAILURE) {
+        fprintf(stderr, "Error setting the deadline of process %d.\n",
+                process_id);
+      }
+
+      // Background launches have no child usage to report yet.
+      struct rusage rusage;
+      memset(&rusage, 0, sizeof(rusage));
+      finish_usage(&last_usage, &rusage, 0);
+    }
+  }
+
+  return 0;
+}
+
+int dispatch_command(char** parsed_command, const struct builtin_t* builtin) {
+  struct rusage before, after, delta;
+  int result;
+
+  // The external_utils option may have changed since the builtin was found.
+  builtin = resolve_builtin(builtin);
+  start_usage(&last_usage);
+
+  // Other commands for program executions.
+  if (builtin == NULL) {
+    if ((result = execute_command(parsed_command)) == EXECUTE_FAILURE) {
+      fprintf(stderr, "Error executing command.\n");
+      memset(&delta, 0, sizeof(delta));
+      finish_usage(&last_usage, &delta, 1);
+    }
+    return result;
+  }
+
+  PROFILE_COUNT(PROFILE_BUILTINS);
+
+  // Builtins such as "time" and "fg" fill in last_usage themselves.
+  if (builtin->flags & BUILTIN_RECORDS_USAGE) {
+    if ((result = builtin->handler(parsed_command)) == BUILTIN_FAILURE) {
+      memset(&delta, 0, sizeof(delta));
+      finish_usage(&last_usage, &delta, 1);
+    }
+    return result;
+  }
+
+  // Other builtins are accounted against the shell process itself.
+  getrusage(RUSAGE_SELF, &before);
+  result = builtin->handler(parsed_command);
+  getrusage(RUSAGE_SELF, &after);
+  subtract_rusage(&delta, &after, &before);
+  finish_usage(&last_usage, &delta, (result == BUILTIN_FAILURE) ? 1 : 0);
+  return result;
+}
+
+int run_command(char** parsed_command) {
+  return dispatch_command(parsed_command, find_builtin(parsed_command));
+}
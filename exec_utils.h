@@ -0,0 +1,68 @@
+#ifndef EXEC_UTILS_H
+#define EXEC_UTILS_H
+
+#define AMPERSAND "&"
+#define CAPTURE_READ_SIZE 65536
+#define EXECUTE_FAILURE -1
+
+#include <stddef.h>
+
+struct builtin_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// char* capture_command(char**, size_t*)
+// Description: Runs a parsed command with its standard output captured.
+// Builtins without side effects run in-process; everything else runs in a
+// child process connected by a pipe.
+// Preconditions: A non-null command and length pointer are provided.
+// Postconditions: The command's resource usage and exit status are stored in
+// last_usage and last_exit_status. The output length is stored in the second
+// argument.
+// Return: A newly allocated, NUL-terminated buffer holding the output, or NULL
+// on failure.
+extern char* capture_command(char**, size_t*);
+
+// char* capture_subshell(int (*)(void*), void*, size_t*)
+// Description: Calls a function in a child process with its standard output
+// captured through a pipe.
+// Preconditions: A non-null function and length pointer are provided.
+// Postconditions: The child exits with the function's return value. Its
+// resource usage and exit status are stored in last_usage and
+// last_exit_status. The output length is stored in the third argument.
+// Return: A newly allocated, NUL-terminated buffer holding the output, or NULL
+// on failure.
+extern char* capture_subshell(int (*)(void*), void*, size_t*);
+
+// int dispatch_command(char**, const struct builtin_t*)
+// Description: Runs a parsed command whose builtin has already been resolved.
+// Preconditions: A non-null command is provided as an argument. The second
+// argument is find_builtin() of the command.
+// Postconditions: The command is executed and its resource usage and exit
+// status are stored in last_usage and last_exit_status.
+// Return: 0 on success, -1 on failure, BUILTIN_EXIT if the shell should exit.
+extern int dispatch_command(char**, const struct builtin_t*);
+
+// int execute_command(char**)
+// Description: Executes the provided command in a child process.
+// Preconditions: A non-null command is provided as an argument.
+// Postconditions: The command is executed. For foreground commands, the
+// child's resource usage and exit status are stored in last_usage.
+// Return: 0 on success, -1 on failure.
+extern int execute_command(char**);
+
+// int run_command(char**)
+// Description: Runs a parsed command, either as a builtin or as a program.
+// Preconditions: A non-null command is provided as an argument.
+// Postconditions: The command is executed and its resource usage and exit
+// status are stored in last_usage and last_exit_status.
+// Return: 0 on success, -1 on failure, BUILTIN_EXIT if the shell should exit.
+extern int run_command(char**);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EXEC_UTILS_H
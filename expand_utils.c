@@ -0,0 +1,412 @@
+// File:    expand_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains the expansion pass run on user input before it
+//          is parsed: variable expansion and command substitution.
+
+#define _GNU_SOURCE
+
+#include "expand_utils.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arith_utils.h"
+#include "ast_utils.h"
+#include "exec_utils.h"
+#include "parse_utils.h"
+#include "var_utils.h"
+
+// Characters that parse_command() passes through unchanged outside quotes.
+#define SAFE_CHARS "-_./,:=+@%^~"
+
+// How substituted text is appended: split into words, kept as one word, or
+// copied as is, as in a here-document.
+enum expand_mode_t { EXPAND_WORD, EXPAND_SPLIT, EXPAND_LITERAL };
+
+// Struct holding a growable output string.
+struct expansion_t {
+    char* data;
+    size_t length;
+    size_t capacity;
+};
+
+// Appends bytes to the expansion. Returns 0 on success, -1 on failure.
+static int append_bytes(struct expansion_t* out, const char* bytes,
+                        size_t length) {
+  if (out->length + length + 1 > out->capacity) {
+    size_t capacity = out->capacity ? out->capacity : 64;
+    while (out->length + length + 1 > capacity) {
+      capacity *= 2;
+    }
+    char* temp_data = realloc(out->data, capacity);
+    if (temp_data == NULL) {
+      perror("realloc error in append_bytes()");
+      return -1;
+    }
+    out->data = temp_data;
+    out->capacity = capacity;
+  }
+  memcpy(out->data + out->length, bytes, length);
+  out->length += length;
+  out->data[out->length] = '\0';
+  return 0;
+}
+
+// Appends expanded text so that parse_command() reproduces it literally.
+// Whitespace becomes an argument separator when splitting. Everything else
+// that unescape() would interpret is written as an octal escape, closing and
+// reopening the surrounding double quotes where needed. Literal text is
+// appended unchanged.
+static int append_output(struct expansion_t* out, const char* output,
+                         size_t length, char quoted, enum expand_mode_t mode) {
+  char escape[5];
+  int in_space = 0;
+
+  if (mode == EXPAND_LITERAL) {
+    return append_bytes(out, output, length);
+  }
+  if (quoted && append_bytes(out, &quoted, 1) == -1) {
+    return -1;
+  }
+  for (size_t i = 0; i < length; i++) {
+    unsigned char c = (unsigned char)output[i];
+
+    if (c == '\0') {
+      continue;
+    }
+    if (mode == EXPAND_SPLIT && !quoted && isspace(c)) {
+      // Word splitting: one separator per run of whitespace.
+      if (!in_space && append_bytes(out, " ", 1) == -1) {
+        return -1;
+      }
+      in_space = 1;
+      continue;
+    }
+    in_space = 0;
+
+    if (isalnum(c) || strchr(SAFE_CHARS, c) != NULL) {
+      if (append_bytes(out, (const char*)&c, 1) == -1) {
+        return -1;
+      }
+    } else {
+      snprintf(escape, sizeof(escape), "\\%03o", c);
+      if (append_bytes(out, escape, 4) == -1) {
+        return -1;
+      }
+    }
+  }
+  if (quoted && append_bytes(out, &quoted, 1) == -1) {
+    return -1;
+  }
+  return 0;
+}
+
+// Returns the index of the ")" closing a "$(" whose body starts at the given
+// index, or -1 if it is unterminated.
+static long find_closing_paren(const char* str, long start) {
+  int depth = 1;
+  char quoted = 0;
+
+  for (long i = start; str[i] != '\0'; i++) {
+    if (str[i] == '\\' && str[i + 1] != '\0') {
+      i++;
+    } else if (quoted) {
+      if (str[i] == quoted) {
+        quoted = 0;
+      }
+    } else if (str[i] == '\'' || str[i] == '"') {
+      quoted = str[i];
+    } else if (str[i] == '(') {
+      depth++;
+    } else if (str[i] == ')' && --depth == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Returns the index of the "`" closing a backtick substitution whose body
+// starts at the given index, or -1 if it is unterminated.
+static long find_closing_backtick(const char* str, long start) {
+  for (long i = start; str[i] != '\0'; i++) {
+    if (str[i] == '\\' && str[i + 1] != '\0') {
+      i++;
+    } else if (str[i] == '`') {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Returns the index of the last ")" of a "$((expression))" starting at the
+// given index, or -1 if it is not one, such as "$((command); command)".
+static long find_arithmetic_end(const char* str, long dollar) {
+  if (str[dollar + 1] != '(' || str[dollar + 2] != '(') {
+    return -1;
+  }
+  long end = find_closing_paren(str, dollar + 2);
+  if (end == -1 || find_closing_paren(str, dollar + 3) != end - 1) {
+    return -1;
+  }
+  return end;
+}
+
+// Evaluates an arithmetic expansion and appends its value to the expansion.
+static int substitute_arithmetic(struct expansion_t* out,
+                                 const char* expression, size_t length,
+                                 char quoted, enum expand_mode_t mode) {
+  char result[ARITH_RESULT_MAX];
+
+  if (evaluate_arithmetic(expression, length, result) == ARITH_FAILURE) {
+    return -1;
+  }
+  return append_output(out, result, strlen(result), quoted, mode);
+}
+
+// Runs a substituted command and appends its output to the expansion.
+static int substitute(struct expansion_t* out, const char* command,
+                      size_t length, char quoted, enum expand_mode_t mode) {
+  char* inner = strndup(command, length);
+  size_t output_length = 0;
+  char* output = NULL;
+
+  if (inner == NULL) {
+    perror("strndup error in substitute()");
+    return -1;
+  }
+
+  // The body is a full program. Nested substitutions are expanded when it
+  // runs.
+  struct ast_program_t* program;
+  int status = compile_program(inner, &program);
+  free(inner);
+  if (status == COMPILE_INCOMPLETE) {
+    fprintf(stderr, "shell error: incomplete command substitution\n");
+  }
+  if (status != COMPILE_OK) {
+    return -1;
+  }
+  if (program != NULL) {
+    output = capture_program(program, &output_length);
+    release_program(program);
+  }
+
+  // Remove trailing newlines.
+  while (output_length > 0 && output[output_length - 1] == '\n') {
+    output_length--;
+  }
+
+  int result =
+      append_output(out, output ? output : "", output_length, quoted, mode);
+  free(output);
+  return result;
+}
+
+// Returns 1 if the character names a special parameter such as $? or $1.
+static int is_special_parameter(char c) {
+  return c != '\0' && (strchr("?$#", c) != NULL || isdigit((unsigned char)c));
+}
+
+// Appends the value of the variable referenced at the given "$". Returns the
+// index of the last character of the reference, or -1 on failure.
+static long expand_variable(struct expansion_t* out, const char* command,
+                            long dollar, char quoted, enum expand_mode_t mode) {
+  const char* name = command + dollar + 1;
+  size_t length = 0;
+  long end;
+
+  if (name[0] == '{') {
+    // ${name}
+    const char* close = strchr(name, '}');
+    length = (close != NULL) ? (size_t)(close - name - 1) : 0;
+    if (close == NULL || !(is_valid_name(name + 1, length) ||
+                           (length == 1 && is_special_parameter(name[1])))) {
+      fprintf(stderr, "shell error: bad substitution\n");
+      return -1;
+    }
+    end = close - command;
+    name++;
+  } else if (isalpha((unsigned char)name[0]) || name[0] == '_') {
+    // $name
+    while (isalnum((unsigned char)name[length]) || name[length] == '_') {
+      length++;
+    }
+    end = dollar + length;
+  } else if (is_special_parameter(name[0])) {
+    length = 1;
+    end = dollar + 1;
+  } else {
+    // A lone "$" is literal.
+    return (append_bytes(out, "$", 1) == -1) ? -1 : dollar;
+  }
+
+  const char* value = get_variable(name, length);
+  if (value == NULL) {
+    value = "";
+  }
+  if (append_output(out, value, strlen(value), quoted, mode) == -1) {
+    return -1;
+  }
+  return end;
+}
+
+// Expands a line, splitting unquoted expansions into words if asked to.
+static char* expand(const char* command, enum expand_mode_t mode) {
+  struct expansion_t out = {NULL, 0, 0};
+  char quoted = 0;
+  int failed = (append_bytes(&out, "", 0) == -1);
+
+  for (long i = 0; !failed && command[i] != '\0'; i++) {
+    char c = command[i];
+    long end;
+
+    if (c == '\\' && command[i + 1] != '\0') {
+      // Escape sequences are left for unescape().
+      failed = (append_bytes(&out, command + i, 2) == -1);
+      i++;
+      continue;
+    }
+
+    if (quoted == '\'') {
+      // No substitution inside single quotes.
+      if (c == quoted) {
+        quoted = 0;
+      }
+    } else if (c == '$' && (end = find_arithmetic_end(command, i)) != -1) {
+      failed = (substitute_arithmetic(&out, command + i + 3, end - i - 4,
+                                      quoted, mode) == -1);
+      i = end;
+      continue;
+    } else if ((c == '$' && command[i + 1] == '(') || c == '`') {
+      // Find the body of the substitution.
+      long body = (c == '`') ? i + 1 : i + 2;
+      if ((end = find_substitution_end(command, i)) == -1) {
+        fprintf(stderr, "shell error: unterminated command substitution\n");
+        failed = 1;
+        break;
+      }
+      failed =
+          (substitute(&out, command + body, end - body, quoted, mode) == -1);
+      i = end;
+      continue;
+    } else if (c == '$') {
+      failed = ((i = expand_variable(&out, command, i, quoted, mode)) == -1);
+      continue;
+    } else if (!quoted && (c == '\'' || c == '"')) {
+      quoted = c;
+    } else if (quoted && c == quoted) {
+      quoted = 0;
+    }
+
+    failed = (append_bytes(&out, &c, 1) == -1);
+  }
+
+  if (failed) {
+    free(out.data);
+    return NULL;
+  }
+  return out.data;
+}
+
+char* expand_command(const char* command) {
+  return expand(command, EXPAND_SPLIT);
+}
+
+char* expand_here_document(const char* body, size_t* length) {
+  struct expansion_t out = {NULL, 0, 0};
+  int failed = (append_bytes(&out, "", 0) == -1);
+
+  // Quotes are ordinary characters, and a backslash only escapes "$", "`",
+  // "\\" and newline.
+  for (long i = 0; !failed && body[i] != '\0'; i++) {
+    size_t span = strcspn(body + i, "\\$`");
+    if (span > 0) {
+      failed = (append_bytes(&out, body + i, span) == -1);
+      i += span - 1;
+      continue;
+    }
+
+    char c = body[i];
+    long end;
+    if (c == '\\') {
+      char next = body[i + 1];
+      if (next == '\n') {
+        i++;
+      } else if (next == '$' || next == '`' || next == '\\') {
+        failed = (append_bytes(&out, &next, 1) == -1);
+        i++;
+      } else {
+        failed = (append_bytes(&out, &c, 1) == -1);
+      }
+    } else if (c == '$' && (end = find_arithmetic_end(body, i)) != -1) {
+      failed = (substitute_arithmetic(&out, body + i + 3, end - i - 4, 0,
+                                      EXPAND_LITERAL) == -1);
+      i = end;
+    } else if ((c == '$' && body[i + 1] == '(') || c == '`') {
+      long start = (c == '`') ? i + 1 : i + 2;
+      if ((end = find_substitution_end(body, i)) == -1) {
+        fprintf(stderr, "shell error: unterminated command substitution\n");
+        failed = 1;
+        break;
+      }
+      failed = (substitute(&out, body + start, end - start, 0,
+                           EXPAND_LITERAL) == -1);
+      i = end;
+    } else {
+      failed =
+          ((i = expand_variable(&out, body, i, 0, EXPAND_LITERAL)) == -1);
+    }
+  }
+
+  if (failed) {
+    free(out.data);
+    return NULL;
+  }
+  *length = out.length;
+  return out.data;
+}
+
+char* expand_word(const char* word) {
+  char* expanded = expand(word, EXPAND_WORD);
+  if (expanded == NULL) {
+    return NULL;
+  }
+
+  // Nothing was split, so the word parses back to at most one argument.
+  char** parsed_word = parse_command(expanded);
+  free(expanded);
+  char* value = strdup((parsed_word != NULL) ? parsed_word[0] : "");
+  free_parsed_command(parsed_word);
+  if (value == NULL) {
+    perror("strdup error in expand_word()");
+  }
+  return value;
+}
+
+long find_substitution_end(const char* str, long start) {
+  if (str[start] == '`') {
+    return find_closing_backtick(str, start + 1);
+  }
+  return find_closing_paren(str, start + 2);
+}
+
+int needs_expansion(const char* command) {
+  return (strchr(command, '$') != NULL) || (strchr(command, '`') != NULL);
+}
+
+char** parse_command_line(char* command) {
+  if (!needs_expansion(command)) {
+    return parse_command(command);
+  }
+
+  char* expanded = expand_command(command);
+  if (expanded == NULL) {
+    return NULL;
+  }
+  char** parsed_command = parse_command(expanded);
+  free(expanded);
+  return parsed_command;
+}
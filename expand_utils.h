@@ -0,0 +1,70 @@
+#ifndef EXPAND_UTILS_H
+#define EXPAND_UTILS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// char* expand_command(const char*)
+// Description: Performs variable expansion and command substitution on a line
+// of user input. Every $name, ${name}, special parameter ($?, $#, $$, $0-$9),
+// $((expression)), $(command) or `command` outside single quotes is replaced
+// by its value, with trailing newlines removed from command output. Unquoted values are split
+// into words at whitespace; values inside double quotes stay a single word.
+// Preconditions: A non-null command is provided as an argument.
+// Postconditions: The substituted commands are executed.
+// Return: A newly allocated line that parse_command() turns into the expanded
+// arguments, or NULL on failure.
+extern char* expand_command(const char*);
+
+// char* expand_here_document(const char*, size_t*)
+// Description: Expands the body of an unquoted here-document. Variables and
+// command substitutions are replaced without word splitting, quotes are kept,
+// and a backslash only escapes "$", "`", "\\" or a newline, which it removes.
+// Arithmetic expansions are evaluated.
+// Preconditions: A non-null body and length pointer are provided.
+// Postconditions: The substituted commands are executed, and the length of
+// the result is stored in the second argument.
+// Return: A newly allocated string holding the text, or NULL on failure.
+extern char* expand_here_document(const char*, size_t*);
+
+// char* expand_word(const char*)
+// Description: Expands and unescapes a single word without word splitting, as
+// for the value of a variable assignment.
+// Preconditions: A non-null word is provided as an argument.
+// Postconditions: The substituted commands are executed.
+// Return: A newly allocated string holding the value, or NULL on failure.
+extern char* expand_word(const char*);
+
+// long find_substitution_end(const char*, long)
+// Description: Finds the end of the $(command) or `command` substitution
+// starting at the given index.
+// Preconditions: The string has "$(" or "`" at the given index.
+// Postconditions: None.
+// Return: The index of the closing ")" or "`", or -1 if it is unterminated.
+extern long find_substitution_end(const char*, long);
+
+// int needs_expansion(const char*)
+// Description: Checks whether a line may contain a variable or command
+// substitution.
+// Preconditions: A non-null command is provided as an argument.
+// Postconditions: None.
+// Return: 1 if the line must go through expand_command(), 0 otherwise.
+extern int needs_expansion(const char*);
+
+// char** parse_command_line(char*)
+// Description: Expands and parses a line of user input.
+// Preconditions: A non-null command is provided as an argument.
+// Postconditions: Substituted commands are executed. Trailing whitespace is
+// removed from the command in place if no expansion was needed.
+// Return: A NULL-terminated array of command arguments, or NULL if the command
+// is empty or cannot be expanded or parsed.
+extern char** parse_command_line(char*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EXPAND_UTILS_H
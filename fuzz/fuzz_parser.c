@@ -0,0 +1,276 @@
+// File:    fuzz_parser.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains a fuzz harness for parse_command(),
+//          first_unquoted_space() and unescape(). Each input is checked
+//          against the reference implementations in reference_parser.c and
+//          the harness aborts on any difference. Build with libFuzzer
+//          (-DLIBFUZZER -fsanitize=fuzzer) or as a standalone driver that
+//          runs files, reads stdin (AFL) or mutates a corpus by itself.
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../parse_utils.h"
+#include "../utils.h"
+#include "reference_parser.h"
+
+#define MAX_INPUT_SIZE 4096
+
+static FILE* null_stream = NULL;
+
+// Prints the failing input with non-printable bytes escaped and aborts.
+static void report_mismatch(const char* what, const char* input) {
+  fprintf(stderr, "fuzz_parser: %s differs from the reference for input \"",
+          what);
+  for (const char* c = input; *c; c++) {
+    if (*c >= 0x20 && *c < 0x7f && *c != '"' && *c != '\\') {
+      fputc(*c, stderr);
+    } else {
+      fprintf(stderr, "\\x%02x", (unsigned char)*c);
+    }
+  }
+  fprintf(stderr, "\"\n");
+  abort();
+}
+
+// Returns 1 if both strings are NULL or equal.
+static int same_string(const char* a, const char* b) {
+  if (a == NULL || b == NULL) {
+    return a == b;
+  }
+  return strcmp(a, b) == 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  if (null_stream == NULL && (null_stream = fopen("/dev/null", "w")) == NULL) {
+    null_stream = stderr;
+  }
+
+  // The shell only ever sees NUL-terminated lines.
+  char* input = strndup((const char*)data, size);
+  if (input == NULL) {
+    return 0;
+  }
+
+  // first_unquoted_space()
+  if (first_unquoted_space(input) != reference_first_unquoted_space(input)) {
+    report_mismatch("first_unquoted_space()", input);
+  }
+
+  // unescape()
+  char* actual = unescape(input, null_stream);
+  char* expected = reference_unescape(input);
+  if (!same_string(actual, expected)) {
+    report_mismatch("unescape()", input);
+  }
+  free(actual);
+  free(expected);
+
+  // parse_command() modifies its argument, so give it a copy.
+  char* copy = strdup(input);
+  FILE* saved_stderr = stderr;
+  stderr = null_stream;
+  char** parsed = parse_command(copy);
+  stderr = saved_stderr;
+  char** expected_parsed = reference_parse_command(input);
+  if ((parsed == NULL) != (expected_parsed == NULL)) {
+    report_mismatch("parse_command()", input);
+  }
+  for (int i = 0; parsed != NULL; i++) {
+    if (!same_string(parsed[i], expected_parsed[i])) {
+      report_mismatch("parse_command()", input);
+    }
+    if (parsed[i] == NULL) {
+      break;
+    }
+  }
+  free_parsed_command(parsed);
+  reference_free_parsed_command(expected_parsed);
+  free(copy);
+  free(input);
+  return 0;
+}
+
+#ifndef LIBFUZZER
+
+// Characters that exercise the interesting paths of the parser.
+static const char interesting[] = "\\'\" \t\nxX0178afAF$!?*nrtv";
+
+// Small deterministic PRNG so mutation runs are reproducible.
+static uint32_t next_random(uint32_t* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+// Reads a whole file into a buffer. Returns the number of bytes read.
+static size_t read_input(FILE* in, uint8_t* buffer) {
+  return fread(buffer, 1, MAX_INPUT_SIZE, in);
+}
+
+// Runs a single file, or every file in a directory.
+static int run_path(const char* path, uint8_t* buffer) {
+  struct stat info;
+  if (stat(path, &info) == -1) {
+    perror(path);
+    return -1;
+  }
+
+  if (S_ISDIR(info.st_mode)) {
+    DIR* dir;
+    struct dirent* entry;
+    if ((dir = opendir(path)) == NULL) {
+      perror(path);
+      return -1;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+      if (entry->d_name[0] == '.') {
+        continue;
+      }
+      char* child;
+      if (asprintf(&child, "%s/%s", path, entry->d_name) == -1) {
+        closedir(dir);
+        return -1;
+      }
+      run_path(child, buffer);
+      free(child);
+    }
+    closedir(dir);
+    return 0;
+  }
+
+  FILE* in;
+  if ((in = fopen(path, "rb")) == NULL) {
+    perror(path);
+    return -1;
+  }
+  size_t size = read_input(in, buffer);
+  fclose(in);
+  return LLVMFuzzerTestOneInput(buffer, size);
+}
+
+// Mutates the given seeds for a number of iterations.
+static void mutate(char** seeds, int num_seeds, long iterations,
+                   uint32_t seed) {
+  uint8_t current[MAX_INPUT_SIZE];
+  uint32_t state = seed ? seed : 0x421u;
+
+  for (long n = 0; n < iterations; n++) {
+    size_t size = 0;
+
+    // Start from a random seed file, or from nothing.
+    if (num_seeds > 0) {
+      FILE* in = fopen(seeds[next_random(&state) % num_seeds], "rb");
+      if (in != NULL) {
+        size = read_input(in, current);
+        fclose(in);
+      }
+    }
+
+    int edits = 1 + next_random(&state) % 8;
+    for (int e = 0; e < edits; e++) {
+      uint32_t r = next_random(&state);
+      size_t pos = size ? r % (size + 1) : 0;
+      char c = (r & 0x100) ? interesting[r % (sizeof(interesting) - 1)]
+                           : (char)(r >> 16);
+
+      switch ((r >> 9) % 3) {
+        case 0:
+          // Insert a character.
+          if (size < MAX_INPUT_SIZE) {
+            memmove(current + pos + 1, current + pos, size - pos);
+            current[pos] = c;
+            size++;
+          }
+          break;
+        case 1:
+          // Replace a character.
+          if (pos < size) {
+            current[pos] = c;
+          }
+          break;
+        default:
+          // Delete a character.
+          if (pos < size) {
+            memmove(current + pos, current + pos + 1, size - pos - 1);
+            size--;
+          }
+          break;
+      }
+    }
+    LLVMFuzzerTestOneInput(current, size);
+  }
+}
+
+int main(int argc, char** argv) {
+  uint8_t buffer[MAX_INPUT_SIZE];
+  long iterations = 0;
+  uint32_t seed = 0;
+  int first_path = 1;
+
+  // Usage: fuzz_parser [-m iterations [-s seed]] [file|directory...]
+  while (first_path < argc && argv[first_path][0] == '-') {
+    if (strcmp(argv[first_path], "-m") == 0 && first_path + 1 < argc) {
+      iterations = atol(argv[first_path + 1]);
+    } else if (strcmp(argv[first_path], "-s") == 0 && first_path + 1 < argc) {
+      seed = (uint32_t)strtoul(argv[first_path + 1], NULL, 10);
+    } else {
+      fprintf(stderr,
+              "Usage: %s [-m iterations [-s seed]] [file|directory...]\n",
+              argv[0]);
+      return 1;
+    }
+    first_path += 2;
+  }
+
+  // AFL style: a single input on stdin.
+  if (first_path == argc && iterations == 0) {
+    size_t size = read_input(stdin, buffer);
+    return LLVMFuzzerTestOneInput(buffer, size);
+  }
+
+  // Replay every seed, then mutate them if asked to.
+  char** seeds = NULL;
+  int num_seeds = 0;
+  for (int i = first_path; i < argc; i++) {
+    run_path(argv[i], buffer);
+
+    DIR* dir = opendir(argv[i]);
+    if (dir == NULL) {
+      seeds = realloc(seeds, (num_seeds + 1) * sizeof(char*));
+      seeds[num_seeds++] = strdup(argv[i]);
+      continue;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+      if (entry->d_name[0] == '.') {
+        continue;
+      }
+      seeds = realloc(seeds, (num_seeds + 1) * sizeof(char*));
+      if (asprintf(&seeds[num_seeds], "%s/%s", argv[i], entry->d_name) != -1) {
+        num_seeds++;
+      }
+    }
+    closedir(dir);
+  }
+
+  mutate(seeds, num_seeds, iterations, seed);
+
+  for (int i = 0; i < num_seeds; i++) {
+    free(seeds[i]);
+  }
+  free(seeds);
+  printf("fuzz_parser: %d seeds replayed, %ld mutations, no differences.\n",
+         num_seeds, iterations);
+  return 0;
+}
+
+#endif // LIBFUZZER
@@ -0,0 +1,200 @@
+// File:    reference_parser.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains simple, index-based reference implementations of
+//          the parser hot paths, used as the fuzz harness's oracle. They
+//          favor obviousness over speed and must not share code with the
+//          implementations under test.
+
+#define _GNU_SOURCE
+
+#include "reference_parser.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+// Returns the value of a hex digit, or -1 if the character is not one.
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// Returns the character produced by a single-character escape sequence.
+static char simple_escape(char c) {
+  switch (c) {
+    case 'n':
+      return '\n';
+    case 'a':
+      return '\a';
+    case 'b':
+      return '\b';
+    case 'r':
+      return '\r';
+    case 'f':
+      return '\f';
+    case 'v':
+      return '\v';
+    case 't':
+      return '\t';
+    default:
+      // Every other character, including \\, \', \", \?, \*, \$, \ and \!,
+      // stands for itself.
+      return c;
+  }
+}
+
+void reference_free_parsed_command(char** args) {
+  if (args == NULL) {
+    return;
+  }
+  for (int i = 0; args[i] != NULL; i++) {
+    free(args[i]);
+  }
+  free(args);
+}
+
+int reference_first_unquoted_space(const char* str) {
+  char quoted = 0;
+  char previous = 0;
+
+  for (int i = 0; str[i] != '\0'; i++) {
+    char c = str[i];
+
+    // A character right after a backslash never opens, closes or splits.
+    if (previous != '\\') {
+      if (!quoted && (c == '\'' || c == '"')) {
+        quoted = c;
+      } else if (quoted && c == quoted) {
+        quoted = 0;
+      }
+      if (!quoted && isspace((unsigned char)c)) {
+        return i;
+      }
+    }
+    previous = c;
+  }
+  return -1;
+}
+
+char** reference_parse_command(const char* command) {
+  size_t length = strlen(command);
+  size_t start = 0;
+  size_t count = 0;
+
+  // Trim whitespace at both ends.
+  while (length > 0 && isspace((unsigned char)command[length - 1])) {
+    length--;
+  }
+  while (start < length && isspace((unsigned char)command[start])) {
+    start++;
+  }
+  if (start >= length) {
+    return NULL;
+  }
+
+  char* trimmed = strndup(command + start, length - start);
+  char** args = calloc(strlen(trimmed) + 2, sizeof(char*));
+  size_t pos = 0;
+  size_t trimmed_length = strlen(trimmed);
+
+  // Split at unquoted spaces, skipping runs of whitespace.
+  while (pos < trimmed_length) {
+    int space = reference_first_unquoted_space(trimmed + pos);
+    size_t word_length =
+        (space == -1) ? (trimmed_length - pos) : (size_t)space;
+    char* raw = strndup(trimmed + pos, word_length);
+
+    args[count] = reference_unescape(raw);
+    free(raw);
+    if (args[count] == NULL) {
+      reference_free_parsed_command(args);
+      free(trimmed);
+      return NULL;
+    }
+    count++;
+
+    pos += word_length;
+    while (pos < trimmed_length && isspace((unsigned char)trimmed[pos])) {
+      pos++;
+    }
+  }
+
+  free(trimmed);
+  return args;
+}
+
+char* reference_unescape(const char* str) {
+  size_t length = strlen(str);
+  char* result = malloc(length + 1);
+  size_t out = 0;
+  char quoted = 0;
+  size_t i = 0;
+
+  while (i < length) {
+    char c = str[i++];
+
+    if (c == '\\' && quoted) {
+      // Inside quotes only the quote character itself can be escaped.
+      if (i >= length) {
+        free(result);
+        return NULL;
+      }
+      char next = str[i++];
+      if (next != quoted) {
+        result[out++] = '\\';
+      }
+      result[out++] = next;
+    } else if (c == '\\') {
+      if (i >= length) {
+        free(result);
+        return NULL;
+      }
+      char next = str[i++];
+
+      if (next >= '0' && next <= '7') {
+        // Exactly three octal digits.
+        if (i + 2 > length || str[i] < '0' || str[i] > '7' ||
+            str[i + 1] < '0' || str[i + 1] > '7') {
+          free(result);
+          return NULL;
+        }
+        int value =
+            ((next - '0') << 6) | ((str[i] - '0') << 3) | (str[i + 1] - '0');
+        result[out++] = (char)value;
+        i += 2;
+      } else if (next == 'x' || next == 'X') {
+        // Exactly two hex digits.
+        if (i + 2 > length || hex_value(str[i]) < 0 ||
+            hex_value(str[i + 1]) < 0) {
+          free(result);
+          return NULL;
+        }
+        result[out++] = (char)((hex_value(str[i]) << 4) | hex_value(str[i + 1]));
+        i += 2;
+      } else {
+        result[out++] = simple_escape(next);
+      }
+    } else if (!quoted && (c == '\'' || c == '"')) {
+      quoted = c;
+    } else if (quoted && c == quoted) {
+      quoted = 0;
+    } else {
+      result[out++] = c;
+    }
+  }
+
+  if (quoted) {
+    free(result);
+    return NULL;
+  }
+  result[out] = '\0';
+  return result;
+}
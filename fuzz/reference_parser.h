@@ -0,0 +1,48 @@
+#ifndef REFERENCE_PARSER_H
+#define REFERENCE_PARSER_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Straightforward reference versions of the parser hot paths. They define the
+// expected behavior of first_unquoted_space(), unescape() and parse_command()
+// and are only used as the differential oracle of the fuzz harness.
+
+// int reference_first_unquoted_space(const char*)
+// Description: Finds the first space that is neither quoted nor escaped.
+// Preconditions: A non-null string is provided.
+// Postconditions: None.
+// Return: The index of the space, or -1 if there is none.
+extern int reference_first_unquoted_space(const char*);
+
+// void reference_free_parsed_command(char**)
+// Description: Frees the result of reference_parse_command().
+// Preconditions: The argument is NULL or was returned by that function.
+// Postconditions: Every argument and the array itself are freed.
+// Return: None.
+extern void reference_free_parsed_command(char**);
+
+// char** reference_parse_command(const char*)
+// Description: Splits a command into unescaped arguments.
+// Preconditions: A non-null string is provided.
+// Postconditions: None.
+// Return: A NULL-terminated array of arguments, or NULL if the command is
+// empty or cannot be parsed. Free with reference_free_parsed_command().
+extern char** reference_parse_command(const char*);
+
+// char* reference_unescape(const char*)
+// Description: Expands escape sequences and removes quotes.
+// Preconditions: A non-null string is provided.
+// Postconditions: None.
+// Return: A newly allocated string, or NULL on an illegal escape sequence or
+// unterminated quote.
+extern char* reference_unescape(const char*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REFERENCE_PARSER_H
@@ -2,38 +2,602 @@
 // Author:  Eric Ekey
 // Date:    2/22/2025
 // Desc:    This file contains utility functions for managing the shell's
-//          command history.
+//          command history. Entries live in a binary data file with an index
+//          of fixed-size records next to it, and both are read through
+//          memory mappings, so any entry is found without reading the ones
+//          before it. Shells append to the data file without locking, and
+//          readers merge new entries into the shared index in order of time.
+
+#define _GNU_SOURCE
 
 #include "history_utils.h"
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "usage_utils.h"
+
+#define HISTORY_MERGE_BATCH 1024
+
+static int data_fd = -1;
+static int index_fd = -1;
+static char* data_map = NULL;
+static size_t data_map_size = 0;
+static char* index_map = NULL;
+static size_t index_map_size = 0;
+static uint64_t indexed_end = 0;
+
+// The entries and data bytes that may be read while the read lock is held.
+static size_t readable_entries = 0;
+static size_t readable_size = 0;
+
+// Returns 1 if a file starts with the given magic string.
+static int has_magic(int fd, const char* magic) {
+  char header[HISTORY_MAGIC_SIZE];
+  return pread(fd, header, sizeof(header), 0) == sizeof(header) &&
+         memcmp(header, magic, sizeof(header)) == 0;
+}
+
+// Truncates a file to a fresh header. Returns 0 on success, -1 on failure.
+static int reset_file(int fd, const char* magic, size_t header_size) {
+  char header[HISTORY_INDEX_HEADER_SIZE] = {0};
+
+  memcpy(header, magic, HISTORY_MAGIC_SIZE);
+  if (ftruncate(fd, 0) == -1 || pwrite(fd, header, header_size, 0) == -1) {
+    perror("history reset error in reset_file()");
+    return HISTORY_FAILURE;
+  }
+  return 0;
+}
+
+// FNV-1a hash, continued from a previous value.
+static uint32_t checksum_bytes(uint32_t hash, const void* bytes, size_t size) {
+  const unsigned char* p = bytes;
+
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ p[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// Checksum of the entry at bytes, from the field after the checksum to its
+// end.
+static uint32_t checksum_entry(const char* bytes, uint32_t length) {
+  size_t start = offsetof(struct history_entry_t, length);
+  return checksum_bytes(2166136261u, bytes + start, length - start);
+}
+
+// Copies the header of the entry at an offset in the data map. Entries after
+// a torn one may not be aligned.
+static void read_header(uint64_t offset, struct history_entry_t* entry) {
+  memcpy(entry, data_map + offset, sizeof(*entry));
+}
+
+// Sets history_file_path on first use. All sessions of a user share one
+// history in their home directory unless HISTFILE names another. Returns 0 on
+// success, -1 on failure.
+static int resolve_history_path(void) {
+  const char* history_env = getenv(HISTORY_FILE_ENV);
+  const char* history_dir = getenv(HISTORY_HOME_ENV);
+  char* cwd = NULL;
+
+  if (history_file_path != NULL) {
+    return 0;
+  }
+  if (history_env != NULL && history_env[0] != '\0') {
+    history_file_path = strdup(history_env);
+  } else {
+    if (history_dir == NULL || history_dir[0] == '\0') {
+      // Fall back to the current directory.
+      if ((cwd = getcwd(NULL, 0)) == NULL) {
+        perror("getcwd error in resolve_history_path()");
+        return HISTORY_FAILURE;
+      }
+      history_dir = cwd;
+    }
+    size_t length = strlen(history_dir) + strlen(HISTORY_FILENAME) + 2;
+    if ((history_file_path = malloc(length)) != NULL) {
+      snprintf(history_file_path, length, "%s/%s", history_dir,
+               HISTORY_FILENAME);
+    }
+    free(cwd);
+  }
+  if (history_file_path == NULL) {
+    perror("history_file_path malloc error in resolve_history_path()");
+    return HISTORY_FAILURE;
+  }
+  return 0;
+}
+
+// Opens the data and index files once per session. Files in another format,
+// e.g. the plain text history of older versions, are started over. Returns
+// 0 on success, -1 on failure.
+static int open_history(void) {
+  char* index_path;
+  struct stat info;
+
+  if (data_fd != -1) {
+    return 0;
+  }
+  if (resolve_history_path() == HISTORY_FAILURE) {
+    return HISTORY_FAILURE;
+  }
+  if ((index_path = malloc(strlen(history_file_path) +
+                           strlen(HISTORY_INDEX_SUFFIX) + 1)) == NULL) {
+    perror("index_path malloc error in open_history()");
+    return HISTORY_FAILURE;
+  }
+  strcpy(index_path, history_file_path);
+  strcat(index_path, HISTORY_INDEX_SUFFIX);
 
-int append_history(const char* command) {
-  FILE* history_file;
+  // Only the data file is appended to. The index is written at explicit
+  // offsets, which O_APPEND would ignore.
+  data_fd = open(history_file_path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC,
+                 0600);
+  index_fd = open(index_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  free(index_path);
+  if (data_fd == -1 || index_fd == -1) {
+    perror("open error in open_history()");
+    close_history();
+    return HISTORY_FAILURE;
+  }
+
+  // The index lock serializes readers and header checks between shells.
+  // Writers never take it.
+  int result = 0;
+  flock(index_fd, LOCK_EX);
+  if (!has_magic(data_fd, HISTORY_DATA_MAGIC)) {
+    if (reset_file(data_fd, HISTORY_DATA_MAGIC, HISTORY_MAGIC_SIZE) == -1 ||
+        reset_file(index_fd, HISTORY_INDEX_MAGIC, HISTORY_INDEX_HEADER_SIZE) ==
+            -1) {
+      result = HISTORY_FAILURE;
+    }
+  } else if (!has_magic(index_fd, HISTORY_INDEX_MAGIC)) {
+    // An index of an older version is rebuilt from the data file.
+    if (reset_file(index_fd, HISTORY_INDEX_MAGIC, HISTORY_INDEX_HEADER_SIZE) ==
+        -1) {
+      result = HISTORY_FAILURE;
+    }
+  } else if (fstat(index_fd, &info) == 0) {
+    // Drop an index record cut short by a crash.
+    off_t partial = (info.st_size - HISTORY_INDEX_HEADER_SIZE) %
+                    sizeof(struct history_index_t);
+    if (partial != 0 && ftruncate(index_fd, info.st_size - partial) == -1) {
+      perror("ftruncate error in open_history()");
+    }
+  }
+  flock(index_fd, LOCK_UN);
+
+  if (result == HISTORY_FAILURE) {
+    close_history();
+  }
+  return result;
+}
+
+// Maps a file read-only, replacing an older mapping if its size changed.
+// Returns 0 on success, -1 on failure.
+static int remap_file(int fd, char** map, size_t* map_size, size_t size) {
+  if (size == *map_size) {
+    return 0;
+  }
+  if (*map != NULL) {
+    munmap(*map, *map_size);
+    *map = NULL;
+    *map_size = 0;
+  }
+  if (size == 0) {
+    return 0;
+  }
+  void* new_map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (new_map == MAP_FAILED) {
+    perror("mmap error in remap_file()");
+    return HISTORY_FAILURE;
+  }
+  *map = new_map;
+  *map_size = size;
+  return 0;
+}
+
+// Maps the data file at its current size. Returns 0 on success, -1 on
+// failure.
+static int map_data(void) {
+  struct stat info;
+
+  if (fstat(data_fd, &info) == -1) {
+    perror("fstat error in map_data()");
+    return HISTORY_FAILURE;
+  }
 
-  // Open history file in append mode.
-  if ((history_file = fopen(history_file_path, "a")) == NULL) {
-    perror("fopen error in append_history()");
+  // Another shell may be between truncating and rewriting the header.
+  if (info.st_size < HISTORY_MAGIC_SIZE) {
+    info.st_size = 0;
+  }
+  return remap_file(data_fd, &data_map, &data_map_size, info.st_size);
+}
+
+// Maps the index file at its current size. Returns 0 on success, -1 on
+// failure.
+static int map_index(void) {
+  struct stat info;
+
+  if (fstat(index_fd, &info) == -1) {
+    perror("fstat error in map_index()");
+    return HISTORY_FAILURE;
+  }
+
+  // Another shell may be between truncating and rewriting the header.
+  if (info.st_size < HISTORY_INDEX_HEADER_SIZE) {
+    info.st_size = 0;
+  }
+  return remap_file(index_fd, &index_map, &index_map_size, info.st_size);
+}
+
+// Returns the number of records in the mapped index.
+static size_t index_count(void) {
+  return index_map_size ? (index_map_size - HISTORY_INDEX_HEADER_SIZE) /
+                              sizeof(struct history_index_t)
+                        : 0;
+}
+
+// Writes where the indexed entries end in the data file into the index
+// header. Returns 0 on success, -1 on failure.
+static int write_indexed_end(void) {
+  if (pwrite(index_fd, &indexed_end, sizeof(indexed_end),
+             offsetof(struct history_index_header_t, indexed_end)) !=
+      sizeof(indexed_end)) {
+    perror("pwrite error in write_indexed_end()");
+    return HISTORY_FAILURE;
+  }
+  return 0;
+}
+
+// Adds a batch of records after the first COUNT of the index, keeping it in
+// order of time. Shells append entries nearly in order, so the batch is
+// insertion sorted and only merged with the few records at the end of the
+// index recorded after its first one. The header is updated last, so a
+// crash in between may index the batch twice but never skips it. The
+// caller holds the index lock. Returns 0 on success, -1 on failure.
+static int write_records(struct history_index_t* records, size_t num_records,
+                         size_t* count) {
+  for (size_t i = 1; i < num_records; i++) {
+    struct history_index_t record = records[i];
+    size_t j = i;
+    for (; j > 0 && records[j - 1].timestamp > record.timestamp; j--) {
+      records[j] = records[j - 1];
+    }
+    records[j] = record;
+  }
+
+  // Find the indexed records recorded after the first of the batch.
+  size_t first = *count;
+  struct history_index_t record;
+  while (first > 0) {
+    off_t at = HISTORY_INDEX_HEADER_SIZE + (first - 1) * sizeof(record);
+    if (pread(index_fd, &record, sizeof(record), at) != sizeof(record)) {
+      perror("pread error in write_records()");
+      return HISTORY_FAILURE;
+    }
+    if (record.timestamp <= records[0].timestamp) {
+      break;
+    }
+    first--;
+  }
+
+  // Merge those with the batch and write both from where the first was.
+  size_t num_later = *count - first;
+  struct history_index_t* merged = records;
+  if (num_later > 0) {
+    if ((merged = malloc((num_later + num_records) * sizeof(*merged))) ==
+        NULL) {
+      perror("malloc error in write_records()");
+      return HISTORY_FAILURE;
+    }
+    ssize_t later_size = num_later * sizeof(*merged);
+    if (pread(index_fd, merged + num_records, later_size,
+              HISTORY_INDEX_HEADER_SIZE + first * sizeof(*merged)) !=
+        later_size) {
+      perror("pread error in write_records()");
+      free(merged);
+      return HISTORY_FAILURE;
+    }
+    struct history_index_t* later = merged + num_records;
+    size_t i = 0, j = 0;
+    for (size_t k = 0; k < num_later + num_records; k++) {
+      merged[k] = (j == num_records ||
+                   (i < num_later && later[i].timestamp <= records[j].timestamp))
+                      ? later[i++]
+                      : records[j++];
+    }
+  }
+
+  ssize_t size = (num_later + num_records) * sizeof(*merged);
+  int result = 0;
+  if (pwrite(index_fd, merged, size,
+             HISTORY_INDEX_HEADER_SIZE + first * sizeof(*merged)) != size) {
+    perror("pwrite error in write_records()");
+    result = HISTORY_FAILURE;
+  }
+  if (merged != records) {
+    free(merged);
+  }
+  *count += num_records;
+  return (result == 0) ? write_indexed_end() : result;
+}
+
+// Indexes the complete entries of the data file past the indexed ones.
+// Entries still being written are left for the next call, and torn entries,
+// e.g. from a crash, are skipped up to the next valid one. The caller holds
+// the index lock. Returns 0 on success, -1 on failure.
+static int merge_entries(void) {
+  if (map_index() == HISTORY_FAILURE) {
+    return HISTORY_FAILURE;
+  }
+
+  // Resume where the index header says the indexed entries end. If that is
+  // past the data file, the file was replaced since, and the index is rebuilt.
+  size_t count = index_count();
+  indexed_end = (count > 0) ? ((const struct history_index_header_t*)index_map)
+                                  ->indexed_end
+                            : HISTORY_MAGIC_SIZE;
+  if (indexed_end < HISTORY_MAGIC_SIZE || indexed_end > data_map_size) {
+    if (ftruncate(index_fd, HISTORY_INDEX_HEADER_SIZE) == -1) {
+      perror("ftruncate error in merge_entries()");
+      return HISTORY_FAILURE;
+    }
+    indexed_end = HISTORY_MAGIC_SIZE;
+    count = 0;
+  }
+
+  struct history_index_t records[HISTORY_MERGE_BATCH];
+  size_t num_records = 0;
+  uint64_t offset = indexed_end;
+
+  while (offset + sizeof(struct history_entry_t) <= data_map_size) {
+    struct history_entry_t entry;
+    read_header(offset, &entry);
+    int plausible = entry.magic == HISTORY_ENTRY_MAGIC &&
+                    entry.length >= sizeof(entry) && entry.length % 8 == 0;
+
+    if (plausible && offset + entry.length > data_map_size) {
+      // Still being written.
+      break;
+    }
+    if (!plausible ||
+        checksum_entry(data_map + offset, entry.length) != entry.checksum ||
+        sizeof(entry) + (uint64_t)entry.cwd_length + entry.command_length + 2 >
+            entry.length) {
+      // Torn. A short write may leave the next entry at any offset.
+      offset++;
+      continue;
+    }
+
+    records[num_records].offset = offset;
+    records[num_records].timestamp = entry.timestamp;
+    offset += entry.length;
+    indexed_end = offset;
+    if (++num_records == HISTORY_MERGE_BATCH) {
+      if (write_records(records, num_records, &count) == HISTORY_FAILURE) {
+        return HISTORY_FAILURE;
+      }
+      num_records = 0;
+    }
+  }
+  if (num_records > 0 &&
+      write_records(records, num_records, &count) == HISTORY_FAILURE) {
+    return HISTORY_FAILURE;
+  }
+  return map_index();
+}
+
+int append_history(const char* command, const struct cmd_usage_t* usage) {
+  static const char padding[8] = {0};
+  struct history_entry_t entry;
+  struct timespec now;
+
+  if (open_history() == HISTORY_FAILURE) {
     return APPEND_FAILURE;
+  }
+
+  char* cwd = getcwd(NULL, 0);
+  const char* cwd_text = cwd ? cwd : "";
+
+  clock_gettime(CLOCK_REALTIME, &now);
+  memset(&entry, 0, sizeof(entry));
+  entry.magic = HISTORY_ENTRY_MAGIC;
+  entry.status = usage->status;
+  entry.timestamp = now.tv_sec * 1000000000LL + now.tv_nsec;
+  entry.cwd_length = strlen(cwd_text);
+  entry.command_length = strlen(command);
+  entry.wall_seconds = usage->wall_seconds;
+  entry.user_usec = usage->rusage.ru_utime.tv_sec * 1000000LL +
+                    usage->rusage.ru_utime.tv_usec;
+  entry.sys_usec = usage->rusage.ru_stime.tv_sec * 1000000LL +
+                   usage->rusage.ru_stime.tv_usec;
+  entry.maxrss = usage->rusage.ru_maxrss;
+  entry.nvcsw = usage->rusage.ru_nvcsw;
+  entry.nivcsw = usage->rusage.ru_nivcsw;
+
+  // Pad every entry to 8 bytes so headers in the mapping stay aligned.
+  size_t unpadded =
+      sizeof(entry) + entry.cwd_length + 1 + entry.command_length + 1;
+  entry.length = (unpadded + 7) & ~(size_t)7;
+  struct iovec parts[4] = {
+      {&entry, sizeof(entry)},
+      {(void*)cwd_text, entry.cwd_length + 1},
+      {(void*)command, entry.command_length + 1},
+      {(void*)padding, entry.length - unpadded},
   };
+  const char* checked = (const char*)&entry.length;
+  entry.checksum = checksum_bytes(2166136261u, checked,
+                                  sizeof(entry) - (checked - (char*)&entry));
+  for (int i = 1; i < 4; i++) {
+    entry.checksum =
+        checksum_bytes(entry.checksum, parts[i].iov_base, parts[i].iov_len);
+  }
 
-  // Append command to history file.
-  fprintf(history_file, "%s\n", command);
-  fclose(history_file);
-  return 0;
+  // A single O_APPEND write lands whole at the end of the file, whatever
+  // other shells write at the same time. A short write, e.g. on a full disk,
+  // leaves a torn entry that readers skip.
+  int result = 0;
+  if (writev(data_fd, parts, 4) != (ssize_t)entry.length) {
+    perror("writev error in append_history()");
+    result = APPEND_FAILURE;
+  }
+  free(cwd);
+  return result;
+}
+
+long begin_history_read(void) {
+  struct stat data_info, index_info;
+
+  if (data_fd == -1) {
+    return HISTORY_FAILURE;
+  }
+
+  // Another shell may have cleared the history since it was mapped, and
+  // reading a mapping past the end of its file raises SIGBUS. Nothing can
+  // shrink the files while the lock is held, so only what they still hold is
+  // read.
+  flock(index_fd, LOCK_SH);
+  if (fstat(data_fd, &data_info) == -1 || fstat(index_fd, &index_info) == -1) {
+    perror("fstat error in begin_history_read()");
+    flock(index_fd, LOCK_UN);
+    return HISTORY_FAILURE;
+  }
+  size_t on_disk = (index_info.st_size < HISTORY_INDEX_HEADER_SIZE)
+                       ? 0
+                       : (index_info.st_size - HISTORY_INDEX_HEADER_SIZE) /
+                             sizeof(struct history_index_t);
+  readable_entries = (index_count() < on_disk) ? index_count() : on_disk;
+  readable_size = ((size_t)data_info.st_size < data_map_size)
+                      ? (size_t)data_info.st_size
+                      : data_map_size;
+  return readable_entries;
 }
 
 int clear_history() {
-  FILE* history_file;
+  int result = 0;
 
-  // Opening in write mode clears the file. Check for unsuccessful open.
-  if ((history_file = fopen(history_file_path, "w")) == NULL) {
-    perror("fopen error in clear_history()");
+  if (open_history() == HISTORY_FAILURE) {
     return CLEAR_FAILURE;
   }
+  flock(index_fd, LOCK_EX);
+  if (ftruncate(data_fd, HISTORY_MAGIC_SIZE) == -1 ||
+      ftruncate(index_fd, HISTORY_INDEX_HEADER_SIZE) == -1) {
+    perror("ftruncate error in clear_history()");
+    result = CLEAR_FAILURE;
+  }
+  indexed_end = HISTORY_MAGIC_SIZE;
+  if (result == 0 && write_indexed_end() == HISTORY_FAILURE) {
+    result = CLEAR_FAILURE;
+  }
+  flock(index_fd, LOCK_UN);
+  return result;
+}
+
+void close_history(void) {
+  if (data_map != NULL) {
+    munmap(data_map, data_map_size);
+  }
+  if (index_map != NULL) {
+    munmap(index_map, index_map_size);
+  }
+  if (data_fd != -1) {
+    close(data_fd);
+  }
+  if (index_fd != -1) {
+    close(index_fd);
+  }
+  data_map = index_map = NULL;
+  data_map_size = index_map_size = 0;
+  data_fd = index_fd = -1;
+  indexed_end = 0;
+}
+
+void end_history_read(void) {
+  readable_entries = 0;
+  readable_size = 0;
+  if (index_fd != -1) {
+    flock(index_fd, LOCK_UN);
+  }
+}
 
-  fclose(history_file);
+size_t find_history_time(int64_t timestamp) {
+  const struct history_index_t* index =
+      (const struct history_index_t*)(index_map + HISTORY_INDEX_HEADER_SIZE);
+  size_t low = 0;
+  size_t high = readable_entries;
+
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (index[middle].timestamp < timestamp) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+int get_history_entry(size_t n, struct history_view_t* view) {
+  const struct history_index_t* index =
+      (const struct history_index_t*)(index_map + HISTORY_INDEX_HEADER_SIZE);
+
+  // Never trust the files further than the mapping and the files reach.
+  if (n >= readable_entries) {
+    return HISTORY_FAILURE;
+  }
+  uint64_t offset = index[n].offset;
+  if (offset + sizeof(struct history_entry_t) > readable_size) {
+    return HISTORY_FAILURE;
+  }
+  read_header(offset, &view->header);
+  view->entry = &view->header;
+  if (offset + view->header.length > readable_size ||
+      sizeof(struct history_entry_t) + (uint64_t)view->header.cwd_length +
+              view->header.command_length + 2 >
+          view->header.length) {
+    return HISTORY_FAILURE;
+  }
+  view->cwd = data_map + offset + sizeof(struct history_entry_t);
+  view->command = view->cwd + view->header.cwd_length + 1;
   return 0;
-}
\ No newline at end of file
+}
+
+long history_length(void) {
+  struct stat info;
+
+  if (open_history() == HISTORY_FAILURE) {
+    return HISTORY_FAILURE;
+  }
+  if (fstat(data_fd, &info) == -1) {
+    perror("fstat error in history_length()");
+    return HISTORY_FAILURE;
+  }
+
+  // Writers never touch the index, so only merge when the data file changed
+  // size since the last merge. Readers merge one at a time, and map the data
+  // file under the lock, since another shell may clear it until then.
+  int result = 0;
+  if ((uint64_t)info.st_size != indexed_end) {
+    flock(index_fd, LOCK_EX);
+    if ((result = map_data()) == 0) {
+      result = (data_map_size == 0) ? map_index() : merge_entries();
+    }
+    flock(index_fd, LOCK_UN);
+  } else if ((result = map_data()) == 0) {
+    result = map_index();
+  }
+  if (result == HISTORY_FAILURE) {
+    return HISTORY_FAILURE;
+  }
+  return index_count();
+}
@@ -3,32 +3,152 @@
 
 #define APPEND_FAILURE -1
 #define CLEAR_FAILURE -1
+#define HISTORY_DATA_MAGIC "421HDAT2"
+#define HISTORY_ENTRY_MAGIC 0x48313234
+#define HISTORY_FAILURE -1
+#define HISTORY_FILE_ENV "HISTFILE"
 #define HISTORY_FILENAME ".421sh"
+#define HISTORY_HOME_ENV "HOME"
+#define HISTORY_INDEX_HEADER_SIZE 16
+#define HISTORY_INDEX_MAGIC "421HIDX3"
+#define HISTORY_INDEX_SUFFIX ".idx"
+#define HISTORY_MAGIC_SIZE 8
 
+#include <stddef.h>
+#include <stdint.h>
+
+struct cmd_usage_t;
+
+// On-disk header of a history entry in the data file. It is followed by the
+// NUL-terminated working directory and command, padded to 8 bytes. The
+// checksum covers everything after it up to the padded length, so readers can
+// tell a torn entry from a complete one.
+struct history_entry_t {
+    uint32_t magic;
+    uint32_t checksum;
+    uint32_t length;
+    int32_t status;
+    int64_t timestamp;
+    uint32_t cwd_length;
+    uint32_t command_length;
+    double wall_seconds;
+    int64_t user_usec;
+    int64_t sys_usec;
+    int64_t maxrss;
+    int64_t nvcsw;
+    int64_t nivcsw;
+};
+
+// On-disk header of the index file: its magic string and where the entries
+// indexed so far end in the data file.
+struct history_index_header_t {
+    char magic[HISTORY_MAGIC_SIZE];
+    uint64_t indexed_end;
+};
+
+// On-disk index record: where entry N starts in the data file and when it
+// was recorded (nanoseconds since the epoch). Entry N is at a fixed offset in
+// the index file, so it is found in O(1). Records are kept in order of time,
+// though concurrent shells may append entries out of order, so timestamps are
+// found by binary search. The index is built by readers from the data file, so
+// writers never touch it.
+struct history_index_t {
+    uint64_t offset;
+    int64_t timestamp;
+};
+
+// Struct holding a history entry read through the memory-mapped data file.
+// The header is copied, since entries after a torn one may not be aligned.
+// The pointers stay valid until the next call into the history functions.
+struct history_view_t {
+    struct history_entry_t header;
+    const struct history_entry_t* entry;
+    const char* cwd;
+    const char* command;
+};
+
+// Path of the history data file, set when the history is first used.
 extern char* history_file_path;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// int append_history(const char*)
-// Description: Appends the provided command to the history file.
-// Preconditions: history_file_path is set. A non-null command is provided as an
-// argument.
-// Postconditions: The command is appended to the history file. History file is 
-// created if it does not exist.
+// int append_history(const char*, const struct cmd_usage_t*)
+// Description: Appends a command with its timestamp, exit status, working
+// directory and resource usage to the history. The entry is a single O_APPEND
+// write to the data file without any lock, so any number of shells may share
+// the history.
+// Preconditions: A non-null command and usage are provided as arguments.
+// Postconditions: The entry is appended to the data file. The files are
+// created if they do not exist.
 // Return: 0 on success, -1 on failure.
-extern int append_history(const char*);
+extern int append_history(const char*, const struct cmd_usage_t*);
+
+// long begin_history_read()
+// Description: Takes the shared lock on the index, so no other shell clears
+// the history or rebuilds the index while entries are read. Shells appending
+// entries are not held up.
+// Preconditions: history_length() succeeded since the last append.
+// Postconditions: The lock is held until end_history_read() on success.
+// Return: The number of entries that may be read, which is less than
+// history_length() returned if the history was cleared since, or -1 on
+// failure.
+extern long begin_history_read(void);
 
 // int clear_history()
-// Description: Clears the history file.
-// Preconditions: history_file_path is set.
-// Postconditions: The history file is cleared. 
+// Description: Clears the history.
+// Preconditions: None.
+// Postconditions: The data and index files are truncated to their headers.
 // Return: 0 on success, -1 on failure.
 extern int clear_history(void);
 
+// void close_history()
+// Description: Closes the history files.
+// Preconditions: None.
+// Postconditions: The files are closed and unmapped.
+// Return: None.
+extern void close_history(void);
+
+// void end_history_read()
+// Description: Releases the lock taken by begin_history_read().
+// Preconditions: None.
+// Postconditions: Views returned by get_history_entry() may no longer be
+// read.
+// Return: None.
+extern void end_history_read(void);
+
+// size_t find_history_time(int64_t)
+// Description: Finds the first entry recorded at or after a time with a
+// binary search of the index.
+// Preconditions: begin_history_read() succeeded and the lock is held.
+// Postconditions: None.
+// Return: The index of the entry, or the number of entries if there is none.
+extern size_t find_history_time(int64_t);
+
+// int get_history_entry(size_t, struct history_view_t*)
+// Description: Reads entry N (counting from 0) without reading the entries
+// before it.
+// Preconditions: begin_history_read() succeeded, returned more than N and
+// the lock is held. A non-null view is provided.
+// Postconditions: The view points into the mapped data file, and may be read
+// until end_history_read().
+// Return: 0 on success, -1 if the entry is damaged or past the readable
+// entries.
+extern int get_history_entry(size_t, struct history_view_t*);
+
+// long history_length()
+// Description: Merges any entries appended since the last call, by this or
+// another shell, into the index, starting from the end of the last indexed
+// entry, and returns the number of entries. Torn entries are skipped.
+// Preconditions: None.
+// Postconditions: The index covers every complete entry and both files are
+// mapped.
+// Return: The number of entries, or -1 on failure.
+extern long history_length(void);
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif // HISTORY_UTILS_H
\ No newline at end of file
+#endif // HISTORY_UTILS_H
@@ -0,0 +1,283 @@
+// File:    limit_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains functions for limiting the resources of jobs:
+//          rlimits and cgroup v2 placement, prepared in the shell and applied
+//          in the child between fork() and exec().
+
+#define _GNU_SOURCE
+
+#include "limit_utils.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CGROUP_PATH_SIZE 4096
+#define CPU_WEIGHT_DEFAULT 100
+#define CPU_WEIGHT_MAX 10000
+#define NICE_MAX 19
+#define NICE_MIN -20
+#define NICE_WEIGHT_RATIO 1.25
+
+// Global variables.
+const struct job_limits_t* job_limits = NULL;
+
+// Parses a number with an optional K, M or G suffix when sizes are allowed.
+// Returns 0 on success, -1 on failure.
+static int parse_limit(const char* text, int is_size, rlim_t* value) {
+  char* end;
+
+  if (!isdigit((unsigned char)text[0])) {
+    return LIMIT_FAILURE;
+  }
+  errno = 0;
+  unsigned long long number = strtoull(text, &end, 10);
+  int shift = 0;
+  if (is_size && *end != '\0' && end[1] == '\0') {
+    switch (toupper((unsigned char)*end)) {
+      case 'K':
+        shift = 10;
+        break;
+      case 'M':
+        shift = 20;
+        break;
+      case 'G':
+        shift = 30;
+        break;
+      default:
+        return LIMIT_FAILURE;
+    }
+    end++;
+  }
+  if (errno == ERANGE || *end != '\0' || number > (RLIM_INFINITY >> shift) ||
+      (number << shift) == RLIM_INFINITY) {
+    return LIMIT_FAILURE;
+  }
+  *value = (rlim_t)(number << shift);
+  return 0;
+}
+
+// Returns where the cgroup2 filesystem is mounted, from /proc/self/mountinfo.
+// Falls back to CGROUP_DEFAULT_MOUNT.
+static const char* cgroup_mount(void) {
+  static char mount_point[CGROUP_PATH_SIZE];
+  char* line = NULL;
+  size_t capacity = 0;
+  FILE* mountinfo;
+
+  if (mount_point[0] != '\0') {
+    return mount_point;
+  }
+  strcpy(mount_point, CGROUP_DEFAULT_MOUNT);
+  if ((mountinfo = fopen("/proc/self/mountinfo", "r")) == NULL) {
+    return mount_point;
+  }
+
+  // Lines read "id parent major:minor root mount_point options... - type".
+  while (getline(&line, &capacity, mountinfo) != -1) {
+    char* separator = strstr(line, " - ");
+    char point[CGROUP_PATH_SIZE];
+    if (separator != NULL && strncmp(separator + 3, "cgroup2 ", 8) == 0 &&
+        sscanf(line, "%*s %*s %*s %*s %4095s", point) == 1) {
+      strcpy(mount_point, point);
+      break;
+    }
+  }
+  free(line);
+  fclose(mountinfo);
+  return mount_point;
+}
+
+// Writes a value to a file in a cgroup directory. Returns 0 on success, -1 on
+// failure.
+static int write_cgroup_file(int cgroup_fd, const char* name,
+                             unsigned long long value) {
+  char text[32];
+  int fd = openat(cgroup_fd, name, O_WRONLY | O_CLOEXEC);
+  int length = snprintf(text, sizeof(text), "%llu\n", value);
+
+  if (fd == -1) {
+    return LIMIT_FAILURE;
+  }
+  int result = (write(fd, text, length) == length) ? 0 : LIMIT_FAILURE;
+  close(fd);
+  return result;
+}
+
+// Creates or opens the job's cgroup and sets its weights. Weights that could
+// not be set are cleared in the arguments, so their fallbacks apply. Returns
+// 0 on success, -1 if the cgroup cannot be used at all.
+static int set_up_cgroup(const char* path, struct job_limits_t* limits,
+                         rlim_t* weight, rlim_t* memory) {
+  char full_path[CGROUP_PATH_SIZE];
+  int cgroup_fd;
+
+  int length = (path[0] == '/')
+                   ? snprintf(full_path, sizeof(full_path), "%s", path)
+                   : snprintf(full_path, sizeof(full_path), "%s/%s",
+                              cgroup_mount(), path);
+  if (length >= (int)sizeof(full_path)) {
+    fprintf(stderr, "limit: cgroup path %s is too long; using rlimits\n", path);
+    return LIMIT_FAILURE;
+  }
+  if ((mkdir(full_path, 0755) == -1 && errno != EEXIST) ||
+      (cgroup_fd = open(full_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
+    fprintf(stderr, "limit: cannot use cgroup %s: %s; using rlimits\n",
+            full_path, strerror(errno));
+    return LIMIT_FAILURE;
+  }
+  if ((limits->cgroup_procs_fd =
+           openat(cgroup_fd, "cgroup.procs", O_WRONLY | O_CLOEXEC)) == -1) {
+    fprintf(stderr, "limit: cannot use cgroup %s: %s; using rlimits\n",
+            full_path, strerror(errno));
+    close(cgroup_fd);
+    return LIMIT_FAILURE;
+  }
+
+  if (*weight != RLIM_INFINITY) {
+    if (write_cgroup_file(cgroup_fd, "cpu.weight", *weight) == LIMIT_FAILURE) {
+      fprintf(stderr, "limit: cannot set cpu.weight in %s; using nice\n",
+              full_path);
+    } else {
+      *weight = RLIM_INFINITY;
+    }
+  }
+  if (*memory != RLIM_INFINITY) {
+    if (write_cgroup_file(cgroup_fd, "memory.max", *memory) == LIMIT_FAILURE) {
+      fprintf(stderr, "limit: cannot set memory.max in %s; using -v\n",
+              full_path);
+    } else {
+      *memory = RLIM_INFINITY;
+    }
+  }
+  close(cgroup_fd);
+  return 0;
+}
+
+// Lowers one resource limit of the calling process. The hard limit is lowered
+// too, so the job cannot raise it again. CPU time keeps a second between the
+// two, so the job gets SIGXCPU before SIGKILL.
+static void set_limit(int resource, rlim_t value) {
+  struct rlimit limit;
+
+  if (value == RLIM_INFINITY) {
+    return;
+  }
+  if (getrlimit(resource, &limit) == -1) {
+    perror("getrlimit error in set_limit()");
+    return;
+  }
+  rlim_t hard = (resource == RLIMIT_CPU) ? value + 1 : value;
+  if (limit.rlim_max == RLIM_INFINITY || hard < limit.rlim_max) {
+    limit.rlim_max = hard;
+  }
+  limit.rlim_cur = (value < limit.rlim_max) ? value : limit.rlim_max;
+  if (setrlimit(resource, &limit) == -1) {
+    perror("setrlimit error in set_limit()");
+  }
+}
+
+void apply_limits(const struct job_limits_t* limits) {
+  // Writing 0 moves the writing process.
+  if (limits->cgroup_procs_fd != -1 &&
+      write(limits->cgroup_procs_fd, "0", 1) == -1) {
+    perror("cgroup.procs write error in apply_limits()");
+  }
+  set_limit(RLIMIT_CPU, limits->cpu_seconds);
+  set_limit(RLIMIT_AS, limits->address_space);
+  set_limit(RLIMIT_NOFILE, limits->open_files);
+  if (limits->nice != LIMIT_NO_NICE &&
+      setpriority(PRIO_PROCESS, 0, limits->nice) == -1) {
+    perror("setpriority error in apply_limits()");
+  }
+}
+
+void release_limits(struct job_limits_t* limits) {
+  if (limits->cgroup_procs_fd != -1) {
+    close(limits->cgroup_procs_fd);
+    limits->cgroup_procs_fd = -1;
+  }
+}
+
+int set_up_limits(char** parsed_cmd, struct job_limits_t* limits,
+                  char*** command) {
+  const char* cgroup = NULL;
+  rlim_t weight = RLIM_INFINITY, memory = RLIM_INFINITY;
+  int i = 1;
+
+  limits->cpu_seconds = limits->address_space = RLIM_INFINITY;
+  limits->open_files = RLIM_INFINITY;
+  limits->nice = LIMIT_NO_NICE;
+  limits->cgroup_procs_fd = -1;
+
+  // Options come in pairs before the command.
+  while (parsed_cmd[i] != NULL && parsed_cmd[i][0] == '-') {
+    const char* option = parsed_cmd[i];
+    const char* value = parsed_cmd[i + 1];
+    int result = LIMIT_FAILURE;
+
+    if (value != NULL && option[1] != '\0' && option[2] == '\0') {
+      switch (option[1]) {
+        case 't':
+          result = parse_limit(value, 0, &limits->cpu_seconds);
+          break;
+        case 'v':
+          result = parse_limit(value, 1, &limits->address_space);
+          break;
+        case 'n':
+          result = parse_limit(value, 0, &limits->open_files);
+          break;
+        case 'g':
+          cgroup = value;
+          result = 0;
+          break;
+        case 'w':
+          result = parse_limit(value, 0, &weight);
+          if (weight < 1 || weight > CPU_WEIGHT_MAX) {
+            result = LIMIT_FAILURE;
+          }
+          break;
+        case 'm':
+          result = parse_limit(value, 1, &memory);
+          break;
+      }
+    }
+    if (result == LIMIT_FAILURE) {
+      fprintf(stderr, "limit: invalid option %s %s\n", option,
+              value ? value : "");
+      return LIMIT_FAILURE;
+    }
+    i += 2;
+  }
+  if (parsed_cmd[i] == NULL) {
+    fprintf(stderr,
+            "Usage: limit [-t secs] [-v size] [-n files] [-g cgroup] "
+            "[-w weight] [-m size] command [args]\n");
+    return LIMIT_FAILURE;
+  }
+  *command = parsed_cmd + i;
+
+  // Weights the cgroup could not take fall back to rlimits and nice.
+  if (cgroup != NULL) {
+    set_up_cgroup(cgroup, limits, &weight, &memory);
+  }
+  if (weight != RLIM_INFINITY) {
+    // Each nice level is worth about 1.25 times the CPU share of the next.
+    long nice = lround(-log((double)weight / CPU_WEIGHT_DEFAULT) /
+                       log(NICE_WEIGHT_RATIO));
+    limits->nice = (nice < NICE_MIN) ? NICE_MIN
+                   : (nice > NICE_MAX) ? NICE_MAX
+                                       : (int)nice;
+  }
+  if (memory < limits->address_space) {
+    limits->address_space = memory;
+  }
+  return 0;
+}
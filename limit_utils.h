@@ -0,0 +1,68 @@
+#ifndef LIMIT_UTILS_H
+#define LIMIT_UTILS_H
+
+#define CGROUP_DEFAULT_MOUNT "/sys/fs/cgroup"
+#define LIMIT_FAILURE -1
+#define LIMIT_NO_NICE 100
+
+#include <sys/resource.h>
+
+// Struct holding the limits applied to a job between fork() and exec().
+//   cpu_seconds:     RLIMIT_CPU, or RLIM_INFINITY to leave it unchanged.
+//   address_space:   RLIMIT_AS in bytes, or RLIM_INFINITY.
+//   open_files:      RLIMIT_NOFILE, or RLIM_INFINITY.
+//   nice:            The nice value standing in for a CPU weight that could
+//                    not be set in a cgroup, or LIMIT_NO_NICE.
+//   cgroup_procs_fd: The cgroup.procs file of the job's cgroup, or -1.
+struct job_limits_t {
+    rlim_t cpu_seconds;
+    rlim_t address_space;
+    rlim_t open_files;
+    int nice;
+    int cgroup_procs_fd;
+};
+
+// The limits for the next external command, or NULL for none.
+extern const struct job_limits_t* job_limits;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// void apply_limits(const struct job_limits_t*)
+// Description: Moves the calling process into the job's cgroup and sets its
+// resource limits and nice value. Called in the child between fork() and
+// exec(), so it only makes system calls.
+// Preconditions: Limits from set_up_limits() are provided.
+// Postconditions: The limits that could be applied are in effect. Failures
+// are reported on stderr.
+// Return: None.
+extern void apply_limits(const struct job_limits_t*);
+
+// void release_limits(struct job_limits_t*)
+// Description: Closes the descriptors held by a set of limits.
+// Preconditions: Limits from set_up_limits() are provided.
+// Postconditions: The cgroup is no longer held open. Jobs keep running in it.
+// Return: None.
+extern void release_limits(struct job_limits_t*);
+
+// int set_up_limits(char**, struct job_limits_t*, char***)
+// Description: Parses the options of the limit builtin and prepares the
+// job's cgroup. -t sets the CPU time in seconds, -v the address space and -n
+// the number of open files. -g places the job in a cgroup v2 directory,
+// created if needed; relative paths are taken under the cgroup2 mount. -w
+// and -m set the cgroup's cpu.weight and memory.max. When they cannot be set,
+// or no cgroup is given, -w falls back to a nice value and -m to the address
+// space limit. Sizes take K, M and G suffixes.
+// Preconditions: A non-null limit command, limits and command pointer are
+// provided.
+// Postconditions: The limits are filled in and the third argument points at
+// the command after the options.
+// Return: 0 on success, -1 on failure.
+extern int set_up_limits(char**, struct job_limits_t*, char***);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIMIT_UTILS_H
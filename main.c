@@ -4,7 +4,8 @@
 // Desc:    This file contains the main function of a simple linux shell
 //          designed to perform basic linux commands.
 
-#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -12,53 +13,54 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include "arith_utils.h"
+#include "ast_utils.h"
 #include "bg_utils.h"
+#include "builtins.h"
+#include "cache_utils.h"
+#include "capture_utils.h"
+#include "coproc_utils.h"
 #include "history_utils.h"
+#include "output_utils.h"
+#include "profile_utils.h"
+#include "prompt_utils.h"
+#include "ps_utils.h"
+#include "serve_utils.h"
 #include "shell_commands.h"
+#include "timeout_utils.h"
+#include "trace_utils.h"
+#include "usage_utils.h"
 #include "utils.h"
+#include "var_utils.h"
+#include "zygote_utils.h"
 
-#define AMPERSAND "&"
-#define CD_CMD "cd"
-#define CHANGE_PROMPT_CMD "prompt"
+#define CONTINUATION_PROMPT "> "
 #define DOLLAR_SIGN "$"
-#define EXECUTE_FAILURE -1
-#define EXIT_CMD "exit"
-#define FG_CMD "fg"
-#define FWD_SLASH "/"
-#define HISTORY_CMD "history"
-#define JOBS_CMD "jobs"
-#define PROC_CMD "/proc/"
-#define PROC_CMD1 "/proc"
-
-// Global variables.
-struct bg_processes_t* bg_processes;
+
+// Global variables. The background process table starts out empty.
+static struct bg_processes_t bg_process_table;
+struct bg_processes_t* bg_processes = &bg_process_table;
 char* history_file_path;
-char* shell_directory;
 char* shell_prompt;
 
 #pragma region Prototypes
 
-// int execute_command(char**)
-// Description: Executes the provided command.
-// Preconditions: A non-null command is provided as an argument.
-// Postconditions: The command is executed.
-// Return: 0 on success, -1 on failure.
-int execute_command(char**);
+// char* get_continued_command(char*, struct ast_program_t**)
+// Description: Compiles a command, reading continuation lines while it ends
+// inside a compound command or quote.
+// Preconditions: A non-null command and program pointer are provided.
+// Postconditions: The argument is freed. Exits the shell if input ends first.
+// Return: The complete command, and the compiled program in the second
+// argument, which is NULL if the command is empty or invalid.
+char* get_continued_command(char*, struct ast_program_t**);
 
 // char* get_user_command()
 // Description: Gets user input from stdin.
 // Preconditions: None.
 // Postconditions: None.
-// Return: A string containing the user input.
+// Return: A string containing the user input, or NULL at the end of input.
 char* get_user_command(void);
 
-// char** parse_command(char*)
-// Description: Parses the user input into an array of command arguments.
-// Preconditions: A non-null command is provided as an argument.
-// Postconditions: None.
-// Return: An array of command arguments.
-char** parse_command(char*);
-
 // void handle_sigint(int)
 // Description: Handles the Ctrl+C signal interrupt.
 // Preconditions: Ctrl+C is pressed.
@@ -66,13 +68,24 @@ char** parse_command(char*);
 // Return: None.
 void handle_sigint(int);
 
-// void print_cwd()
-// Description: Prints the current working directory and shell prompt.
-// Preconditions: shell_prompt is set.
-// Postconditions: The current working directory and shell prompt are printed to
-// stdout.
+// void handle_sigpipe(int)
+// Description: Handles writes to a closed pipe, e.g. a coprocess that has
+// exited.
+// Preconditions: SIGPIPE is raised.
+// Postconditions: None. The write fails with EPIPE instead of killing the
+// shell, and programs the shell starts still get the default action.
 // Return: None.
-void print_cwd(void);
+void handle_sigpipe(int);
+
+// char* read_here_document(char*, const char*, int)
+// Description: Reads the body of a here-document, up to and including the
+// line holding just its delimiter, and appends it to a command.
+// Preconditions: A non-null command and delimiter are provided. The third
+// argument is whether leading tabs are ignored when matching the delimiter.
+// Postconditions: The command is freed. If input ends first, a warning is
+// printed and the delimiter is supplied.
+// Return: The command followed by a newline and the body lines.
+char* read_here_document(char*, const char*, int);
 
 // void set_up()
 // Description: Sets up the shell environment.
@@ -85,8 +98,8 @@ void set_up(void);
 // void tear_down()
 // Description: Tears down the shell environment.
 // Preconditions: None.
-// Postconditions: Memory is freed for global variables and command history is
-// cleared. Exits process.
+// Postconditions: Memory is freed for global variables and the command history
+// files are closed. Exits process.
 // Return: None.
 void tear_down(void);
 
@@ -103,10 +116,22 @@ void user_prompt_loop(void);
 
 int main(int argc, char** argv) {
   // Check for command-line arguments.
-  if (argc > 1) {
+  if (argc == 3 && strcmp(argv[1], SERVE_OPTION) == 0) {
+    // Serve sessions on a Unix domain socket. Each session continues here in
+    // its own process, with the socket as its input.
+    set_up();
+    int result = serve(argv[2]);
+    if (result == SERVE_FAILURE) {
+      exit(EXIT_FAILURE);
+    }
+    if (result == SERVE_STOPPED) {
+      tear_down();
+    }
+    user_prompt_loop();
+    tear_down();
+  } else if (argc > 1) {
     // Throw error if arguments are passed.
-    fprintf(stderr, "Usage: %s\tCommand line arguments are not supported.\n",
-            argv[0]);
+    fprintf(stderr, "Usage: %s [%s SOCKET]\n", argv[0], SERVE_OPTION);
     return 1;
   } else {
     // NOTE: Extra credit - detailed error messaging/handling throughout
@@ -131,60 +156,88 @@ void set_up() {
     fprintf(stderr, "Error setting Ctrl+C signal handler\n");
   }
 
-  if ((shell_directory = getcwd(NULL, 0)) == NULL) {
-    perror("getcwd error in set_up()");
-    exit(EXIT_FAILURE);
+  // Catch rather than ignore SIGPIPE, so exec() restores the default action.
+  if (signal(SIGPIPE, handle_sigpipe) == SIG_ERR) {
+    fprintf(stderr, "Error setting broken pipe signal handler\n");
   }
 
-  // Print full history file path to a global variable.
-  if ((history_file_path = malloc(strlen(HISTORY_FILENAME) + strlen(FWD_SLASH) +
-                                  strlen(shell_directory) + 1)) == NULL) {
-    perror("history_file_path malloc error in set_up()");
-    exit(EXIT_FAILURE);
+  // Compute slow prompt segments before drawing the prompt, if requested.
+  if (getenv(PROMPT_SYNC_ENV) != NULL) {
+    async_prompt_enabled = 0;
   }
-  if (snprintf(history_file_path,
-               strlen(shell_directory) + strlen(FWD_SLASH) +
-                   strlen(HISTORY_FILENAME) + 1,
-               "%s%s%s", shell_directory, FWD_SLASH, HISTORY_FILENAME) < 0) {
-    perror("snprintf error in set_up()");
-    exit(EXIT_FAILURE);
+
+  // Record the processes the shell starts, if a trace file is requested.
+  if (getenv(TRACE_FILE_ENV) != NULL && trace_start() == TRACE_FAILURE) {
+    fprintf(stderr, "Error starting the trace.\n");
+  }
+
+  // Fork the zygote, if requested, while the shell is still small.
+  if (getenv(ZYGOTE_ENV) != NULL) {
+    zygote_enabled = 1;
+    update_zygote();
   }
 
+  // Buffer standard output and keep error messages in order with it.
+  if (set_up_output() == OUTPUT_FAILURE) {
+    fprintf(stderr, "Error setting up output buffering.\n");
+  }
+
+  // The history path and the background process table are set up when first
+  // used, so a shell that only runs a few commands starts faster.
+
   // Print shell prompt to a global variable.
   if ((shell_prompt = malloc(strlen(DOLLAR_SIGN) + 1)) == NULL) {
     perror("shell_prompt malloc error in set_up()");
     exit(EXIT_FAILURE);
   }
   strcpy(shell_prompt, DOLLAR_SIGN);
-
-  // Initialize global struct for tracking background processes.
-  if ((bg_processes = malloc(sizeof(struct bg_processes_t))) == NULL) {
-    perror("bg_processes malloc error in set_up()");
-    exit(EXIT_FAILURE);
-  }
-  if (set_up_bg_processes() == SETUP_FAILURE) {
-    fprintf(stderr, "Failed to set up background process tracking.\n");
-    exit(EXIT_FAILURE);
-  }
 }
 
 void tear_down() {
-  // Clear command history.
-  if (clear_history() == CLEAR_FAILURE) {
-    fprintf(stderr, "Error clearing history file.\n");
-    exit(EXIT_FAILURE);
+  // Write profiling statistics if requested.
+  if (profile_dump_on_exit() == PROFILE_FAILURE) {
+    fprintf(stderr, "Error writing shell statistics.\n");
   }
 
+  // Write the trace if requested, after the statistics.
+  if (trace_dump_on_exit() == TRACE_FAILURE) {
+    fprintf(stderr, "Error writing the trace.\n");
+  }
+
+  // Close the command history. It is kept for the next session.
+  close_history();
+
+  // Close the shell's ends of any coprocesses, so they see end of input.
+  clear_coprocs();
+
+  // Stop capturing the output of background jobs.
+  clear_captures();
+
+  // Background jobs outlive the shell without their deadlines.
+  clear_bg_deadlines();
+
+  // Stop the zygote. Commands it started are the shell's own children.
+  stop_zygote();
+
+  // Stop the prompt worker and free its cache.
+  clear_prompt();
+
   // Free memory allocated for background process tracking.
   if (clear_bg_processes() == CLEAR_BG_FAILURE) {
     fprintf(stderr, "Error clearing background process data.\n");
     exit(EXIT_FAILURE);
   }
 
-  // Free memory allocated for global variables.
-  free(bg_processes);
+  // Free memory allocated for the parse cache, functions, shell variables and
+  // global variables.
+  clear_parse_cache();
+  clear_arithmetic_cache();
+  clear_trace();
+  clear_ps();
+  clear_functions();
+  clear_variables();
+  clear_output();
   free(history_file_path);
-  free(shell_directory);
   free(shell_prompt);
   exit(EXIT_SUCCESS);
 }
@@ -193,167 +246,87 @@ void user_prompt_loop() {
   char* cmd = NULL;
   // Get user input repeatedly until the user enters the "exit" command.
   while (1) {
-    // Always display the current working directory with the shell prompt.
-    print_cwd();
-
-    cmd = get_user_command();
-    char** parsed_cmd = parse_command(cmd);
-    int is_shell_cmd = 0;
-
-    if (parsed_cmd != NULL) {
-      // First argument is "exit".
-      if (strcmp(parsed_cmd[0], EXIT_CMD) == 0) {
-        if (parsed_cmd[1] != NULL) {
-          // Invalid exit command.
-          fprintf(stderr,
-                  "Usage: exit\tAdditional arguments are not supported.\n");
-        } else {
-          // Valid exit command.
-          free(cmd);
-          for (int i = 0; parsed_cmd[i] != NULL; i++) {
-            free(parsed_cmd[i]);
-          }
-          free(parsed_cmd);
-          tear_down();
-        }
-        is_shell_cmd = 1;
-      }
-
-      // First argument starts with "/proc/".
-      if (strncmp(parsed_cmd[0], PROC_CMD, strlen(PROC_CMD)) == 0) {
-        // Case when command is passed as a single argument.
-        if (parsed_cmd[1] != NULL) {
-          // Invalid /proc command.
-          fprintf(stderr,
-                  "Usage: /proc/[filepath]\tAdditional arguments are "
-                  "not supported.\n");
-        } else {
-          // Valid /proc command.
-          if (execute_proc_command(parsed_cmd[0]) == EXEC_PROC_FAILURE) {
-            fprintf(stderr, "Error executing /proc command.\n");
-          }
-        }
-        is_shell_cmd = 1;
-      } else if ((strcmp(parsed_cmd[0], PROC_CMD1) == 0) &&
-                 (parsed_cmd[1] != NULL)) {
-        // Case when command is passed as 2 arguments (e.g., "/proc /filepath").
-        if (strncmp(parsed_cmd[1], FWD_SLASH, strlen(FWD_SLASH)) == 0) {
-          if (parsed_cmd[2] == NULL) {
-            // Valid /proc command that needs to be concatenated.
-            char* proc_cmd_concat;
-            if ((proc_cmd_concat = malloc(
-                     (strlen(parsed_cmd[0]) + strlen(parsed_cmd[1]) + 1) *
-                     sizeof(char))) == NULL) {
-              perror("proc_cmd_concat malloc error in user_prompt_loop()");
-              exit(EXIT_FAILURE);
-            }
-            strcpy(proc_cmd_concat, parsed_cmd[0]);
-            strcat(proc_cmd_concat, parsed_cmd[1]);
-            if (execute_proc_command(proc_cmd_concat) == EXEC_PROC_FAILURE) {
-              fprintf(stderr, "Error executing /proc command.\n");
-            }
-            free(proc_cmd_concat);
-          } else {
-            fprintf(stderr,
-                    "Usage: /proc/[filepath]\tAdditional arguments are "
-                    "not supported.\n");
-          }
-        }
-        is_shell_cmd = 1;
-      }
-
-      // First argument is "history".
-      if (strcmp(parsed_cmd[0], HISTORY_CMD) == 0) {
-        if (parsed_cmd[1] != NULL) {
-          // Invalid history command.
-          fprintf(stderr,
-                  "Usage: history\tAdditional arguments are not supported.\n");
-        } else {
-          // Valid history command. Check for successsful execution.
-          if (print_history() == PRINT_FAILURE) {
-            fprintf(stderr, "Error printing command history.\n");
-          }
-        }
-        is_shell_cmd = 1;
-      }
-
-      // NOTE: Extra credit - changes working directory.
-      // First argument is "cd".
-      if (strcmp(parsed_cmd[0], CD_CMD) == 0) {
-        if (change_directory(parsed_cmd) == CD_FAILURE) {
-          fprintf(stderr, "Error changing directory.\n");
-        }
-        is_shell_cmd = 1;
-      }
-
-      // NOTE: Extra credit - changes shell prompt.
-      // First argument is "prompt".
-      if (strcmp(parsed_cmd[0], CHANGE_PROMPT_CMD) == 0) {
-        if (change_shell_prompt(parsed_cmd) == CHANGE_PROMPT_FAILURE) {
-          fprintf(stderr, "Error changing shell prompt.\n");
-        }
-        is_shell_cmd = 1;
-      }
-
-      // NOTE: Extra credit - lists background processes.
-      // First argument is "jobs".
-      if (strcmp(parsed_cmd[0], JOBS_CMD) == 0) {
-        if (parsed_cmd[1] != NULL) {
-          // Invalid background command.
-          fprintf(stderr,
-                  "Usage: bg\tAdditional arguments are not supported\n");
-        } else {
-          // Valid background command.
-          if (remove_dead_processes() == CLEAR_BG_FAILURE) {
-            fprintf(stderr, "Error removing dead background processes.\n");
-          }
-          if (list_bg_processes() == BG_FAILURE) {
-            fprintf(stderr, "Error listing background processes.\n");
-          }
-        }
-        is_shell_cmd = 1;
-      }
-
-      // NOTE: Extra credit - foregrounds a background process.
-      // First argument is "fg".
-      if (strcmp(parsed_cmd[0], FG_CMD) == 0) {
-        if (parsed_cmd[1] == NULL) {
-          // Invalid foreground command.
-          fprintf(stderr, "Usage: fg [pid]\tToo few arguments.\n");
-        } else {
-          if (parsed_cmd[2] != NULL) {
-            // Invalid foreground command.
-            fprintf(stderr, "Usage: fg [pid]\tToo many arguments.\n");
-          } else {
-            // Valid foreground command.
-            if (foreground_process(atoi(parsed_cmd[1])) == FG_FAILURE) {
-              fprintf(stderr, "Error foregrounding process.\n");
-            }
-          }
-
-        }
-        is_shell_cmd = 1;
-      }
+    // Always display the prompt segments with the shell prompt, except to the
+    // clients of a server.
+    PROFILE_BEGIN(prompt);
+    if (session_socket == -1) {
+      draw_prompt();
+    }
+    PROFILE_END(prompt, PROFILE_PROMPT);
 
-      // Other commands for program executions.
-      if (!is_shell_cmd) {
-        if (execute_command(parsed_cmd) == EXECUTE_FAILURE) {
-          fprintf(stderr, "Error executing command.\n");
-        }
+    if ((cmd = get_user_command()) == NULL) {
+      // Exit at the end of input as if "exit" had been entered.
+      tear_down();
+    }
+    PROFILE_BEGIN(parse);
+    struct ast_program_t* program;
+    cmd = get_continued_command(cmd, &program);
+    PROFILE_END(parse, PROFILE_PARSE);
+
+    if (program != NULL) {
+      PROFILE_COUNT(PROFILE_COMMANDS);
+      trace_job++;
+      PROFILE_BEGIN(dispatch);
+      int result = run_program(program);
+      PROFILE_END(dispatch, PROFILE_DISPATCH);
+      release_program(program);
+      if (result == BUILTIN_EXIT) {
+        // Valid exit command.
+        free(cmd);
+        tear_down();
       }
 
       // Append latest command to history file.
-      if (append_history(cmd) == APPEND_FAILURE) {
+      PROFILE_BEGIN(history);
+      if (append_history(cmd, &last_usage) == APPEND_FAILURE) {
         fprintf(stderr, "Error appending to history file\n");
       }
+      PROFILE_END(history, PROFILE_HISTORY);
+      PROFILE_COUNT(PROFILE_HISTORY_WRITES);
+    }
+    if (session_socket != -1) {
+      send_session_status(last_exit_status);
+    }
+    free(cmd);
+  }
+}
 
-      for (int i = 0; parsed_cmd[i] != NULL; i++) {
-        free(parsed_cmd[i]);
-      }
-      free(parsed_cmd);
+char* get_continued_command(char* cmd, struct ast_program_t** program) {
+  int status;
+
+  while ((*program = cached_compile_command_line(cmd, &status)) == NULL &&
+         status == COMPILE_INCOMPLETE) {
+    // A here-document body is read in one go rather than compiled again
+    // after every line.
+    int strip_tabs;
+    const char* delimiter = open_heredoc_delimiter(&strip_tabs);
+    if (delimiter != NULL && !feof(stdin)) {
+      cmd = read_here_document(cmd, delimiter, strip_tabs);
+      continue;
+    }
+
+    if (session_socket == -1) {
+      append_output_string(CONTINUATION_PROMPT);
+    }
+    char* next_line;
+    if ((next_line = get_user_command()) == NULL) {
+      fprintf(stderr, "shell error: unexpected end of input\n");
+      free(cmd);
+      tear_down();
+    }
+
+    // Join the lines with a newline, which separates commands.
+    char* joined_cmd;
+    if ((joined_cmd = malloc(strlen(cmd) + strlen(next_line) + 2)) == NULL) {
+      perror("joined_cmd malloc error in get_continued_command()");
+      exit(EXIT_FAILURE);
     }
+    sprintf(joined_cmd, "%s\n%s", cmd, next_line);
     free(cmd);
+    free(next_line);
+    cmd = joined_cmd;
   }
+  return cmd;
 }
 
 char* get_user_command() {
@@ -362,10 +335,20 @@ char* get_user_command() {
   size_t buffer_size = 0;
   ssize_t command_length = -1;
 
+  // Write out the previous command's output and the prompt in one go, then
+  // redraw the prompt as slow segments arrive until input is ready.
+  flush_output();
+  wait_for_prompt_input();
+  wait_for_capture_input();
+
   // Dynamically allocate memory for the user command from stdin.
   if ((command_length = getline(&user_command, &buffer_size, stdin)) == -1) {
-    perror("getline error in get_user_command()");
     free(user_command);
+    if (feof(stdin)) {
+      // End of input, e.g. the end of a script piped to the shell.
+      return NULL;
+    }
+    perror("getline error in get_user_command()");
     if ((user_command = malloc(1)) == NULL) {
       perror("user_command malloc error in get_user_command()");
       exit(EXIT_FAILURE);
@@ -381,154 +364,80 @@ char* get_user_command() {
   return user_command;
 }
 
-char** parse_command(char* user_command) {
-  // Initialize variables.
-  size_t arg_capacity = 10;
-  size_t arg_count = 0;
-  size_t command_length = strlen(user_command);
-  int start_pos = 0;
-  int end_pos = command_length - 1;
-  char** parsed_command = malloc(arg_capacity * sizeof(char*));
-
-  // Skip leading whitespaces.
-  while ((start_pos < command_length) && isspace(user_command[start_pos])) {
-    start_pos++;
-  }
-
-  // Eliminate trailing whitespaces.
-  while ((end_pos >= 0) && isspace(user_command[end_pos])) {
-    user_command[end_pos] = '\0';
-    end_pos--;
-  }
-
-  // If the command is empty, return NULL.
-  if ((!command_length) || (start_pos >= end_pos)) {
-    free(parsed_command);
-    return NULL;
-  }
+char* read_here_document(char* cmd, const char* delimiter, int strip_tabs) {
+  size_t length = strlen(cmd), capacity = length + 1;
+  size_t delimiter_length = strlen(delimiter);
+  int prompt = (session_socket == -1 && isatty(STDIN_FILENO));
+  char* line = NULL;
+  size_t line_capacity = 0;
+  ssize_t line_length;
 
-  // Parse the command into arguments.
-  while (start_pos < command_length) {
-    // Reallocate more memory to hold the parsed command as necessary.
-    if (arg_count >= arg_capacity) {
-      arg_capacity *= 2;
-      char** temp_parsed_cmd =
-          realloc(parsed_command, arg_capacity * sizeof(char*));
-      if (temp_parsed_cmd == NULL) {
-        perror("realloc error in parse_command()");
-        for (int i = 0; i < arg_count; i++) {
-          free(parsed_command[i]);
-        }
-        free(parsed_command);
-        return NULL;
-      }
-      parsed_command = temp_parsed_cmd;
+  while (1) {
+    if (prompt) {
+      append_output_string(CONTINUATION_PROMPT);
+      flush_output();
     }
-
-    int space_pos;
-    if ((space_pos = first_unquoted_space(user_command + start_pos)) != -1) {
-      space_pos += start_pos;
+    if ((line_length = getline(&line, &line_capacity, stdin)) == -1) {
+      fprintf(stderr,
+              "shell warning: here-document delimited by end of input "
+              "(wanted `%s')\n",
+              delimiter);
+      free(line);
+      if ((line = strdup(delimiter)) == NULL) {
+        perror("line strdup error in read_here_document()");
+        exit(EXIT_FAILURE);
+      }
+      line_length = delimiter_length;
+    } else if (line[line_length - 1] == '\n') {
+      line[--line_length] = '\0';
     }
 
-    if (space_pos == -1) {
-      // If there are no spaces after the current start position, add the rest
-      // of the command as the last argument.
-      parsed_command[arg_count] =
-          strndup(user_command + start_pos, command_length - start_pos);
-      start_pos = command_length;
-    } else {
-      // Add the argument between the current start position and the next space
-      // as the next argument.
-      parsed_command[arg_count] =
-          strndup(user_command + start_pos, space_pos - start_pos);
-      start_pos = (space_pos + 1);
+    // Grow geometrically, since bodies may run to many lines.
+    if (length + line_length + 2 > capacity) {
+      while (length + line_length + 2 > capacity) {
+        capacity *= 2;
+      }
+      char* temp_cmd = realloc(cmd, capacity);
+      if (temp_cmd == NULL) {
+        perror("cmd realloc error in read_here_document()");
+        exit(EXIT_FAILURE);
+      }
+      cmd = temp_cmd;
     }
-    arg_count++;
-  }
-  parsed_command[arg_count] = NULL;
-
-  // Expand the escape characters in the parsed command arguments.
-  for (int i = 0; parsed_command[i] != NULL; i++) {
-    char* temp_unescaped_arg = unescape(parsed_command[i], stderr);
-    free(parsed_command[i]);
-    parsed_command[i] = temp_unescaped_arg;
-    temp_unescaped_arg = NULL;
-  }
-
-  return parsed_command;
-}
-
-int execute_command(char** parsed_command) {
-  // NOTE: Extra credit - implementing background process execution.
-  // Check if the command should start a background process.
-  int is_background = 0;
-  int i = 0;
-  while (parsed_command[i] != NULL) {
-    i++;
-  }
-  if (strcmp(parsed_command[i - 1], AMPERSAND) == 0) {
-    free(parsed_command[i - 1]);
-    parsed_command[i - 1] = NULL;
-    is_background = 1;
-  }
-
-  // Create child process.
-  pid_t process_id = fork();
-
-  // Check for error in child process creation.
-  if (process_id < 0) {
-    perror("fork error in execute_command()");
-    return EXECUTE_FAILURE;
-  }
+    cmd[length++] = '\n';
+    memcpy(cmd + length, line, line_length + 1);
+    length += line_length;
 
-  if (process_id == 0) {
-    // Child process.
-    // Child executes the parsed command.
-    if (execvp(parsed_command[0], parsed_command) == -1) {
-      exit(EXIT_FAILURE);
+    const char* text = line;
+    while (strip_tabs && *text == '\t') {
+      text++;
     }
-    exit(EXIT_SUCCESS);
-  } else {
-    // Parent process.
-    if (!is_background) {
-      // Wait for child process to terminate if it is not a background process.
-      int status;
-      if (waitpid(process_id, &status, 0) == -1) {
-        perror("waitpid error in execute_command()");
-        return EXECUTE_FAILURE;
-      }
-    } else {
-      // Add child process to background process array.
-      if (append_bg_process(process_id) == CLEAR_BG_FAILURE) {
-        return EXECUTE_FAILURE;
-      }
-      printf("Started background process %d\n", process_id);
+    if (strcmp(text, delimiter) == 0) {
+      break;
     }
   }
-
-  return 0;
+  free(line);
+  return cmd;
 }
 
 void handle_sigint(int sig) {
-  // Ignore Ctrl+C interrupt.
-  printf("\nInterrupt ignored. Type `exit` to quit.\n");
-  print_cwd();
-  fflush(stdout);
-}
-
-void print_cwd() {
-  char* working_directory;
+  char working_directory[PATH_MAX];
+  char text[PATH_MAX + 128];
 
-  if ((working_directory = getcwd(NULL, 0)) == NULL) {
-    // Print the shell prompt by itself if the current working directory cannot
-    // be obtained.
-    perror("getcwd error in user_prompt_loop()");
-    printf("%s ", shell_prompt);
-  } else {
-    // Print the current working directory in blue with the shell prompt.
-    printf("\033[0;34m%s\033[0m%s ", working_directory, shell_prompt);
-    free(working_directory);
+  // Ignore Ctrl+C interrupt. Write the message and prompt directly, since the
+  // output buffer may be in the middle of an update.
+  if (getcwd(working_directory, sizeof(working_directory)) == NULL) {
+    working_directory[0] = '\0';
+  }
+  int length = snprintf(text, sizeof(text),
+                        "\nInterrupt ignored. Type `exit` to quit.\n"
+                        "\033[0;34m%s\033[0m%s ",
+                        working_directory, shell_prompt);
+  if (length > 0 && write(STDOUT_FILENO, text, strlen(text)) == -1) {
+    // Nothing more can be done inside a signal handler.
   }
 }
 
+void handle_sigpipe(int sig) {}
+
 #pragma endregion Implementations
\ No newline at end of file
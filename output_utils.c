@@ -0,0 +1,202 @@
+// File:    output_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains the shell's standard output buffer. Builtins
+//          append to it, and it is written out with one writev() per command
+//          instead of one write per line, whether or not standard output is
+//          a terminal.
+
+#define _GNU_SOURCE
+
+#include "output_utils.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define OUTPUT_MAX_CHUNKS (OUTPUT_FLUSH_THRESHOLD / OUTPUT_CHUNK_SIZE)
+
+// Buffered output fills chunks[0] to chunks[current], with used bytes in the
+// last one. Chunks are kept for reuse after a flush.
+static char* chunks[OUTPUT_MAX_CHUNKS];
+static int current = 0;
+static size_t used = 0;
+
+// Returns the free space at the end of the buffer, moving to the next chunk
+// or flushing when the current one is full. Returns NULL on failure.
+static char* chunk_space(size_t* space) {
+  if (used == OUTPUT_CHUNK_SIZE) {
+    if (current + 1 == OUTPUT_MAX_CHUNKS) {
+      flush_output();
+    } else {
+      current++;
+      used = 0;
+    }
+  }
+  if (chunks[current] == NULL &&
+      (chunks[current] = malloc(OUTPUT_CHUNK_SIZE)) == NULL) {
+    return NULL;
+  }
+  *space = OUTPUT_CHUNK_SIZE - used;
+  return chunks[current] + used;
+}
+
+// Writes to the real stderr after flushing standard output.
+static ssize_t write_error(void* cookie, const char* buffer, size_t size) {
+  size_t total = 0;
+
+  flush_output();
+  while (total < size) {
+    ssize_t written = write(STDERR_FILENO, buffer + total, size - total);
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return total ? (ssize_t)total : -1;
+    }
+    total += written;
+  }
+  return size;
+}
+
+static void flush_at_exit(void) {
+  flush_output();
+}
+
+int append_output(const char* bytes, size_t length) {
+  while (length > 0) {
+    size_t space;
+    char* destination = chunk_space(&space);
+    if (destination == NULL) {
+      return OUTPUT_FAILURE;
+    }
+    size_t copied = (length < space) ? length : space;
+    memcpy(destination, bytes, copied);
+    used += copied;
+    bytes += copied;
+    length -= copied;
+  }
+  return 0;
+}
+
+int append_output_char(char c) {
+  // Fast path for the common case of room in the current chunk.
+  if (used < OUTPUT_CHUNK_SIZE && chunks[current] != NULL) {
+    chunks[current][used++] = c;
+    return 0;
+  }
+  return append_output(&c, 1);
+}
+
+int append_output_string(const char* string) {
+  return append_output(string, strlen(string));
+}
+
+int append_output_unsigned(unsigned long long value) {
+  char digits[20];
+  int length = sizeof(digits);
+
+  do {
+    digits[--length] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+  return append_output(digits + length, sizeof(digits) - length);
+}
+
+void clear_output(void) {
+  flush_output();
+  for (int i = 0; i < OUTPUT_MAX_CHUNKS; i++) {
+    free(chunks[i]);
+    chunks[i] = NULL;
+  }
+}
+
+int flush_output(void) {
+  struct iovec parts[OUTPUT_MAX_CHUNKS];
+  int num_parts = 0;
+  int result = 0;
+
+  for (int i = 0; i <= current; i++) {
+    size_t length = (i < current) ? OUTPUT_CHUNK_SIZE : used;
+    if (length > 0) {
+      parts[num_parts].iov_base = chunks[i];
+      parts[num_parts].iov_len = length;
+      num_parts++;
+    }
+  }
+  current = 0;
+  used = 0;
+
+  // Pipes may take less than everything at once.
+  for (int first = 0; first < num_parts;) {
+    ssize_t written = writev(STDOUT_FILENO, parts + first, num_parts - first);
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      result = OUTPUT_FAILURE;
+      break;
+    }
+    while (first < num_parts && (size_t)written >= parts[first].iov_len) {
+      written -= parts[first].iov_len;
+      first++;
+    }
+    if (first < num_parts) {
+      parts[first].iov_base = (char*)parts[first].iov_base + written;
+      parts[first].iov_len -= written;
+    }
+  }
+  return result;
+}
+
+int format_output(const char* format, ...) {
+  va_list args, args_copy;
+  size_t space;
+  char* destination;
+  int result = 0;
+
+  if ((destination = chunk_space(&space)) == NULL) {
+    return OUTPUT_FAILURE;
+  }
+
+  // Format straight into the buffer when the text fits in the current chunk.
+  va_start(args, format);
+  va_copy(args_copy, args);
+  int length = vsnprintf(destination, space, format, args_copy);
+  va_end(args_copy);
+  if (length < 0) {
+    result = OUTPUT_FAILURE;
+  } else if ((size_t)length < space) {
+    used += length;
+  } else {
+    char* text = malloc(length + 1);
+    if (text == NULL) {
+      result = OUTPUT_FAILURE;
+    } else {
+      vsnprintf(text, length + 1, format, args);
+      result = append_output(text, length);
+      free(text);
+    }
+  }
+  va_end(args);
+  return result;
+}
+
+int set_up_output(void) {
+  cookie_io_functions_t functions = {NULL, write_error, NULL, NULL};
+  FILE* error_stream;
+
+  if ((error_stream = fopencookie(NULL, "w", functions)) == NULL) {
+    perror("fopencookie error in set_up_output()");
+    return OUTPUT_FAILURE;
+  }
+
+  // Unbuffered, like the stderr it replaces.
+  setvbuf(error_stream, NULL, _IONBF, 0);
+  stderr = error_stream;
+  return (atexit(flush_at_exit) == 0) ? 0 : OUTPUT_FAILURE;
+}
@@ -0,0 +1,83 @@
+#ifndef OUTPUT_UTILS_H
+#define OUTPUT_UTILS_H
+
+#define OUTPUT_CHUNK_SIZE 65536
+#define OUTPUT_FAILURE -1
+#define OUTPUT_FLUSH_THRESHOLD (1 << 20)
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// int append_output(const char*, size_t)
+// Description: Appends bytes to the shell's standard output buffer. The buffer
+// is written out early once it holds OUTPUT_FLUSH_THRESHOLD bytes.
+// Preconditions: A non-null buffer of the given length is provided.
+// Postconditions: The bytes are buffered.
+// Return: 0 on success, -1 on failure.
+extern int append_output(const char*, size_t);
+
+// int append_output_char(char)
+// Description: Appends one character to the standard output buffer.
+// Preconditions: None.
+// Postconditions: The character is buffered.
+// Return: 0 on success, -1 on failure.
+extern int append_output_char(char);
+
+// int append_output_string(const char*)
+// Description: Appends a string to the standard output buffer.
+// Preconditions: A non-null string is provided.
+// Postconditions: The string is buffered without its terminator.
+// Return: 0 on success, -1 on failure.
+extern int append_output_string(const char*);
+
+// int append_output_unsigned(unsigned long long)
+// Description: Appends a number in decimal to the standard output buffer,
+// without the cost of format_output().
+// Preconditions: None.
+// Postconditions: The digits are buffered.
+// Return: 0 on success, -1 on failure.
+extern int append_output_unsigned(unsigned long long);
+
+// void clear_output()
+// Description: Writes out and frees the standard output buffer.
+// Preconditions: None.
+// Postconditions: The buffer is empty and its memory is freed.
+// Return: None.
+extern void clear_output(void);
+
+// int flush_output()
+// Description: Writes the standard output buffer to standard output with a
+// single writev(). Called before the shell waits for input, forks or moves
+// standard output, and before anything is written to stderr, so output stays
+// in order with children and error messages.
+// Preconditions: None.
+// Postconditions: The buffer is empty. Output that could not be written is
+// dropped.
+// Return: 0 on success, -1 on failure.
+extern int flush_output(void);
+
+// int format_output(const char*, ...)
+// Description: Appends printf()-style formatted text to the standard output
+// buffer.
+// Preconditions: A non-null format matching the arguments is provided.
+// Postconditions: The text is buffered.
+// Return: 0 on success, -1 on failure.
+extern int format_output(const char*, ...)
+    __attribute__((format(printf, 1, 2)));
+
+// int set_up_output()
+// Description: Routes stderr through a stream that flushes the standard output
+// buffer before each write, and flushes the buffer at exit.
+// Preconditions: None.
+// Postconditions: stderr is replaced.
+// Return: 0 on success, -1 on failure.
+extern int set_up_output(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OUTPUT_UTILS_H
@@ -0,0 +1,160 @@
+// File:    parse_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains the functions that turn a line of user input
+//          into an array of command arguments.
+
+#define _GNU_SOURCE
+
+#include "parse_utils.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+// Frees an argument array whose arguments were allocated one by one.
+static void free_argument_list(char** arguments) {
+  for (int i = 0; arguments[i] != NULL; i++) {
+    free(arguments[i]);
+  }
+  free(arguments);
+}
+
+char** copy_parsed_command(char** parsed_command) {
+  size_t arg_count = 0;
+  size_t strings_size = 0;
+
+  // Measure the arguments.
+  while (parsed_command[arg_count] != NULL) {
+    strings_size += strlen(parsed_command[arg_count]) + 1;
+    arg_count++;
+  }
+
+  // The array comes first, followed by the strings it points to.
+  char** copy = malloc((arg_count + 1) * sizeof(char*) + strings_size);
+  if (copy == NULL) {
+    perror("malloc error in copy_parsed_command()");
+    return NULL;
+  }
+  char* strings = (char*)(copy + arg_count + 1);
+  for (size_t i = 0; i < arg_count; i++) {
+    size_t length = strlen(parsed_command[i]) + 1;
+    memcpy(strings, parsed_command[i], length);
+    copy[i] = strings;
+    strings += length;
+  }
+  copy[arg_count] = NULL;
+  return copy;
+}
+
+void free_parsed_command(char** parsed_command) {
+  free(parsed_command);
+}
+
+char** parse_command(char* user_command) {
+  // Initialize variables.
+  size_t arg_capacity = 10;
+  size_t arg_count = 0;
+  size_t command_length = strlen(user_command);
+  size_t start_pos = 0;
+  size_t end_pos = command_length;
+
+  // Eliminate trailing whitespaces.
+  while ((end_pos > 0) && isspace((unsigned char)user_command[end_pos - 1])) {
+    user_command[--end_pos] = '\0';
+  }
+  command_length = end_pos;
+
+  // Skip leading whitespaces.
+  while ((start_pos < command_length) &&
+         isspace((unsigned char)user_command[start_pos])) {
+    start_pos++;
+  }
+
+  // If the command is empty, return NULL.
+  if (start_pos >= command_length) {
+    return NULL;
+  }
+
+  char** parsed_command = malloc(arg_capacity * sizeof(char*));
+  if (parsed_command == NULL) {
+    perror("malloc error in parse_command()");
+    return NULL;
+  }
+
+  // Parse the command into arguments.
+  while (start_pos < command_length) {
+    // Reallocate more memory to hold the parsed command as necessary. One slot
+    // is always kept free for the terminating NULL.
+    if (arg_count + 1 >= arg_capacity) {
+      arg_capacity *= 2;
+      char** temp_parsed_cmd =
+          realloc(parsed_command, arg_capacity * sizeof(char*));
+      if (temp_parsed_cmd == NULL) {
+        perror("realloc error in parse_command()");
+        parsed_command[arg_count] = NULL;
+        free_argument_list(parsed_command);
+        return NULL;
+      }
+      parsed_command = temp_parsed_cmd;
+    }
+
+    int space_pos;
+    if ((space_pos = first_unquoted_space(user_command + start_pos)) != -1) {
+      space_pos += start_pos;
+    }
+
+    if (space_pos == -1) {
+      // If there are no spaces after the current start position, add the rest
+      // of the command as the last argument.
+      parsed_command[arg_count] =
+          strndup(user_command + start_pos, command_length - start_pos);
+      start_pos = command_length;
+    } else {
+      // Add the argument between the current start position and the next space
+      // as the next argument.
+      parsed_command[arg_count] =
+          strndup(user_command + start_pos, space_pos - start_pos);
+      start_pos = (space_pos + 1);
+
+      // Skip the rest of a run of whitespace between arguments.
+      while ((start_pos < command_length) &&
+             isspace((unsigned char)user_command[start_pos])) {
+        start_pos++;
+      }
+    }
+    if (parsed_command[arg_count] == NULL) {
+      perror("strndup error in parse_command()");
+      free_argument_list(parsed_command);
+      return NULL;
+    }
+    arg_count++;
+  }
+  parsed_command[arg_count] = NULL;
+
+  // Expand the escape characters in the parsed command arguments.
+  for (int i = 0; parsed_command[i] != NULL; i++) {
+    char* temp_unescaped_arg = unescape(parsed_command[i], stderr);
+    if (temp_unescaped_arg == NULL) {
+      // Invalid escape sequence or unterminated quote. Keep the array
+      // NULL-terminated while freeing it.
+      for (int j = i; parsed_command[j] != NULL; j++) {
+        free(parsed_command[j]);
+      }
+      parsed_command[i] = NULL;
+      free_argument_list(parsed_command);
+      return NULL;
+    }
+    free(parsed_command[i]);
+    parsed_command[i] = temp_unescaped_arg;
+    temp_unescaped_arg = NULL;
+  }
+
+  // Pack the arguments into a single allocation.
+  char** packed_command = copy_parsed_command(parsed_command);
+  free_argument_list(parsed_command);
+  return packed_command;
+}
@@ -0,0 +1,40 @@
+#ifndef PARSE_UTILS_H
+#define PARSE_UTILS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// char** copy_parsed_command(char**)
+// Description: Copies a parsed command into a single allocation holding both
+// the argument array and the argument strings.
+// Preconditions: A non-null, NULL-terminated argument array is provided.
+// Postconditions: None.
+// Return: The copy on success, NULL on failure. Free with
+// free_parsed_command().
+extern char** copy_parsed_command(char**);
+
+// void free_parsed_command(char**)
+// Description: Frees a parsed command returned by parse_command() or
+// copy_parsed_command().
+// Preconditions: The argument is NULL or was returned by one of those
+// functions.
+// Postconditions: The array and its arguments are freed.
+// Return: None.
+extern void free_parsed_command(char**);
+
+// char** parse_command(char*)
+// Description: Parses the user input into an array of command arguments.
+// Arguments are separated by runs of unquoted, unescaped whitespace and each
+// argument is unescaped.
+// Preconditions: A non-null command is provided as an argument.
+// Postconditions: Trailing whitespace is removed from the command in place.
+// Return: A NULL-terminated array of command arguments in a single allocation,
+// or NULL if the command is empty or cannot be parsed.
+extern char** parse_command(char*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PARSE_UTILS_H
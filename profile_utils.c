@@ -0,0 +1,103 @@
+// File:    profile_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains the optional instrumentation layer used to
+//          profile the shell's own hot path.
+
+#include "profile_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char* phase_names[PROFILE_NUM_PHASES] = {
+    "prompt", "parse", "dispatch", "fork", "wait", "history"};
+static const char* counter_names[PROFILE_NUM_COUNTERS] = {
+    "commands",           "builtins",
+    "spawns",             "history_writes",
+    "parse_cache_hits",   "parse_cache_misses",
+    "parse_cache_evictions", "parse_cache_bypasses"};
+
+static struct profile_span_t spans[PROFILE_NUM_PHASES];
+static unsigned long long counters[PROFILE_NUM_COUNTERS];
+
+void profile_count(enum profile_counter_t counter) {
+  counters[counter]++;
+}
+
+int profile_dump(FILE* out) {
+  if (out == NULL) {
+    return PROFILE_FAILURE;
+  }
+
+  fprintf(out, "kind,name,count,total_ns,min_ns,max_ns,le_ns\n");
+  for (int i = 0; profile_enabled() && i < PROFILE_NUM_PHASES; i++) {
+    struct profile_span_t* span = &spans[i];
+    fprintf(out, "span,%s,%llu,%llu,%llu,%llu,\n", phase_names[i], span->count,
+            span->total_ns, span->min_ns, span->max_ns);
+    for (int b = 0; b < PROFILE_HISTOGRAM_BUCKETS; b++) {
+      if (span->buckets[b] > 0) {
+        fprintf(out, "hist,%s,%llu,,,,%llu\n", phase_names[i], span->buckets[b],
+                1ULL << b);
+      }
+    }
+  }
+  for (int i = 0; i < PROFILE_NUM_COUNTERS; i++) {
+    // Only the parse cache counters are kept without instrumentation.
+    if (!profile_enabled() && i < PROFILE_PARSE_CACHE_HITS) {
+      continue;
+    }
+    fprintf(out, "counter,%s,%llu,,,,\n", counter_names[i], counters[i]);
+  }
+  return 0;
+}
+
+int profile_dump_on_exit(void) {
+  char* stats_path;
+  FILE* stats_file;
+
+  if ((stats_path = getenv(PROFILE_STATS_ENV)) == NULL) {
+    return 0;
+  }
+
+  if ((stats_file = fopen(stats_path, "w")) == NULL) {
+    perror("fopen error in profile_dump_on_exit()");
+    return PROFILE_FAILURE;
+  }
+  int result = profile_dump(stats_file);
+  fclose(stats_file);
+  return result;
+}
+
+int profile_enabled(void) {
+#ifdef SHELL_PROFILE
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+void profile_record(enum profile_phase_t phase, const struct timespec* start) {
+  struct timespec end;
+  struct profile_span_t* span = &spans[phase];
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  unsigned long long ns =
+      (unsigned long long)(end.tv_sec - start->tv_sec) * 1000000000ULL +
+      end.tv_nsec - start->tv_nsec;
+
+  if (span->count == 0 || ns < span->min_ns) {
+    span->min_ns = ns;
+  }
+  if (ns > span->max_ns) {
+    span->max_ns = ns;
+  }
+  span->count++;
+  span->total_ns += ns;
+
+  // Find the smallest power of two above the span length.
+  int bucket = 0;
+  while (bucket < PROFILE_HISTOGRAM_BUCKETS - 1 && (1ULL << bucket) <= ns) {
+    bucket++;
+  }
+  span->buckets[bucket]++;
+}
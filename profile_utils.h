@@ -0,0 +1,104 @@
+#ifndef PROFILE_UTILS_H
+#define PROFILE_UTILS_H
+
+#define PROFILE_FAILURE -1
+#define PROFILE_HISTOGRAM_BUCKETS 40
+#define PROFILE_STATS_ENV "SHELL_STATS_FILE"
+
+#include <stdio.h>
+#include <time.h>
+
+// Phases of the shell's hot path that are timed.
+enum profile_phase_t {
+    PROFILE_PROMPT,
+    PROFILE_PARSE,
+    PROFILE_DISPATCH,
+    PROFILE_FORK,
+    PROFILE_WAIT,
+    PROFILE_HISTORY,
+    PROFILE_NUM_PHASES
+};
+
+// Events of the shell's hot path that are counted. The parse cache counters
+// are always kept, even when instrumentation is compiled out.
+enum profile_counter_t {
+    PROFILE_COMMANDS,
+    PROFILE_BUILTINS,
+    PROFILE_SPAWNS,
+    PROFILE_HISTORY_WRITES,
+    PROFILE_PARSE_CACHE_HITS,
+    PROFILE_PARSE_CACHE_MISSES,
+    PROFILE_PARSE_CACHE_EVICTIONS,
+    PROFILE_PARSE_CACHE_BYPASSES,
+    PROFILE_NUM_COUNTERS
+};
+
+// Struct holding the aggregated timings of one phase. Bucket i counts spans
+// shorter than 2^i nanoseconds.
+struct profile_span_t {
+    unsigned long long count;
+    unsigned long long total_ns;
+    unsigned long long min_ns;
+    unsigned long long max_ns;
+    unsigned long long buckets[PROFILE_HISTOGRAM_BUCKETS];
+};
+
+// Instrumentation is compiled in only when SHELL_PROFILE is defined, so the
+// macros below expand to nothing in regular builds.
+#ifdef SHELL_PROFILE
+#define PROFILE_BEGIN(name)                 \
+    struct timespec profile_start_##name;  \
+    clock_gettime(CLOCK_MONOTONIC, &profile_start_##name)
+#define PROFILE_END(name, phase) profile_record((phase), &profile_start_##name)
+#define PROFILE_COUNT(counter) profile_count(counter)
+#else
+#define PROFILE_BEGIN(name) ((void)0)
+#define PROFILE_END(name, phase) ((void)0)
+#define PROFILE_COUNT(counter) ((void)0)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// void profile_count(enum profile_counter_t)
+// Description: Increments a hot path counter.
+// Preconditions: None.
+// Postconditions: The counter is incremented.
+// Return: None.
+extern void profile_count(enum profile_counter_t);
+
+// int profile_dump(FILE*)
+// Description: Writes all spans, histograms and counters as CSV.
+// Preconditions: A non-null, writable stream is provided.
+// Postconditions: One "span", "hist" or "counter" row is written per value.
+// Spans and histograms are only written when instrumentation is compiled in.
+// Return: 0 on success, -1 on failure.
+extern int profile_dump(FILE*);
+
+// int profile_dump_on_exit()
+// Description: Writes the statistics to the file named by SHELL_STATS_FILE.
+// Preconditions: None.
+// Postconditions: The file is overwritten if the variable is set.
+// Return: 0 on success or if there is nothing to do, -1 on failure.
+extern int profile_dump_on_exit(void);
+
+// int profile_enabled()
+// Description: Reports whether instrumentation is compiled in.
+// Preconditions: None.
+// Postconditions: None.
+// Return: 1 if compiled with SHELL_PROFILE, 0 otherwise.
+extern int profile_enabled(void);
+
+// void profile_record(enum profile_phase_t, const struct timespec*)
+// Description: Records a span that started at the given time and ends now.
+// Preconditions: A non-null start time from CLOCK_MONOTONIC is provided.
+// Postconditions: The span is added to the phase's totals and histogram.
+// Return: None.
+extern void profile_record(enum profile_phase_t, const struct timespec*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PROFILE_UTILS_H
@@ -0,0 +1,623 @@
+// File:    prompt_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains functions for drawing the prompt from the
+//          segments named in PROMPT_SEGMENTS. Cheap segments are computed as
+//          the prompt is drawn. The git segment runs `git status`, which can
+//          take seconds in a large repository, so it is computed on a worker
+//          thread and cached; the prompt is drawn at once with the cached
+//          value and redrawn in place when a new one arrives.
+
+#define _GNU_SOURCE
+
+#include "prompt_utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bg_utils.h"
+#include "output_utils.h"
+#include "shell_commands.h"
+#include "usage_utils.h"
+#include "var_utils.h"
+
+#define BRANCH_PREFIX "refs/heads/"
+#define LOADAVG_PATH "/proc/loadavg"
+#define REDRAW_LINE "\r\033[K"
+
+// Struct holding what a git segment depends on.
+//   work_tree:     The top directory of the work tree.
+//   git_dir:       The repository directory, usually work_tree/.git.
+//   head_mtime:    The modification time of git_dir/HEAD.
+//   index_mtime:   The modification time of git_dir/index.
+//   command_start: When the last command started. Any command may change
+//                  the work tree, so a value computed before it is stale.
+struct git_key_t {
+    char work_tree[PATH_MAX];
+    char git_dir[PATH_MAX];
+    struct timespec head_mtime;
+    struct timespec index_mtime;
+    struct timespec command_start;
+};
+
+// Struct holding the cached git segment of a working directory.
+//   cwd:           The working directory, or NULL if the entry is unused.
+//   head_mtime:    The git_key_t members the text was computed for.
+//   index_mtime:   See head_mtime.
+//   command_start: See head_mtime.
+//   computed:      Whether the text has been computed.
+//   last_used:     When the entry was last looked up, for eviction.
+//   text:          The branch, followed by "*" if the work tree has changes.
+struct git_entry_t {
+    char* cwd;
+    struct timespec head_mtime;
+    struct timespec index_mtime;
+    struct timespec command_start;
+    int computed;
+    unsigned long last_used;
+    char text[PROMPT_SEGMENT_MAX];
+};
+
+// Struct describing a prompt segment.
+//   name:   The name used in PROMPT_SEGMENTS.
+//   append: Appends the segment for a working directory, which is NULL if it
+//           is unknown, preceded by a space if the second argument is set.
+//           Slow segments are requested from the worker if the third
+//           argument is set. Returns 1 if anything was appended, 0
+//           otherwise.
+struct prompt_segment_t {
+    const char* name;
+    int (*append)(const char*, int, int);
+};
+
+// Global variables.
+int async_prompt_enabled = 1;
+
+extern char** environ;
+
+// The cache and the request slot are shared with the worker under the lock.
+// The worker holds one request at a time; a newer one replaces it.
+static pthread_mutex_t prompt_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t request_ready = PTHREAD_COND_INITIALIZER;
+static struct git_entry_t git_cache[PROMPT_CACHE_SIZE];
+static unsigned long cache_clock = 0;
+static struct git_key_t request_key;
+static char* request_cwd = NULL;
+static int worker_busy = 0;
+static int stop_worker = 0;
+static int git_changed = 0;
+
+// The worker writes a byte to the pipe after storing each result.
+static pthread_t worker_thread;
+static int worker_started = 0;
+static int notify_fds[2] = {-1, -1};
+
+// Whether the last prompt is waiting on the worker.
+static int redraw_pending = 0;
+
+static int timespec_equal(const struct timespec* a, const struct timespec* b) {
+  return a->tv_sec == b->tv_sec && a->tv_nsec == b->tv_nsec;
+}
+
+// Stores the modification time of a file in a repository directory, or zero
+// if it does not exist.
+static void stat_mtime(const char* git_dir, const char* name,
+                       struct timespec* mtime) {
+  char path[PATH_MAX];
+  struct stat file_stat;
+
+  mtime->tv_sec = mtime->tv_nsec = 0;
+  if (snprintf(path, sizeof(path), "%s/%s", git_dir, name) <
+          (int)sizeof(path) &&
+      stat(path, &file_stat) == 0) {
+    *mtime = file_stat.st_mtim;
+  }
+}
+
+// Finds the repository holding a working directory by looking for .git in it
+// and its parents. A .git file points to the repository of a linked work
+// tree. Returns 0 on success, -1 if the directory is not in a work tree.
+static int find_git_key(const char* cwd, struct git_key_t* key) {
+  char* work_tree = key->work_tree;
+  struct stat git_stat;
+
+  if (strlen(cwd) >= PATH_MAX) {
+    return -1;
+  }
+  strcpy(work_tree, cwd);
+  while (1) {
+    if (snprintf(key->git_dir, PATH_MAX, "%s/.git",
+                 strcmp(work_tree, "/") == 0 ? "" : work_tree) < PATH_MAX &&
+        stat(key->git_dir, &git_stat) == 0) {
+      break;
+    }
+    char* slash = strrchr(work_tree, '/');
+    if (slash == NULL || strcmp(work_tree, "/") == 0) {
+      return -1;
+    }
+    slash[slash == work_tree ? 1 : 0] = '\0';
+  }
+
+  if (S_ISREG(git_stat.st_mode)) {
+    // "gitdir: PATH", relative to the work tree unless absolute.
+    char line[PATH_MAX];
+    FILE* git_file = fopen(key->git_dir, "r");
+    if (git_file == NULL || fgets(line, sizeof(line), git_file) == NULL ||
+        strncmp(line, "gitdir: ", 8) != 0) {
+      if (git_file != NULL) {
+        fclose(git_file);
+      }
+      return -1;
+    }
+    fclose(git_file);
+    line[strcspn(line, "\n")] = '\0';
+    if (line[8] == '/') {
+      snprintf(key->git_dir, PATH_MAX, "%s", line + 8);
+    } else if (snprintf(key->git_dir, PATH_MAX, "%s/%s", work_tree,
+                        line + 8) >= PATH_MAX) {
+      return -1;
+    }
+  }
+
+  stat_mtime(key->git_dir, "HEAD", &key->head_mtime);
+  stat_mtime(key->git_dir, "index", &key->index_mtime);
+  key->command_start = last_usage.start;
+  return 0;
+}
+
+// Checks whether tracked files in a work tree have changes, with
+// `git status`. Optional locks are skipped, so the index is not rewritten,
+// which would change its modification time. Returns 1 if there are changes,
+// 0 if there are none or git fails.
+static int work_tree_dirty(const char* work_tree) {
+  char* argv[] = {"git", "--no-optional-locks", "-C", (char*)work_tree,
+                  "status", "--porcelain", "--untracked-files=no", NULL};
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attributes;
+  sigset_t signals;
+  char buffer[4096];
+  size_t total = 0;
+  ssize_t length;
+  int fds[2];
+  int status;
+  pid_t process_id;
+
+  if (pipe2(fds, O_CLOEXEC) == -1) {
+    return 0;
+  }
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null",
+                                   O_RDONLY, 0);
+  posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+  posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null",
+                                   O_WRONLY, 0);
+
+  // The worker blocks every signal; git gets none blocked and the default
+  // actions for the ones the shell catches.
+  posix_spawnattr_init(&attributes);
+  sigemptyset(&signals);
+  posix_spawnattr_setsigmask(&attributes, &signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGPIPE);
+  posix_spawnattr_setsigdefault(&attributes, &signals);
+  posix_spawnattr_setflags(&attributes,
+                           POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+  int result = posix_spawnp(&process_id, "git", &actions, &attributes, argv,
+                            environ);
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attributes);
+  close(fds[1]);
+  if (result != 0) {
+    close(fds[0]);
+    return 0;
+  }
+
+  // Read to the end, so git is not stopped by a full pipe.
+  while ((length = read(fds[0], buffer, sizeof(buffer))) > 0 ||
+         (length == -1 && errno == EINTR)) {
+    total += (length > 0) ? length : 0;
+  }
+  close(fds[0]);
+  while (waitpid(process_id, &status, 0) == -1 && errno == EINTR) {
+  }
+  return total > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Computes the git segment: the branch, or the abbreviated commit of a
+// detached HEAD, followed by "*" if the work tree has changes.
+static void compute_git(const struct git_key_t* key, char* text) {
+  char path[PATH_MAX];
+  char head[PATH_MAX];
+  const char* branch = head;
+  FILE* head_file;
+
+  text[0] = '\0';
+  if (snprintf(path, sizeof(path), "%s/HEAD", key->git_dir) >=
+          (int)sizeof(path) ||
+      (head_file = fopen(path, "r")) == NULL) {
+    return;
+  }
+  if (fgets(head, sizeof(head), head_file) == NULL) {
+    fclose(head_file);
+    return;
+  }
+  fclose(head_file);
+  head[strcspn(head, "\n")] = '\0';
+
+  if (strncmp(head, "ref: ", 5) == 0) {
+    branch = head + 5;
+    if (strncmp(branch, BRANCH_PREFIX, strlen(BRANCH_PREFIX)) == 0) {
+      branch += strlen(BRANCH_PREFIX);
+    }
+  } else {
+    head[7] = '\0';
+  }
+  // Long branch names are cut short.
+  if (snprintf(text, PROMPT_SEGMENT_MAX, "%s%s", branch,
+               work_tree_dirty(key->work_tree) ? "*" : "") >=
+      PROMPT_SEGMENT_MAX) {
+    text[PROMPT_SEGMENT_MAX - 1] = '\0';
+  }
+}
+
+// Returns the cache entry for a working directory, taking the least recently
+// used one if there is none. Called with the lock held. Returns NULL if
+// memory runs out.
+static struct git_entry_t* find_git_entry(const char* cwd, int create) {
+  struct git_entry_t* oldest = &git_cache[0];
+
+  for (size_t i = 0; i < PROMPT_CACHE_SIZE; i++) {
+    struct git_entry_t* entry = &git_cache[i];
+    if (entry->cwd != NULL && strcmp(entry->cwd, cwd) == 0) {
+      entry->last_used = ++cache_clock;
+      return entry;
+    }
+    if (entry->cwd == NULL ||
+        (oldest->cwd != NULL && entry->last_used < oldest->last_used)) {
+      oldest = entry;
+    }
+  }
+  if (!create) {
+    return NULL;
+  }
+
+  char* copy = strdup(cwd);
+  if (copy == NULL) {
+    perror("strdup error in find_git_entry()");
+    return NULL;
+  }
+  free(oldest->cwd);
+  oldest->cwd = copy;
+  oldest->computed = 0;
+  oldest->text[0] = '\0';
+  oldest->last_used = ++cache_clock;
+  return oldest;
+}
+
+// Stores a computed git segment. Called with the lock held.
+static void store_git(const char* cwd, const struct git_key_t* key,
+                      const char* text) {
+  struct git_entry_t* entry = find_git_entry(cwd, 0);
+
+  if (entry == NULL) {
+    // Evicted while it was computed.
+    return;
+  }
+  if (!entry->computed || strcmp(entry->text, text) != 0) {
+    git_changed = 1;
+  }
+  entry->head_mtime = key->head_mtime;
+  entry->index_mtime = key->index_mtime;
+  entry->command_start = key->command_start;
+  entry->computed = 1;
+  strcpy(entry->text, text);
+}
+
+// Computes the requested git segments until the shell stops the worker.
+static void* prompt_worker(void* arg) {
+  char text[PROMPT_SEGMENT_MAX];
+
+  pthread_mutex_lock(&prompt_lock);
+  while (1) {
+    while (request_cwd == NULL && !stop_worker) {
+      pthread_cond_wait(&request_ready, &prompt_lock);
+    }
+    if (stop_worker) {
+      break;
+    }
+    char* cwd = request_cwd;
+    struct git_key_t* key = malloc(sizeof(struct git_key_t));
+    if (key != NULL) {
+      *key = request_key;
+    }
+    request_cwd = NULL;
+    worker_busy = 1;
+    pthread_mutex_unlock(&prompt_lock);
+
+    if (key != NULL) {
+      compute_git(key, text);
+    }
+
+    pthread_mutex_lock(&prompt_lock);
+    if (key != NULL) {
+      store_git(cwd, key, text);
+    }
+    free(key);
+    free(cwd);
+    worker_busy = 0;
+    if (write(notify_fds[1], "", 1) == -1) {
+      // The pipe is full, so the shell has wake-ups pending already.
+    }
+  }
+  pthread_mutex_unlock(&prompt_lock);
+  return NULL;
+}
+
+// Starts the worker thread with every signal blocked, so signals reach the
+// main thread. Returns 0 on success, -1 on failure.
+static int start_worker(void) {
+  sigset_t all_signals, old_signals;
+
+  if (pipe2(notify_fds, O_CLOEXEC | O_NONBLOCK) == -1) {
+    perror("pipe2 error in start_worker()");
+    return -1;
+  }
+  sigfillset(&all_signals);
+  pthread_sigmask(SIG_SETMASK, &all_signals, &old_signals);
+  int result = pthread_create(&worker_thread, NULL, prompt_worker, NULL);
+  pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+  if (result != 0) {
+    errno = result;
+    perror("pthread_create error in start_worker()");
+    close(notify_fds[0]);
+    close(notify_fds[1]);
+    notify_fds[0] = notify_fds[1] = -1;
+    return -1;
+  }
+  worker_started = 1;
+  return 0;
+}
+
+// Looks up the git segment of a working directory. A missing or stale value
+// is requested from the worker, or computed at once if the async_prompt
+// option is off, if the third argument is set. The text is empty outside a
+// work tree and while the first value is computed.
+static void lookup_git(const char* cwd, char* text, int request) {
+  struct git_key_t key;
+  int fresh = 0;
+
+  text[0] = '\0';
+  if (find_git_key(cwd, &key) == -1) {
+    return;
+  }
+
+  pthread_mutex_lock(&prompt_lock);
+  struct git_entry_t* entry = find_git_entry(cwd, 1);
+  if (entry != NULL && entry->computed) {
+    strcpy(text, entry->text);
+    fresh = timespec_equal(&entry->head_mtime, &key.head_mtime) &&
+            timespec_equal(&entry->index_mtime, &key.index_mtime) &&
+            timespec_equal(&entry->command_start, &key.command_start);
+  }
+  if (!fresh && request && async_prompt_enabled &&
+      (worker_started || start_worker() == 0)) {
+    char* copy = strdup(cwd);
+    if (copy != NULL) {
+      free(request_cwd);
+      request_cwd = copy;
+      request_key = key;
+      pthread_cond_signal(&request_ready);
+      redraw_pending = isatty(STDIN_FILENO);
+      pthread_mutex_unlock(&prompt_lock);
+      return;
+    }
+  }
+  pthread_mutex_unlock(&prompt_lock);
+
+  if (!fresh && request) {
+    compute_git(&key, text);
+    pthread_mutex_lock(&prompt_lock);
+    store_git(cwd, &key, text);
+    git_changed = 0;
+    pthread_mutex_unlock(&prompt_lock);
+  }
+}
+
+#pragma region Segments
+
+// The working directory, in blue.
+static int segment_cwd(const char* cwd, int separate, int request) {
+  if (cwd == NULL) {
+    return 0;
+  }
+  format_output("%s\033[0;34m%s\033[0m", separate ? " " : "", cwd);
+  return 1;
+}
+
+// The branch and whether the work tree has changes, in magenta.
+static int segment_git(const char* cwd, int separate, int request) {
+  char text[PROMPT_SEGMENT_MAX];
+
+  if (cwd == NULL) {
+    return 0;
+  }
+  lookup_git(cwd, text, request);
+  if (text[0] == '\0') {
+    return 0;
+  }
+  format_output("%s\033[0;35m(%s)\033[0m", separate ? " " : "", text);
+  return 1;
+}
+
+// The number of background jobs still running.
+static int segment_jobs(const char* cwd, int separate, int request) {
+  remove_dead_processes();
+  if (bg_processes->num_processes == 0) {
+    return 0;
+  }
+  format_output("%sjobs:%zu", separate ? " " : "",
+                bg_processes->num_processes);
+  return 1;
+}
+
+// The 1-minute load average.
+static int segment_load(const char* cwd, int separate, int request) {
+  char buffer[64];
+  int fd = open(LOADAVG_PATH, O_RDONLY | O_CLOEXEC);
+
+  if (fd == -1) {
+    return 0;
+  }
+  ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+  close(fd);
+  if (length <= 0) {
+    return 0;
+  }
+  buffer[length] = '\0';
+  buffer[strcspn(buffer, " ")] = '\0';
+  format_output("%sload:%s", separate ? " " : "", buffer);
+  return 1;
+}
+
+// The last exit status, in red, when it is not 0.
+static int segment_status(const char* cwd, int separate, int request) {
+  if (last_exit_status == 0) {
+    return 0;
+  }
+  format_output("%s\033[0;31m[%d]\033[0m", separate ? " " : "",
+                last_exit_status);
+  return 1;
+}
+
+#pragma endregion Segments
+
+// Table of prompt segments.
+static const struct prompt_segment_t prompt_segments[] = {
+    {"cwd", segment_cwd},       {"git", segment_git},
+    {"jobs", segment_jobs},     {"load", segment_load},
+    {"status", segment_status},
+};
+
+// Appends the segments and the shell prompt. Unknown segment names are
+// skipped.
+static void append_prompt(int request) {
+  const char* names = get_variable(PROMPT_SEGMENTS_VAR,
+                                   strlen(PROMPT_SEGMENTS_VAR));
+  size_t num_segments = sizeof(prompt_segments) / sizeof(prompt_segments[0]);
+  char buffer[PATH_MAX];
+  char* cwd = buffer;
+  int separate = 0;
+
+  // Only paths longer than PATH_MAX need an allocation.
+  if (getcwd(buffer, sizeof(buffer)) == NULL &&
+      (errno != ERANGE || (cwd = getcwd(NULL, 0)) == NULL)) {
+    if (request) {
+      perror("getcwd error in draw_prompt()");
+    }
+    cwd = NULL;
+  }
+
+  for (names = names ? names : PROMPT_DEFAULT_SEGMENTS; *names != '\0';) {
+    size_t length = strcspn(names, " \t");
+    for (size_t i = 0; i < num_segments && length > 0; i++) {
+      if (strlen(prompt_segments[i].name) == length &&
+          strncmp(prompt_segments[i].name, names, length) == 0) {
+        separate |= prompt_segments[i].append(cwd, separate, request);
+        break;
+      }
+    }
+    names += length + (names[length] != '\0');
+  }
+  format_output("%s ", shell_prompt);
+
+  if (cwd != buffer) {
+    free(cwd);
+  }
+}
+
+void clear_prompt(void) {
+  int busy;
+
+  if (!worker_started) {
+    return;
+  }
+  pthread_mutex_lock(&prompt_lock);
+  stop_worker = 1;
+  busy = worker_busy;
+  pthread_cond_signal(&request_ready);
+  pthread_mutex_unlock(&prompt_lock);
+
+  // A worker waiting on git is not waited for; it ends with the shell.
+  if (busy) {
+    return;
+  }
+  pthread_join(worker_thread, NULL);
+  worker_started = 0;
+  for (size_t i = 0; i < PROMPT_CACHE_SIZE; i++) {
+    free(git_cache[i].cwd);
+    git_cache[i].cwd = NULL;
+  }
+  free(request_cwd);
+  request_cwd = NULL;
+  close(notify_fds[0]);
+  close(notify_fds[1]);
+  notify_fds[0] = notify_fds[1] = -1;
+}
+
+void draw_prompt(void) {
+  redraw_pending = 0;
+  append_prompt(1);
+}
+
+void wait_for_prompt_input(void) {
+  char drain[64];
+
+  // On a terminal, a line is read only once it is complete, so stdin's
+  // buffer is empty and polling the descriptor shows whether input is
+  // waiting.
+  while (redraw_pending) {
+    struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0},
+                            {notify_fds[0], POLLIN, 0}};
+    if (poll(fds, 2, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (fds[0].revents != 0) {
+      // Input is ready; the prompt stays as it is.
+      break;
+    }
+    while (read(notify_fds[0], drain, sizeof(drain)) > 0) {
+    }
+
+    pthread_mutex_lock(&prompt_lock);
+    int changed = git_changed;
+    git_changed = 0;
+    int done = (request_cwd == NULL && !worker_busy);
+    pthread_mutex_unlock(&prompt_lock);
+
+    if (changed) {
+      append_output_string(REDRAW_LINE);
+      append_prompt(0);
+      flush_output();
+    }
+    if (done) {
+      break;
+    }
+  }
+  redraw_pending = 0;
+}
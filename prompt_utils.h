@@ -0,0 +1,55 @@
+#ifndef PROMPT_UTILS_H
+#define PROMPT_UTILS_H
+
+#define PROMPT_CACHE_SIZE 16
+#define PROMPT_DEFAULT_SEGMENTS "cwd"
+#define PROMPT_SEGMENT_MAX 256
+#define PROMPT_SEGMENTS_VAR "PROMPT_SEGMENTS"
+#define PROMPT_SYNC_ENV "SHELL_SYNC_PROMPT"
+
+// Whether slow prompt segments are computed on a background thread. Set by
+// the async_prompt option, and cleared at startup by SHELL_SYNC_PROMPT.
+extern int async_prompt_enabled;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// void clear_prompt()
+// Description: Stops the prompt worker thread and frees the segment cache.
+// Preconditions: None.
+// Postconditions: An idle worker has exited and the cache is freed. A worker
+// still computing a segment is left to end with the process.
+// Return: None.
+extern void clear_prompt(void);
+
+// void draw_prompt()
+// Description: Appends the prompt to the standard output buffer. It is made
+// of the segments named in PROMPT_SEGMENTS, separated by spaces and followed
+// by the shell prompt: cwd (the working directory), git (branch, with "*"
+// when the work tree has changes), status (the last exit status, when it is
+// not 0), jobs (the number of background jobs, when there are any) and load
+// (the 1-minute load average). The git segment is computed on a background
+// thread and cached by working directory and the modification times of the
+// repository's HEAD and index; the prompt is drawn at once with the cached,
+// possibly stale, value.
+// Preconditions: shell_prompt is set.
+// Postconditions: The prompt is buffered. Segments still being computed are
+// noted for wait_for_prompt_input().
+// Return: None.
+extern void draw_prompt(void);
+
+// void wait_for_prompt_input()
+// Description: Waits for input on a terminal while segments of the last
+// prompt are being computed, and redraws the prompt in place as each result
+// arrives.
+// Preconditions: Output is flushed.
+// Postconditions: No segments are pending, or standard input is readable.
+// Return: None.
+extern void wait_for_prompt_input(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PROMPT_UTILS_H
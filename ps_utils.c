@@ -0,0 +1,510 @@
+// File:    ps_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains functions for listing processes from /proc.
+//          The process ids are read from the directory with getdents64()
+//          in large batches, and the per-process files are read by a pool of
+//          threads that claim chunks of them from a shared counter. Each
+//          scan is kept so the next one can report CPU usage over the time
+//          in between.
+
+#define _GNU_SOURCE
+
+#include "ps_utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bg_utils.h"
+#include "output_utils.h"
+
+#define DIRENT_BUFFER_SIZE 32768
+#define PROC_PATH "/proc"
+#define STAT_BUFFER_SIZE 1024
+
+// Struct holding what is listed about one process.
+//   pid:         The process id.
+//   ppid:        The parent's process id.
+//   uid:         The effective user id, which owns its /proc files.
+//   state:       The state letter from stat, e.g. R or S.
+//   is_job:      Whether it is in the shell's job table.
+//   cpu_ticks:   User and system time, in clock ticks.
+//   start_ticks: When it started after boot, in clock ticks.
+//   rss_pages:   Resident set size, in pages.
+//   cpu_percent: CPU usage since the previous scan or since it started.
+//   command:     The command line, or the name in brackets for kernel
+//                threads.
+struct ps_process_t {
+    pid_t pid;
+    pid_t ppid;
+    uid_t uid;
+    char state;
+    char is_job;
+    unsigned long long cpu_ticks;
+    unsigned long long start_ticks;
+    long rss_pages;
+    double cpu_percent;
+    char command[PS_COMMAND_MAX];
+};
+
+// Struct holding one scan shared by its threads.
+//   proc_fd:   The open /proc directory.
+//   pids:      The process ids to read.
+//   processes: One entry per process id. Processes that exited before they
+//              were read are left with pid 0.
+//   count:     The number of process ids.
+//   next:      The index of the next unclaimed chunk.
+struct ps_scan_t {
+    int proc_fd;
+    const pid_t* pids;
+    struct ps_process_t* processes;
+    size_t count;
+    size_t next;
+};
+
+// The previous scan, sorted by process id.
+static struct ps_process_t* previous_processes = NULL;
+static size_t previous_count = 0;
+static double previous_seconds = 0;
+
+static double boot_seconds(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_BOOTTIME, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static int compare_pids(const void* a, const void* b) {
+  pid_t left = ((const struct ps_process_t*)a)->pid;
+  pid_t right = ((const struct ps_process_t*)b)->pid;
+  return (left > right) - (left < right);
+}
+
+static int compare_cpu(const void* a, const void* b) {
+  const struct ps_process_t* left = *(const struct ps_process_t* const*)a;
+  const struct ps_process_t* right = *(const struct ps_process_t* const*)b;
+  if (left->cpu_percent != right->cpu_percent) {
+    return (left->cpu_percent < right->cpu_percent) ? 1 : -1;
+  }
+  return (left->pid > right->pid) - (left->pid < right->pid);
+}
+
+static int compare_memory(const void* a, const void* b) {
+  const struct ps_process_t* left = *(const struct ps_process_t* const*)a;
+  const struct ps_process_t* right = *(const struct ps_process_t* const*)b;
+  if (left->rss_pages != right->rss_pages) {
+    return (left->rss_pages < right->rss_pages) ? 1 : -1;
+  }
+  return (left->pid > right->pid) - (left->pid < right->pid);
+}
+
+// Finds a process in an array sorted by process id. Returns NULL if it is not
+// there.
+static struct ps_process_t* find_process(struct ps_process_t* processes,
+                                         size_t count, pid_t pid) {
+  struct ps_process_t key;
+
+  if (count == 0) {
+    return NULL;
+  }
+  key.pid = pid;
+  return bsearch(&key, processes, count, sizeof(*processes), compare_pids);
+}
+
+// Reads the process ids in /proc. Returns the number read, or -1 on failure.
+static ssize_t read_pids(int proc_fd, pid_t** pids) {
+  char buffer[DIRENT_BUFFER_SIZE];
+  size_t count = 0, capacity = 1024;
+  long length;
+
+  if ((*pids = malloc(capacity * sizeof(pid_t))) == NULL) {
+    perror("pids malloc error in read_pids()");
+    return PS_FAILURE;
+  }
+  while ((length = syscall(SYS_getdents64, proc_fd, buffer,
+                           sizeof(buffer))) > 0) {
+    for (long offset = 0; offset < length;) {
+      // struct linux_dirent64: inode, offset, record length, type, name.
+      unsigned short record_length;
+      memcpy(&record_length, buffer + offset + 16, sizeof(record_length));
+      const char* name = buffer + offset + 19;
+      offset += record_length;
+      if (name[0] < '1' || name[0] > '9') {
+        continue;
+      }
+      char* end;
+      long pid = strtol(name, &end, 10);
+      if (*end != '\0') {
+        continue;
+      }
+      if (count == capacity) {
+        pid_t* grown = realloc(*pids, capacity * 2 * sizeof(pid_t));
+        if (grown == NULL) {
+          perror("pids realloc error in read_pids()");
+          free(*pids);
+          return PS_FAILURE;
+        }
+        *pids = grown;
+        capacity *= 2;
+      }
+      (*pids)[count++] = (pid_t)pid;
+    }
+  }
+  if (length == -1) {
+    perror("getdents64 error in read_pids()");
+    free(*pids);
+    return PS_FAILURE;
+  }
+  return (ssize_t)count;
+}
+
+// Reads a file relative to /proc into a buffer. Returns the number of bytes
+// read, or -1 if it could not be opened. The owner is stored if requested.
+static ssize_t read_proc_file(int proc_fd, const char* path, char* buffer,
+                              size_t size, uid_t* uid) {
+  int fd = openat(proc_fd, path, O_RDONLY | O_CLOEXEC);
+  struct stat info;
+
+  if (fd == -1) {
+    return -1;
+  }
+  if (uid != NULL) {
+    *uid = (fstat(fd, &info) == 0) ? info.st_uid : (uid_t)-1;
+  }
+  ssize_t length = read(fd, buffer, size);
+  close(fd);
+  return length;
+}
+
+// Reads one process's stat and cmdline. Leaves its pid 0 if it has exited.
+static void read_process(int proc_fd, pid_t pid,
+                         struct ps_process_t* process) {
+  char buffer[STAT_BUFFER_SIZE];
+  char path[32];
+  unsigned long long user_ticks, system_ticks;
+
+  process->pid = 0;
+  snprintf(path, sizeof(path), "%d/stat", pid);
+  ssize_t length =
+      read_proc_file(proc_fd, path, buffer, sizeof(buffer) - 1, &process->uid);
+  if (length <= 0) {
+    return;
+  }
+  buffer[length] = '\0';
+
+  // The name may hold spaces and parentheses, so the fields after it are
+  // found from the last ')'.
+  char* name = strchr(buffer, '(');
+  char* name_end = strrchr(buffer, ')');
+  if (name == NULL || name_end == NULL || name_end < name ||
+      name_end[1] == '\0') {
+    return;
+  }
+  *name_end = '\0';
+  if (sscanf(name_end + 2,
+             "%c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu %*d %*d "
+             "%*d %*d %*d %*d %llu %*u %ld",
+             &process->state, &process->ppid, &user_ticks, &system_ticks,
+             &process->start_ticks, &process->rss_pages) != 6) {
+    return;
+  }
+  process->cpu_ticks = user_ticks + system_ticks;
+  process->is_job = 0;
+  process->cpu_percent = 0;
+
+  // Arguments are separated by NULs. Kernel threads have none.
+  snprintf(path, sizeof(path), "%d/cmdline", pid);
+  length = read_proc_file(proc_fd, path, process->command,
+                          PS_COMMAND_MAX - 1, NULL);
+  while (length > 0 && process->command[length - 1] == '\0') {
+    length--;
+  }
+  if (length > 0) {
+    for (ssize_t i = 0; i < length; i++) {
+      if (process->command[i] == '\0' || process->command[i] == '\n') {
+        process->command[i] = ' ';
+      }
+    }
+    process->command[length] = '\0';
+  } else {
+    snprintf(process->command, PS_COMMAND_MAX, "[%s]", name + 1);
+  }
+  process->pid = pid;
+}
+
+// Reads chunks of processes until none are left.
+static void* scan_worker(void* arg) {
+  struct ps_scan_t* scan = arg;
+  size_t start;
+
+  while ((start = __atomic_fetch_add(&scan->next, PS_CHUNK_SIZE,
+                                     __ATOMIC_RELAXED)) < scan->count) {
+    size_t end = start + PS_CHUNK_SIZE;
+    if (end > scan->count) {
+      end = scan->count;
+    }
+    for (size_t i = start; i < end; i++) {
+      read_process(scan->proc_fd, scan->pids[i], &scan->processes[i]);
+    }
+  }
+  return NULL;
+}
+
+// Returns how many threads to scan a number of processes with.
+static int scan_threads(const struct ps_options_t* options, size_t count) {
+  long threads = options->threads;
+
+  if (threads <= 0) {
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if (threads > PS_MAX_THREADS) {
+    threads = PS_MAX_THREADS;
+  }
+  // Starting a thread costs more than reading a few processes.
+  if ((size_t)threads > count / PS_MIN_PIDS_PER_THREAD) {
+    threads = count / PS_MIN_PIDS_PER_THREAD;
+  }
+  return (threads < 1) ? 1 : (int)threads;
+}
+
+// Reads every process into an array sorted by process id. Returns the number
+// of processes, or -1 on failure.
+static ssize_t scan_processes(const struct ps_options_t* options,
+                              struct ps_process_t** processes) {
+  struct ps_scan_t scan = {-1, NULL, NULL, 0, 0};
+  pthread_t threads[PS_MAX_THREADS];
+  pid_t* pids;
+  sigset_t all_signals, old_signals;
+  int started = 0;
+
+  if ((scan.proc_fd = open(PROC_PATH, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) ==
+      -1) {
+    perror("open error in scan_processes()");
+    return PS_FAILURE;
+  }
+  ssize_t count = read_pids(scan.proc_fd, &pids);
+  if (count == PS_FAILURE) {
+    close(scan.proc_fd);
+    return PS_FAILURE;
+  }
+  if ((scan.processes = malloc((count + 1) * sizeof(struct ps_process_t))) ==
+      NULL) {
+    perror("processes malloc error in scan_processes()");
+    free(pids);
+    close(scan.proc_fd);
+    return PS_FAILURE;
+  }
+  scan.pids = pids;
+  scan.count = count;
+
+  // Signals are handled by the main thread, which reads chunks too.
+  sigfillset(&all_signals);
+  pthread_sigmask(SIG_SETMASK, &all_signals, &old_signals);
+  for (int i = 1; i < scan_threads(options, count); i++) {
+    if (pthread_create(&threads[started], NULL, scan_worker, &scan) != 0) {
+      break;
+    }
+    started++;
+  }
+  pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+  scan_worker(&scan);
+  for (int i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  free(pids);
+  close(scan.proc_fd);
+
+  // Drop processes that exited while the scan ran.
+  size_t kept = 0;
+  for (size_t i = 0; i < scan.count; i++) {
+    if (scan.processes[i].pid != 0) {
+      if (kept != i) {
+        scan.processes[kept] = scan.processes[i];
+      }
+      kept++;
+    }
+  }
+  qsort(scan.processes, kept, sizeof(struct ps_process_t), compare_pids);
+  *processes = scan.processes;
+  return (ssize_t)kept;
+}
+
+// Sets each process's CPU usage since the previous scan, or since it started
+// if it was not in it, and marks the shell's jobs.
+static void measure_processes(struct ps_process_t* processes, size_t count,
+                              double seconds) {
+  double ticks_per_second = sysconf(_SC_CLK_TCK);
+
+  for (size_t i = 0; i < count; i++) {
+    struct ps_process_t* process = &processes[i];
+    struct ps_process_t* previous =
+        find_process(previous_processes, previous_count, process->pid);
+    double ticks = process->cpu_ticks;
+    double elapsed = seconds - process->start_ticks / ticks_per_second;
+
+    // A reused process id has a different start time.
+    if (previous != NULL && previous->start_ticks == process->start_ticks &&
+        previous->cpu_ticks <= process->cpu_ticks) {
+      ticks -= previous->cpu_ticks;
+      elapsed = seconds - previous_seconds;
+    }
+    if (elapsed > 0) {
+      process->cpu_percent = 100.0 * ticks / ticks_per_second / elapsed;
+    }
+  }
+  for (size_t i = 0; i < bg_processes->num_processes; i++) {
+    struct ps_process_t* job =
+        find_process(processes, count, bg_processes->process_ids[i]);
+    if (job != NULL) {
+      job->is_job = 1;
+    }
+  }
+}
+
+// Scans the processes and lists them in the requested order, keeping the scan
+// for the next one. Returns the number of processes, or -1 on failure.
+static ssize_t list_processes(const struct ps_options_t* options) {
+  struct ps_process_t* processes;
+  long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+  long ticks_per_second = sysconf(_SC_CLK_TCK);
+
+  ssize_t count = scan_processes(options, &processes);
+  if (count == PS_FAILURE) {
+    return PS_FAILURE;
+  }
+  double seconds = boot_seconds();
+  measure_processes(processes, count, seconds);
+
+  // The scan stays sorted by process id, so other orders sort pointers.
+  struct ps_process_t** order = malloc((count + 1) * sizeof(*order));
+  if (order == NULL) {
+    perror("order malloc error in list_processes()");
+    free(processes);
+    return PS_FAILURE;
+  }
+  for (ssize_t i = 0; i < count; i++) {
+    order[i] = &processes[i];
+  }
+  if (options->sort == PS_SORT_CPU) {
+    qsort(order, count, sizeof(*order), compare_cpu);
+  } else if (options->sort == PS_SORT_MEM) {
+    qsort(order, count, sizeof(*order), compare_memory);
+  }
+
+  size_t shown = count;
+  if (options->limit > 0 && options->limit < shown) {
+    shown = options->limit;
+  }
+  append_output_string("   PID  PPID   UID S  %CPU    RSS     TIME COMMAND\n");
+  for (size_t i = 0; i < shown; i++) {
+    const struct ps_process_t* process = order[i];
+    unsigned long long cpu_seconds = process->cpu_ticks / ticks_per_second;
+    format_output("%c%5d %5d %5u %c %5.1f %6ld %5llu:%02llu %s\n",
+                  process->is_job ? '*' : ' ', process->pid, process->ppid,
+                  (unsigned)process->uid, process->state,
+                  process->cpu_percent, process->rss_pages * page_kb,
+                  cpu_seconds / 60, cpu_seconds % 60, process->command);
+  }
+  free(order);
+
+  free(previous_processes);
+  previous_processes = processes;
+  previous_count = count;
+  previous_seconds = seconds;
+  return count;
+}
+
+// Returns how many processes fit on the terminal below the header, or
+// TOP_DEFAULT_ROWS if the output is not a terminal.
+static size_t terminal_rows(void) {
+  struct winsize size;
+
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == -1 || size.ws_row < 4) {
+    return TOP_DEFAULT_ROWS;
+  }
+  return size.ws_row - 3;
+}
+
+// Waits for the delay. Returns 1 if it ran out, or 0 if a line was entered or
+// the wait failed. Signals, e.g. SIGCHLD from a finished job, only cut the
+// wait short, so it goes on for the time left. Input that is not a terminal is
+// the rest of a script, so it is left alone.
+static int wait_for_delay(double delay) {
+  struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+  struct timespec now;
+  char buffer[256];
+
+  if (!isatty(STDIN_FILENO)) {
+    struct timespec duration = {(time_t)delay,
+                                (long)((delay - (time_t)delay) * 1e9)};
+    while (nanosleep(&duration, &duration) == -1) {
+      if (errno != EINTR) {
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  double deadline = now.tv_sec + now.tv_nsec / 1e9 + delay;
+  int ready;
+  while ((ready = poll(&input, 1, (int)(delay * 1000))) == -1 &&
+         errno == EINTR) {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((delay = deadline - (now.tv_sec + now.tv_nsec / 1e9)) <= 0) {
+      return 1;
+    }
+  }
+  if (ready == 0) {
+    return 1;
+  }
+  if (ready == 1) {
+    // Consume the line so the shell does not run it.
+    ssize_t length;
+    while ((length = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0 &&
+           buffer[length - 1] != '\n') {
+    }
+  }
+  return 0;
+}
+
+void clear_ps(void) {
+  free(previous_processes);
+  previous_processes = NULL;
+  previous_count = 0;
+}
+
+int ps_command(const struct ps_options_t* options) {
+  return (list_processes(options) == PS_FAILURE) ? PS_FAILURE : 0;
+}
+
+int top_command(const struct ps_options_t* options, double delay,
+                long iterations) {
+  struct ps_options_t top_options = *options;
+
+  for (long i = 0; iterations == 0 || i < iterations; i++) {
+    if (i > 0 && !wait_for_delay(delay)) {
+      break;
+    }
+    top_options.limit = options->limit ? options->limit : terminal_rows();
+    append_output_string("\033[H\033[2J");
+    format_output("top - every %.1fs, enter a line to stop\n", delay);
+    if (list_processes(&top_options) == PS_FAILURE) {
+      return PS_FAILURE;
+    }
+    if (flush_output() == OUTPUT_FAILURE) {
+      return PS_FAILURE;
+    }
+  }
+  return 0;
+}
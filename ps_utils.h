@@ -0,0 +1,68 @@
+#ifndef PS_UTILS_H
+#define PS_UTILS_H
+
+#define PS_CHUNK_SIZE 64
+#define PS_COMMAND_MAX 256
+#define PS_FAILURE -1
+#define PS_MAX_THREADS 8
+#define PS_MIN_PIDS_PER_THREAD 256
+#define TOP_DEFAULT_DELAY 2.0
+#define TOP_DEFAULT_ROWS 20
+
+#include <stddef.h>
+
+// Orders in which processes are listed.
+enum ps_sort_t {
+    PS_SORT_PID,
+    PS_SORT_CPU,
+    PS_SORT_MEM
+};
+
+// Struct holding the options of the ps and top builtins.
+//   sort:    The order of the listing.
+//   threads: The most threads to scan /proc with, or 0 for one per online
+//            CPU, up to PS_MAX_THREADS.
+//   limit:   The most processes to list, or 0 for all of them.
+struct ps_options_t {
+    enum ps_sort_t sort;
+    int threads;
+    size_t limit;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// void clear_ps()
+// Description: Frees the snapshot kept for the next CPU usage delta.
+// Preconditions: None.
+// Postconditions: The next scan reports CPU usage since each process started.
+// Return: None.
+extern void clear_ps(void);
+
+// int ps_command(const struct ps_options_t*)
+// Description: Lists every process. /proc is enumerated with getdents64()
+// and each process's stat and cmdline are read by a pool of threads. CPU
+// usage is measured since the previous scan of a process by ps or top, or
+// since it started. Processes in the shell's job table are marked with "*".
+// Preconditions: Non-null options are provided.
+// Postconditions: The listing is appended to the standard output buffer and
+// the snapshot is kept for the next delta.
+// Return: 0 on success, -1 on failure.
+extern int ps_command(const struct ps_options_t*);
+
+// int top_command(const struct ps_options_t*, double, long)
+// Description: Redraws the first processes in the given order, scanned like
+// ps_command(), every given number of seconds. Lists as many as fit on the
+// terminal unless the options limit them. Stops after the given number
+// of iterations, or when a line is entered if it is 0.
+// Preconditions: Non-null options and a positive delay are provided.
+// Postconditions: Each iteration clears the screen and writes the listing.
+// Return: 0 on success, -1 on failure.
+extern int top_command(const struct ps_options_t*, double, long);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PS_UTILS_H
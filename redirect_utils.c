@@ -0,0 +1,242 @@
+// File:    redirect_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains functions for applying and undoing the
+//          input and output redirections of a command. Here-documents and
+//          here-strings are read from a pipe when they fit in its buffer and
+//          from an in-memory file otherwise, so no temporary file is made.
+
+#define _GNU_SOURCE
+
+#include "redirect_utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "expand_utils.h"
+#include "output_utils.h"
+
+// The number of redirections in effect of standard input, output and error,
+// and of the descriptors above them.
+static int num_standard_redirects[3] = {0, 0, 0};
+static int num_high_redirects = 0;
+
+// Writes all of a buffer to a descriptor. Returns 0 on success, -1 on
+// failure.
+static int write_all(int fd, const char* text, size_t length) {
+  while (length > 0) {
+    ssize_t written = write(fd, text, length);
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    text += written;
+    length -= written;
+  }
+  return 0;
+}
+
+// Returns a descriptor reading the given text, followed by a newline if
+// asked. Small texts are written to a pipe, which cannot block since they fit
+// in its buffer, and larger ones to a memfd. Returns -1 on failure.
+static int open_text(const char* text, size_t length, int add_newline) {
+  size_t total = length + (add_newline ? 1 : 0);
+  int fd;
+
+  if (total <= PIPE_BUF) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) == -1) {
+      perror("pipe2 error in open_text()");
+      return REDIRECT_FAILURE;
+    }
+    if (write_all(fds[1], text, length) == -1 ||
+        (add_newline && write_all(fds[1], "\n", 1) == -1)) {
+      perror("write error in open_text()");
+      close(fds[0]);
+      close(fds[1]);
+      return REDIRECT_FAILURE;
+    }
+    close(fds[1]);
+    return fds[0];
+  }
+
+  if ((fd = memfd_create("here-document", MFD_CLOEXEC)) == -1) {
+    perror("memfd_create error in open_text()");
+    return REDIRECT_FAILURE;
+  }
+  if (write_all(fd, text, length) == -1 ||
+      (add_newline && write_all(fd, "\n", 1) == -1) ||
+      lseek(fd, 0, SEEK_SET) == -1) {
+    perror("write error in open_text()");
+    close(fd);
+    return REDIRECT_FAILURE;
+  }
+  return fd;
+}
+
+// Opens the text of a here-document or here-string. Returns a new
+// descriptor, or -1 on failure.
+static int open_here_text(const struct redirect_t* redirect) {
+  int heredoc = (redirect->flags == REDIRECT_HEREDOC);
+  size_t length;
+  char* text;
+  int fd;
+
+  if (redirect->path != NULL) {
+    return open_text(redirect->path, strlen(redirect->path), !heredoc);
+  }
+  text = heredoc ? expand_here_document(redirect->word, &length)
+                 : expand_word(redirect->word);
+  if (text == NULL) {
+    return REDIRECT_FAILURE;
+  }
+  fd = open_text(text, heredoc ? length : strlen(text), !heredoc);
+  free(text);
+  return fd;
+}
+
+// Opens the target of a redirection. Returns a new descriptor, or -1 on
+// failure.
+static int open_target(const struct redirect_t* redirect) {
+  if (redirect->flags == REDIRECT_HEREDOC ||
+      redirect->flags == REDIRECT_HERESTRING) {
+    return open_here_text(redirect);
+  }
+
+  char* path = redirect->path ? strdup(redirect->path)
+                              : expand_word(redirect->word);
+  int fd;
+
+  if (path == NULL) {
+    return REDIRECT_FAILURE;
+  }
+
+  if (redirect->flags == REDIRECT_DUP) {
+    // Duplicate another descriptor, e.g. 2>&1.
+    char* end;
+    long target = strtol(path, &end, 10);
+    if (path[0] == '\0' || *end != '\0' || target < 0) {
+      fprintf(stderr, "shell error: %s: bad file descriptor\n", path);
+      free(path);
+      return REDIRECT_FAILURE;
+    }
+    if ((fd = fcntl((int)target, F_DUPFD_CLOEXEC, 0)) == -1) {
+      fprintf(stderr, "shell error: %s: %s\n", path, strerror(errno));
+    }
+  } else if ((fd = open(path, redirect->flags | O_CLOEXEC, 0644)) == -1) {
+    fprintf(stderr, "shell error: %s: %s\n", path, strerror(errno));
+  }
+  free(path);
+  return fd;
+}
+
+struct saved_fd_t* apply_redirects(const struct redirect_t* redirects,
+                                   size_t num_redirects) {
+  struct saved_fd_t* saved = malloc(num_redirects * sizeof(struct saved_fd_t));
+  if (saved == NULL) {
+    perror("malloc error in apply_redirects()");
+    return NULL;
+  }
+
+  // Buffered output belongs to the old descriptors.
+  flush_output();
+  for (size_t i = 0; i < num_redirects; i++) {
+    int fd = redirects[i].fd;
+
+    // Keep a copy above the descriptors scripts use. A descriptor that was
+    // closed is closed again afterwards.
+    saved[i].fd = fd;
+    if ((saved[i].copy = fcntl(fd, F_DUPFD_CLOEXEC, SAVED_FD_MIN)) == -1 &&
+        errno != EBADF) {
+      perror("fcntl error in apply_redirects()");
+      restore_redirects(saved, i);
+      return NULL;
+    }
+
+    // A target opened on the lowest free descriptor may already be the one
+    // redirected. dup2() then does nothing, so close-on-exec is cleared here
+    // instead, and the target is kept open.
+    int target = open_target(&redirects[i]);
+    int result = -1;
+    if (target == fd) {
+      result = fcntl(fd, F_SETFD, 0);
+    } else if (target != -1) {
+      result = dup2(target, fd);
+    }
+    if (result == -1) {
+      if (target != -1) {
+        perror((target == fd) ? "fcntl error in apply_redirects()"
+                              : "dup2 error in apply_redirects()");
+        if (target != fd) {
+          close(target);
+        }
+      }
+      if (saved[i].copy != -1) {
+        close(saved[i].copy);
+      }
+      restore_redirects(saved, i);
+      return NULL;
+    }
+    if (target != fd) {
+      close(target);
+    }
+    if (fd <= STDERR_FILENO) {
+      num_standard_redirects[fd]++;
+    } else {
+      num_high_redirects++;
+    }
+  }
+  return saved;
+}
+
+int high_fds_redirected(void) {
+  return num_high_redirects > 0;
+}
+
+int input_redirected(void) {
+  return num_standard_redirects[STDIN_FILENO] > 0;
+}
+
+int output_redirected(int fd) {
+  return fd >= STDOUT_FILENO && fd <= STDERR_FILENO &&
+         num_standard_redirects[fd] > 0;
+}
+
+void free_redirects(struct redirect_t* redirects, size_t num_redirects) {
+  for (size_t i = 0; redirects != NULL && i < num_redirects; i++) {
+    free(redirects[i].word);
+    free(redirects[i].path);
+  }
+  free(redirects);
+}
+
+void restore_redirects(struct saved_fd_t* saved, size_t num_saved) {
+  flush_output();
+
+  // Undo in reverse order, so a descriptor redirected twice ends up as it was
+  // before the first redirection.
+  for (size_t i = num_saved; i > 0; i--) {
+    if (saved[i - 1].fd <= STDERR_FILENO) {
+      num_standard_redirects[saved[i - 1].fd]--;
+    } else {
+      num_high_redirects--;
+    }
+    if (saved[i - 1].copy == -1) {
+      close(saved[i - 1].fd);
+      continue;
+    }
+    if (dup2(saved[i - 1].copy, saved[i - 1].fd) == -1) {
+      perror("dup2 error in restore_redirects()");
+    }
+    close(saved[i - 1].copy);
+  }
+  free(saved);
+}
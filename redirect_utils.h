@@ -0,0 +1,91 @@
+#ifndef REDIRECT_UTILS_H
+#define REDIRECT_UTILS_H
+
+#define REDIRECT_DUP -1
+#define REDIRECT_FAILURE -1
+#define REDIRECT_HEREDOC -2
+#define REDIRECT_HERESTRING -3
+#define SAVED_FD_MIN 10
+
+#include <stddef.h>
+
+// Struct holding one redirection of a command, e.g. "2>>log" or "2>&1".
+//   fd:    The descriptor being redirected.
+//   flags: The open() flags for the target, REDIRECT_DUP to duplicate
+//          another descriptor, or REDIRECT_HEREDOC or REDIRECT_HERESTRING to
+//          read the target text itself.
+//   word:  The raw target word, or here-document body.
+//   path:  The target with escapes resolved, or NULL if the word needs
+//          expansion each time the command runs.
+struct redirect_t {
+    int fd;
+    int flags;
+    char* word;
+    char* path;
+};
+
+// Struct holding a descriptor saved while a redirection is in effect.
+struct saved_fd_t {
+    int fd;
+    int copy;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// struct saved_fd_t* apply_redirects(const struct redirect_t*, size_t)
+// Description: Applies redirections to the shell itself, so builtins honor
+// them and external commands inherit them.
+// Preconditions: A non-null array of redirections and its length are provided.
+// Postconditions: The redirected descriptors point at their targets. On
+// failure, nothing is redirected.
+// Return: The saved descriptors to pass to restore_redirects(), or NULL on
+// failure.
+extern struct saved_fd_t* apply_redirects(const struct redirect_t*, size_t);
+
+// int high_fds_redirected()
+// Description: Checks whether a descriptor above standard error is redirected
+// by the command running, e.g. "cmd 3>log".
+// Preconditions: None.
+// Postconditions: None.
+// Return: 1 if such a descriptor is redirected, 0 otherwise.
+extern int high_fds_redirected(void);
+
+// int input_redirected()
+// Description: Checks whether standard input is redirected by a command
+// running in the shell itself, such as "read line <<< text", so stdin's
+// buffer no longer matches the descriptor.
+// Preconditions: None.
+// Postconditions: None.
+// Return: 1 if standard input is redirected, 0 otherwise.
+extern int input_redirected(void);
+
+// int output_redirected(int)
+// Description: Checks whether standard output or standard error is
+// redirected by the command running, e.g. "cmd >log &".
+// Preconditions: None.
+// Postconditions: None.
+// Return: 1 if the descriptor is 1 or 2 and redirected, 0 otherwise.
+extern int output_redirected(int);
+
+// void free_redirects(struct redirect_t*, size_t)
+// Description: Frees an array of redirections.
+// Preconditions: The argument is NULL or an array of the given length.
+// Postconditions: The array and its strings are freed.
+// Return: None.
+extern void free_redirects(struct redirect_t*, size_t);
+
+// void restore_redirects(struct saved_fd_t*, size_t)
+// Description: Undoes apply_redirects().
+// Preconditions: The saved descriptors returned by apply_redirects() for the
+// same number of redirections are provided.
+// Postconditions: The descriptors are restored and the saved array is freed.
+// Return: None.
+extern void restore_redirects(struct saved_fd_t*, size_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REDIRECT_UTILS_H
@@ -0,0 +1,250 @@
+// File:    sched_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains functions for scheduling jobs: CPU affinity,
+//          nice value, scheduling policy and I/O priority, parsed in the
+//          shell and applied in the child between fork() and exec(), and
+//          the spreading of background jobs over the shell's CPUs.
+
+#define _GNU_SOURCE
+
+#include "sched_utils.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "bg_utils.h"
+
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_CLASS_RT 1
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_LEVEL_DEFAULT 4
+#define IOPRIO_LEVEL_MAX 7
+#define IOPRIO_WHO_PROCESS 1
+#define NICE_MAX 19
+#define NICE_MIN -20
+
+// Global variables.
+const struct job_sched_t* job_sched = NULL;
+int spread_jobs_enabled = 0;
+
+// The CPU the last background job was pinned to.
+static int last_spread_cpu = -1;
+
+// Parses a whole number within a range. Returns 0 on success, -1 on failure.
+static int parse_number(const char* text, long minimum, long maximum,
+                        long* value) {
+  char* end;
+
+  if (!isdigit((unsigned char)text[text[0] == '-'])) {
+    return SCHED_FAILURE;
+  }
+  *value = strtol(text, &end, 10);
+  return (*end != '\0' || *value < minimum || *value > maximum) ? SCHED_FAILURE
+                                                                : 0;
+}
+
+// Parses a CPU list such as "0-3,6" into a set. Returns 0 on success, -1 on
+// failure.
+static int parse_cpu_list(const char* text, cpu_set_t* cpus) {
+  CPU_ZERO(cpus);
+  while (*text != '\0') {
+    char* end;
+    if (!isdigit((unsigned char)*text)) {
+      return SCHED_FAILURE;
+    }
+    long first = strtol(text, &end, 10), last = first;
+    if (*end == '-') {
+      if (!isdigit((unsigned char)end[1])) {
+        return SCHED_FAILURE;
+      }
+      last = strtol(end + 1, &end, 10);
+    }
+    if (first > last || last >= CPU_SETSIZE || (*end != ',' && *end != '\0') ||
+        (*end == ',' && end[1] == '\0')) {
+      return SCHED_FAILURE;
+    }
+    for (long cpu = first; cpu <= last; cpu++) {
+      CPU_SET(cpu, cpus);
+    }
+    text = end + (*end == ',');
+  }
+  return CPU_COUNT(cpus) > 0 ? 0 : SCHED_FAILURE;
+}
+
+// Parses an I/O class and level such as "be:4" into an I/O priority. Returns
+// 0 on success, -1 on failure.
+static int parse_ioprio(const char* text, int* ioprio) {
+  const char* level = strchr(text, ':');
+  size_t length = level ? (size_t)(level - text) : strlen(text);
+  long number = IOPRIO_LEVEL_DEFAULT;
+  int io_class;
+
+  if (strcmp(text, "idle") == 0) {
+    *ioprio = IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT;
+    return 0;
+  }
+  if (length == 2 && strncmp(text, "be", 2) == 0) {
+    io_class = IOPRIO_CLASS_BE;
+  } else if (length == 2 && strncmp(text, "rt", 2) == 0) {
+    io_class = IOPRIO_CLASS_RT;
+  } else {
+    return SCHED_FAILURE;
+  }
+  if (level != NULL &&
+      parse_number(level + 1, 0, IOPRIO_LEVEL_MAX, &number) == SCHED_FAILURE) {
+    return SCHED_FAILURE;
+  }
+  *ioprio = (io_class << IOPRIO_CLASS_SHIFT) | (int)number;
+  return 0;
+}
+
+void apply_sched(const struct job_sched_t* sched) {
+  if (sched->has_cpus &&
+      sched_setaffinity(0, sizeof(cpu_set_t), &sched->cpus) == -1) {
+    perror("sched_setaffinity error in apply_sched()");
+  }
+  if (sched->policy != SCHED_UNCHANGED) {
+    struct sched_param param = {0};
+    if (sched_setscheduler(0, sched->policy, &param) == -1) {
+      perror("sched_setscheduler error in apply_sched()");
+    }
+  }
+  if (sched->nice != SCHED_NO_NICE &&
+      setpriority(PRIO_PROCESS, 0, sched->nice) == -1) {
+    perror("setpriority error in apply_sched()");
+  }
+  if (sched->ioprio != SCHED_UNCHANGED &&
+      syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, sched->ioprio) == -1) {
+    perror("ioprio_set error in apply_sched()");
+  }
+}
+
+const struct job_sched_t* background_sched(struct job_sched_t* storage,
+                                           int* cpu) {
+  cpu_set_t allowed;
+  int jobs_on[CPU_SETSIZE];
+
+  *cpu = -1;
+  if (!spread_jobs_enabled || (job_sched != NULL && job_sched->has_cpus) ||
+      sched_getaffinity(0, sizeof(allowed), &allowed) == -1) {
+    return job_sched;
+  }
+
+  // Count the running jobs pinned to each CPU.
+  memset(jobs_on, 0, sizeof(jobs_on));
+  remove_dead_processes();
+  for (size_t i = 0; bg_processes->process_ids != NULL &&
+                     i < bg_processes->capacity;
+       i++) {
+    int pinned = bg_processes->cpus[i];
+    if (bg_processes->process_ids[i] != DEAD_PROCESS_ID && pinned != -1) {
+      jobs_on[pinned]++;
+    }
+  }
+
+  // Take the least loaded CPU, starting after the last one chosen.
+  for (int i = 1; i <= CPU_SETSIZE; i++) {
+    int candidate = (last_spread_cpu + i) % CPU_SETSIZE;
+    if (CPU_ISSET(candidate, &allowed) &&
+        (*cpu == -1 || jobs_on[candidate] < jobs_on[*cpu])) {
+      *cpu = candidate;
+    }
+  }
+  if (*cpu == -1) {
+    return job_sched;
+  }
+  last_spread_cpu = *cpu;
+
+  if (job_sched != NULL) {
+    *storage = *job_sched;
+  } else {
+    storage->nice = SCHED_NO_NICE;
+    storage->policy = SCHED_UNCHANGED;
+    storage->ioprio = SCHED_UNCHANGED;
+  }
+  CPU_ZERO(&storage->cpus);
+  CPU_SET(*cpu, &storage->cpus);
+  storage->has_cpus = 1;
+  return storage;
+}
+
+int set_up_sched(char** parsed_cmd, struct job_sched_t* sched,
+                 char*** command) {
+  const char* cpu_list = NULL;
+  int i = 1;
+
+  CPU_ZERO(&sched->cpus);
+  sched->has_cpus = 0;
+  sched->nice = SCHED_NO_NICE;
+  sched->policy = SCHED_UNCHANGED;
+  sched->ioprio = SCHED_UNCHANGED;
+
+  // Options come in pairs before the command.
+  while (parsed_cmd[i] != NULL && parsed_cmd[i][0] == '-') {
+    const char* option = parsed_cmd[i];
+    const char* value = parsed_cmd[i + 1];
+    int result = SCHED_FAILURE;
+    long nice;
+
+    if (value != NULL && option[1] != '\0' && option[2] == '\0') {
+      switch (option[1]) {
+        case 'c':
+          result = parse_cpu_list(value, &sched->cpus);
+          sched->has_cpus = (result == 0);
+          cpu_list = value;
+          break;
+        case 'n':
+          result = parse_number(value, NICE_MIN, NICE_MAX, &nice);
+          sched->nice = (int)nice;
+          break;
+        case 'p':
+          result = 0;
+          if (strcmp(value, "other") == 0) {
+            sched->policy = SCHED_OTHER;
+          } else if (strcmp(value, "batch") == 0) {
+            sched->policy = SCHED_BATCH;
+          } else if (strcmp(value, "idle") == 0) {
+            sched->policy = SCHED_IDLE;
+          } else {
+            result = SCHED_FAILURE;
+          }
+          break;
+        case 'i':
+          result = parse_ioprio(value, &sched->ioprio);
+          break;
+      }
+    }
+    if (result == SCHED_FAILURE) {
+      fprintf(stderr, "sched: invalid option %s %s\n", option,
+              value ? value : "");
+      return SCHED_FAILURE;
+    }
+    i += 2;
+  }
+  if (parsed_cmd[i] == NULL) {
+    fprintf(stderr,
+            "Usage: sched [-c cpus] [-n nice] [-p other|batch|idle] "
+            "[-i idle|be:N|rt:N] command [args]\n");
+    return SCHED_FAILURE;
+  }
+  *command = parsed_cmd + i;
+
+  // A job may only run where the shell may, so at least one of its CPUs
+  // must be allowed.
+  cpu_set_t allowed;
+  if (sched->has_cpus && sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+    CPU_AND(&allowed, &allowed, &sched->cpus);
+    if (CPU_COUNT(&allowed) == 0) {
+      fprintf(stderr, "sched: none of CPUs %s are available\n", cpu_list);
+      return SCHED_FAILURE;
+    }
+  }
+  return 0;
+}
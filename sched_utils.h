@@ -0,0 +1,73 @@
+#ifndef SCHED_UTILS_H
+#define SCHED_UTILS_H
+
+#define SCHED_FAILURE -1
+#define SCHED_NO_NICE 100
+#define SCHED_UNCHANGED -1
+
+#include <sched.h>
+
+// Struct holding the scheduling applied to a job between fork() and exec().
+//   cpus:     The CPUs the job may run on, if has_cpus is set.
+//   has_cpus: Whether the job's CPU affinity is set.
+//   nice:     The job's nice value, or SCHED_NO_NICE.
+//   policy:   SCHED_OTHER, SCHED_BATCH or SCHED_IDLE, or SCHED_UNCHANGED.
+//   ioprio:   The job's I/O priority as passed to ioprio_set(), or
+//             SCHED_UNCHANGED.
+struct job_sched_t {
+    cpu_set_t cpus;
+    int has_cpus;
+    int nice;
+    int policy;
+    int ioprio;
+};
+
+// The scheduling for the next external command, or NULL for none.
+extern const struct job_sched_t* job_sched;
+
+// Whether background jobs are spread over the shell's CPUs.
+extern int spread_jobs_enabled;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// void apply_sched(const struct job_sched_t*)
+// Description: Sets the calling process's CPU affinity, nice value,
+// scheduling policy and I/O priority. Called in the child between fork() and
+// exec(), so it only makes system calls.
+// Preconditions: Scheduling from set_up_sched() or background_sched() is
+// provided.
+// Postconditions: The settings that could be applied are in effect. Failures
+// are reported on stderr.
+// Return: None.
+extern void apply_sched(const struct job_sched_t*);
+
+// const struct job_sched_t* background_sched(struct job_sched_t*, int*)
+// Description: Chooses the scheduling of a background job. With the
+// spread_jobs option on and no CPUs chosen with sched -c, the job is pinned
+// to the CPU the shell may run on that has the fewest running background
+// jobs pinned to it, taking tied CPUs in turn.
+// Preconditions: Storage for the scheduling and the CPU are provided.
+// Postconditions: The second argument holds the CPU the job is pinned to, or
+// -1.
+// Return: job_sched, or the first argument filled in, or NULL for none.
+extern const struct job_sched_t* background_sched(struct job_sched_t*, int*);
+
+// int set_up_sched(char**, struct job_sched_t*, char***)
+// Description: Parses the options of the sched builtin. -c sets the CPUs the
+// job may run on as a list such as "0-3,6", -n its nice value, -p its policy
+// (other, batch or idle) and -i its I/O class and level as "idle", "be:N" or
+// "rt:N", with N from 0 (highest) to 7.
+// Preconditions: A non-null sched command, scheduling and command pointer are
+// provided.
+// Postconditions: The scheduling is filled in and the third argument points
+// at the command after the options. Errors are reported on stderr.
+// Return: 0 on success, -1 on failure.
+extern int set_up_sched(char**, struct job_sched_t*, char***);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCHED_UTILS_H
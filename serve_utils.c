@@ -0,0 +1,273 @@
+// File:    serve_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains functions for serving shell sessions on a Unix
+//          domain socket. The server sets up once and forks a session for
+//          each client, so sessions start warm and keep their state apart.
+
+#define _GNU_SOURCE
+
+#include "serve_utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "output_utils.h"
+#include "redirect_utils.h"
+
+#define NUM_CLIENT_FDS 3
+#define RETRY_DELAY_NS 10000000
+
+// Global variables.
+int session_socket = -1;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_stop(int sig) { stop_requested = 1; }
+
+// Creates the listening socket. A socket left behind by a server that has
+// exited is replaced, but a live server is not. Returns the socket, or -1 on
+// failure.
+static int listen_on(const char* path) {
+  struct sockaddr_un address;
+  struct stat info;
+  int fd;
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    fprintf(stderr, "serve: socket path %s is too long\n", path);
+    return SERVE_FAILURE;
+  }
+  strcpy(address.sun_path, path);
+
+  if (lstat(path, &info) == 0) {
+    if (!S_ISSOCK(info.st_mode)) {
+      fprintf(stderr, "serve: %s exists and is not a socket\n", path);
+      return SERVE_FAILURE;
+    }
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int live = probe != -1 &&
+               connect(probe, (struct sockaddr*)&address, sizeof(address)) == 0;
+    if (probe != -1) {
+      close(probe);
+    }
+    if (live) {
+      fprintf(stderr, "serve: %s is already being served\n", path);
+      return SERVE_FAILURE;
+    }
+    unlink(path);
+  }
+
+  if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1) {
+    perror("socket error in listen_on()");
+    return SERVE_FAILURE;
+  }
+
+  // Only the user may connect, since a session runs anything it is sent.
+  mode_t mask = umask(0077);
+  int bound = bind(fd, (struct sockaddr*)&address, sizeof(address));
+  umask(mask);
+  if (bound == -1 || listen(fd, SOMAXCONN) == -1) {
+    fprintf(stderr, "serve: cannot listen on %s: %s\n", path, strerror(errno));
+    close(fd);
+    return SERVE_FAILURE;
+  }
+  return fd;
+}
+
+// Returns whether the peer of a connection runs as the same user as the
+// server.
+static int from_same_user(int connection) {
+  struct ucred credentials;
+  socklen_t length = sizeof(credentials);
+
+  return getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &credentials,
+                    &length) == 0 &&
+         credentials.uid == geteuid();
+}
+
+// Sets up the session of a new connection in its own process. The client's
+// descriptors, if it passed them, become the standard ones; otherwise output
+// goes to the socket. The socket becomes the shell's input. Returns 0 on
+// success, -1 if the client left or sent something unusable.
+static int start_session(int connection) {
+  union {
+    struct cmsghdr header;
+    char space[CMSG_SPACE(NUM_CLIENT_FDS * sizeof(int))];
+  } control;
+  char first_byte;
+  struct iovec data = {&first_byte, 1};
+  struct msghdr message;
+  int client_fds[NUM_CLIENT_FDS];
+  int num_fds = 0;
+  ssize_t received;
+
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  message.msg_control = control.space;
+  message.msg_controllen = sizeof(control.space);
+  while ((received = recvmsg(connection, &message, MSG_CMSG_CLOEXEC)) == -1 &&
+         errno == EINTR) {
+  }
+  if (received <= 0) {
+    return SERVE_FAILURE;
+  }
+
+  for (struct cmsghdr* header = CMSG_FIRSTHDR(&message); header != NULL;
+       header = CMSG_NXTHDR(&message, header)) {
+    if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) {
+      continue;
+    }
+    int count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    int* fds = (int*)CMSG_DATA(header);
+    for (int i = 0; i < count; i++) {
+      if (num_fds < NUM_CLIENT_FDS) {
+        client_fds[num_fds++] = fds[i];
+      } else {
+        close(fds[i]);
+      }
+    }
+  }
+  if (num_fds != 0 && num_fds != NUM_CLIENT_FDS) {
+    for (int i = 0; i < num_fds; i++) {
+      close(client_fds[i]);
+    }
+    return SERVE_FAILURE;
+  }
+
+  // Commands are read from the socket, above the descriptors commands use.
+  int input_fd = fcntl(connection, F_DUPFD_CLOEXEC, SAVED_FD_MIN);
+  FILE* input;
+  if (input_fd == -1 || (input = fdopen(input_fd, "r")) == NULL) {
+    perror("session input error in start_session()");
+    return SERVE_FAILURE;
+  }
+  close(connection);
+  fclose(stdin);
+
+  if (num_fds == 0) {
+    // Output is sent back between the status records.
+    int null_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    client_fds[0] = (null_fd != -1) ? null_fd : input_fd;
+    client_fds[1] = client_fds[2] = input_fd;
+  }
+  for (int i = 0; i < NUM_CLIENT_FDS; i++) {
+    if (client_fds[i] != i && dup2(client_fds[i], i) == -1) {
+      perror("dup2 error in start_session()");
+      return SERVE_FAILURE;
+    }
+  }
+  for (int i = 0; i < NUM_CLIENT_FDS; i++) {
+    if (client_fds[i] != input_fd && client_fds[i] > STDERR_FILENO) {
+      close(client_fds[i]);
+    }
+  }
+
+  // A client that passes no descriptors starts with its first command.
+  stdin = input;
+  if (first_byte != '\0') {
+    ungetc(first_byte, stdin);
+  }
+  session_socket = input_fd;
+  return 0;
+}
+
+void send_session_status(int status) {
+  char record[16];
+
+  flush_output();
+  int length = snprintf(record, sizeof(record), "%c%d\n", SERVE_STATUS_MARKER,
+                        status);
+  if (write(session_socket, record, length) == -1) {
+    // The client is gone. The session ends when its input does.
+  }
+}
+
+int serve(const char* path) {
+  struct sigaction stop, previous_int, previous_term;
+  sigset_t stop_signals, wait_mask;
+  int listen_fd;
+
+  if ((listen_fd = listen_on(path)) == SERVE_FAILURE) {
+    return SERVE_FAILURE;
+  }
+
+  // The stop signals are only let in while waiting for a connection, so one
+  // cannot slip in between the check and the wait.
+  sigemptyset(&stop_signals);
+  sigaddset(&stop_signals, SIGINT);
+  sigaddset(&stop_signals, SIGTERM);
+  sigprocmask(SIG_BLOCK, &stop_signals, &wait_mask);
+  stop.sa_handler = handle_stop;
+  stop.sa_flags = 0;
+  sigemptyset(&stop.sa_mask);
+  sigaction(SIGINT, &stop, &previous_int);
+  sigaction(SIGTERM, &stop, &previous_term);
+
+  // Sessions are reaped automatically.
+  signal(SIGCHLD, SIG_IGN);
+  flush_output();
+
+  while (!stop_requested) {
+    struct pollfd incoming = {listen_fd, POLLIN, 0};
+    if (ppoll(&incoming, 1, NULL, &wait_mask) == -1) {
+      continue;
+    }
+    int connection = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (connection == -1) {
+      if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS ||
+          errno == ENOMEM) {
+        // Wait for sessions to end rather than spin.
+        struct timespec delay = {0, RETRY_DELAY_NS};
+        perror("accept4 error in serve()");
+        nanosleep(&delay, NULL);
+      }
+      continue;
+    }
+    if (!from_same_user(connection)) {
+      close(connection);
+      continue;
+    }
+
+    pid_t process_id = fork();
+    if (process_id == 0) {
+      // The session leaves the server's terminal, so Ctrl+C there does not
+      // reach it or its jobs.
+      close(listen_fd);
+      setsid();
+      signal(SIGCHLD, SIG_DFL);
+      sigaction(SIGINT, &previous_int, NULL);
+      sigaction(SIGTERM, &previous_term, NULL);
+      sigprocmask(SIG_SETMASK, &wait_mask, NULL);
+      if (start_session(connection) == SERVE_FAILURE) {
+        _exit(EXIT_FAILURE);
+      }
+      return 0;
+    }
+    if (process_id == -1) {
+      perror("fork error in serve()");
+    }
+    close(connection);
+  }
+
+  // Sessions keep running until their clients leave.
+  close(listen_fd);
+  unlink(path);
+  signal(SIGCHLD, SIG_DFL);
+  sigaction(SIGINT, &previous_int, NULL);
+  sigaction(SIGTERM, &previous_term, NULL);
+  sigprocmask(SIG_SETMASK, &wait_mask, NULL);
+  return SERVE_STOPPED;
+}
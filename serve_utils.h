@@ -0,0 +1,47 @@
+#ifndef SERVE_UTILS_H
+#define SERVE_UTILS_H
+
+#define SERVE_FAILURE -1
+#define SERVE_OPTION "--serve"
+#define SERVE_STATUS_MARKER '\036'
+#define SERVE_STOPPED 1
+
+// The socket of the client this process serves, or -1 outside a session.
+// Commands are read from it and a status record is written back after each.
+extern int session_socket;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// void send_session_status(int)
+// Description: Reports that a command has finished to the session's client.
+// The record is SERVE_STATUS_MARKER, the exit status in decimal and a
+// newline.
+// Preconditions: The process serves a session.
+// Postconditions: Buffered output is flushed, then the record is written to
+// the session socket.
+// Return: None.
+extern void send_session_status(int);
+
+// int serve(const char*)
+// Description: Serves shell sessions on a Unix domain socket. Each client is
+// served by a session forked from the server, so its working directory,
+// prompt, variables and job table are its own. A client may pass its
+// standard input, output and error as one message with a single zero byte
+// and SCM_RIGHTS; commands then read and write them directly. Otherwise
+// output is sent over the socket, between the status records.
+// Preconditions: The shell environment is set up and a non-null socket path
+// is provided.
+// Postconditions: In the server, runs until SIGINT or SIGTERM, then removes
+// the socket. In a session, the standard descriptors and stdin are those of
+// the client.
+// Return: 0 in a session, SERVE_STOPPED in the server once it has stopped,
+// -1 if the socket cannot be served.
+extern int serve(const char*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERVE_UTILS_H
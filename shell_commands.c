@@ -3,14 +3,24 @@
 // Date:    2/22/2025
 // Desc:    This file contains functions for executing built-in shell commands.
 
+#define _GNU_SOURCE
+
 #include "shell_commands.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
 #include <sys/wait.h>
+#include <time.h>
 
 #include "bg_utils.h"
+#include "capture_utils.h"
+#include "history_utils.h"
+#include "output_utils.h"
+#include "timeout_utils.h"
+#include "trace_utils.h"
+#include "usage_utils.h"
 
 int change_directory(char** parsed_command) {
   // Check for number of arguments.
@@ -20,7 +30,7 @@ int change_directory(char** parsed_command) {
   }
 
   // Set destination based on whether an argument is provided.
-  char* destination;
+  char* destination = NULL;
   if (num_args > 2) {
     fprintf(stderr, "Usage: cd [directory]\tToo many arguments.\n");
     return CD_FAILURE;
@@ -72,15 +82,14 @@ int execute_proc_command(char* proc_file_path) {
     return EXEC_PROC_FAILURE;
   }
 
-  char* line = NULL;
-  size_t proc_file_length = 0;
+  char buffer[PROC_READ_SIZE];
+  size_t bytes_read;
 
-  while (getline(&line, &proc_file_length, proc_file) != -1) {
+  while ((bytes_read = fread(buffer, 1, sizeof(buffer), proc_file)) > 0) {
     // Read and print the contents of the proc file.
-    printf("%s", line);
+    append_output(buffer, bytes_read);
   }
 
-  free(line);
   fclose(proc_file);
   return 0;
 }
@@ -112,26 +121,62 @@ int foreground_process(pid_t process_id) {
               process_id);
     }
     int status;
-    if (waitpid(process_id, &status, 0) == -1) {
-      perror("waitpid error in foreground_process()");
+    struct rusage rusage;
+    start_usage(&last_usage);
+    trace_foreground(process_id);
+    if (job_deadline != NULL) {
+      // Waits started by the timeout builtin end at the deadline. Only the
+      // output captured so far is shown, since streaming could outlast it.
+      print_capture(process_id);
+      flush_output();
+      int timed_out =
+          wait_with_deadline(process_id, job_deadline, &status, &rusage);
+      if (timed_out == TIMEOUT_FAILURE) {
+        perror("wait4 error in foreground_process()");
+      } else {
+        finish_usage(&last_usage, &rusage,
+                     timed_out ? TIMEOUT_EXIT_STATUS
+                               : exit_status_from_wait(status));
+        trace_exit(process_id, last_exit_status);
+      }
+    } else {
+      // Captured output is shown, then streamed until the job exits.
+      stream_capture(process_id);
+      if (wait4(process_id, &status, 0, &rusage) == -1) {
+        perror("wait4 error in foreground_process()");
+      } else {
+        finish_usage(&last_usage, &rusage, exit_status_from_wait(status));
+        trace_exit(process_id, last_exit_status);
+      }
     }
   }
 
   return 0;
 }
 
-int list_bg_processes(void) {
+int list_bg_processes(int show_output) {
   if (bg_processes == NULL) {
     // Global struct not initialized.
     return BG_FAILURE;
   } else {
     // List active background processes.
     if (bg_processes->num_processes == 0) {
-      printf("No active background processes.\n");
+      append_output_string("No active background processes.\n");
     } else {
       for (int i = 0, cnt = 1; i < bg_processes->capacity; i++) {
         if (bg_processes->process_ids[i] > DEAD_PROCESS_ID) {
-          printf("[%d]\t%d\n", cnt, bg_processes->process_ids[i]);
+          append_output_char('[');
+          append_output_unsigned(cnt);
+          append_output("]\t", 2);
+          append_output_unsigned(bg_processes->process_ids[i]);
+          if (show_output && bg_processes->cpus[i] != -1) {
+            append_output_string("\tcpu ");
+            append_output_unsigned(bg_processes->cpus[i]);
+          }
+          if (show_output) {
+            append_capture_status(bg_processes->process_ids[i]);
+          }
+          append_output_char('\n');
           cnt++;
         }
       }
@@ -140,44 +185,48 @@ int list_bg_processes(void) {
   return 0;
 }
 
-int print_history() {
-  FILE* history_file;
+int print_history(int show_usage, size_t first, size_t last) {
+  struct history_view_t view;
+  char time_text[32];
 
-  // Try to open the history file.
-  if ((history_file = fopen(history_file_path, "r")) == NULL) {
-    perror("fopen error in print_history()");
-    return PRINT_FAILURE;
+  if (show_usage && first < last) {
+    append_output_string("\ttime\tstatus\treal\tuser\tsys\tmaxrss\tvcsw\tivcsw\t"
+                         "cwd\tcommand\n");
   }
-
-  char* line = NULL;
-  char* lines[MAX_HISTORY_LINES];
-  size_t line_count = 0;
-  size_t length = 0;
-
-  while (getline(&line, &length, history_file) != -1) {
-    // Free old lines if we've already read the max number of lines.
-    if (line_count == MAX_HISTORY_LINES) {
-      free(lines[line_count % MAX_HISTORY_LINES]);
+  for (size_t i = first; i < last; i++) {
+    if (get_history_entry(i, &view) == HISTORY_FAILURE) {
+      fprintf(stderr, "History entry %zu is damaged.\n", i + 1);
+      return PRINT_FAILURE;
+    }
+    if (!show_usage) {
+      // The plain listing is hot enough to skip format_output().
+      append_output_char('[');
+      append_output_unsigned(i + 1);
+      append_output("]\t", 2);
+      append_output(view.command, view.entry->command_length);
+      append_output_char('\n');
+      continue;
     }
-    // Store the line.
-    lines[line_count % MAX_HISTORY_LINES] = strdup(line);
-
-    line_count++;
-  }
-
-  // Print the last 10 lines if available.
-  int start =
-      (line_count >= MAX_HISTORY_LINES) ? (line_count % MAX_HISTORY_LINES) : 0;
-  int total_lines_to_print =
-      (line_count < MAX_HISTORY_LINES) ? line_count : MAX_HISTORY_LINES;
 
-  for (int i = 0; i < total_lines_to_print; i++) {
-    int idx = (start + i) % MAX_HISTORY_LINES;
-    printf("[%d]\t%s", i + 1, lines[idx]);
-    free(lines[idx]);
+    // Entries are stamped in nanoseconds since the epoch.
+    const struct history_entry_t* entry = view.entry;
+    time_t seconds = entry->timestamp / 1000000000LL;
+    struct tm local_time;
+    if (localtime_r(&seconds, &local_time) == NULL ||
+        strftime(time_text, sizeof(time_text), "%Y-%m-%d %H:%M:%S",
+                 &local_time) == 0) {
+      strcpy(time_text, "-");
+    }
+    format_output(
+        "[%zu]\t%s\t%d\t%.6f\t%lld.%06lld\t%lld.%06lld\t%lld\t%lld\t%lld\t"
+        "%s\t%s\n",
+        i + 1, time_text, entry->status, entry->wall_seconds,
+        (long long)(entry->user_usec / 1000000),
+        (long long)(entry->user_usec % 1000000),
+        (long long)(entry->sys_usec / 1000000),
+        (long long)(entry->sys_usec % 1000000), (long long)entry->maxrss,
+        (long long)entry->nvcsw, (long long)entry->nivcsw, view.cwd,
+        view.command);
   }
-
-  free(line);
-  fclose(history_file);
   return 0;
-}
\ No newline at end of file
+}
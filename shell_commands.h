@@ -9,6 +9,7 @@
 #define HOME_ENV "HOME"
 #define MAX_HISTORY_LINES 10
 #define PRINT_FAILURE -1
+#define PROC_READ_SIZE 4096
 
 #include <unistd.h>
 
@@ -47,23 +48,31 @@ extern int execute_proc_command(char*);
 // Description: Moves a background process to the foreground.
 // Preconditions: The bg_processes struct is initialized and a process id is 
 // provided as an argument.
-// Postconditions: The process is moved to the foreground.
+// Postconditions: The process is moved to the foreground. Its captured output
+// is printed as it arrives. Its resource usage and exit status are stored in
+// last_usage.
 // Return: 0 on success, -1 on failure.
 extern int foreground_process(pid_t);
 
-// int list_bg_processes()
-// Description: Lists the active background processes.
+// int list_bg_processes(int)
+// Description: Lists the active background processes. If the argument is
+// nonzero, the CPU each job was pinned to and a summary of its captured
+// output are listed alongside it.
 // Preconditions: The bg_processes struct is initialized.
 // Postconditions: The active background processes are printed to stdout.
 // Return: 0 on success, -1 on failure.
-extern int list_bg_processes(void);
+extern int list_bg_processes(int);
 
-// int print_history()
-// Description: Prints the command history.
-// Preconditions: history_file_path is set. History file exists.
-// Postconditions: The 10 most recent commands are printed to stdout.
+// int print_history(int, size_t, size_t)
+// Description: Prints a range of the command history, numbered from 1.
+// Preconditions: history_file_path is set. history_length() returned more
+// than the last index.
+// Postconditions: The entries from the first index up to, but not including,
+// the second index are printed to stdout. If the first argument is nonzero,
+// the time, exit status, resource usage and working directory recorded for
+// each command are printed alongside it.
 // Return: 0 on success, -1 on failure.
-extern int print_history(void);
+extern int print_history(int, size_t, size_t);
 
 #ifdef __cplusplus
 }
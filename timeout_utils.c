@@ -0,0 +1,290 @@
+// File:    timeout_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains functions for enforcing deadlines on jobs. The
+//          shell waits for foreground jobs by polling a pidfd, and a timer
+//          signal enforces the deadlines of background jobs while the shell
+//          waits for input. Signals go through pidfds, so a recycled process
+//          id is never signaled by mistake.
+
+#define _GNU_SOURCE
+
+#include "timeout_utils.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/pidfd.h>
+#include <sys/wait.h>
+#include <time.h>
+
+// Struct holding the deadline of a background job.
+//   pidfd:         The job's pidfd, or -1 once it has exited or been killed.
+//   signal_number: The signal sent at the deadline: SIGTERM, then SIGKILL.
+//   expires:       The deadline in seconds on the monotonic clock.
+//   kill_after:    The grace period between SIGTERM and SIGKILL.
+struct bg_deadline_t {
+    int pidfd;
+    int signal_number;
+    double expires;
+    double kill_after;
+};
+
+// Global variables.
+const struct job_deadline_t* job_deadline = NULL;
+
+// Background deadlines. Changed only with SIGALRM blocked, since the handler
+// walks them.
+static struct bg_deadline_t* deadlines = NULL;
+static size_t num_deadlines = 0;
+static size_t deadline_capacity = 0;
+static timer_t deadline_timer;
+static int timer_created = 0;
+
+// Returns the monotonic time in seconds.
+static double now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Arms the timer for the earliest background deadline, or disarms it when
+// there is none. Async-signal-safe.
+static void arm_timer(void) {
+  struct itimerspec setting = {{0, 0}, {0, 0}};
+  double earliest = 0;
+
+  for (size_t i = 0; i < num_deadlines; i++) {
+    if (deadlines[i].pidfd != -1 &&
+        (earliest == 0 || deadlines[i].expires < earliest)) {
+      earliest = deadlines[i].expires;
+    }
+  }
+  if (earliest > 0) {
+    setting.it_value.tv_sec = (time_t)earliest;
+    setting.it_value.tv_nsec = (long)((earliest - (time_t)earliest) * 1e9);
+    if (setting.it_value.tv_sec == 0 && setting.it_value.tv_nsec == 0) {
+      setting.it_value.tv_nsec = 1;
+    }
+  }
+  timer_settime(deadline_timer, TIMER_ABSTIME, &setting, NULL);
+}
+
+// Signals the background jobs whose deadlines have passed and forgets the
+// ones that have exited.
+static void handle_deadlines(int sig) {
+  int saved_errno = errno;
+  double current = now();
+
+  for (size_t i = 0; i < num_deadlines; i++) {
+    struct bg_deadline_t* deadline = &deadlines[i];
+    struct pollfd exited = {deadline->pidfd, POLLIN, 0};
+
+    if (deadline->pidfd == -1) {
+      continue;
+    }
+    if (poll(&exited, 1, 0) != 0) {
+      close(deadline->pidfd);
+      deadline->pidfd = -1;
+      continue;
+    }
+    if (current < deadline->expires) {
+      continue;
+    }
+    pidfd_send_signal(deadline->pidfd, deadline->signal_number, NULL, 0);
+    if (deadline->signal_number == SIGTERM) {
+      deadline->signal_number = SIGKILL;
+      deadline->expires = current + deadline->kill_after;
+    } else {
+      close(deadline->pidfd);
+      deadline->pidfd = -1;
+    }
+  }
+  arm_timer();
+  errno = saved_errno;
+}
+
+// Installs the SIGALRM handler and creates the timer. Returns 0 on success,
+// -1 on failure.
+static int set_up_timer(void) {
+  struct sigaction action;
+  struct sigevent event;
+
+  action.sa_handler = handle_deadlines;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGALRM, &action, NULL) == -1) {
+    perror("sigaction error in set_up_timer()");
+    return TIMEOUT_FAILURE;
+  }
+
+  event.sigev_notify = SIGEV_SIGNAL;
+  event.sigev_signo = SIGALRM;
+  event.sigev_value.sival_ptr = NULL;
+  if (timer_create(CLOCK_MONOTONIC, &event, &deadline_timer) == -1) {
+    perror("timer_create error in set_up_timer()");
+    return TIMEOUT_FAILURE;
+  }
+  timer_created = 1;
+  return 0;
+}
+
+int add_bg_deadline(pid_t process_id, const struct job_deadline_t* deadline) {
+  sigset_t block, previous;
+  int result = TIMEOUT_FAILURE;
+  int pidfd;
+
+  if ((pidfd = pidfd_open(process_id, 0)) == -1) {
+    perror("pidfd_open error in add_bg_deadline()");
+    return TIMEOUT_FAILURE;
+  }
+
+  sigemptyset(&block);
+  sigaddset(&block, SIGALRM);
+  sigprocmask(SIG_BLOCK, &block, &previous);
+  if (!timer_created && set_up_timer() == TIMEOUT_FAILURE) {
+    close(pidfd);
+    sigprocmask(SIG_SETMASK, &previous, NULL);
+    return TIMEOUT_FAILURE;
+  }
+
+  // Drop the deadlines of jobs that are gone.
+  size_t kept = 0;
+  for (size_t i = 0; i < num_deadlines; i++) {
+    if (deadlines[i].pidfd != -1) {
+      deadlines[kept++] = deadlines[i];
+    }
+  }
+  num_deadlines = kept;
+
+  if (num_deadlines >= deadline_capacity) {
+    // Array is full, allocate more memory.
+    size_t capacity = deadline_capacity ? deadline_capacity * 2 : 8;
+    struct bg_deadline_t* temp_deadlines =
+        realloc(deadlines, capacity * sizeof(struct bg_deadline_t));
+    if (temp_deadlines == NULL) {
+      perror("realloc error in add_bg_deadline()");
+      close(pidfd);
+    } else {
+      deadlines = temp_deadlines;
+      deadline_capacity = capacity;
+    }
+  }
+  if (num_deadlines < deadline_capacity) {
+    struct bg_deadline_t* added = &deadlines[num_deadlines++];
+    added->pidfd = pidfd;
+    added->signal_number = SIGTERM;
+    added->expires = now() + deadline->seconds;
+    added->kill_after = deadline->kill_after;
+    arm_timer();
+    result = 0;
+  }
+  sigprocmask(SIG_SETMASK, &previous, NULL);
+  return result;
+}
+
+void clear_bg_deadlines(void) {
+  sigset_t block, previous;
+
+  sigemptyset(&block);
+  sigaddset(&block, SIGALRM);
+  sigprocmask(SIG_BLOCK, &block, &previous);
+  if (timer_created) {
+    timer_delete(deadline_timer);
+    timer_created = 0;
+  }
+  for (size_t i = 0; i < num_deadlines; i++) {
+    if (deadlines[i].pidfd != -1) {
+      close(deadlines[i].pidfd);
+    }
+  }
+  free(deadlines);
+  deadlines = NULL;
+  num_deadlines = deadline_capacity = 0;
+  sigprocmask(SIG_SETMASK, &previous, NULL);
+}
+
+int parse_duration(const char* text, double* seconds) {
+  char* end;
+
+  *seconds = strtod(text, &end);
+  if (end == text || !isfinite(*seconds) || *seconds < 0) {
+    return TIMEOUT_FAILURE;
+  }
+  switch (*end) {
+    case '\0':
+      return 0;
+    case 's':
+      break;
+    case 'm':
+      *seconds *= 60;
+      break;
+    case 'h':
+      *seconds *= 3600;
+      break;
+    case 'd':
+      *seconds *= 86400;
+      break;
+    default:
+      return TIMEOUT_FAILURE;
+  }
+  return (end[1] == '\0') ? 0 : TIMEOUT_FAILURE;
+}
+
+int wait_with_deadline(pid_t process_id, const struct job_deadline_t* deadline,
+                       int* status, struct rusage* rusage) {
+  int timed_out = 0;
+  int pidfd = pidfd_open(process_id, 0);
+
+  if (pidfd == -1) {
+    // Without a pidfd, wait without a deadline.
+    perror("pidfd_open error in wait_with_deadline()");
+  } else {
+    struct pollfd exited = {pidfd, POLLIN, 0};
+    int signal_number = SIGTERM;
+    double expires = now() + deadline->seconds;
+
+    // Poll until the child exits. At the deadline send SIGTERM, then SIGKILL
+    // after the grace period, then wait for the child to die.
+    while (1) {
+      int timeout_ms = -1;
+      if (signal_number != 0) {
+        double remaining = ceil((expires - now()) * 1000);
+        timeout_ms = (remaining < 0)         ? 0
+                     : (remaining > INT_MAX) ? INT_MAX
+                                             : (int)remaining;
+      }
+      int ready = poll(&exited, 1, timeout_ms);
+      if (ready == -1 && errno == EINTR) {
+        continue;
+      }
+      if (ready != 0) {
+        break;
+      }
+      if (expires - now() > 0) {
+        // Woken early by a very long deadline being clamped.
+        continue;
+      }
+      pidfd_send_signal(pidfd, signal_number, NULL, 0);
+      timed_out = 1;
+      if (signal_number == SIGTERM) {
+        signal_number = SIGKILL;
+        expires = now() + deadline->kill_after;
+      } else {
+        signal_number = 0;
+      }
+    }
+    close(pidfd);
+  }
+
+  while (wait4(process_id, status, 0, rusage) == -1) {
+    if (errno != EINTR) {
+      return TIMEOUT_FAILURE;
+    }
+  }
+  return timed_out ? TIMEOUT_EXPIRED : 0;
+}
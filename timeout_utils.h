@@ -0,0 +1,71 @@
+#ifndef TIMEOUT_UTILS_H
+#define TIMEOUT_UTILS_H
+
+#define TIMEOUT_EXIT_STATUS 124
+#define TIMEOUT_EXPIRED 1
+#define TIMEOUT_FAILURE -1
+#define TIMEOUT_KILL_AFTER 2.0
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Struct holding the deadline of a job.
+//   seconds:    Time the job may run before it is sent SIGTERM.
+//   kill_after: Time it may take to exit after SIGTERM before SIGKILL.
+struct job_deadline_t {
+    double seconds;
+    double kill_after;
+};
+
+// The deadline for the next external command or fg, or NULL for none.
+extern const struct job_deadline_t* job_deadline;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// int add_bg_deadline(pid_t, const struct job_deadline_t*)
+// Description: Enforces a deadline on a background job. A timer signal
+// terminates the job when the deadline passes, even while the shell waits
+// for input.
+// Preconditions: The process is an unreaped child of the shell and a
+// non-null deadline is provided.
+// Postconditions: The job is sent SIGTERM at its deadline and SIGKILL after
+// the grace period if it is still running.
+// Return: 0 on success, -1 on failure.
+extern int add_bg_deadline(pid_t, const struct job_deadline_t*);
+
+// void clear_bg_deadlines()
+// Description: Stops enforcing background deadlines.
+// Preconditions: None.
+// Postconditions: The timer is deleted and the deadline table freed. Jobs
+// keep running.
+// Return: None.
+extern void clear_bg_deadlines(void);
+
+// int parse_duration(const char*, double*)
+// Description: Parses a duration such as 10, 2.5s, 1m, 1h or 1d.
+// Preconditions: A non-null string and result pointer are provided.
+// Postconditions: The duration in seconds is stored in the second argument.
+// Return: 0 on success, -1 if the duration is invalid.
+extern int parse_duration(const char*, double*);
+
+// int wait_with_deadline(pid_t, const struct job_deadline_t*, int*,
+//                        struct rusage*)
+// Description: Waits for a child like wait4(), polling a pidfd so the wait
+// ends at the deadline. The child is then sent SIGTERM, and SIGKILL if it has
+// not exited after the grace period.
+// Preconditions: The process is an unreaped child of the shell and non-null
+// deadline, status and usage pointers are provided.
+// Postconditions: The child is reaped and its wait status and resource usage
+// are stored in the third and fourth arguments.
+// Return: 0 if the child exited in time, TIMEOUT_EXPIRED if it was
+// terminated at the deadline, -1 on failure.
+extern int wait_with_deadline(pid_t, const struct job_deadline_t*, int*,
+                              struct rusage*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMEOUT_UTILS_H
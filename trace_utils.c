@@ -0,0 +1,286 @@
+// File:    trace_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains functions for recording when the processes the
+//          shell starts run, and exporting the timeline as a Chrome trace.
+//          Events go into a ring buffer of fixed-size slots. A writer claims
+//          a slot with one atomic increment and publishes it by storing its
+//          sequence number last, so recording needs no locks and a dump can
+//          run while events are still recorded, skipping slots caught
+//          mid-write.
+
+#define _GNU_SOURCE
+
+#include "trace_utils.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Event types.
+#define TRACE_EVENT_LAUNCH 0
+#define TRACE_EVENT_EXIT 1
+#define TRACE_EVENT_FOREGROUND 2
+
+// Struct holding one recorded event. 128 bytes, so slots do not share cache
+// lines.
+//   sequence: The ticket of the event plus 1, or 0 while it is written.
+//   ns:       When it happened, in CLOCK_MONOTONIC nanoseconds.
+//   pid:      The process it is about.
+//   parent:   The shell process that recorded it.
+//   job:      The input line being run.
+//   type:     TRACE_EVENT_LAUNCH, TRACE_EVENT_EXIT or TRACE_EVENT_FOREGROUND.
+//   kind:     How the process was started, for launches.
+//   status:   The exit status, for exits.
+//   argv:     The arguments separated by spaces, for launches.
+struct trace_event_t {
+    uint64_t sequence;
+    int64_t ns;
+    int32_t pid;
+    int32_t parent;
+    uint32_t job;
+    uint8_t type;
+    uint8_t kind;
+    int32_t status;
+    char argv[TRACE_ARGV_SIZE];
+};
+
+// Global variables.
+int trace_enabled = 0;
+unsigned long trace_job = 0;
+
+static struct trace_event_t* trace_events = NULL;
+static uint64_t trace_next = 0;
+static int64_t trace_origin = 0;
+
+// The recording process. getpid() is a system call, so it is cached, and
+// updated in children forked to run shell code.
+static pid_t trace_pid = -1;
+
+static const char* const kind_names[] = {"foreground", "background",
+                                         "subshell", "coproc"};
+
+// Subshells run shell code rather than a program.
+static char* subshell_argv[] = {"(subshell)", NULL};
+
+static int64_t now_ns(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (int64_t)time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+// Claims the next slot and fills in the common members. Returns NULL if
+// tracing is off.
+static struct trace_event_t* claim_event(int type, pid_t process_id,
+                                         uint64_t* ticket) {
+  if (!trace_enabled) {
+    return NULL;
+  }
+  *ticket = __atomic_fetch_add(&trace_next, 1, __ATOMIC_RELAXED);
+  struct trace_event_t* event =
+      &trace_events[*ticket & (TRACE_BUFFER_EVENTS - 1)];
+
+  // Readers skip the slot until it is published again.
+  __atomic_store_n(&event->sequence, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  event->ns = now_ns();
+  event->pid = process_id;
+  event->parent = trace_pid;
+  event->job = (uint32_t)trace_job;
+  event->type = type;
+  return event;
+}
+
+static void publish_event(struct trace_event_t* event, uint64_t ticket) {
+  __atomic_store_n(&event->sequence, ticket + 1, __ATOMIC_RELEASE);
+}
+
+// Writes a string as the contents of a JSON string.
+static void write_json_string(FILE* file, const char* text, size_t length) {
+  for (size_t i = 0; i < length && text[i] != '\0'; i++) {
+    unsigned char c = text[i];
+    if (c == '"' || c == '\\') {
+      fputc('\\', file);
+      fputc(c, file);
+    } else if (c < 0x20) {
+      fprintf(file, "\\u%04x", c);
+    } else {
+      fputc(c, file);
+    }
+  }
+}
+
+// Writes one event as Chrome trace events. Each traced process is a track
+// (tid) of the shell that started it (pid): a launch opens a slice named
+// after the program and an exit closes it.
+static void write_event(FILE* file, const struct trace_event_t* event,
+                        int* first) {
+  double ts = (event->ns - trace_origin) / 1000.0;
+  const char* separator = *first ? "" : ",\n";
+
+  *first = 0;
+  if (event->type == TRACE_EVENT_LAUNCH) {
+    size_t name_length = strcspn(event->argv, " ");
+    fprintf(file,
+            "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+            "\"args\":{\"name\":\"%d ",
+            separator, event->parent, event->pid, event->pid);
+    write_json_string(file, event->argv, name_length);
+    fprintf(file, "\"}},\n{\"name\":\"");
+    write_json_string(file, event->argv, name_length);
+    fprintf(file,
+            "\",\"cat\":\"%s\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":%d,"
+            "\"tid\":%d,\"args\":{\"argv\":\"",
+            kind_names[event->kind], ts, event->parent, event->pid);
+    write_json_string(file, event->argv, TRACE_ARGV_SIZE);
+    fprintf(file, "\",\"pid\":%d,\"job\":%u}}", event->pid, event->job);
+  } else if (event->type == TRACE_EVENT_EXIT) {
+    fprintf(file,
+            "%s{\"ph\":\"E\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d,"
+            "\"args\":{\"status\":%d}}",
+            separator, ts, event->parent, event->pid, event->status);
+  } else {
+    fprintf(file,
+            "%s{\"name\":\"fg\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,"
+            "\"pid\":%d,\"tid\":%d,\"args\":{\"job\":%u}}",
+            separator, ts, event->parent, event->pid, event->job);
+  }
+}
+
+static void update_trace_pid(void) {
+  trace_pid = getpid();
+}
+
+void clear_trace(void) {
+  trace_enabled = 0;
+  free(trace_events);
+  trace_events = NULL;
+}
+
+int trace_dump(const char* path) {
+  FILE* file;
+  int first = 1;
+
+  if ((file = fopen(path, "w")) == NULL) {
+    perror("fopen error in trace_dump()");
+    return TRACE_FAILURE;
+  }
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+  // Only the last TRACE_BUFFER_EVENTS tickets can still be in the buffer.
+  // A slot is read between two loads of its sequence number, and skipped if
+  // it was being written or was overwritten in between.
+  uint64_t end = __atomic_load_n(&trace_next, __ATOMIC_ACQUIRE);
+  uint64_t begin = (end > TRACE_BUFFER_EVENTS) ? end - TRACE_BUFFER_EVENTS : 0;
+  uint64_t dropped = begin;
+  for (uint64_t ticket = begin; trace_events != NULL && ticket < end;
+       ticket++) {
+    const struct trace_event_t* slot =
+        &trace_events[ticket & (TRACE_BUFFER_EVENTS - 1)];
+    struct trace_event_t event;
+    if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != ticket + 1) {
+      dropped++;
+      continue;
+    }
+    memcpy(&event, slot, sizeof(event));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != ticket + 1) {
+      dropped++;
+      continue;
+    }
+    write_event(file, &event, &first);
+  }
+
+  fprintf(file, "\n],\"otherData\":{\"dropped_events\":%llu}}\n",
+          (unsigned long long)dropped);
+  if (ferror(file) | fclose(file)) {
+    perror("write error in trace_dump()");
+    return TRACE_FAILURE;
+  }
+  return 0;
+}
+
+int trace_dump_on_exit(void) {
+  const char* path = getenv(TRACE_FILE_ENV);
+
+  if (path == NULL || path[0] == '\0') {
+    return 0;
+  }
+  return trace_dump(path);
+}
+
+void trace_exit(pid_t process_id, int status) {
+  uint64_t ticket;
+  struct trace_event_t* event =
+      claim_event(TRACE_EVENT_EXIT, process_id, &ticket);
+
+  if (event != NULL) {
+    event->status = status;
+    publish_event(event, ticket);
+  }
+}
+
+void trace_foreground(pid_t process_id) {
+  uint64_t ticket;
+  struct trace_event_t* event =
+      claim_event(TRACE_EVENT_FOREGROUND, process_id, &ticket);
+
+  if (event != NULL) {
+    publish_event(event, ticket);
+  }
+}
+
+void trace_launch(pid_t process_id, enum trace_kind_t kind, char** argv) {
+  uint64_t ticket;
+  struct trace_event_t* event =
+      claim_event(TRACE_EVENT_LAUNCH, process_id, &ticket);
+  size_t length = 0;
+
+  if (event == NULL) {
+    return;
+  }
+  event->kind = kind;
+  if (argv == NULL) {
+    argv = subshell_argv;
+  }
+  for (size_t i = 0; argv[i] != NULL && length < TRACE_ARGV_SIZE - 1; i++) {
+    if (i > 0) {
+      event->argv[length++] = ' ';
+    }
+    size_t arg_length = strnlen(argv[i], TRACE_ARGV_SIZE - 1 - length);
+    memcpy(event->argv + length, argv[i], arg_length);
+    length += arg_length;
+  }
+  event->argv[length] = '\0';
+  publish_event(event, ticket);
+}
+
+int trace_start(void) {
+  // The buffer's pages are only touched as events fill them.
+  if (trace_events == NULL &&
+      (trace_events = calloc(TRACE_BUFFER_EVENTS,
+                             sizeof(struct trace_event_t))) == NULL) {
+    perror("calloc error in trace_start()");
+    return TRACE_FAILURE;
+  }
+  for (size_t i = 0; i < TRACE_BUFFER_EVENTS; i++) {
+    if (trace_events[i].sequence != 0) {
+      trace_events[i].sequence = 0;
+    }
+  }
+  if (trace_pid == -1) {
+    pthread_atfork(NULL, NULL, update_trace_pid);
+  }
+  update_trace_pid();
+  trace_next = 0;
+  trace_origin = now_ns();
+  trace_enabled = 1;
+  return 0;
+}
+
+void trace_stop(void) {
+  trace_enabled = 0;
+}
@@ -0,0 +1,100 @@
+#ifndef TRACE_UTILS_H
+#define TRACE_UTILS_H
+
+#define TRACE_ARGV_SIZE 88
+#define TRACE_BUFFER_EVENTS 65536
+#define TRACE_FAILURE -1
+#define TRACE_FILE_ENV "SHELL_TRACE_FILE"
+
+#include <unistd.h>
+
+// How a traced process was started.
+enum trace_kind_t {
+    TRACE_FOREGROUND,
+    TRACE_BACKGROUND,
+    TRACE_SUBSHELL,
+    TRACE_COPROC
+};
+
+// Whether process events are being recorded.
+extern int trace_enabled;
+
+// The number of the input line being run, recorded as each process's job.
+extern unsigned long trace_job;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// void clear_trace()
+// Description: Stops recording and frees the event buffer.
+// Preconditions: None.
+// Postconditions: Recorded events are discarded.
+// Return: None.
+extern void clear_trace(void);
+
+// int trace_dump(const char*)
+// Description: Writes the recorded events as a Chrome trace, which Perfetto
+// and chrome://tracing open. Each process is a track named after its pid and
+// program, with a slice from its launch to its exit. Recording continues.
+// Preconditions: A non-null path is provided.
+// Postconditions: The file is overwritten. Events overwritten in the ring
+// buffer before the dump are counted as dropped.
+// Return: 0 on success, -1 on failure.
+extern int trace_dump(const char*);
+
+// int trace_dump_on_exit()
+// Description: Writes the trace to the file named by SHELL_TRACE_FILE.
+// Preconditions: None.
+// Postconditions: The file is overwritten if the variable is set.
+// Return: 0 on success or if there is nothing to do, -1 on failure.
+extern int trace_dump_on_exit(void);
+
+// void trace_exit(pid_t, int)
+// Description: Records that a traced process was reaped.
+// Preconditions: The exit status, as from exit_status_from_wait(), is
+// provided.
+// Postconditions: An exit event is recorded if tracing is on.
+// Return: None.
+extern void trace_exit(pid_t, int);
+
+// void trace_foreground(pid_t)
+// Description: Records that a background process was brought to the
+// foreground.
+// Preconditions: None.
+// Postconditions: An instant event is recorded if tracing is on.
+// Return: None.
+extern void trace_foreground(pid_t);
+
+// void trace_launch(pid_t, enum trace_kind_t, char**)
+// Description: Records that a process was started. Recording takes a
+// timestamp and copies the event into a ring buffer slot claimed with one
+// atomic increment, without locks or allocation.
+// Preconditions: The argument vector is NULL or NULL-terminated.
+// Postconditions: A launch event with the arguments, truncated to
+// TRACE_ARGV_SIZE bytes, is recorded if tracing is on.
+// Return: None.
+extern void trace_launch(pid_t, enum trace_kind_t, char**);
+
+// int trace_start()
+// Description: Starts recording process events into an empty buffer of
+// TRACE_BUFFER_EVENTS events. The oldest events are overwritten when it is
+// full.
+// Preconditions: None.
+// Postconditions: Earlier events are discarded.
+// Return: 0 on success, -1 on failure.
+extern int trace_start(void);
+
+// void trace_stop()
+// Description: Stops recording. The events recorded so far are kept for
+// trace_dump().
+// Preconditions: None.
+// Postconditions: No more events are recorded.
+// Return: None.
+extern void trace_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_UTILS_H
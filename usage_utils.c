@@ -0,0 +1,105 @@
+// File:    usage_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains utility functions for per-command resource
+//          accounting (wall time, CPU time, max RSS, context switches).
+
+#include "usage_utils.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+
+// Global variables.
+struct cmd_usage_t last_usage;
+int last_exit_status = 0;
+
+// Converts a timeval to seconds.
+static double timeval_seconds(const struct timeval* tv) {
+  return tv->tv_sec + (tv->tv_usec / 1e6);
+}
+
+// Stores the difference between two timevals in the first argument.
+static void subtract_timeval(struct timeval* result, const struct timeval* end,
+                             const struct timeval* start) {
+  result->tv_sec = end->tv_sec - start->tv_sec;
+  result->tv_usec = end->tv_usec - start->tv_usec;
+  if (result->tv_usec < 0) {
+    result->tv_sec--;
+    result->tv_usec += 1000000;
+  }
+}
+
+int exit_status_from_wait(int status) {
+  if (WIFEXITED(status)) {
+    return WEXITSTATUS(status);
+  }
+  if (WIFSIGNALED(status)) {
+    return 128 + WTERMSIG(status);
+  }
+  return status;
+}
+
+int finish_usage(struct cmd_usage_t* usage, const struct rusage* rusage,
+                 int status) {
+  struct timespec end;
+
+  if (usage == NULL || rusage == NULL) {
+    return USAGE_FAILURE;
+  }
+
+  if (clock_gettime(CLOCK_MONOTONIC, &end) == -1) {
+    perror("clock_gettime error in finish_usage()");
+    return USAGE_FAILURE;
+  }
+
+  usage->wall_seconds = (end.tv_sec - usage->start.tv_sec) +
+                        ((end.tv_nsec - usage->start.tv_nsec) / 1e9);
+  usage->rusage = *rusage;
+  usage->status = status;
+  last_exit_status = status;
+  return 0;
+}
+
+int print_usage(const struct cmd_usage_t* usage) {
+  if (usage == NULL) {
+    return USAGE_FAILURE;
+  }
+
+  fprintf(stderr,
+          "\nreal\t%.3fs\nuser\t%.3fs\nsys\t%.3fs\nmaxrss\t%ldKB\n"
+          "ctxsw\t%ld voluntary, %ld involuntary\nstatus\t%d\n",
+          usage->wall_seconds, timeval_seconds(&usage->rusage.ru_utime),
+          timeval_seconds(&usage->rusage.ru_stime), usage->rusage.ru_maxrss,
+          usage->rusage.ru_nvcsw, usage->rusage.ru_nivcsw, usage->status);
+  return 0;
+}
+
+int start_usage(struct cmd_usage_t* usage) {
+  if (usage == NULL) {
+    return USAGE_FAILURE;
+  }
+
+  memset(usage, 0, sizeof(struct cmd_usage_t));
+  if (clock_gettime(CLOCK_MONOTONIC, &usage->start) == -1) {
+    perror("clock_gettime error in start_usage()");
+    return USAGE_FAILURE;
+  }
+  return 0;
+}
+
+int subtract_rusage(struct rusage* result, const struct rusage* end,
+                    const struct rusage* start) {
+  if (result == NULL || end == NULL || start == NULL) {
+    return USAGE_FAILURE;
+  }
+
+  memset(result, 0, sizeof(struct rusage));
+  subtract_timeval(&result->ru_utime, &end->ru_utime, &start->ru_utime);
+  subtract_timeval(&result->ru_stime, &end->ru_stime, &start->ru_stime);
+  result->ru_maxrss = end->ru_maxrss;
+  result->ru_nvcsw = end->ru_nvcsw - start->ru_nvcsw;
+  result->ru_nivcsw = end->ru_nivcsw - start->ru_nivcsw;
+  return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef USAGE_UTILS_H
+#define USAGE_UTILS_H
+
+#define USAGE_FAILURE -1
+
+#include <sys/resource.h>
+#include <time.h>
+
+// Struct holding resource accounting for a single command.
+struct cmd_usage_t {
+    struct timespec start;
+    double wall_seconds;
+    struct rusage rusage;
+    int status;
+};
+
+extern struct cmd_usage_t last_usage;
+extern int last_exit_status;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// int exit_status_from_wait(int)
+// Description: Converts a wait status into a shell exit status.
+// Preconditions: A status filled in by wait4() or waitpid() is provided.
+// Postconditions: None.
+// Return: The exit code for normal exits, 128 + signal number for signaled
+// processes.
+extern int exit_status_from_wait(int);
+
+// int finish_usage(struct cmd_usage_t*, const struct rusage*, int)
+// Description: Records the end of a command's execution.
+// Preconditions: start_usage() was called on the struct. A non-null rusage
+// describing the command is provided.
+// Postconditions: Wall time, rusage and exit status are stored in the struct
+// and last_exit_status is updated.
+// Return: 0 on success, -1 on failure.
+extern int finish_usage(struct cmd_usage_t*, const struct rusage*, int);
+
+// int print_usage(const struct cmd_usage_t*)
+// Description: Prints the resource usage of a command.
+// Preconditions: finish_usage() was called on the struct.
+// Postconditions: Wall time, user/sys CPU, max RSS and context switches are
+// printed to stderr.
+// Return: 0 on success, -1 on failure.
+extern int print_usage(const struct cmd_usage_t*);
+
+// int start_usage(struct cmd_usage_t*)
+// Description: Records the start of a command's execution.
+// Preconditions: A non-null struct is provided.
+// Postconditions: The start timestamp is stored and the remaining members
+// are reset.
+// Return: 0 on success, -1 on failure.
+extern int start_usage(struct cmd_usage_t*);
+
+// int subtract_rusage(struct rusage*, const struct rusage*, const struct rusage*)
+// Description: Computes the difference between two getrusage() snapshots.
+// Preconditions: Non-null snapshots are provided, the second taken after the
+// first.
+// Postconditions: CPU times and context switch counts of the difference are
+// stored in the first argument. Max RSS is taken from the later snapshot.
+// Return: 0 on success, -1 on failure.
+extern int subtract_rusage(struct rusage*, const struct rusage*,
+                           const struct rusage*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // USAGE_UTILS_H
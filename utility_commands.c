@@ -0,0 +1,578 @@
+// File:    utility_commands.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains in-process versions of common utilities (cat,
+//          echo, printf and test) so scripts dominated by them do not fork.
+
+#define _GNU_SOURCE
+
+#include "utility_commands.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "output_utils.h"
+
+// Struct holding the state of a test expression evaluation.
+struct test_state_t {
+    char** args;
+    int pos;
+    int count;
+    int error;
+};
+
+static int test_or(struct test_state_t*);
+
+#pragma region Escapes
+
+// Prints the escape sequence starting at the backslash *c points to and moves
+// *c to its last character. Octal escapes are \0NNN for echo and %b and \NNN
+// in printf formats. Returns 1 for "\c", which ends all output, 0 otherwise.
+static int print_escape(const char** c, int zero_prefixed_octal) {
+  const char* s = *c + 1;
+  int value = 0;
+  int digits = 0;
+
+  switch (*s) {
+    case '\0':
+      append_output_char('\\');
+      return 0;
+    case 'a':
+      append_output_char('\a');
+      break;
+    case 'b':
+      append_output_char('\b');
+      break;
+    case 'c':
+      return 1;
+    case 'f':
+      append_output_char('\f');
+      break;
+    case 'n':
+      append_output_char('\n');
+      break;
+    case 'r':
+      append_output_char('\r');
+      break;
+    case 't':
+      append_output_char('\t');
+      break;
+    case 'v':
+      append_output_char('\v');
+      break;
+    case '\\':
+      append_output_char('\\');
+      break;
+    default:
+      if (zero_prefixed_octal ? (*s == '0') : (*s >= '0' && *s <= '7')) {
+        const char* d = zero_prefixed_octal ? s + 1 : s;
+        while (digits < 3 && *d >= '0' && *d <= '7') {
+          value = value * 8 + (*d++ - '0');
+          digits++;
+        }
+        append_output_char(value);
+        *c = d - 1;
+        return 0;
+      }
+      // Unknown escapes are printed as they are.
+      append_output_char('\\');
+      append_output_char(*s);
+      break;
+  }
+  *c = s;
+  return 0;
+}
+
+// Prints a string with backslash escapes interpreted. Returns 1 if "\c" ended
+// the output, 0 otherwise.
+static int print_escaped(const char* str, int zero_prefixed_octal) {
+  for (const char* c = str; *c != '\0'; c++) {
+    if (*c != '\\') {
+      append_output_char(*c);
+    } else if (print_escape(&c, zero_prefixed_octal)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+#pragma endregion Escapes
+
+#pragma region Cat
+
+// Writes a whole buffer to standard output. Returns 0 on success, -1 on
+// failure.
+static int write_all(const char* buffer, size_t length) {
+  while (length > 0) {
+    ssize_t written = write(STDOUT_FILENO, buffer, length);
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return CAT_FAILURE;
+    }
+    buffer += written;
+    length -= written;
+  }
+  return 0;
+}
+
+// Copies a file descriptor to standard output. Returns 0 on success, -1 on
+// failure.
+static int copy_to_stdout(int fd, const char* name) {
+  struct stat info;
+
+  // Regular files go straight from the page cache to standard output. Not
+  // every output accepts sendfile() (e.g. files opened for appending), so
+  // fall back to read() and write() when it is refused.
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+    ssize_t sent;
+    while ((sent = sendfile(STDOUT_FILENO, fd, NULL, CAT_SENDFILE_SIZE)) > 0) {
+    }
+    if (sent == 0) {
+      return 0;
+    }
+    if (errno != EINVAL && errno != ENOSYS) {
+      fprintf(stderr, "cat: %s: %s\n", name, strerror(errno));
+      return CAT_FAILURE;
+    }
+  }
+
+  char buffer[CAT_READ_SIZE];
+  ssize_t bytes_read;
+  while ((bytes_read = read(fd, buffer, sizeof(buffer))) != 0) {
+    if (bytes_read == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "cat: %s: %s\n", name, strerror(errno));
+      return CAT_FAILURE;
+    }
+    if (write_all(buffer, bytes_read) == CAT_FAILURE) {
+      fprintf(stderr, "cat: write error: %s\n", strerror(errno));
+      return CAT_FAILURE;
+    }
+  }
+  return 0;
+}
+
+int cat_command(char** parsed_command) {
+  int result = 0;
+
+  // Earlier buffered output must come first.
+  flush_output();
+
+  if (parsed_command[1] == NULL) {
+    return copy_to_stdout(STDIN_FILENO, "-");
+  }
+  for (int i = 1; parsed_command[i] != NULL; i++) {
+    if (strcmp(parsed_command[i], "-") == 0) {
+      if (copy_to_stdout(STDIN_FILENO, "-") == CAT_FAILURE) {
+        result = CAT_FAILURE;
+      }
+      continue;
+    }
+
+    int fd = open(parsed_command[i], O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      fprintf(stderr, "cat: %s: %s\n", parsed_command[i], strerror(errno));
+      result = CAT_FAILURE;
+      continue;
+    }
+    if (copy_to_stdout(fd, parsed_command[i]) == CAT_FAILURE) {
+      result = CAT_FAILURE;
+    }
+    close(fd);
+  }
+  return result;
+}
+
+#pragma endregion Cat
+
+#pragma region Echo
+
+void echo_command(char** parsed_command) {
+  int newline = 1;
+  int escapes = 0;
+  int i = 1;
+
+  // Leading option words made only of n, e and E characters.
+  for (; parsed_command[i] != NULL && parsed_command[i][0] == '-' &&
+         parsed_command[i][1] != '\0' &&
+         strspn(parsed_command[i] + 1, "neE") == strlen(parsed_command[i] + 1);
+       i++) {
+    for (const char* c = parsed_command[i] + 1; *c != '\0'; c++) {
+      if (*c == 'n') {
+        newline = 0;
+      } else {
+        escapes = (*c == 'e');
+      }
+    }
+  }
+
+  for (int first = i; parsed_command[i] != NULL; i++) {
+    if (i > first) {
+      append_output_char(' ');
+    }
+    if (!escapes) {
+      append_output_string(parsed_command[i]);
+    } else if (print_escaped(parsed_command[i], 1)) {
+      return;
+    }
+  }
+  if (newline) {
+    append_output_char('\n');
+  }
+}
+
+#pragma endregion Echo
+
+#pragma region Printf
+
+// Converts a printf argument to an integer. Missing arguments are 0.
+static long long integer_argument(const char* arg, int* result) {
+  char* end;
+
+  if (arg == NULL || arg[0] == '\0') {
+    return 0;
+  }
+  errno = 0;
+  long long value = strtoll(arg, &end, 0);
+  if (*end != '\0' || errno != 0) {
+    fprintf(stderr, "printf: %s: invalid number\n", arg);
+    *result = PRINTF_FAILURE;
+  }
+  return value;
+}
+
+// Converts a printf argument to a floating point number. Missing arguments
+// are 0.
+static double float_argument(const char* arg, int* result) {
+  char* end;
+
+  if (arg == NULL || arg[0] == '\0') {
+    return 0;
+  }
+  double value = strtod(arg, &end);
+  if (*end != '\0') {
+    fprintf(stderr, "printf: %s: invalid number\n", arg);
+    *result = PRINTF_FAILURE;
+  }
+  return value;
+}
+
+int printf_command(char** parsed_command) {
+  if (parsed_command[1] == NULL) {
+    fprintf(stderr, "Usage: printf format [arguments]\tToo few arguments.\n");
+    return PRINTF_FAILURE;
+  }
+
+  const char* format = parsed_command[1];
+  char** args = parsed_command + 2;
+  int result = 0;
+
+  do {
+    char** first_arg = args;
+
+    for (const char* c = format; *c != '\0'; c++) {
+      if (*c == '\\') {
+        if (print_escape(&c, 0)) {
+          return result;
+        }
+        continue;
+      }
+      if (*c != '%') {
+        append_output_char(*c);
+        continue;
+      }
+      if (c[1] == '%') {
+        append_output_char('%');
+        c++;
+        continue;
+      }
+
+      // Copy the flags, width and precision into a printf() specification.
+      char spec[32] = "%";
+      size_t n = 1;
+      c++;
+      while (*c != '\0' && strchr("-+ #0", *c) != NULL && n < 8) {
+        spec[n++] = *c++;
+      }
+      while (isdigit((unsigned char)*c) && n < 16) {
+        spec[n++] = *c++;
+      }
+      if (*c == '.') {
+        spec[n++] = *c++;
+        while (isdigit((unsigned char)*c) && n < 24) {
+          spec[n++] = *c++;
+        }
+      }
+
+      const char* arg = (*args != NULL) ? *args++ : NULL;
+      switch (*c) {
+        case 's':
+          strcpy(spec + n, "s");
+          format_output(spec, arg ? arg : "");
+          break;
+        case 'b':
+          if (print_escaped(arg ? arg : "", 1)) {
+            return result;
+          }
+          break;
+        case 'c':
+          strcpy(spec + n, "c");
+          if (arg != NULL && arg[0] != '\0') {
+            format_output(spec, arg[0]);
+          }
+          break;
+        case 'd':
+        case 'i':
+          strcpy(spec + n, "lld");
+          format_output(spec, integer_argument(arg, &result));
+          break;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+          spec[n++] = 'l';
+          spec[n++] = 'l';
+          spec[n++] = *c;
+          spec[n] = '\0';
+          format_output(spec, (unsigned long long)integer_argument(arg, &result));
+          break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'g':
+        case 'G':
+          spec[n++] = *c;
+          spec[n] = '\0';
+          format_output(spec, float_argument(arg, &result));
+          break;
+        default:
+          fprintf(stderr, "printf: %%%c: invalid conversion\n",
+                  *c ? *c : ' ');
+          return PRINTF_FAILURE;
+      }
+    }
+
+    // Stop if a pass of the format consumed no arguments.
+    if (args == first_arg) {
+      break;
+    }
+  } while (*args != NULL);
+
+  return result;
+}
+
+#pragma endregion Printf
+
+#pragma region Test
+
+// Returns the current argument, or NULL at the end of the expression.
+static const char* test_peek(struct test_state_t* state, int offset) {
+  int pos = state->pos + offset;
+  return (pos < state->count) ? state->args[pos] : NULL;
+}
+
+// Reports a syntax error in the expression.
+static int test_error(struct test_state_t* state, const char* message,
+                      const char* arg) {
+  if (!state->error) {
+    fprintf(stderr, "test: %s%s%s\n", arg ? arg : "", arg ? ": " : "", message);
+  }
+  state->error = 1;
+  return 0;
+}
+
+// Converts an integer operand.
+static long long test_integer(struct test_state_t* state, const char* arg) {
+  char* end;
+  errno = 0;
+  long long value = strtoll(arg, &end, 10);
+  if (arg[0] == '\0' || *end != '\0' || errno != 0) {
+    test_error(state, "integer expression expected", arg);
+  }
+  return value;
+}
+
+// Evaluates a unary file or string test.
+static int test_unary(struct test_state_t* state, const char* op,
+                      const char* arg) {
+  struct stat info;
+
+  switch (op[1]) {
+    case 'n':
+      return arg[0] != '\0';
+    case 'z':
+      return arg[0] == '\0';
+    case 'e':
+      return stat(arg, &info) == 0;
+    case 'f':
+      return stat(arg, &info) == 0 && S_ISREG(info.st_mode);
+    case 'd':
+      return stat(arg, &info) == 0 && S_ISDIR(info.st_mode);
+    case 's':
+      return stat(arg, &info) == 0 && info.st_size > 0;
+    case 'L':
+    case 'h':
+      return lstat(arg, &info) == 0 && S_ISLNK(info.st_mode);
+    case 'r':
+      return access(arg, R_OK) == 0;
+    case 'w':
+      return access(arg, W_OK) == 0;
+    case 'x':
+      return access(arg, X_OK) == 0;
+    default:
+      return test_error(state, "unary operator expected", op);
+  }
+}
+
+// Returns 1 if the argument is a supported unary operator.
+static int is_unary_operator(const char* arg) {
+  return arg != NULL && arg[0] == '-' && arg[1] != '\0' && arg[2] == '\0' &&
+         strchr("nzefdsLhrwx", arg[1]) != NULL;
+}
+
+// Returns 1 if the argument is a supported binary operator.
+static int is_binary_operator(const char* arg) {
+  static const char* const operators[] = {"=",   "==",  "!=",  "-eq", "-ne",
+                                          "-lt", "-le", "-gt", "-ge", NULL};
+  for (int i = 0; arg != NULL && operators[i] != NULL; i++) {
+    if (strcmp(arg, operators[i]) == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Evaluates a binary string or integer comparison.
+static int test_binary(struct test_state_t* state, const char* left,
+                       const char* op, const char* right) {
+  if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0) {
+    return strcmp(left, right) == 0;
+  }
+  if (strcmp(op, "!=") == 0) {
+    return strcmp(left, right) != 0;
+  }
+
+  long long a = test_integer(state, left);
+  long long b = test_integer(state, right);
+  if (strcmp(op, "-eq") == 0) {
+    return a == b;
+  }
+  if (strcmp(op, "-ne") == 0) {
+    return a != b;
+  }
+  if (strcmp(op, "-lt") == 0) {
+    return a < b;
+  }
+  if (strcmp(op, "-le") == 0) {
+    return a <= b;
+  }
+  if (strcmp(op, "-gt") == 0) {
+    return a > b;
+  }
+  return a >= b;
+}
+
+// primary: ( expr ) | unary-op arg | arg binary-op arg | arg
+static int test_primary(struct test_state_t* state) {
+  const char* arg = test_peek(state, 0);
+
+  if (arg == NULL) {
+    return test_error(state, "argument expected", NULL);
+  }
+  if (is_binary_operator(test_peek(state, 1)) && test_peek(state, 2) != NULL) {
+    state->pos += 3;
+    return test_binary(state, arg, state->args[state->pos - 2],
+                       state->args[state->pos - 1]);
+  }
+  if (is_unary_operator(arg) && test_peek(state, 1) != NULL) {
+    state->pos += 2;
+    return test_unary(state, arg, state->args[state->pos - 1]);
+  }
+  if (strcmp(arg, "(") == 0 && test_peek(state, 1) != NULL) {
+    state->pos++;
+    int value = test_or(state);
+    if (test_peek(state, 0) == NULL || strcmp(test_peek(state, 0), ")") != 0) {
+      return test_error(state, "')' expected", NULL);
+    }
+    state->pos++;
+    return value;
+  }
+
+  // A single string is true if it is not empty.
+  state->pos++;
+  return arg[0] != '\0';
+}
+
+// not: ! not | primary
+static int test_not(struct test_state_t* state) {
+  const char* arg = test_peek(state, 0);
+  if (arg != NULL && strcmp(arg, "!") == 0 && test_peek(state, 1) != NULL) {
+    state->pos++;
+    return !test_not(state);
+  }
+  return test_primary(state);
+}
+
+// and: not (-a not)*
+static int test_and(struct test_state_t* state) {
+  int value = test_not(state);
+  while (test_peek(state, 0) != NULL && strcmp(test_peek(state, 0), "-a") == 0) {
+    state->pos++;
+    value = test_not(state) && value;
+  }
+  return value;
+}
+
+// or: and (-o and)*
+static int test_or(struct test_state_t* state) {
+  int value = test_and(state);
+  while (test_peek(state, 0) != NULL && strcmp(test_peek(state, 0), "-o") == 0) {
+    state->pos++;
+    value = test_and(state) || value;
+  }
+  return value;
+}
+
+int test_command(char** parsed_command) {
+  struct test_state_t state = {parsed_command + 1, 0, 0, 0};
+
+  while (state.args[state.count] != NULL) {
+    state.count++;
+  }
+
+  // "[" must be closed by a final "]".
+  if (strcmp(parsed_command[0], "[") == 0) {
+    if (state.count == 0 || strcmp(state.args[state.count - 1], "]") != 0) {
+      fprintf(stderr, "[: missing `]'\n");
+      return TEST_FAILURE;
+    }
+    state.count--;
+  }
+
+  // An empty expression is false.
+  if (state.count == 0) {
+    return TEST_FALSE;
+  }
+
+  int value = test_or(&state);
+  if (!state.error && state.pos < state.count) {
+    test_error(&state, "too many arguments", NULL);
+  }
+  if (state.error) {
+    return TEST_FAILURE;
+  }
+  return value ? TEST_TRUE : TEST_FALSE;
+}
+
+#pragma endregion Test
@@ -0,0 +1,57 @@
+#ifndef UTILITY_COMMANDS_H
+#define UTILITY_COMMANDS_H
+
+#define CAT_FAILURE -1
+#define CAT_SENDFILE_SIZE (1 << 30)
+#define CAT_READ_SIZE 65536
+#define PRINTF_FAILURE -1
+#define TEST_FAILURE -1
+#define TEST_FALSE 1
+#define TEST_TRUE 0
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// int cat_command(char**)
+// Description: Copies files, or standard input for no files or "-", to standard
+// output. Regular files are copied with sendfile() without passing through
+// user space.
+// Preconditions: A non-null command is provided as an argument.
+// Postconditions: The file contents are written to standard output.
+// Return: 0 on success, -1 if any file could not be copied.
+extern int cat_command(char**);
+
+// void echo_command(char**)
+// Description: Prints the arguments separated by spaces. Supports -n to omit
+// the trailing newline and -e to interpret backslash escapes.
+// Preconditions: A non-null command is provided as an argument.
+// Postconditions: The arguments are printed to standard output.
+// Return: None.
+extern void echo_command(char**);
+
+// int printf_command(char**)
+// Description: Prints the arguments according to a format string. Supports
+// backslash escapes and the %s, %b, %c, %d, %i, %u, %o, %x, %X, %e, %f, %g and
+// %% conversions with flags, width and precision. The format is reused while
+// arguments remain.
+// Preconditions: A non-null command is provided as an argument.
+// Postconditions: The formatted output is printed to standard output.
+// Return: 0 on success, -1 on an invalid format or argument.
+extern int printf_command(char**);
+
+// int test_command(char**)
+// Description: Evaluates a conditional expression as test(1) does. Supports !,
+// -a, -o, the string tests -n, -z, =, != and the file tests -e, -f, -d, -r,
+// -w, -x, -s, -L, and the integer comparisons -eq, -ne, -lt, -le, -gt and -ge.
+// A command named "[" must end with "]".
+// Preconditions: A non-null command is provided as an argument.
+// Postconditions: None.
+// Return: 0 if the expression is true, 1 if it is false, -1 on a syntax error.
+extern int test_command(char**);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UTILITY_COMMANDS_H
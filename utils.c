@@ -39,7 +39,7 @@ size_t count_spaces(const char* str) {
   size_t rv = 0;
 
   while (*str) {
-    if (isspace(*str++))
+    if (isspace((unsigned char)*str++))
       ++rv;
   }
 
@@ -58,6 +58,24 @@ void flush_input(FILE* fp) {
   }
 }
 
+/* Digits of escape sequences. The terminator is never a digit, and the
+   second digit is only read once the first is valid, so a sequence cut short
+   by the end of the string never reads past it. Returns -1 for a character
+   that is not a digit. */
+static int octal_value(char c) {
+  return (c >= '0' && c <= '7') ? c - '0' : -1;
+}
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
 char* unescape(const char* str, FILE* errf) {
   size_t len = strlen(str), i;
   char *unesc, *rv;
@@ -142,57 +160,32 @@ char* unescape(const char* str, FILE* errf) {
         case '5':
         case '6':
         case '7': {
-          int tmp = (cur - '0') << 6;
+          int middle, low;
 
-          cur = *str++;
-          if (cur < '0' || cur > '7') {
+          if ((middle = octal_value(*str++)) == -1 ||
+              (low = octal_value(*str++)) == -1) {
+            fprintf(errf, "shell error: illegal escape sequence\n");
             free(rv);
             return NULL;
           }
 
-          tmp |= (cur - '0') << 3;
-
-          cur = *str++;
-          if (cur < '0' || cur > '7') {
-            free(rv);
-            return NULL;
-          }
-
-          tmp |= (cur - '0');
-          *unesc++ = (char)tmp;
+          *unesc++ = (char)(((cur - '0') << 6) | (middle << 3) | low);
           continue;
         }
 
         /* And, for more fun, hex! */
         case 'x':
         case 'X': {
-          int tmp;
-
-          cur = *str++;
-          if (cur >= '0' && cur <= '9')
-            tmp = (cur - '0') << 4;
-          else if (cur >= 'a' && cur <= 'f')
-            tmp = (cur - 'a' + 10) << 4;
-          else if (cur >= 'A' && cur <= 'F')
-            tmp = (cur - 'A' + 10) << 4;
-          else {
-            free(rv);
-            return NULL;
-          }
+          int high, low;
 
-          cur = *str++;
-          if (cur >= '0' && cur <= '9')
-            tmp |= (cur - '0');
-          else if (cur >= 'a' && cur <= 'f')
-            tmp |= (cur - 'a' + 10);
-          else if (cur >= 'A' && cur <= 'F')
-            tmp |= (cur - 'A' + 10);
-          else {
+          if ((high = hex_value(*str++)) == -1 ||
+              (low = hex_value(*str++)) == -1) {
+            fprintf(errf, "shell error: illegal escape sequence\n");
             free(rv);
             return NULL;
           }
 
-          *unesc++ = (char)tmp;
+          *unesc++ = (char)((high << 4) | low);
           continue;
         }
 
@@ -254,7 +247,7 @@ int first_unquoted_space(const char* str) {
         quoted = cur;
       else if (quoted && cur == quoted)
         quoted = 0;
-      if (!quoted && isspace(cur))
+      if (!quoted && isspace((unsigned char)cur))
         return pos;
     }
 
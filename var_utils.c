@@ -0,0 +1,184 @@
+// File:    var_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains the shell variable store and the positional
+//          parameters used by functions.
+
+#define _GNU_SOURCE
+
+#include "var_utils.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "usage_utils.h"
+
+#define MAX_POSITIONAL_DEPTH 256
+#define SHELL_NAME "simple_shell"
+
+// Global variables.
+struct shell_vars_t shell_vars = {NULL, 0, 0};
+
+static char** positional_stack[MAX_POSITIONAL_DEPTH];
+static int positional_depth = 0;
+static char special_value[32];
+
+// Returns the index of a variable, or -1 if it is not set.
+static long find_variable(const char* name, size_t length) {
+  for (size_t i = 0; i < shell_vars.num_vars; i++) {
+    if (strncmp(shell_vars.vars[i].name, name, length) == 0 &&
+        shell_vars.vars[i].name[length] == '\0') {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void clear_variables(void) {
+  for (size_t i = 0; i < shell_vars.num_vars; i++) {
+    free(shell_vars.vars[i].name);
+    free(shell_vars.vars[i].value);
+  }
+  free(shell_vars.vars);
+  shell_vars.vars = NULL;
+  shell_vars.num_vars = shell_vars.capacity = 0;
+}
+
+char** get_positional(void) {
+  return positional_depth ? positional_stack[positional_depth - 1] : NULL;
+}
+
+const char* get_variable(const char* name, size_t length) {
+  char** positional = get_positional();
+
+  // Special parameters.
+  if (length == 1) {
+    switch (name[0]) {
+      case '?':
+        snprintf(special_value, sizeof(special_value), "%d", last_exit_status);
+        return special_value;
+      case '$':
+        snprintf(special_value, sizeof(special_value), "%d", (int)getpid());
+        return special_value;
+      case '#': {
+        int count = 0;
+        while (positional != NULL && positional[count] != NULL) {
+          count++;
+        }
+        snprintf(special_value, sizeof(special_value), "%d", count);
+        return special_value;
+      }
+      case '0':
+        return SHELL_NAME;
+      default:
+        break;
+    }
+    if (isdigit((unsigned char)name[0])) {
+      for (int i = 0; positional != NULL && positional[i] != NULL; i++) {
+        if (i + 1 == name[0] - '0') {
+          return positional[i];
+        }
+      }
+      return NULL;
+    }
+  }
+
+  long index = find_variable(name, length);
+  if (index != -1) {
+    return shell_vars.vars[index].value;
+  }
+
+  // Fall back to the environment.
+  char* env_name = strndup(name, length);
+  if (env_name == NULL) {
+    return NULL;
+  }
+  const char* value = getenv(env_name);
+  free(env_name);
+  return value;
+}
+
+int is_valid_name(const char* name, size_t length) {
+  if (length == 0 || !(isalpha((unsigned char)name[0]) || name[0] == '_')) {
+    return 0;
+  }
+  for (size_t i = 1; i < length; i++) {
+    if (!(isalnum((unsigned char)name[i]) || name[i] == '_')) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int pop_positional(void) {
+  if (positional_depth == 0) {
+    return VAR_FAILURE;
+  }
+  positional_depth--;
+  return 0;
+}
+
+int push_positional(char** arguments) {
+  if (positional_depth == MAX_POSITIONAL_DEPTH) {
+    fprintf(stderr, "shell error: maximum function nesting exceeded\n");
+    return VAR_FAILURE;
+  }
+  positional_stack[positional_depth++] = arguments;
+  return 0;
+}
+
+int set_variable(const char* name, const char* value) {
+  char* value_copy = strdup(value);
+  if (value_copy == NULL) {
+    perror("strdup error in set_variable()");
+    return VAR_FAILURE;
+  }
+
+  // Replace the value of an existing variable.
+  long index = find_variable(name, strlen(name));
+  if (index != -1) {
+    free(shell_vars.vars[index].value);
+    shell_vars.vars[index].value = value_copy;
+    return 0;
+  }
+
+  if (shell_vars.num_vars >= shell_vars.capacity) {
+    // Array is full, allocate more memory.
+    size_t capacity = shell_vars.capacity ? shell_vars.capacity * 2 : 16;
+    struct shell_var_t* temp_vars =
+        realloc(shell_vars.vars, capacity * sizeof(struct shell_var_t));
+    if (temp_vars == NULL) {
+      perror("realloc error in set_variable()");
+      free(value_copy);
+      return VAR_FAILURE;
+    }
+    shell_vars.vars = temp_vars;
+    shell_vars.capacity = capacity;
+  }
+
+  if ((shell_vars.vars[shell_vars.num_vars].name = strdup(name)) == NULL) {
+    perror("strdup error in set_variable()");
+    free(value_copy);
+    return VAR_FAILURE;
+  }
+  shell_vars.vars[shell_vars.num_vars].value = value_copy;
+  shell_vars.num_vars++;
+  return 0;
+}
+
+int unset_variable(const char* name) {
+  long index = find_variable(name, strlen(name));
+  if (index == -1) {
+    return VAR_FAILURE;
+  }
+
+  free(shell_vars.vars[index].name);
+  free(shell_vars.vars[index].value);
+  memmove(&shell_vars.vars[index], &shell_vars.vars[index + 1],
+          (shell_vars.num_vars - index - 1) * sizeof(struct shell_var_t));
+  shell_vars.num_vars--;
+  return 0;
+}
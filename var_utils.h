@@ -0,0 +1,91 @@
+#ifndef VAR_UTILS_H
+#define VAR_UTILS_H
+
+#define VAR_FAILURE -1
+
+#include <stddef.h>
+
+// Struct holding a shell variable.
+struct shell_var_t {
+    char* name;
+    char* value;
+};
+
+// Struct holding the shell variables.
+struct shell_vars_t {
+    struct shell_var_t* vars;
+    size_t num_vars;
+    size_t capacity;
+};
+
+extern struct shell_vars_t shell_vars;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// void clear_variables()
+// Description: Frees every shell variable.
+// Preconditions: None.
+// Postconditions: The shell_vars struct members are reset and freed.
+// Return: None.
+extern void clear_variables(void);
+
+// char** get_positional()
+// Description: Returns the active positional parameters.
+// Preconditions: None.
+// Postconditions: None.
+// Return: A NULL-terminated array, or NULL outside of functions.
+extern char** get_positional(void);
+
+// const char* get_variable(const char*, size_t)
+// Description: Looks up a shell variable, falling back to the environment.
+// Special parameters ?, #, $ and 0-9 are supported.
+// Preconditions: A non-null name and its length are provided.
+// Postconditions: None.
+// Return: The value, or NULL if the variable is not set. Special parameters
+// are formatted into a buffer that is reused by the next call.
+extern const char* get_variable(const char*, size_t);
+
+// int is_valid_name(const char*, size_t)
+// Description: Checks whether a string is a valid variable name.
+// Preconditions: A non-null name and its length are provided.
+// Postconditions: None.
+// Return: 1 if the name is valid, 0 otherwise.
+extern int is_valid_name(const char*, size_t);
+
+// int pop_positional()
+// Description: Restores the positional parameters saved by push_positional().
+// Preconditions: push_positional() was called.
+// Postconditions: The previous positional parameters are active again.
+// Return: 0 on success, -1 on failure.
+extern int pop_positional(void);
+
+// int push_positional(char**)
+// Description: Makes an argument array the positional parameters $1, $2, ...
+// Preconditions: A non-null, NULL-terminated array is provided. It stays valid
+// until the matching pop_positional().
+// Postconditions: The previous positional parameters are saved.
+// Return: 0 on success, -1 on failure.
+extern int push_positional(char**);
+
+// int set_variable(const char*, const char*)
+// Description: Sets a shell variable.
+// Preconditions: A valid name and a non-null value are provided.
+// Postconditions: The variable holds a copy of the value.
+// Return: 0 on success, -1 on failure.
+extern int set_variable(const char*, const char*);
+
+// int unset_variable(const char*)
+// Description: Removes a shell variable.
+// Preconditions: A non-null name is provided.
+// Postconditions: The variable is no longer set. Environment variables of the
+// same name are visible again.
+// Return: 0 on success, -1 if the variable was not set.
+extern int unset_variable(const char*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VAR_UTILS_H
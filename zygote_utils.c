@@ -0,0 +1,329 @@
+// File:    zygote_utils.c
+// Author:  Eric Ekey
+// Date:    10/19/2026
+// Desc:    This file contains functions for starting external commands from a
+//          zygote: a helper forked while the shell is small. fork() copies
+//          the page tables of the whole address space, so it slows down as
+//          the shell's heap grows, while forking from the zygote does not.
+//          The shell sends each command's arguments, environment, standard
+//          descriptors and working directory over a socketpair, and the
+//          zygote clones with CLONE_PARENT so the command is the shell's
+//          child, waited for and tracked like any other.
+
+#define _GNU_SOURCE
+
+#include "zygote_utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+#include "output_utils.h"
+#include "redirect_utils.h"
+
+// The standard descriptors and the working directory.
+#define NUM_SPAWN_FDS 4
+
+// Struct heading a spawn request. The argument and environment strings
+// follow, each terminated by a NUL.
+//   argc: The number of arguments.
+//   envc: The number of environment strings.
+struct spawn_header_t {
+    uint32_t argc;
+    uint32_t envc;
+};
+
+// Global variables.
+int zygote_enabled = 0;
+
+extern char** environ;
+
+static int zygote_fd = -1;
+static pid_t zygote_process_id = -1;
+static pid_t zygote_owner = -1;
+
+// Ctrl+C reaches the zygote with the rest of the terminal's foreground
+// group. It is caught rather than ignored, so commands get the default action.
+static void handle_zygote_sigint(int sig) {}
+
+// Reports a failed exec() as the shell does for commands it forks. Only
+// write() is used, since it runs in the clone child.
+static void report_exec_failure(const char* command, int error) {
+  const char* reason = (error == ENOENT)    ? "command not found"
+                       : (error == EACCES)  ? "Permission denied"
+                       : (error == ENOEXEC) ? "Exec format error"
+                                            : "cannot execute";
+  struct iovec parts[5] = {{"shell error: ", 13},
+                           {(void*)command, strlen(command)},
+                           {": ", 2},
+                           {(void*)reason, strlen(reason)},
+                           {"\n", 1}};
+  writev(STDERR_FILENO, parts, 5);
+}
+
+// Starts one command from a request. Returns its process id, or -errno on
+// failure.
+static pid_t spawn_request(char* message, size_t length, const int* fds) {
+  struct spawn_header_t header;
+  char** strings;
+
+  if (length < sizeof(header) + 1 || message[length - 1] != '\0') {
+    return -EINVAL;
+  }
+  memcpy(&header, message, sizeof(header));
+  if (header.argc == 0 || header.argc + header.envc > length) {
+    return -EINVAL;
+  }
+
+  // Point each argument and environment string into the message, leaving a
+  // NULL after each list.
+  if ((strings = malloc((header.argc + header.envc + 2) * sizeof(char*))) ==
+      NULL) {
+    return -ENOMEM;
+  }
+  char* next = message + sizeof(header);
+  char* end = message + length;
+  char** argv = strings;
+  char** envp = strings + header.argc + 1;
+  for (uint32_t i = 0; i < header.argc + header.envc; i++) {
+    if (next >= end) {
+      free(strings);
+      return -EINVAL;
+    }
+    if (i < header.argc) {
+      argv[i] = next;
+    } else {
+      envp[i - header.argc] = next;
+    }
+    next += strlen(next) + 1;
+  }
+  argv[header.argc] = NULL;
+  envp[header.envc] = NULL;
+
+  // The child's parent is the shell, not the zygote.
+  pid_t process_id = syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, 0, 0, 0);
+  if (process_id == 0) {
+    // Only system calls until exec(): libc still describes the zygote here.
+    for (int i = 0; i < NUM_SPAWN_FDS - 1; i++) {
+      if (dup2(fds[i], i) == -1) {
+        _exit(EXIT_FAILURE);
+      }
+    }
+    if (fchdir(fds[NUM_SPAWN_FDS - 1]) == -1) {
+      _exit(EXIT_FAILURE);
+    }
+    environ = envp;
+    execvp(argv[0], argv);
+    report_exec_failure(argv[0], errno);
+    _exit((errno == ENOENT) ? 127 : 126);
+  }
+  free(strings);
+  return (process_id == -1) ? -errno : process_id;
+}
+
+// Serves spawn requests until the shell closes its end of the socket.
+static void run_zygote(int fd) {
+  static char message[ZYGOTE_MESSAGE_SIZE];
+  int null_fd = open("/dev/null", O_RDWR);
+
+  signal(SIGINT, handle_zygote_sigint);
+
+  // The zygote must not hold the shell's terminal or pipes open.
+  if (null_fd != -1) {
+    for (int i = 0; i < NUM_SPAWN_FDS - 1; i++) {
+      dup2(null_fd, i);
+    }
+    if (null_fd >= NUM_SPAWN_FDS - 1) {
+      close(null_fd);
+    }
+  }
+
+  while (1) {
+    union {
+      struct cmsghdr header;
+      char space[CMSG_SPACE(NUM_SPAWN_FDS * sizeof(int))];
+    } control;
+    struct iovec data = {message, sizeof(message)};
+    struct msghdr request;
+    int fds[NUM_SPAWN_FDS];
+    int num_fds = 0;
+
+    memset(&request, 0, sizeof(request));
+    request.msg_iov = &data;
+    request.msg_iovlen = 1;
+    request.msg_control = control.space;
+    request.msg_controllen = sizeof(control.space);
+    ssize_t length = recvmsg(fd, &request, MSG_CMSG_CLOEXEC);
+    if (length == -1 && errno == EINTR) {
+      continue;
+    }
+    if (length <= 0) {
+      return;
+    }
+
+    struct cmsghdr* header = CMSG_FIRSTHDR(&request);
+    if (header != NULL && header->cmsg_level == SOL_SOCKET &&
+        header->cmsg_type == SCM_RIGHTS) {
+      num_fds = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      memcpy(fds, CMSG_DATA(header), num_fds * sizeof(int));
+    }
+    pid_t reply = (num_fds == NUM_SPAWN_FDS && !(request.msg_flags & MSG_TRUNC))
+                      ? spawn_request(message, length, fds)
+                      : -EINVAL;
+    for (int i = 0; i < num_fds; i++) {
+      close(fds[i]);
+    }
+    if (send(fd, &reply, sizeof(reply), 0) == -1 && errno != EINTR) {
+      return;
+    }
+  }
+}
+
+int start_zygote(void) {
+  int fds[2];
+
+  if (zygote_fd != -1 && zygote_owner == getpid()) {
+    return 0;
+  }
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == -1) {
+    perror("socketpair error in start_zygote()");
+    return ZYGOTE_FAILURE;
+  }
+
+  flush_output();
+  pid_t process_id = fork();
+  if (process_id == -1) {
+    perror("fork error in start_zygote()");
+    close(fds[0]);
+    close(fds[1]);
+    return ZYGOTE_FAILURE;
+  }
+  if (process_id == 0) {
+    close(fds[0]);
+    run_zygote(fds[1]);
+    _exit(EXIT_SUCCESS);
+  }
+  close(fds[1]);
+
+  // Keep the socket clear of the descriptors redirections use.
+  if ((zygote_fd = fcntl(fds[0], F_DUPFD_CLOEXEC, SAVED_FD_MIN)) == -1) {
+    perror("fcntl error in start_zygote()");
+    zygote_fd = fds[0];
+  } else {
+    close(fds[0]);
+  }
+  zygote_process_id = process_id;
+  zygote_owner = getpid();
+  return 0;
+}
+
+void stop_zygote(void) {
+  // Only the process that started the zygote stops it. Children of the shell
+  // merely forget their copy of the socket.
+  if (zygote_fd == -1) {
+    return;
+  }
+  close(zygote_fd);
+  zygote_fd = -1;
+  if (zygote_owner == getpid()) {
+    while (waitpid(zygote_process_id, NULL, 0) == -1 && errno == EINTR) {
+    }
+  }
+  zygote_process_id = zygote_owner = -1;
+}
+
+void update_zygote(void) {
+  if (!zygote_enabled) {
+    stop_zygote();
+  } else if (start_zygote() == ZYGOTE_FAILURE) {
+    zygote_enabled = 0;
+  }
+}
+
+pid_t zygote_spawn(char** parsed_command) {
+  struct spawn_header_t header = {0, 0};
+  char* message;
+  size_t length = sizeof(header);
+
+  // Only the standard descriptors are sent, so commands with others
+  // redirected, as in "cmd 3>log", are forked.
+  if (!zygote_enabled || zygote_fd == -1 || zygote_owner != getpid() ||
+      high_fds_redirected()) {
+    return ZYGOTE_FAILURE;
+  }
+
+  // Lay out the header and strings, giving up on commands too large for one
+  // message.
+  for (char** string = parsed_command; *string != NULL; string++) {
+    length += strlen(*string) + 1;
+    header.argc++;
+  }
+  for (char** string = environ; *string != NULL; string++) {
+    length += strlen(*string) + 1;
+    header.envc++;
+  }
+  if (length > ZYGOTE_MESSAGE_SIZE || (message = malloc(length)) == NULL) {
+    return ZYGOTE_FAILURE;
+  }
+  memcpy(message, &header, sizeof(header));
+  char* next = message + sizeof(header);
+  for (char** string = parsed_command; *string != NULL; string++) {
+    next = stpcpy(next, *string) + 1;
+  }
+  for (char** string = environ; *string != NULL; string++) {
+    next = stpcpy(next, *string) + 1;
+  }
+
+  int fds[NUM_SPAWN_FDS] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO, -1};
+  if ((fds[NUM_SPAWN_FDS - 1] =
+           open(".", O_PATH | O_DIRECTORY | O_CLOEXEC)) == -1) {
+    free(message);
+    return ZYGOTE_FAILURE;
+  }
+  union {
+    struct cmsghdr header;
+    char space[CMSG_SPACE(sizeof(fds))];
+  } control;
+  struct iovec data = {message, length};
+  struct msghdr request;
+  memset(&request, 0, sizeof(request));
+  request.msg_iov = &data;
+  request.msg_iovlen = 1;
+  request.msg_control = control.space;
+  request.msg_controllen = sizeof(control.space);
+  struct cmsghdr* control_header = CMSG_FIRSTHDR(&request);
+  control_header->cmsg_level = SOL_SOCKET;
+  control_header->cmsg_type = SCM_RIGHTS;
+  control_header->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(control_header), fds, sizeof(fds));
+
+  ssize_t sent;
+  while ((sent = sendmsg(zygote_fd, &request, 0)) == -1 && errno == EINTR) {
+  }
+  close(fds[NUM_SPAWN_FDS - 1]);
+  free(message);
+
+  pid_t reply;
+  ssize_t received = -1;
+  if (sent != -1) {
+    while ((received = recv(zygote_fd, &reply, sizeof(reply), 0)) == -1 &&
+           errno == EINTR) {
+    }
+  }
+  if (received != sizeof(reply)) {
+    fprintf(stderr, "The zygote has exited; starting commands with fork().\n");
+    stop_zygote();
+    zygote_enabled = 0;
+    return ZYGOTE_FAILURE;
+  }
+  return (reply > 0) ? reply : ZYGOTE_FAILURE;
+}
@@ -0,0 +1,61 @@
+#ifndef ZYGOTE_UTILS_H
+#define ZYGOTE_UTILS_H
+
+#define ZYGOTE_ENV "SHELL_ZYGOTE"
+#define ZYGOTE_FAILURE -1
+#define ZYGOTE_MESSAGE_SIZE 65536
+
+#include <unistd.h>
+
+// Whether external commands are started by the zygote. Set by the zygote
+// option, or at startup by SHELL_ZYGOTE.
+extern int zygote_enabled;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// int start_zygote()
+// Description: Forks the zygote, a helper that starts external commands for
+// the shell. It is forked while the shell is still small, so forking from it
+// stays fast however large the shell grows. The commands it starts are
+// children of the shell.
+// Preconditions: None.
+// Postconditions: The zygote runs and serves spawn requests from this
+// process. A zygote already running is kept.
+// Return: 0 on success, -1 on failure.
+extern int start_zygote(void);
+
+// void stop_zygote()
+// Description: Stops the zygote. Commands it started keep running.
+// Preconditions: None.
+// Postconditions: The zygote has exited and been reaped.
+// Return: None.
+extern void stop_zygote(void);
+
+// void update_zygote()
+// Description: Starts or stops the zygote to match zygote_enabled.
+// Preconditions: None.
+// Postconditions: The zygote runs if and only if zygote_enabled is set, or
+// zygote_enabled is cleared if it cannot be started.
+// Return: None.
+extern void update_zygote(void);
+
+// pid_t zygote_spawn(char**)
+// Description: Starts an external command through the zygote, with the
+// shell's standard descriptors, working directory and environment.
+// Preconditions: A non-null, NULL-terminated argument vector is provided.
+// Output is flushed.
+// Postconditions: The command runs as a child of the shell. Nothing is
+// started if the zygote is off, belongs to another process or has exited,
+// the command redirects a descriptor above standard error, or it is too
+// large to send.
+// Return: The process id of the command, or -1 if the caller should fork
+// instead.
+extern pid_t zygote_spawn(char**);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZYGOTE_UTILS_H